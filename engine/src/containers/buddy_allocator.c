@@ -0,0 +1,437 @@
+#include "buddy_allocator.h"
+
+#include "core/lmemory.h"
+#include "core/logger.h"
+
+// Internal state of the buddy allocator. Directly followed in memory by the largest free
+// order table (one byte per node), then the allocated bitmap (one bit per node).
+typedef struct internal_state {
+    u64 total_size;
+    u64 min_block_size;
+    // log2(min_block_size).
+    u32 min_shift;
+    // The order of the root block. Blocks of order k are min_block_size << k bytes.
+    u32 max_order;
+    u64 node_count;
+
+    // Maintained counters.
+    u64 free_space;
+    u64 allocation_count;
+    u64 allocated_bytes;
+    u64 requested_bytes;
+
+    // For each node, 1 + the order of the largest free block beneath it, or 0 if there is none.
+    // Only kept up to date along paths which have been walked; the children of a node which is
+    // entirely free are stale until it is split (see push_down).
+    u8* longest;
+    // One bit per node, set for each block handed out.
+    u8* allocated;
+} internal_state;
+
+// Private functions
+static u64 state_memory_requirement(u64 total_size, u64 min_block_size, u32* out_max_order, u64* out_node_count);
+static void setup_state(internal_state* state, u64 total_size, u64 min_block_size, u32 max_order, u64 node_count);
+static void init_node(internal_state* state, u64 index, u32 order, u64 start);
+static void push_down(internal_state* state, u64 index, u32 order);
+static void update_up(internal_state* state, u64 index, u32 order);
+static void take_node(internal_state* state, u64 index, u32 order);
+static void mark_allocated(internal_state* state, u32 order, u64 offset);
+static b8 find_last_allocated(internal_state* state, u64 index, u32 order, u64 start, u64 below, u64* out_index, u32* out_order);
+
+LINLINE u32 ceil_log2(u64 value) {
+    return value <= 1 ? 0 : 64 - __builtin_clzll(value - 1);
+}
+
+LINLINE u64 node_index(internal_state* state, u32 order, u64 offset) {
+    u32 depth = state->max_order - order;
+    return ((1ull << depth) - 1) + (offset >> (state->min_shift + order));
+}
+
+LINLINE b8 is_allocated(internal_state* state, u64 index) {
+    return (state->allocated[index >> 3] >> (index & 7)) & 1;
+}
+
+LINLINE void set_allocated(internal_state* state, u64 index, b8 value) {
+    if (value) {
+        state->allocated[index >> 3] |= (u8)(1 << (index & 7));
+    } else {
+        state->allocated[index >> 3] &= (u8)~(1 << (index & 7));
+    }
+}
+
+// Combines the children of a node of order child_order + 1. Two entirely free buddies make an entirely free parent.
+LINLINE u8 combine(u8 left, u8 right, u32 child_order) {
+    if (left == child_order + 1 && right == child_order + 1) {
+        return (u8)(child_order + 2);
+    }
+    return left > right ? left : right;
+}
+
+// The order of the block needed for the given size and alignment.
+LINLINE u32 block_order(internal_state* state, u64 size, u64 alignment) {
+    u32 shift = ceil_log2(size);
+    if (alignment > 1 && ceil_log2(alignment) > shift) {
+        shift = ceil_log2(alignment);
+    }
+    return shift > state->min_shift ? shift - state->min_shift : 0;
+}
+
+b8 buddy_allocator_create(u64 total_size, u64 min_block_size, u64* memory_requirement, void* memory, buddy_allocator* out_allocator)
+{
+    if (!memory_requirement) {
+        LERROR("buddy_allocator_create requires a pointer to hold the memory requirement.");
+        return false;
+    }
+
+    if (!min_block_size || (min_block_size & (min_block_size - 1)) || min_block_size > total_size) {
+        LERROR("buddy_allocator_create - min_block_size must be a power of two no larger than total_size (got %llu, total %llu).", min_block_size, total_size);
+        return false;
+    }
+
+    u32 max_order = 0;
+    u64 node_count = 0;
+    *memory_requirement = state_memory_requirement(total_size, min_block_size, &max_order, &node_count);
+    if (!memory) {
+        return true;
+    }
+
+    if (!out_allocator) {
+        LERROR("buddy_allocator_create requires a pointer to hold the allocator.");
+        return false;
+    }
+
+    lzero_memory(memory, *memory_requirement);
+    out_allocator->memory = memory;
+    setup_state(memory, total_size, min_block_size, max_order, node_count);
+    return true;
+}
+
+void buddy_allocator_destroy(buddy_allocator* allocator)
+{
+    if (!allocator || !allocator->memory) {
+        return;
+    }
+
+    internal_state* state = allocator->memory;
+    lzero_memory(allocator->memory, state_memory_requirement(state->total_size, state->min_block_size, 0, 0));
+    allocator->memory = 0;
+}
+
+u64 buddy_allocator_block_size(buddy_allocator* allocator, u64 size, u64 alignment)
+{
+    if (!allocator || !allocator->memory) {
+        return 0;
+    }
+
+    internal_state* state = allocator->memory;
+    return state->min_block_size << block_order(state, size, alignment);
+}
+
+b8 buddy_allocator_allocate(buddy_allocator* allocator, u64 size, u64 alignment, u64* out_offset)
+{
+    if (!allocator || !allocator->memory || !size || !out_offset) {
+        return false;
+    }
+
+    if (alignment & (alignment - 1)) {
+        LERROR("buddy_allocator_allocate - alignment must be a power of two (got %llu).", alignment);
+        return false;
+    }
+
+    internal_state* state = allocator->memory;
+    u32 order = block_order(state, size, alignment);
+    if (order > state->max_order || state->longest[0] < order + 1) {
+        return false;
+    }
+
+    // Walk down to a free block of the right order, taking the lower half whenever it has room.
+    u64 index = 0;
+    u32 current = state->max_order;
+    while (current > order) {
+        push_down(state, index, current);
+        u64 left = (index * 2) + 1;
+        index = state->longest[left] >= order + 1 ? left : left + 1;
+        current--;
+    }
+
+    take_node(state, index, order);
+    state->requested_bytes += size;
+
+    u32 depth = state->max_order - order;
+    *out_offset = (index - ((1ull << depth) - 1)) << (state->min_shift + order);
+    return true;
+}
+
+b8 buddy_allocator_free(buddy_allocator* allocator, u64 size, u64 offset)
+{
+    if (!allocator || !allocator->memory || !size) {
+        return false;
+    }
+
+    internal_state* state = allocator->memory;
+    if (offset + size > state->total_size || (offset & (state->min_block_size - 1))) {
+        LERROR("buddy_allocator_free - invalid block (offset %llu, size %llu) for an allocator of %lluB.", offset, size, state->total_size);
+        return false;
+    }
+
+    // The block may have been rounded up past size for alignment, so look for it from the
+    // smallest order which could hold size upwards, while the offset stays aligned to the block.
+    for (u32 order = block_order(state, size, 0); order <= state->max_order; ++order) {
+        if (offset & ((state->min_block_size << order) - 1)) {
+            break;
+        }
+
+        u64 index = node_index(state, order, offset);
+        if (is_allocated(state, index)) {
+            u64 block_size = state->min_block_size << order;
+            set_allocated(state, index, false);
+            state->longest[index] = (u8)(order + 1);
+            update_up(state, index, order);
+
+            state->free_space += block_size;
+            state->allocated_bytes -= block_size;
+            state->requested_bytes -= size;
+            state->allocation_count--;
+            return true;
+        }
+    }
+
+    LWARN("buddy_allocator_free - no block allocated at offset %llu for size %llu. Possible double free?", offset, size);
+    return false;
+}
+
+b8 buddy_allocator_resize(buddy_allocator* allocator, u64* memory_requirement, void* new_memory, u64 new_size, void** out_old_memory)
+{
+    if (!allocator || !allocator->memory || !memory_requirement) {
+        return false;
+    }
+
+    internal_state* old_state = allocator->memory;
+    u32 max_order = 0;
+    u64 node_count = 0;
+    *memory_requirement = state_memory_requirement(new_size, old_state->min_block_size, &max_order, &node_count);
+    if (!new_memory) {
+        return true;
+    }
+
+    if (old_state->total_size > new_size || !out_old_memory) {
+        return false;
+    }
+
+    lzero_memory(new_memory, *memory_requirement);
+    internal_state* state = new_memory;
+    setup_state(state, new_size, old_state->min_block_size, max_order, node_count);
+
+    // Take the same blocks in the new tree. Offsets are unchanged, as are the orders.
+    for (u64 index = 0; index < old_state->node_count; ++index) {
+        if (is_allocated(old_state, index)) {
+            u32 depth = 63 - __builtin_clzll(index + 1);
+            u32 order = old_state->max_order - depth;
+            u64 offset = (index - ((1ull << depth) - 1)) << (old_state->min_shift + order);
+            mark_allocated(state, order, offset);
+        }
+    }
+    state->requested_bytes = old_state->requested_bytes;
+
+    *out_old_memory = allocator->memory;
+    allocator->memory = new_memory;
+    return true;
+}
+
+void buddy_allocator_clear(buddy_allocator* allocator)
+{
+    if (!allocator || !allocator->memory) {
+        return;
+    }
+
+    internal_state* state = allocator->memory;
+    lzero_memory(state->longest, state->node_count + ((state->node_count + 7) / 8));
+    setup_state(state, state->total_size, state->min_block_size, state->max_order, state->node_count);
+}
+
+u32 buddy_allocator_compact_step(buddy_allocator* allocator, u64* cursor, u64 max_bytes, buddy_allocator_move* out_moves, u32 max_moves)
+{
+    if (!allocator || !allocator->memory || !cursor || !out_moves) {
+        return 0;
+    }
+
+    internal_state* state = allocator->memory;
+    u32 move_count = 0;
+    u64 moved_bytes = 0;
+    while (*cursor && move_count < max_moves && moved_bytes < max_bytes) {
+        u64 index = 0;
+        u32 order = 0;
+        if (!find_last_allocated(state, 0, state->max_order, 0, *cursor, &index, &order)) {
+            // Nothing left below the cursor, so the pass is complete.
+            *cursor = 0;
+            break;
+        }
+
+        u32 depth = state->max_order - order;
+        u64 offset = (index - ((1ull << depth) - 1)) << (state->min_shift + order);
+        u64 block_size = state->min_block_size << order;
+        *cursor = offset;
+
+        // Take the lowest free block of the same size. Only worth keeping if it is lower.
+        u64 new_offset = 0;
+        if (!buddy_allocator_allocate(allocator, block_size, 0, &new_offset)) {
+            continue;
+        }
+        if (new_offset > offset) {
+            buddy_allocator_free(allocator, block_size, new_offset);
+            continue;
+        }
+
+        out_moves[move_count].old_offset = offset;
+        out_moves[move_count].new_offset = new_offset;
+        out_moves[move_count].size = block_size;
+        move_count++;
+        moved_bytes += block_size;
+    }
+
+    return move_count;
+}
+
+b8 buddy_allocator_get_stats(buddy_allocator* allocator, buddy_allocator_stats* out_stats)
+{
+    if (!allocator || !allocator->memory || !out_stats) {
+        return false;
+    }
+
+    internal_state* state = allocator->memory;
+    out_stats->total_size = state->total_size;
+    out_stats->total_free = state->free_space;
+    out_stats->largest_free_block = state->longest[0] ? state->min_block_size << (state->longest[0] - 1) : 0;
+    out_stats->allocation_count = state->allocation_count;
+    out_stats->allocated_bytes = state->allocated_bytes;
+    out_stats->requested_bytes = state->requested_bytes;
+    out_stats->internal_waste = state->allocated_bytes - state->requested_bytes;
+    out_stats->waste_ratio = state->allocated_bytes ? (f32)out_stats->internal_waste / (f32)state->allocated_bytes : 0.0f;
+    out_stats->fragmentation = state->free_space ? 1.0f - ((f32)out_stats->largest_free_block / (f32)state->free_space) : 0.0f;
+    return true;
+}
+
+// Private functions
+
+static u64 state_memory_requirement(u64 total_size, u64 min_block_size, u32* out_max_order, u64* out_node_count)
+{
+    // The tree spans the next power of two up from total_size. Anything past total_size is never free.
+    u32 max_order = ceil_log2(total_size) - (63 - __builtin_clzll(min_block_size));
+    u64 node_count = (2ull << max_order) - 1;
+    if (out_max_order) {
+        *out_max_order = max_order;
+    }
+    if (out_node_count) {
+        *out_node_count = node_count;
+    }
+    return sizeof(internal_state) + node_count + ((node_count + 7) / 8);
+}
+
+static void setup_state(internal_state* state, u64 total_size, u64 min_block_size, u32 max_order, u64 node_count)
+{
+    state->total_size = total_size;
+    state->min_block_size = min_block_size;
+    state->min_shift = 63 - __builtin_clzll(min_block_size);
+    state->max_order = max_order;
+    state->node_count = node_count;
+    state->free_space = 0;
+    state->allocation_count = 0;
+    state->allocated_bytes = 0;
+    state->requested_bytes = 0;
+    state->longest = (u8*)(state + 1);
+    state->allocated = state->longest + node_count;
+
+    // Only nodes straddling the end of the range are visited; everything else is left to push_down.
+    init_node(state, 0, max_order, 0);
+}
+
+static void init_node(internal_state* state, u64 index, u32 order, u64 start)
+{
+    u64 size = state->min_block_size << order;
+    if (start + size <= state->total_size) {
+        state->longest[index] = (u8)(order + 1);
+        state->free_space += size;
+        return;
+    }
+
+    if (start >= state->total_size || order == 0) {
+        state->longest[index] = 0;
+        return;
+    }
+
+    u64 left = (index * 2) + 1;
+    init_node(state, left, order - 1, start);
+    init_node(state, left + 1, order - 1, start + (size / 2));
+    state->longest[index] = combine(state->longest[left], state->longest[left + 1], order - 1);
+}
+
+static void push_down(internal_state* state, u64 index, u32 order)
+{
+    // An entirely free node is about to be split, so its children are entirely free too.
+    if (state->longest[index] == order + 1) {
+        u64 left = (index * 2) + 1;
+        state->longest[left] = (u8)order;
+        state->longest[left + 1] = (u8)order;
+    }
+}
+
+static void update_up(internal_state* state, u64 index, u32 order)
+{
+    while (index) {
+        u64 parent = (index - 1) / 2;
+        u64 left = (parent * 2) + 1;
+        state->longest[parent] = combine(state->longest[left], state->longest[left + 1], order);
+        index = parent;
+        order++;
+    }
+}
+
+static void take_node(internal_state* state, u64 index, u32 order)
+{
+    u64 block_size = state->min_block_size << order;
+    state->longest[index] = 0;
+    set_allocated(state, index, true);
+    update_up(state, index, order);
+
+    state->free_space -= block_size;
+    state->allocated_bytes += block_size;
+    state->allocation_count++;
+}
+
+static void mark_allocated(internal_state* state, u32 order, u64 offset)
+{
+    // Walk down the path to the block, as given by the bits of its offset.
+    u64 index = 0;
+    u32 current = state->max_order;
+    while (current > order) {
+        push_down(state, index, current);
+        index = (index * 2) + 1 + ((offset >> (state->min_shift + current - 1)) & 1);
+        current--;
+    }
+
+    take_node(state, index, order);
+}
+
+// Finds the allocated block with the highest offset below the given one, searching the upper half of each node first.
+static b8 find_last_allocated(internal_state* state, u64 index, u32 order, u64 start, u64 below, u64* out_index, u32* out_order)
+{
+    if (start >= below || start >= state->total_size) {
+        return false;
+    }
+
+    if (is_allocated(state, index)) {
+        *out_index = index;
+        *out_order = order;
+        return true;
+    }
+
+    // Nothing is allocated beneath an entirely free node. Its children may be stale, so are not looked at.
+    if (order == 0 || state->longest[index] == order + 1) {
+        return false;
+    }
+
+    u64 left = (index * 2) + 1;
+    u64 half = state->min_block_size << (order - 1);
+    return find_last_allocated(state, left + 1, order - 1, start + half, below, out_index, out_order) ||
+           find_last_allocated(state, left, order - 1, start, below, out_index, out_order);
+}
@@ -0,0 +1,179 @@
+/**
+ * @file buddy_allocator.h
+ *
+ * @brief Definition of the buddy allocator, used to track allocations within a range by offset
+ * using power-of-two size classes.
+ * @version 0.1
+ * @date 2024-05-23
+ *
+ */
+
+#pragma once
+#include "defines.h"
+
+/*
+Buddy allocator:
+
+    The range is split in halves, quarters and so on down to a minimum block size. Each
+    allocation is rounded up to the nearest power-of-two block, and blocks are always
+    placed at a multiple of their own size, so every offset handed out is aligned to the
+    block size. Freeing a block merges it with its buddy (the other half of its parent)
+    whenever both are free, so the range cannot fragment into unusably small pieces the
+    way a first fit freelist can.
+
+    The tree of blocks is stored as an implicit binary heap holding, for each node, the
+    largest block free beneath it. Allocate and free both walk a single path between the
+    root and a node, so are O(log n) in the number of minimum sized blocks.
+
+    The cost is internal waste: the difference between the size asked for and the block
+    handed out, which is at most just under half the block. It is reported in the stats.
+
+    Like the freelist, this only tracks offsets. It does not own or touch the memory (or
+    GPU buffer) being allocated from.
+ */
+
+/**
+ * @brief A buddy allocator. Tracks allocated blocks within a range of memory by offset.
+ */
+typedef struct buddy_allocator {
+    /** @brief The internal state of the allocator. */
+    void* memory;
+} buddy_allocator;
+
+/**
+ * @brief A snapshot of the state of a buddy allocator.
+ */
+typedef struct buddy_allocator_stats {
+    /** @brief The total size in bytes being tracked. */
+    u64 total_size;
+    /** @brief The total amount of free space in bytes. */
+    u64 total_free;
+    /** @brief The size of the largest block which can currently be allocated, in bytes. */
+    u64 largest_free_block;
+    /** @brief The number of live allocations. */
+    u64 allocation_count;
+    /** @brief The total size of the blocks handed out, in bytes. */
+    u64 allocated_bytes;
+    /** @brief The total size asked for by live allocations, in bytes. */
+    u64 requested_bytes;
+    /** @brief The bytes lost to rounding allocations up to their block size; allocated_bytes - requested_bytes. */
+    u64 internal_waste;
+    /** @brief The share of allocated bytes which are internal waste, 0 (none) to 1. */
+    f32 waste_ratio;
+    /** @brief The share of free space unusable for a single allocation, 0 (none) to 1. Computed as 1 - largest/total. */
+    f32 fragmentation;
+} buddy_allocator_stats;
+
+/**
+ * @brief A block moved by buddy_allocator_compact_step.
+ */
+typedef struct buddy_allocator_move {
+    /** @brief The offset the block was at. Still allocated until the caller frees it. */
+    u64 old_offset;
+    /** @brief The offset the block has been given. */
+    u64 new_offset;
+    /** @brief The size in bytes of the block. */
+    u64 size;
+} buddy_allocator_move;
+
+/**
+ * @brief Creates a new buddy allocator or obtains the memory requirement for one. Should be called twice;
+ * once passing 0 to memory to obtain the memory requirement, then a second time passing an allocated block.
+ * Any part of total_size beyond the last whole minimum block can never be handed out.
+ *
+ * @param total_size The total size in bytes that the allocator should track.
+ * @param min_block_size The size in bytes of the smallest block. Must be a power of two, and no larger than total_size.
+ * Every offset handed out is a multiple of it, so it should be at least the alignment needed by the memory's users.
+ * @param memory_requirement A pointer to hold the memory requirement of the internal state. This grows with total_size / min_block_size.
+ * @param memory 0; or a pre-allocated block of memory for the internal state.
+ * @param out_allocator A pointer to hold the created allocator.
+ * @return True on success; otherwise false.
+ */
+LAPI b8 buddy_allocator_create(u64 total_size, u64 min_block_size, u64* memory_requirement, void* memory, buddy_allocator* out_allocator);
+
+/**
+ * @brief Destroys the provided allocator. The memory passed to create is not freed.
+ *
+ * @param allocator A pointer to the allocator to be destroyed.
+ */
+LAPI void buddy_allocator_destroy(buddy_allocator* allocator);
+
+/**
+ * @brief Obtains the size of the block which would be handed out for the given size and alignment.
+ *
+ * @param allocator A pointer to the allocator.
+ * @param size The size in bytes to be allocated.
+ * @param alignment The alignment required of the offset. Must be a power of two, or 0 for none.
+ * @return The block size in bytes; 0 if the allocator is invalid.
+ */
+LAPI u64 buddy_allocator_block_size(buddy_allocator* allocator, u64 size, u64 alignment);
+
+/**
+ * @brief Attempts to allocate a block of at least the given size, whose offset is a multiple of the given
+ * alignment. The lowest free offset which fits is used.
+ *
+ * @param allocator A pointer to the allocator.
+ * @param size The size in bytes to be allocated.
+ * @param alignment The alignment required of the offset. Must be a power of two, or 0 for none.
+ * @param out_offset A pointer to hold the offset of the allocated block.
+ * @return True if a block was found and allocated; otherwise false.
+ */
+LAPI b8 buddy_allocator_allocate(buddy_allocator* allocator, u64 size, u64 alignment, u64* out_offset);
+
+/**
+ * @brief Frees the block allocated at the given offset. Any alignment passed to allocate need not be passed again.
+ *
+ * @param allocator A pointer to the allocator.
+ * @param size The size in bytes which was passed to allocate.
+ * @param offset The offset of the block.
+ * @return True if successful; otherwise false. False should be treated as an error.
+ */
+LAPI b8 buddy_allocator_free(buddy_allocator* allocator, u64 size, u64 offset);
+
+/**
+ * @brief Attempts to resize the provided allocator to the given size, keeping all live allocations at their
+ * offsets. Should be called twice; once to query the memory requirement (passing new_memory=0), and a second
+ * time to actually resize. The old block of memory must be freed after this call.
+ *
+ * @param allocator A pointer to the allocator to be resized.
+ * @param memory_requirement A pointer to hold the amount of memory required for the resize.
+ * @param new_memory The new block of state memory. Set to 0 if only querying memory_requirement.
+ * @param new_size The new size. Must be greater than the size of the provided allocator.
+ * @param out_old_memory A pointer to hold the old block of memory so that it may be freed after this call.
+ * @return True on success; otherwise false.
+ */
+LAPI b8 buddy_allocator_resize(buddy_allocator* allocator, u64* memory_requirement, void* new_memory, u64 new_size, void** out_old_memory);
+
+/**
+ * @brief Frees every allocation at once.
+ *
+ * @param allocator A pointer to the allocator to be cleared.
+ */
+LAPI void buddy_allocator_clear(buddy_allocator* allocator);
+
+/**
+ * @brief Performs part of a compaction pass, which moves allocated blocks into the lowest free blocks of
+ * the same size so free space gathers into large blocks at the top of the range. Blocks are walked from the
+ * highest offset down, starting below the cursor. For each block moved a new block is allocated, and the old
+ * one is left allocated so the caller can copy the contents over and free it (with the move's size) once
+ * nothing refers to it any more.
+ *
+ * @param allocator A pointer to the allocator.
+ * @param cursor A pointer to the offset to continue the pass from. Set to the allocator's total size to begin
+ * a pass. Updated as blocks are walked; set to 0 once the pass is complete.
+ * @param max_bytes The most bytes to move in this step.
+ * @param out_moves An array to hold the moves made.
+ * @param max_moves The capacity of out_moves.
+ * @return The number of moves made.
+ */
+LAPI u32 buddy_allocator_compact_step(buddy_allocator* allocator, u64* cursor, u64 max_bytes, buddy_allocator_move* out_moves, u32 max_moves);
+
+/**
+ * @brief Obtains statistics about the allocator, including internal waste. All are maintained
+ * counters, so this is cheap to call.
+ *
+ * @param allocator A pointer to the allocator.
+ * @param out_stats A pointer to hold the statistics.
+ * @return True on success; otherwise false.
+ */
+LAPI b8 buddy_allocator_get_stats(buddy_allocator* allocator, buddy_allocator_stats* out_stats);
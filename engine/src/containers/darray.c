@@ -1,16 +1,49 @@
 #include "darray.h"
 #include "core/lmemory.h"
 #include "core/logger.h"
+#include "memory/allocator.h"
+
+#include <string.h>
+
+// Private functions
+static void* set_capacity(void* array, u64 new_capacity);
+static void* grow_to_fit(void* array, u64 required);
+
+LINLINE u64* header_of(void* array)
+{
+    return (u64*)array - DARRAY_FIELD_LENGTH;
+}
 
 void* _darray_create(u64 length, u64 stride)
 {
     u64 header_size = DARRAY_FIELD_LENGTH * sizeof(u64);
     u64 array_size = length * stride;
+    // NOTE: lallocate already zeroes the block.
     u64* new_array = lallocate(header_size + array_size, MEMORY_TAG_DARRAY);
-    lset_memory(new_array, 0, header_size + array_size);
     new_array[DARRAY_CAPACITY] = length;
     new_array[DARRAY_LENGTH] = 0;
     new_array[DARRAY_STRIDE] = stride;
+    new_array[DARRAY_ALLOCATOR] = 0;
+    return (void*)(new_array + DARRAY_FIELD_LENGTH);
+}
+
+void* _darray_create_with_allocator(u64 length, u64 stride, const allocator_interface* allocator)
+{
+    if (!allocator) {
+        return _darray_create(length, stride);
+    }
+
+    u64 header_size = DARRAY_FIELD_LENGTH * sizeof(u64);
+    u64 array_size = length * stride;
+    u64* new_array = allocator_allocate(allocator, header_size + array_size, LMEMORY_DEFAULT_ALIGNMENT);
+    if (!new_array) {
+        LERROR("_darray_create_with_allocator - allocator failed to provide %lluB.", header_size + array_size);
+        return 0;
+    }
+    new_array[DARRAY_CAPACITY] = length;
+    new_array[DARRAY_LENGTH] = 0;
+    new_array[DARRAY_STRIDE] = stride;
+    new_array[DARRAY_ALLOCATOR] = (u64)allocator;
     return (void*)(new_array + DARRAY_FIELD_LENGTH);
 }
 
@@ -19,7 +52,12 @@ void _darray_destroy(void* array)
     u64* header = (u64*)array - DARRAY_FIELD_LENGTH;
     u64 header_size = DARRAY_FIELD_LENGTH * sizeof(u64);
     u64 total_size = header_size + header[DARRAY_CAPACITY] * header[DARRAY_STRIDE];
-    lfree(header, total_size, MEMORY_TAG_DARRAY);
+    const allocator_interface* allocator = (const allocator_interface*)header[DARRAY_ALLOCATOR];
+    if (allocator) {
+        allocator_free(allocator, header, total_size, LMEMORY_DEFAULT_ALIGNMENT);
+    } else {
+        lfree(header, total_size, MEMORY_TAG_DARRAY);
+    }
 }
 
 
@@ -37,95 +75,196 @@ void _darray_field_set(void* array, u64 field, u64 value)
 
 void* _darray_resize(void* array) 
 {
-    u64 length = darray_length(array);
-    u64 stride = darray_stride(array);
-    void* temp = _darray_create(
-        DARRAY_RESIZE_FACTOR * darray_capacity(array),
-        stride);
-    lcopy_memory(temp, array, length * stride);
-
-    _darray_field_set(temp, DARRAY_LENGTH, length);
-    _darray_destroy(array);
-    return temp;
+    u64 capacity = darray_capacity(array);
+    return set_capacity(array, capacity ? DARRAY_RESIZE_FACTOR * capacity : DARRAY_DEFAULT_CAPACITY);
 }
 
 
 void* _darray_push(void* array, const void* value_ptr)
 {
-    u64 length = darray_length(array);
-    u64 stride = darray_stride(array);
-    if (length >= darray_capacity(array)) {
-        array = _darray_resize(array);
+    u64* header = header_of(array);
+    u64 length = header[DARRAY_LENGTH];
+    if (length >= header[DARRAY_CAPACITY]) {
+        array = grow_to_fit(array, length + 1);
+        header = header_of(array);
+        if (length >= header[DARRAY_CAPACITY]) {
+            return array;
+        }
     }
 
-    u64 addr = (u64) array;
-    addr += (length * stride);
-    lcopy_memory((void*)addr, value_ptr, stride);
-    _darray_field_set(array, DARRAY_LENGTH, length + 1);
+    u64 stride = header[DARRAY_STRIDE];
+    lcopy_memory((u8*)array + (length * stride), value_ptr, stride);
+    header[DARRAY_LENGTH] = length + 1;
     return array;
 }
 
 void _darray_pop(void* array, void* dest)
 {
-    u64 length = darray_length(array);
-    u64 stride = darray_stride(array);
-    u64 addr = (u64)array;
-    addr += ((length - 1) * stride);
-    lcopy_memory(dest, (void*)addr, stride);
-    _darray_field_set(array, DARRAY_LENGTH, length - 1);
+    u64* header = header_of(array);
+    u64 length = header[DARRAY_LENGTH];
+    u64 stride = header[DARRAY_STRIDE];
+    lcopy_memory(dest, (u8*)array + ((length - 1) * stride), stride);
+    header[DARRAY_LENGTH] = length - 1;
 }
 
 void* _darray_pop_at(void* array, u64 index, void* dest)
 {
-    u64 length = darray_length(array);
-    u64 stride = darray_stride(array);
+    u64* header = header_of(array);
+    u64 length = header[DARRAY_LENGTH];
+    u64 stride = header[DARRAY_STRIDE];
 
     if (index >= length) {
-        LERROR("Index outside the bounds of this array! Length: %i, index: %index", length, index);
+        LERROR("Index outside the bounds of this array! Length: %llu, index: %llu", length, index);
         return array;
     }
 
-    u64 addr = (u64) array;
-    lcopy_memory(dest, (void*)(addr + (index * stride)), stride);
+    u8* element = (u8*)array + (index * stride);
+    lcopy_memory(dest, element, stride);
 
-    // If not on the last element, snip out the entry and copy the rest inward.
-    if (index != length - 1) {
-        lcopy_memory(
-            (void*)(addr + (index * stride)),
-            (void*)(addr + ((index + 1) * stride)),
-            stride * (length - index)
-        );
-    }
+    // Snip out the entry and move the rest inward. The ranges overlap.
+    memmove(element, element + stride, stride * (length - index - 1));
 
-    _darray_field_set(array, DARRAY_LENGTH, length - 1);
+    header[DARRAY_LENGTH] = length - 1;
     return array;
 }
 
 void* _darray_insert_at(void* array, u64 index, void* value_ptr)
+{
+    u64* header = header_of(array);
+    u64 length = header[DARRAY_LENGTH];
+    if (index > length) {
+        LERROR("Index outside the bounds of this array! Length: %llu, index: %llu", length, index);
+        return array;
+    }
+    if (length >= header[DARRAY_CAPACITY]) {
+        array = grow_to_fit(array, length + 1);
+        header = header_of(array);
+        if (length >= header[DARRAY_CAPACITY]) {
+            return array;
+        }
+    }
+
+    u64 stride = header[DARRAY_STRIDE];
+    u8* element = (u8*)array + (index * stride);
+
+    // Move the rest outward. The ranges overlap.
+    memmove(element + stride, element, stride * (length - index));
+
+    // Set the value at the index
+    lcopy_memory(element, value_ptr, stride);
+
+    header[DARRAY_LENGTH] = length + 1;
+    return array;
+}
+
+void* _darray_push_n(void* array, const void* values, u64 count)
+{
+    u64* header = header_of(array);
+    u64 length = header[DARRAY_LENGTH];
+    if (length + count > header[DARRAY_CAPACITY]) {
+        array = grow_to_fit(array, length + count);
+        header = header_of(array);
+        if (length + count > header[DARRAY_CAPACITY]) {
+            return array;
+        }
+    }
+
+    u64 stride = header[DARRAY_STRIDE];
+    lcopy_memory((u8*)array + (length * stride), values, count * stride);
+    header[DARRAY_LENGTH] = length + count;
+    return array;
+}
+
+void* _darray_resize_uninit(void* array, u64 length)
+{
+    if (length > darray_capacity(array)) {
+        array = grow_to_fit(array, length);
+        if (length > darray_capacity(array)) {
+            return array;
+        }
+    }
+
+    header_of(array)[DARRAY_LENGTH] = length;
+    return array;
+}
+
+void* _darray_reserve_exact(void* array, u64 capacity)
+{
+    if (capacity <= darray_capacity(array)) {
+        return array;
+    }
+    return set_capacity(array, capacity);
+}
+
+void* _darray_shrink_to_fit(void* array)
 {
     u64 length = darray_length(array);
-    u64 stride = darray_stride(array);
-    if (index >= length) {
-        LERROR("Index outside the bounds of this array! Length: %i, index: %index", length, index);
+    u64 capacity = length > DARRAY_DEFAULT_CAPACITY ? length : DARRAY_DEFAULT_CAPACITY;
+    if (capacity >= darray_capacity(array)) {
         return array;
     }
-    if (length >= darray_capacity(array)) {
-        array = _darray_resize(array);
+    return set_capacity(array, capacity);
+}
+
+void _darray_swap_remove(void* array, u64 index, void* dest)
+{
+    u64* header = header_of(array);
+    u64 length = header[DARRAY_LENGTH];
+    u64 stride = header[DARRAY_STRIDE];
+
+    if (index >= length) {
+        LERROR("Index outside the bounds of this array! Length: %llu, index: %llu", length, index);
+        return;
     }
 
-    u64 addr = (u64)array;
+    u8* element = (u8*)array + (index * stride);
+    if (dest) {
+        lcopy_memory(dest, element, stride);
+    }
 
-    // If not on the last element, copy the rest outward.
+    // Fill the hole with the last element, unless it is the last element.
     if (index != length - 1) {
-        lcopy_memory(
-            (void*)(addr + ((index + 1) * stride)),
-            (void*)(addr + (index * stride)),
-            stride * (length - index));
+        lcopy_memory(element, (u8*)array + ((length - 1) * stride), stride);
     }
 
-    // Set the value at the index
-    lcopy_memory((void*)(addr + (index * stride)), value_ptr, stride);
+    header[DARRAY_LENGTH] = length - 1;
+}
 
-    _darray_field_set(array, DARRAY_LENGTH, length + 1);
-    return array;
+// Private functions
+
+static void* set_capacity(void* array, u64 new_capacity)
+{
+    // Resized in place when the memory after the array allows, so the elements usually stay put.
+    // NOTE: The space past the length is uninitialized after growing.
+    u64* header = header_of(array);
+    u64 header_size = DARRAY_FIELD_LENGTH * sizeof(u64);
+    u64 stride = header[DARRAY_STRIDE];
+    u64 size = header_size + (header[DARRAY_CAPACITY] * stride);
+    u64 new_size = header_size + (new_capacity * stride);
+    const allocator_interface* allocator = (const allocator_interface*)header[DARRAY_ALLOCATOR];
+    u64* new_header = 0;
+    if (allocator) {
+        new_header = allocator_reallocate(allocator, header, size, new_size, LMEMORY_DEFAULT_ALIGNMENT);
+    } else {
+        new_header = lreallocate(header, size, new_size, MEMORY_TAG_DARRAY);
+    }
+    if (!new_header) {
+        // Leave the array as it was. Callers check the capacity to tell.
+        LERROR("darray - failed to resize to %lluB.", new_size);
+        return array;
+    }
+
+    new_header[DARRAY_CAPACITY] = new_capacity;
+    return (void*)(new_header + DARRAY_FIELD_LENGTH);
+}
+
+static void* grow_to_fit(void* array, u64 required)
+{
+    // Grow geometrically, unless more than that is needed at once.
+    u64 capacity = darray_capacity(array);
+    u64 new_capacity = capacity ? DARRAY_RESIZE_FACTOR * capacity : DARRAY_DEFAULT_CAPACITY;
+    if (new_capacity < required) {
+        new_capacity = required;
+    }
+    return set_capacity(array, new_capacity);
 }
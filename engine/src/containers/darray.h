@@ -7,17 +7,24 @@ Memory layout
 u64 capacity = number of elements that can be held
 u64 length = number of elements currently contained
 u64 stride - size of each element in bytes
+u64 allocator - the allocator_interface* the array was created with, or 0 for lallocate
 void* elements
 */
 
+struct allocator_interface;
+
 enum{
     DARRAY_CAPACITY,
     DARRAY_LENGTH,
     DARRAY_STRIDE,
+    DARRAY_ALLOCATOR,
     DARRAY_FIELD_LENGTH
 };
 
 LAPI void* _darray_create(u64 length, u64 stride);
+// Same as _darray_create, but all memory comes from the given allocator, which must outlive the array.
+// Returns 0 if the allocator is out of memory.
+LAPI void* _darray_create_with_allocator(u64 length, u64 stride, const struct allocator_interface* allocator);
 LAPI void _darray_destroy(void* array);
 
 LAPI u64 _darray_field_get(void* array, u64 field);
@@ -29,8 +36,21 @@ LAPI void* _darray_push(void* array, const void* value_ptr);
 LAPI void _darray_pop(void* array, void* dest);
 
 LAPI void* _darray_pop_at(void* array, u64 index, void* dest);
+// Inserts before the element at index, shifting the rest outward. An index of the length appends.
 LAPI void* _darray_insert_at(void* array, u64 index, void* value_ptr);
 
+// Appends count elements with a single copy, growing at most once.
+LAPI void* _darray_push_n(void* array, const void* values, u64 count);
+// Sets the length, growing as push would if needed. Any elements gained are uninitialized.
+LAPI void* _darray_resize_uninit(void* array, u64 length);
+// Grows the capacity to exactly the given number of elements, if it is not already at least that.
+LAPI void* _darray_reserve_exact(void* array, u64 capacity);
+// Shrinks the capacity to the length (at least DARRAY_DEFAULT_CAPACITY), handing back the rest.
+LAPI void* _darray_shrink_to_fit(void* array);
+// Removes the element at index in O(1) by moving the last element into its place. Does not keep order.
+// dest may be 0 if the removed element is not needed.
+LAPI void _darray_swap_remove(void* array, u64 index, void* dest);
+
 #define DARRAY_DEFAULT_CAPACITY 1
 #define DARRAY_RESIZE_FACTOR 2
 
@@ -40,6 +60,12 @@ LAPI void* _darray_insert_at(void* array, u64 index, void* value_ptr);
 #define darray_reserve(type, capacity) \
     _darray_create(capacity, sizeof(type))
 
+#define darray_create_with_allocator(type, allocator) \
+    _darray_create_with_allocator(DARRAY_DEFAULT_CAPACITY, sizeof(type), allocator)
+
+#define darray_reserve_with_allocator(type, capacity, allocator) \
+    _darray_create_with_allocator(capacity, sizeof(type), allocator)
+
 #define darray_destroy(array) _darray_destroy(array)
 
 #define darray_push(array, value)           \
@@ -54,15 +80,30 @@ LAPI void* _darray_insert_at(void* array, u64 index, void* value_ptr);
 #define darray_pop(array, value_ptr) \
     _darray_pop(array, value_ptr)
 
-#define darray_insert_at(array, index, value)       \
-    {                                               \
-        typeof(value) temp = value;                 \
-        array = _darray_insert_at(array, &temp);    \
-    }                                               \
+#define darray_insert_at(array, index, value)           \
+    {                                                   \
+        typeof(value) temp = value;                     \
+        array = _darray_insert_at(array, index, &temp); \
+    }                                                   \
 
 #define darray_pop_at(array, index, value_ptr) \
     _darray_pop_at(array, index, value_ptr)
 
+#define darray_push_n(array, values, count) \
+    array = _darray_push_n(array, values, count)
+
+#define darray_resize_uninit(array, length) \
+    array = _darray_resize_uninit(array, length)
+
+#define darray_reserve_exact(array, capacity) \
+    array = _darray_reserve_exact(array, capacity)
+
+#define darray_shrink_to_fit(array) \
+    array = _darray_shrink_to_fit(array)
+
+#define darray_swap_remove(array, index, value_ptr) \
+    _darray_swap_remove(array, index, value_ptr)
+
 #define darray_clear(array) \
     _darray_field_set(array, DARRAY_LENGTH, 0)
 
@@ -2,35 +2,92 @@
 
 #include "core/lmemory.h"
 #include "core/logger.h"
+#include "platform/platform.h"
 
 
+// Number of size bins. Free ranges are binned by floor(log2(size)).
+#define FREELIST_BIN_COUNT 64
+
 typedef struct freelist_node {
     u64 offset;
     u64 size;
+    // Neighbouring free ranges, in address order.
     struct freelist_node* next;
+    struct freelist_node* prev;
+    // Neighbouring free ranges within the same size bin.
+    struct freelist_node* bin_next;
+    struct freelist_node* bin_prev;
 } freelist_node;
 
+// An additional block of nodes, obtained once the inline node pool is exhausted.
+// Chunks are kept in a list so they may be released on destroy.
+typedef struct freelist_node_chunk {
+    struct freelist_node_chunk* next;
+    u64 capacity;
+    u64 size_bytes;
+} freelist_node_chunk;
+
 // Internal state of the entire freelist. 
 typedef struct internal_state {
     u64 total_size;
+    // Capacity of the inline node pool, which directly follows the state.
     u64 max_entries;
     freelist_node* head;
     freelist_node* nodes;
+
+    // The pool nodes are currently being carved from, and how much of it has been used.
+    freelist_node* pool;
+    u64 pool_capacity;
+    u64 pool_used;
+
+    // Stack of nodes that have been returned and can be reused.
+    freelist_node* free_nodes;
+    // Overflow chunks, in order of creation (newest first).
+    freelist_node_chunk* chunks;
+    // Total nodes available across the inline pool and all chunks.
+    u64 node_capacity;
+
+    // Maintained counters, kept up to date as ranges are linked, unlinked and resized.
+    u64 free_space;
+    u64 range_count;
+    // The largest free range. Only recomputed when dirty, which happens when
+    // the largest range shrinks or is removed.
+    u64 largest;
+    b8 largest_dirty;
+
+    // Free ranges binned by size, with a bit set for each non-empty bin.
+    u64 bin_bitmap;
+    freelist_node* bins[FREELIST_BIN_COUNT];
 } internal_state;
 
 // Private method declarations
 freelist_node* get_node(freelist* list);
 void return_node(freelist* list, freelist_node* node);
+static void reset_node_pool(internal_state* state);
+static void release_chunks(internal_state* state);
+static void range_link(internal_state* state, freelist_node* prev, freelist_node* node);
+static void range_unlink(internal_state* state, freelist_node* node);
+static void range_resize(internal_state* state, freelist_node* node, u64 size);
+static u64 largest_free_range(internal_state* state);
+static b8 carve_range(freelist* list, freelist_node* node, u64 padding, u64 size);
+
+LINLINE u32 bin_index(u64 size) {
+    return 63 - __builtin_clzll(size);
+}
 
+LINLINE u64 align_offset(u64 offset, u64 alignment) {
+    return (offset + (alignment - 1)) & ~(alignment - 1);
+}
 
 // Function definitions
 
 // Public functions
 void freelist_create(u64 total_size, u64* memory_requirement, void* memory, freelist* out_list)
 {
-    // Enough space to hold state, plus the array for all the nodes.
-    // NOTE: Might have a remainder; okay if so.
-    u64 max_entries = (total_size / (sizeof(void*) * sizeof(freelist_node))); 
+    // Enough space to hold state, plus a small inline pool of nodes. Additional nodes
+    // are obtained as needed, so metadata scales with the number of free ranges
+    // rather than the total size being tracked.
+    u64 max_entries = FREELIST_INITIAL_NODE_COUNT;
     *memory_requirement = sizeof(internal_state) + (sizeof(freelist_node) * max_entries);
     if (!memory) {
         // First pass.
@@ -46,317 +103,577 @@ void freelist_create(u64 total_size, u64* memory_requirement, void* memory, free
 
     out_list->memory = memory;
 
-    // The block's layout is head* first, then array of available nodes.
-    lzero_memory(out_list->memory, *memory_requirement);
+    // The block's layout is state first, then the inline array of nodes.
+    lzero_memory(out_list->memory, sizeof(internal_state));
     internal_state* state = out_list->memory;
     state->nodes = (void*)(out_list->memory + sizeof(internal_state));
     state->max_entries = max_entries;
     state->total_size = total_size;
+    state->chunks = 0;
+    reset_node_pool(state);
 
-    state->head = &state->nodes[0];
-    state->head->offset = 0;
-    state->head->size = total_size;
-    state->head->next = 0;
-
-    // Invalidate the offset an dsize for all but the first node. The invalid
-    // value will be checked for thwn seeking a new node from teh list. 
-    for (u64 i = 1; i < state->max_entries; i++) {
-        state->nodes[i].offset = INVALID_ID;
-        state->nodes[i].size = INVALID_ID;
-    }
+    freelist_node* node = get_node(out_list);
+    node->offset = 0;
+    node->size = total_size;
+    range_link(state, 0, node);
 }
 
 void freelist_destroy(freelist* list)
 {
-    if (!(list || list->memory)) {
+    if (!list || !list->memory) {
         return;
     }
 
-    // Just zero out the memory before giving it back.
+    // Give back any overflow chunks, then zero out the memory before giving it back.
     internal_state* state = list->memory;
-    lzero_memory(list->memory, sizeof(internal_state) + sizeof(freelist_node)* state->max_entries);
+    release_chunks(state);
+    lzero_memory(list->memory, sizeof(internal_state) + sizeof(freelist_node) * state->max_entries);
     list->memory = 0;
 }
 
 b8 freelist_allocate_block(freelist* list, u64 size, u64* out_offset)
 {
-    if (!(list || out_offset || list->memory)) {
+    if (!list || !out_offset || !list->memory || !size) {
         return false;
     }
 
     internal_state* state = list->memory;
     freelist_node* node = state->head;
-    freelist_node* prev = 0;
 
     while (node) 
     {
         if (node->size == size) {
             // Exact match
             *out_offset = node->offset;
-            freelist_node* node_to_return = 0;
-            if (prev) {
-                prev->next = node->next;
-                node_to_return = node;
-            } else {
-                // This node is the head of the list. Reassign the head 
-                // and return the prev head node.
-                node_to_return = state->head;
-                state->head = node->next; 
-                // TODO: state->head might be set to null. The block is full, and there's no freelist. 
-            }
-            return_node(list, node_to_return);
+            range_unlink(state, node);
+            return_node(list, node);
             return true;
         } else if (node->size > size) {
             // Node is larger. Deduct the memory from it and move the offset
             // by that amount.
             *out_offset = node->offset;
-            node->size -= size;
             node->offset += size;
+            range_resize(state, node, node->size - size);
             return true; 
         }
         // Else, iterate.
-        prev = node;
         node = node->next;
     }
 
-    u64 free_space = freelist_free_space(list);
-    LWARN("freelist_allocate_block, no block with enough free space found (requested: %iB, available: %lluB)", size, free_space);
+    LWARN("freelist_allocate_block, no block with enough free space found (requested: %lluB, available: %lluB, largest: %lluB)", size, state->free_space, largest_free_range(state));
     return false;
 }
 
 b8 freelist_allocate_block_best(freelist* list, u64 size, u64* out_offset) 
 {
-    // TODO: Implement.
-    // Just pass it to first fit (for now).
-    LWARN("freelist_allocate_block_best not yet implemented. Passing to first fit...");
+    if (!list || !out_offset || !list->memory || !size) {
+        return false;
+    }
+
+    internal_state* state = list->memory;
+
+    // Look for the smallest range that fits within the bin the size falls in.
+    u32 index = bin_index(size);
+    freelist_node* best = 0;
+    for (freelist_node* node = state->bins[index]; node; node = node->bin_next) {
+        if (node->size >= size && (!best || node->size < best->size)) {
+            best = node;
+            if (best->size == size) {
+                break;
+            }
+        }
+    }
+
+    if (!best && index + 1 < FREELIST_BIN_COUNT) {
+        // Every range in a larger bin fits, so the best is the smallest in the next non-empty one.
+        u64 larger = state->bin_bitmap & (~0ULL << (index + 1));
+        if (larger) {
+            for (freelist_node* node = state->bins[__builtin_ctzll(larger)]; node; node = node->bin_next) {
+                if (!best || node->size < best->size) {
+                    best = node;
+                }
+            }
+        }
+    }
+
+    if (!best) {
+        LWARN("freelist_allocate_block_best, no block with enough free space found (requested: %lluB, available: %lluB, largest: %lluB)", size, state->free_space, largest_free_range(state));
+        return false;
+    }
+
+    *out_offset = best->offset;
+    return carve_range(list, best, 0, size);
+}
+
+b8 freelist_allocate_block_aligned(freelist* list, u64 size, u64 alignment, u64* out_offset)
+{
+    if (!list || !out_offset || !list->memory || !size) {
+        return false;
+    }
+
+    if (alignment & (alignment - 1)) {
+        LERROR("freelist_allocate_block_aligned requires a power of two alignment (got %llu).", alignment);
+        return false;
+    }
+
+    if (alignment <= 1) {
+        return freelist_allocate_block_best(list, size, out_offset);
+    }
+
+    internal_state* state = list->memory;
+
+    // Ranges in bins below the size can never fit. Walk the non-empty bins upwards, 
+    // taking the smallest range in the first one that can hold the aligned block.
+    u64 bins = state->bin_bitmap & (~0ULL << bin_index(size));
+    while (bins) {
+        freelist_node* best = 0;
+        u64 best_padding = 0;
+        for (freelist_node* node = state->bins[__builtin_ctzll(bins)]; node; node = node->bin_next) {
+            u64 padding = align_offset(node->offset, alignment) - node->offset;
+            if (node->size >= size + padding && (!best || node->size < best->size)) {
+                best = node;
+                best_padding = padding;
+            }
+        }
+
+        if (best) {
+            *out_offset = best->offset + best_padding;
+            return carve_range(list, best, best_padding, size);
+        }
+
+        // Clear the lowest bit to move on to the next bin.
+        bins &= bins - 1;
+    }
 
-    return freelist_allocate_block(list, size, out_offset);
+    LWARN("freelist_allocate_block_aligned, no block with enough free space found (requested: %lluB aligned to %llu, available: %lluB, largest: %lluB)", size, alignment, state->free_space, largest_free_range(state));
+    return false;
 }
 
 b8 freelist_free_block(freelist* list, u64 size, u64 offset)
 {
-    if (!(list || list->memory || size)) {
+    if (!list || !list->memory || !size) {
         return false;
     }
 
     internal_state* state = list->memory;
-    freelist_node* node = state->head;
+    if (offset + size > state->total_size) {
+        LWARN("freelist_free_block called with a range outside of the list. Corruption possible.");
+        return false;
+    }
+
+    // Find the last free range which starts before the freed one.
     freelist_node* prev = 0;
+    freelist_node* node = state->head;
+    while (node && node->offset < offset) {
+        prev = node;
+        node = node->next;
+    }
+
+    // Make sure the freed range overlaps neither neighbour.
+    if ((prev && prev->offset + prev->size > offset) || (node && offset + size > node->offset)) {
+        LWARN("freelist_free_block called on a range which is already free. Corruption possible.");
+        return false;
+    }
 
-  if (!node) {
-        // Check for the case where the entire thing is allocated.
-        // In this case a new node is needed at the head.
+    b8 joins_prev = prev && prev->offset + prev->size == offset;
+    b8 joins_next = node && offset + size == node->offset;
+
+    if (joins_prev && joins_next) {
+        // The freed range bridges the gap between two ranges, so combine them
+        // and return the second node.
+        u64 combined = prev->size + size + node->size;
+        range_unlink(state, node);
+        return_node(list, node);
+        range_resize(state, prev, combined);
+    } else if (joins_prev) {
+        // The freed range directly follows the previous node, so can just append to it.
+        range_resize(state, prev, prev->size + size);
+    } else if (joins_next) {
+        // The freed range directly precedes the next node, so can just prepend to it.
+        node->offset = offset;
+        range_resize(state, node, node->size + size);
+    } else {
+        // Isolated range. Need a new node.
         freelist_node* new_node = get_node(list);
+        if (!new_node) {
+            return false;
+        }
         new_node->offset = offset;
         new_node->size = size;
-        new_node->next = 0;
-        state->head = new_node;
-        return true;
+        range_link(state, prev, new_node);
     }
 
-    while (node) 
-    {
-        if (node->offset == offset) {
-            // Can just append to this node.
-            node->size += size;
-
-            // Check if this then connects the range between this and the next node,
-            // and if so, combine them and return the second node. 
-            if (node->next && node->next->offset == node->offset + node->size) {
-                node->size += node->next->size;
-                freelist_node* next = node->next;
-                node->next = node->next->next;
-                return_node(list, next);
-            }
-            return true;
-        } else if (node->offset > offset) {
-            // Iterated beyond the space to be freed. Need a new node.
-            freelist_node* new_node = get_node(list);
-            new_node->offset = offset;
-            new_node->size = size;
-
-            // If there is a previous node, the new node should be inserted between this and it.
-            if (prev) {
-                prev->next = new_node;
-                new_node->next = node;
-            } else{
-                // Otherwise, the new node becomes the head.
-                new_node->next = node;
-                state->head = new_node;
-            }
-            
-            // Double check next node to see if it can be joined.
-            if (new_node->next && new_node->offset + new_node->size == new_node->next->offset) {
-                new_node->size += new_node->next->size;
-                freelist_node* temp = new_node->next;
-                new_node->next = temp->next;
-                return_node(list, temp);
-            }
-            
-            // Double check prev node to see if the new node can be joined to it.
-            if (prev && prev->offset + prev->size == new_node->offset) {
-                prev->size += new_node->size;
-                freelist_node* temp = new_node;
-                prev->next = temp->next;
-                return_node(list, temp);
-            }
+    return true;
+}
 
-            return true;
-        }
+b8 freelist_resize_block(freelist* list, u64 offset, u64 size, u64 new_size)
+{
+    if (!list || !list->memory || !size || !new_size) {
+        return false;
+    }
 
-        prev = node;
+    internal_state* state = list->memory;
+    if (offset + size > state->total_size) {
+        LWARN("freelist_resize_block called with a range outside of the list. Corruption possible.");
+        return false;
+    }
+
+    if (new_size == size) {
+        return true;
+    }
+
+    if (new_size < size) {
+        // Shrinking just gives the tail back.
+        return freelist_free_block(list, size - new_size, offset + new_size);
+    }
+
+    // Growing needs a free range starting exactly where the block ends.
+    u64 end = offset + size;
+    freelist_node* node = state->head;
+    while (node && node->offset < end) {
         node = node->next;
     }
+    if (!node || node->offset != end || node->size < new_size - size) {
+        return false;
+    }
 
-    LWARN("Unable to find block to be freed. Corruption possible.");
-    return false;
+    return carve_range(list, node, 0, new_size - size);
 }
 
 b8 freelist_resize(freelist* list, u64* memory_requirement, void* new_memory, u64 new_size, void** out_old_memory)
 {
-    if (!list || !memory_requirement  || ((internal_state*)list->memory)->total_size > new_size) {
+    if (!list || !memory_requirement) {
         return false;
     }
 
-    // Enough space to hold the state, plus array for all nodes.
-    u64 max_entries = (new_size / sizeof(void*));
-    *memory_requirement = sizeof(internal_state) + (sizeof(freelist_node) * max_entries);
+    // Enough space to hold the state, plus the inline node pool. Same as create.
+    *memory_requirement = sizeof(internal_state) + (sizeof(freelist_node) * FREELIST_INITIAL_NODE_COUNT);
     if (!new_memory) {
         return true;
     }
 
+    internal_state* old_state = (internal_state*)list->memory;
+    if (!old_state || old_state->total_size > new_size) {
+        return false;
+    }
+
     // Assign the old memory pointer so it can be freed.
     *out_old_memory = list->memory;
 
-    // Copy over the old state to the new.
-    internal_state* old_state = (internal_state*)list->memory;
     u64 size_diff = new_size - old_state->total_size;
 
     // Setup the new memory.
     list->memory = new_memory;
 
-    // The block's layout is head first, then array of available nodes.
-    lzero_memory(list->memory, *memory_requirement);
+    // The block's layout is state first, then the inline array of nodes.
+    lzero_memory(list->memory, sizeof(internal_state));
 
     // Setup the new state.
     internal_state* state = (internal_state*)list->memory;
     state->nodes = (void*)(list->memory + sizeof(internal_state));
+    state->max_entries = FREELIST_INITIAL_NODE_COUNT;
     state->total_size = new_size;
+    state->chunks = 0;
+    reset_node_pool(state);
 
-    // Invalidate the offset and size for all but the first node. The invalud value will be checked 
-    // for hwhen seeking a new node from the list.
-    for (u64 i = 1; i < state->max_entries; i++) {
-        state->nodes[i].offset = INVALID_ID;
-        state->nodes[i].size = INVALID_ID;
-    }
-
-    state->head = &state->nodes[0];
-
-    // Copy over the nodes.
-    freelist_node* new_list_node = state->head;
-    freelist_node* old_node = old_state->head;
-
-    if (!old_node) {
-        // If there is no head, then the entire list is allocated. In this case, 
-        // the head should be set to the difference of the space new available, and
-        // at the end of the list.
-        state->head->offset = old_state->total_size;
-        state->head->size = size_diff;
-        state->head->next = 0;
-        return true;
-    }
-
-    // Iterate over the nodes
-    while(old_node) {
-        // Get a new node, copy the offset/size, and set next to it.
+    // Iterate over the nodes, copying them in order.
+    freelist_node* tail = 0;
+    for (freelist_node* old_node = old_state->head; old_node; old_node = old_node->next) {
+        // Get a new node, copy the offset/size, and attach it to the end.
         freelist_node* new_node = get_node(list);
+        if (!new_node) {
+            LERROR("freelist_resize unable to obtain a node. Resize failed.");
+            list->memory = *out_old_memory;
+            *out_old_memory = 0;
+            release_chunks(state);
+            return false;
+        }
         new_node->offset = old_node->offset;
         new_node->size = old_node->size;
-        new_node->next = 0;
-        new_list_node->next = new_node;
-
-        // Move to the next entry.
-        new_list_node = new_list_node->next;
-
-        if (old_node->next) {
-            // If there is another node, move on.
-            old_node = old_node->next;
-            continue;
-        }  
-        
-        // Reached the end of the list. 
-        // Check if it extends ot the end of the block. If so, 
-        // just append to the size. Otherwise, create a new node and 
-        // attach to it.
-        if (old_node->offset + old_node->size == old_state->total_size) {
-            new_node->size += size_diff;
+        range_link(state, tail, new_node);
+        tail = new_node;
+    }
+
+    // Check if the last range extends to the end of the block. If so, 
+    // just append to the size. Otherwise, create a new node for the new space.
+    if (size_diff) {
+        if (tail && tail->offset + tail->size == old_state->total_size) {
+            range_resize(state, tail, tail->size + size_diff);
         } else {
-            freelist_node* new_node_end = get_node(list);
-            new_node_end->offset = old_state->total_size;
-            new_node_end->size = size_diff;
-            new_node_end->next = 0;
-            new_node->next = new_node_end;
+            freelist_node* new_node = get_node(list);
+            if (!new_node) {
+                LERROR("freelist_resize unable to obtain a node. Resize failed.");
+                list->memory = *out_old_memory;
+                *out_old_memory = 0;
+                release_chunks(state);
+                return false;
+            }
+            new_node->offset = old_state->total_size;
+            new_node->size = size_diff;
+            range_link(state, tail, new_node);
         }
-        break;
     }
 
+    // The old nodes have been copied, so any chunks they lived in can be released.
+    release_chunks(old_state);
     return true;
 }
 
 void freelist_clear(freelist* list)
 {
-    if (!(list || list->memory)) {
+    if (!list || !list->memory) {
         return;
     }
 
     internal_state* state = list->memory;
-    // Invalidate the offset and size for all BUT the first node. The invalid
-    // value will be checked for when seeing a new node from the list.
-    for (u64 i = 1; i < state->max_entries; i++) {
-        state->nodes[i].offset = INVALID_ID;
-        state->nodes[i].size = INVALID_ID;
-    }
-
-    // Reset the head to occupy the entire thing.
-    state->head->offset = 0;
-    state->head->size = state->total_size;
-    state->head->next = 0;
+    // Drop all nodes, including any overflow chunks, and start over
+    // with a single node occupying the entire thing.
+    release_chunks(state);
+    reset_node_pool(state);
+
+    freelist_node* node = get_node(list);
+    node->offset = 0;
+    node->size = state->total_size;
+    range_link(state, 0, node);
 }
 
 u64 freelist_free_space(freelist* list)
 {
-    if (!(list || list->memory)) {
+    if (!list || !list->memory) {
         return 0;
     }
 
-    u64 running_total = 0;
-    internal_state* state = list->memory;
-    freelist_node* node = state->head;
-    while (node) {
-        running_total += node->size;
-        node = node->next;
+    return ((internal_state*)list->memory)->free_space;
+}
+
+b8 freelist_get_stats(freelist* list, freelist_stats* out_stats)
+{
+    if (!list || !list->memory || !out_stats) {
+        return false;
     }
 
-    return running_total;
+    internal_state* state = list->memory;
+    out_stats->total_free = state->free_space;
+    out_stats->largest_free_block = largest_free_range(state);
+    out_stats->free_range_count = state->range_count;
+    // The share of free space which cannot be handed out as one contiguous block.
+    out_stats->fragmentation = state->free_space ? 1.0f - ((f32)out_stats->largest_free_block / (f32)state->free_space) : 0.0f;
+    return true;
 }
 
 // Private functions
 freelist_node* get_node(freelist* list)
 {
     internal_state* state = list->memory;
-    for (u64 i = 1; i < state->max_entries; i++) {
-        if (state->nodes[i].offset == INVALID_ID) {
-            return &state->nodes[i];
+
+    // Reuse a returned node if there is one.
+    if (state->free_nodes) {
+        freelist_node* node = state->free_nodes;
+        state->free_nodes = node->next;
+        node->next = 0;
+        return node;
+    }
+
+    // Otherwise carve one from the current pool, growing it if needed.
+    if (state->pool_used == state->pool_capacity) {
+        // NOTE: A freelist may back the memory system itself, so chunks are
+        // obtained from the platform directly rather than via lallocate.
+        u64 capacity = state->node_capacity;
+        u64 size_bytes = sizeof(freelist_node_chunk) + sizeof(freelist_node) * capacity;
+        freelist_node_chunk* chunk = platform_allocate(size_bytes, false);
+        if (!chunk) {
+            LERROR("freelist unable to allocate additional nodes.");
+            return 0;
         }
+
+        chunk->next = state->chunks;
+        chunk->capacity = capacity;
+        chunk->size_bytes = size_bytes;
+        state->chunks = chunk;
+        state->pool = (freelist_node*)((u8*)chunk + sizeof(freelist_node_chunk));
+        state->pool_capacity = capacity;
+        state->pool_used = 0;
+        state->node_capacity += capacity;
     }
 
-    // Return nothing if cannot find one.
-    return 0;
+    freelist_node* node = &state->pool[state->pool_used++];
+    node->next = 0;
+    return node;
 }
 
 void return_node(freelist* list, freelist_node* node)
 {
+    internal_state* state = list->memory;
     node->offset = INVALID_ID;
     node->size = INVALID_ID;
+    node->prev = 0;
+    node->next = state->free_nodes;
+    state->free_nodes = node;
+}
+
+static void reset_node_pool(internal_state* state)
+{
+    state->head = 0;
+    state->free_nodes = 0;
+    state->pool = state->nodes;
+    state->pool_capacity = state->max_entries;
+    state->pool_used = 0;
+    state->node_capacity = state->max_entries;
+
+    state->free_space = 0;
+    state->range_count = 0;
+    state->largest = 0;
+    state->largest_dirty = false;
+    state->bin_bitmap = 0;
+    lzero_memory(state->bins, sizeof(state->bins));
+}
+
+static void release_chunks(internal_state* state)
+{
+    freelist_node_chunk* chunk = state->chunks;
+    while (chunk) {
+        freelist_node_chunk* next = chunk->next;
+        platform_free(chunk, false);
+        chunk = next;
+    }
+    state->chunks = 0;
+}
+
+static void bin_insert(internal_state* state, freelist_node* node)
+{
+    u32 index = bin_index(node->size);
+    node->bin_prev = 0;
+    node->bin_next = state->bins[index];
+    if (node->bin_next) {
+        node->bin_next->bin_prev = node;
+    }
+    state->bins[index] = node;
+    state->bin_bitmap |= (1ULL << index);
+}
+
+static void bin_remove(internal_state* state, freelist_node* node)
+{
+    u32 index = bin_index(node->size);
+    if (node->bin_prev) {
+        node->bin_prev->bin_next = node->bin_next;
+    } else {
+        state->bins[index] = node->bin_next;
+        if (!node->bin_next) {
+            state->bin_bitmap &= ~(1ULL << index);
+        }
+    }
+    if (node->bin_next) {
+        node->bin_next->bin_prev = node->bin_prev;
+    }
+    node->bin_next = 0;
+    node->bin_prev = 0;
+}
+
+// Links the node into the address-ordered list after prev (or as the head if prev is 0).
+static void range_link(internal_state* state, freelist_node* prev, freelist_node* node)
+{
+    node->prev = prev;
+    if (prev) {
+        node->next = prev->next;
+        prev->next = node;
+    } else {
+        node->next = state->head;
+        state->head = node;
+    }
+    if (node->next) {
+        node->next->prev = node;
+    }
+
+    bin_insert(state, node);
+    state->free_space += node->size;
+    state->range_count++;
+    if (node->size > state->largest) {
+        state->largest = node->size;
+        state->largest_dirty = false;
+    }
+}
+
+static void range_unlink(internal_state* state, freelist_node* node)
+{
+    if (node->prev) {
+        node->prev->next = node->next;
+    } else {
+        state->head = node->next;
+    }
+    if (node->next) {
+        node->next->prev = node->prev;
+    }
     node->next = 0;
+    node->prev = 0;
+
+    bin_remove(state, node);
+    state->free_space -= node->size;
+    state->range_count--;
+    if (node->size == state->largest) {
+        state->largest_dirty = true;
+    }
+}
+
+static void range_resize(internal_state* state, freelist_node* node, u64 size)
+{
+    bin_remove(state, node);
+    state->free_space = state->free_space - node->size + size;
+    if (size > state->largest) {
+        state->largest = size;
+        state->largest_dirty = false;
+    } else if (node->size == state->largest && size < node->size) {
+        state->largest_dirty = true;
+    }
+    node->size = size;
+    bin_insert(state, node);
+}
+
+static u64 largest_free_range(internal_state* state)
+{
+    if (state->largest_dirty) {
+        // The largest range always lives in the highest non-empty bin.
+        state->largest = 0;
+        if (state->bin_bitmap) {
+            for (freelist_node* node = state->bins[bin_index(state->bin_bitmap)]; node; node = node->bin_next) {
+                if (node->size > state->largest) {
+                    state->largest = node->size;
+                }
+            }
+        }
+        state->largest_dirty = false;
+    }
+    return state->largest;
+}
+
+// Takes size bytes out of the given range, starting padding bytes in. Any padding
+// stays free as part of the node, and any remainder after the block gets a node of its own.
+static b8 carve_range(freelist* list, freelist_node* node, u64 padding, u64 size)
+{
+    internal_state* state = list->memory;
+    u64 remainder = node->size - padding - size;
+
+    if (!padding) {
+        if (!remainder) {
+            // Exact match
+            range_unlink(state, node);
+            return_node(list, node);
+        } else {
+            node->offset += size;
+            range_resize(state, node, remainder);
+        }
+        return true;
+    }
+
+    if (remainder) {
+        // Obtain the node first so nothing changes if one is not available.
+        freelist_node* tail = get_node(list);
+        if (!tail) {
+            return false;
+        }
+        tail->offset = node->offset + padding + size;
+        tail->size = remainder;
+        range_link(state, node, tail);
+    }
+    range_resize(state, node, padding);
+    return true;
 }
@@ -10,6 +10,13 @@
 #pragma once
 #include "defines.h"
 
+/**
+ * @brief The number of nodes held inline with the freelist state. Once exhausted, 
+ * additional nodes are obtained in growing chunks, so metadata scales with the
+ * number of free ranges rather than with the total size tracked.
+ */
+#define FREELIST_INITIAL_NODE_COUNT 64
+
 /**
  * @brief A data structure to be used alongside an allocator for dynamic memory
  * allocation. Tracks free ranges of memory.
@@ -20,13 +27,27 @@ typedef struct freelist {
     void* memory;
 } freelist;
 
+/**
+ * @brief A snapshot of the free ranges tracked by a freelist.
+ */
+typedef struct freelist_stats {
+    /** @brief The total amount of free space in bytes. */
+    u64 total_free;
+    /** @brief The size of the largest contiguous free range in bytes. */
+    u64 largest_free_block;
+    /** @brief The number of distinct free ranges. */
+    u64 free_range_count;
+    /** @brief The share of free space unusable for a single allocation, 0 (none) to 1. Computed as 1 - largest/total. */
+    f32 fragmentation;
+} freelist_stats;
+
 /**
  * @brief Creates a new freelist or obtains the memory requirement for one. Should call twice (in line with vulkan style).
  * Should be first called, passing 0 to memory, to obtain memory requirement.
  * Should then be called, passing an allocated block to memory.
  * 
  * @param total_size The total size in bytes that the freelist should track.
- * @param memory_requirement A pointer to hold memory requirement to the freelist itself (the internal state!).
+ * @param memory_requirement A pointer to hold memory requirement to the freelist itself (the internal state!). This does not depend on total_size.
  * @param memory 0; or a pre-allocated block of memory for the free list to use (the intenal state!).
  * @param out_list  A pointer to hold the created free list.
  */
@@ -51,8 +72,9 @@ LAPI void freelist_destroy(freelist* list);
 LAPI b8 freelist_allocate_block(freelist* list, u64 size, u64* out_offset);
 
 /**
- * @brief Attempts to find a free block of memory of the given size. Done by best fit.
- * TODO: Implement this
+ * @brief Attempts to find a free block of memory of the given size. Done by best fit;
+ * the smallest free range which can hold the size is used. Free ranges are binned by size,
+ * so only the bin the size falls in and the next non-empty bin above it are searched.
  * 
  * @param list A pointer to the list to search.
  * @param size The size to allocate.
@@ -61,6 +83,19 @@ LAPI b8 freelist_allocate_block(freelist* list, u64 size, u64* out_offset);
  */
 LAPI b8 freelist_allocate_block_best(freelist* list, u64 size, u64* out_offset);
 
+/**
+ * @brief Attempts to find a free block of memory of the given size, whose offset is a multiple
+ * of the given alignment. Any space skipped to reach the alignment stays free, so it can be
+ * handed out later. Freed as normal with freelist_free_block, using the returned offset and size.
+ * 
+ * @param list A pointer to the list to search.
+ * @param size The size to allocate.
+ * @param alignment The alignment of the returned offset. Must be a power of two.
+ * @param out_offset A pointer to hold the offset to the allocated memory.
+ * @return b8 True if a block of memory was found and allocated; otherwise false
+ */
+LAPI b8 freelist_allocate_block_aligned(freelist* list, u64 size, u64 alignment, u64* out_offset);
+
 
 
 /**
@@ -74,9 +109,23 @@ LAPI b8 freelist_allocate_block_best(freelist* list, u64 size, u64* out_offset);
  */
 LAPI b8 freelist_free_block(freelist* list, u64 size, u64 offset);
 
+/**
+ * @brief Attempts to resize an allocated block in place. Shrinking always succeeds, giving the
+ * tail back to the list. Growing only succeeds if the range directly following the block is
+ * free and large enough; otherwise nothing is changed.
+ * 
+ * @param list A pointer to the list the block was allocated from.
+ * @param offset The offset of the block.
+ * @param size The size the block currently has.
+ * @param new_size The size the block should have.
+ * @return True if the block now has new_size bytes at the same offset; otherwise false.
+ */
+LAPI b8 freelist_resize_block(freelist* list, u64 offset, u64 size, u64 new_size);
+
 /**
  * @brief Attempts to resize the provided freelist to the given size. Internal data is copied to the new
- * block of memory. The old block must be freed after this call.
+ * block of memory. The old block must be freed after this call. Any overflow node chunks owned by the
+ * old block are released by this call.
  * NOTE: New size must be _greater_ than the existing size of the given list.
  * NOTE: Should be called twice; once to query the memory requirement (passing new_memory=0),
  * and a second time to actually resize the list.
@@ -98,11 +147,21 @@ LAPI b8 freelist_resize(freelist* list, u64* memory_requirement, void* new_memor
 LAPI void freelist_clear(freelist* list);
 
 /**
- * @brief Returns the amount of free space in this list. 
- * NOTE: Since this has to iterate over the enitre internal list, 
- * this can be an expensive operation. Use sparingly
+ * @brief Returns the amount of free space in this list. This is a maintained
+ * counter, so it is cheap to call.
  * 
- * @param list A pointer tot he list from which to obtain.
+ * @param list A pointer to the list from which to obtain.
  * @return The amount of free space in bytes
  */
-LAPI u64 freelist_free_space(freelist* list);
\ No newline at end of file
+LAPI u64 freelist_free_space(freelist* list);
+
+/**
+ * @brief Obtains statistics about the free ranges in this list. Total free space and
+ * the range count are maintained counters; the largest range is cached and only
+ * recomputed (from the highest non-empty size bin) after it shrinks.
+ * 
+ * @param list A pointer to the list from which to obtain.
+ * @param out_stats A pointer to hold the statistics.
+ * @return True on success; otherwise false.
+ */
+LAPI b8 freelist_get_stats(freelist* list, freelist_stats* out_stats);
\ No newline at end of file
@@ -1,55 +1,191 @@
 #include "hashtable.h"
 
+#include "core/lhash.h"
 #include "core/lmemory.h"
+#include "core/lstring.h"
 #include "core/logger.h"
+#include "memory/allocator.h"
 
-u64 hash_name(const char* name, u32 element_count) 
+/** @brief A slot in the table. Empty when key is 0. */
+typedef struct hashtable_slot {
+    u64 hash;
+    const char* key;
+} hashtable_slot;
+
+// The number of names hashed and prefetched ahead of being probed by hashtable_get_batch.
+#define HASHTABLE_BATCH_SIZE 32
+
+/** @brief A view of one array of slots and its values; either the table's current one or, while rehashing, its previous one. */
+typedef struct slot_array {
+    hashtable_slot* slots;
+    u8* values;
+    u32 capacity;
+    u64 element_size;
+} slot_array;
+
+// Private functions
+static u32 capacity_for(u32 element_count);
+static u32 max_entries(u32 capacity);
+static u32 probe_distance(const slot_array* array, u64 hash, u32 index);
+static u32 find_slot(const slot_array* array, const char* name, u64 hash);
+static u32 find_entry(const hashtable* table, const char* name, u64 hash, slot_array* out_array);
+static void place(slot_array* array, const char* name, u64 hash, const void* value);
+static b8 insert(hashtable* table, const char* name, u64 hash, const void* value);
+static void remove_at(slot_array* array, u32 index);
+static b8 begin_rehash(hashtable* table, u32 new_capacity);
+static void rehash_step(hashtable* table, u32 max_slots);
+
+LINLINE slot_array current_array(const hashtable* table)
+{
+    slot_array array = {(hashtable_slot*)table->memory, (u8*)table->values, table->capacity, table->element_size};
+    return array;
+}
+
+LINLINE slot_array previous_array(const hashtable* table)
 {
-    // A multiplier to use when generating a hash. Prime to hopefully avoid collisions
-    static const u64 multiplier = 97;
+    slot_array array = {(hashtable_slot*)table->previous_memory, (u8*)table->previous_values, table->previous_capacity, table->element_size};
+    return array;
+}
 
-    unsigned const char* us;
-    u64 hash = 0;
+LINLINE u64 array_size(u64 element_size, u32 capacity)
+{
+    return (sizeof(hashtable_slot) + element_size) * capacity;
+}
 
-    for (us = (unsigned const char*)name; *us; us++) {
-        hash = hash * multiplier + *us;
-    }
+LINLINE void* value_at(const slot_array* array, u32 index)
+{
+    return array->values + (array->element_size * index);
+}
 
-    // Mode it against the size of the table
-    hash %= element_count;
+LINLINE u32 home_slot(const slot_array* array, u64 hash)
+{
+    // Capacity is a power of two, so the low bits of the hash are the index.
+    return (u32)hash & (array->capacity - 1);
+}
 
-    return hash;
+LINLINE u32 next_index(const slot_array* array, u32 index)
+{
+    return (index + 1) & (array->capacity - 1);
 }
 
-void hashtable_create(u64 element_size, u32 element_count, void* memory, b8 is_pointer_type, hashtable* out_hashtable)
+b8 hashtable_create(u64 element_size, u32 element_count, b8 is_pointer_type, u64* memory_requirement, void* memory, hashtable* out_hashtable)
 {
-    if (!memory || !out_hashtable) {
-        LERROR("hashtable_create failed! Pointer to memory and out_hashtable are required.");
-        return;
+    if (!memory_requirement) {
+        LERROR("hashtable_create failed! Pointer to memory_requirement is required.");
+        return false;
     }
 
     if (!element_count || !element_size) {
         LERROR("element_size and element_count must be a positive non-zero-value.");
-        return;
+        return false;
+    }
+
+    u32 capacity = capacity_for(element_count);
+    if (!capacity) {
+        LERROR("hashtable_create failed! element_count of %u is too large.", element_count);
+        return false;
+    }
+
+    *memory_requirement = array_size(element_size, capacity);
+
+    if (!memory) {
+        return true;
+    }
+
+    if (!out_hashtable) {
+        LERROR("hashtable_create failed! Pointer to out_hashtable is required.");
+        return false;
     }
 
-    // TODO: Might want to require an allocator and allocate this memory instead.
+    lzero_memory(out_hashtable, sizeof(hashtable));
     out_hashtable->memory = memory;
+    out_hashtable->values = (u8*)memory + (sizeof(hashtable_slot) * capacity);
     out_hashtable->element_count = element_count;
+    out_hashtable->capacity = capacity;
     out_hashtable->element_size = element_size;
     out_hashtable->is_pointer_type = is_pointer_type;
-    lzero_memory(out_hashtable->memory, element_size * element_count);
+    lzero_memory(out_hashtable->memory, *memory_requirement);
+    return true;
+}
+
+b8 hashtable_create_with_allocator(u64 element_size, u32 element_count, b8 is_pointer_type, const allocator_interface* allocator, hashtable* out_hashtable)
+{
+    if (!allocator || !out_hashtable) {
+        LERROR("hashtable_create_with_allocator failed! Pointer to allocator and out_hashtable are required.");
+        return false;
+    }
+
+    u64 memory_requirement = 0;
+    if (!hashtable_create(element_size, element_count, is_pointer_type, &memory_requirement, 0, 0)) {
+        return false;
+    }
+
+    void* memory = allocator_allocate(allocator, memory_requirement, LMEMORY_DEFAULT_ALIGNMENT);
+    if (!memory) {
+        LERROR("hashtable_create_with_allocator failed! Allocator could not provide %lluB.", memory_requirement);
+        return false;
+    }
+
+    hashtable_create(element_size, element_count, is_pointer_type, &memory_requirement, memory, out_hashtable);
+    out_hashtable->allocator = allocator;
+    return true;
+}
+
+b8 hashtable_create_growable(u64 element_size, u32 initial_count, b8 is_pointer_type, const allocator_interface* allocator, hashtable* out_hashtable)
+{
+    if (initial_count < HASHTABLE_GROWABLE_MIN_COUNT) {
+        initial_count = HASHTABLE_GROWABLE_MIN_COUNT;
+    }
+
+    if (!hashtable_create_with_allocator(element_size, initial_count, is_pointer_type, allocator, out_hashtable)) {
+        return false;
+    }
+
+    out_hashtable->growable = true;
+    out_hashtable->min_capacity = out_hashtable->capacity;
+    out_hashtable->element_count = max_entries(out_hashtable->capacity);
+    return true;
 }
 
 void hashtable_destroy(hashtable* table)
 {
     if (table) {
-        // TODO: If using allocator above, free memory here.
+        if (table->allocator) {
+            allocator_free(table->allocator, table->memory, array_size(table->element_size, table->capacity), LMEMORY_DEFAULT_ALIGNMENT);
+            if (table->previous_memory) {
+                allocator_free(table->allocator, table->previous_memory, array_size(table->element_size, table->previous_capacity), LMEMORY_DEFAULT_ALIGNMENT);
+            }
+        }
         lzero_memory(table, sizeof(hashtable));
     }
 }
 
 b8 hashtable_set(hashtable* table, const char* name, void* value)
+{
+    return hashtable_set_hashed(table, name, name ? hash_string(name) : 0, value);
+}
+
+b8 hashtable_set_ptr(hashtable* table, const char* name, void** value)
+{
+    return hashtable_set_ptr_hashed(table, name, name ? hash_string(name) : 0, value);
+}
+
+b8 hashtable_get(hashtable* table, const char* name, void* out_value)
+{
+    return hashtable_get_hashed(table, name, name ? hash_string(name) : 0, out_value);
+}
+
+b8 hashtable_get_ptr(hashtable* table, const char* name, void** out_value)
+{
+    return hashtable_get_ptr_hashed(table, name, name ? hash_string(name) : 0, out_value);
+}
+
+b8 hashtable_remove(hashtable* table, const char* name)
+{
+    return hashtable_remove_hashed(table, name, name ? hash_string(name) : 0);
+}
+
+b8 hashtable_set_hashed(hashtable* table, const char* name, u64 hash, void* value)
 {
     if (!table || !name || !value) {
         LERROR("hashtable_set requires table, name, and value to exist.");
@@ -60,12 +196,10 @@ b8 hashtable_set(hashtable* table, const char* name, void* value)
         return false;
     }
 
-    u64 hash = hash_name(name, table->element_count);
-    lcopy_memory(table->memory + (table->element_size * hash), value, table->element_size);
-    return true;
+    return insert(table, name, hash, value);
 }
 
-b8 hashtable_set_ptr(hashtable* table, const char* name, void** value)
+b8 hashtable_set_ptr_hashed(hashtable* table, const char* name, u64 hash, void** value)
 {
     if (!table || !name) {
         LERROR("hashtable_set_ptr requires table and name to exist.");
@@ -75,13 +209,17 @@ b8 hashtable_set_ptr(hashtable* table, const char* name, void** value)
         LERROR("hashtable_set_ptr should not be used with tables that do not have pointer types. Use hastable_set instead.");
         return false;    
     }
-    
-    u64 hash = hash_name(name, table->element_count);
-    ((void**)table->memory)[hash] = value ? *value : 0;
-    return true;
+
+    if (!value || !*value) {
+        // Unsetting an entry which does not exist is not an error.
+        hashtable_remove_hashed(table, name, hash);
+        return true;
+    }
+
+    return insert(table, name, hash, value);
 }
 
-b8 hashtable_get(hashtable* table, const char* name, void* out_value)
+b8 hashtable_get_hashed(hashtable* table, const char* name, u64 hash, void* out_value)
 {
     if (!table || !name || !out_value) {
         LWARN("hashtable_get requires table, name, and out_value to exist.");
@@ -92,12 +230,17 @@ b8 hashtable_get(hashtable* table, const char* name, void* out_value)
         return false;
     }
 
-    u64 hash = hash_name(name, table->element_count);
-    lcopy_memory(out_value, table->memory + (table->element_size * hash), table->element_size);
+    slot_array array;
+    u32 index = find_entry(table, name, hash, &array);
+    if (index == INVALID_ID) {
+        return false;
+    }
+
+    lcopy_memory(out_value, value_at(&array, index), table->element_size);
     return true;
 }
 
-b8 hashtable_get_ptr(hashtable* table, const char* name, void** out_value)
+b8 hashtable_get_ptr_hashed(hashtable* table, const char* name, u64 hash, void** out_value)
 {
     if (!table || !name || !out_value) {
         LWARN("hashtable_get_ptr requires table, name, and out_value to exist.");
@@ -108,26 +251,374 @@ b8 hashtable_get_ptr(hashtable* table, const char* name, void** out_value)
         return false;
     }
 
-    u64 hash = hash_name(name, table->element_count);
-    *out_value = ((void**)table->memory)[hash];
-    return *out_value != 0;
+    slot_array array;
+    u32 index = find_entry(table, name, hash, &array);
+    if (index == INVALID_ID) {
+        *out_value = 0;
+        return false;
+    }
+
+    *out_value = *(void**)value_at(&array, index);
+    return true;
 }
 
-b8 hashtable_fill(hashtable* table, void* value)
+void* hashtable_find_hashed(hashtable* table, const char* name, u64 hash)
 {
-    if (!table || !value) {
-        LWARN("hashtable_fill requires table and value to exist.");
+    if (!table || !name) {
+        LWARN("hashtable_find requires table and name to exist.");
+        return 0;
+    }
+
+    slot_array array;
+    u32 index = find_entry(table, name, hash, &array);
+    if (index == INVALID_ID) {
+        return 0;
+    }
+
+    return value_at(&array, index);
+}
+
+b8 hashtable_remove_hashed(hashtable* table, const char* name, u64 hash)
+{
+    if (!table || !name) {
+        LWARN("hashtable_remove requires table and name to exist.");
         return false;
     }
-    if (table->is_pointer_type) {
-        LERROR("hashtable_fill should not be used with tables that have pointer types.");
+
+    slot_array array;
+    u32 index = find_entry(table, name, hash, &array);
+    if (index == INVALID_ID) {
+        return false;
+    }
+
+    remove_at(&array, index);
+    if (array.slots != (hashtable_slot*)table->memory) {
+        table->previous_count--;
+    }
+    table->count--;
+
+    if (table->growable) {
+        rehash_step(table, HASHTABLE_REHASH_SLOTS_PER_OP);
+
+        // Shrink once the table falls to an eighth full, so a large set of entries being removed
+        // (ie. a level unloading) gives its memory back. Growing happens at 80%, so the table
+        // does not flip between the two as entries come and go around either size.
+        if (!table->previous_memory && table->capacity > table->min_capacity && table->count < table->capacity / 8) {
+            begin_rehash(table, table->capacity / 2);
+        }
+    }
+    return true;
+}
+
+u32 hashtable_get_batch(hashtable* table, const char** names, u32 count, void* out_values)
+{
+    if (!table || !names || !out_values) {
+        LWARN("hashtable_get_batch requires table, names, and out_values to exist.");
+        return 0;
+    }
+
+    u32 found = 0;
+    u64 hashes[HASHTABLE_BATCH_SIZE];
+    for (u32 start = 0; start < count; start += HASHTABLE_BATCH_SIZE) {
+        u32 batch_count = count - start < HASHTABLE_BATCH_SIZE ? count - start : HASHTABLE_BATCH_SIZE;
+        const char** batch_names = names + start;
+
+        // Hash every name and ask for its home slot and value, so the misses on all of them
+        // are in flight at once, rather than each waiting for the one before it.
+        slot_array current = current_array(table);
+        slot_array previous = previous_array(table);
+        for (u32 i = 0; i < batch_count; ++i) {
+            hashes[i] = batch_names[i] ? hash_string(batch_names[i]) : 0;
+            u32 home = home_slot(&current, hashes[i]);
+            LPREFETCH(&current.slots[home]);
+            LPREFETCH(value_at(&current, home));
+            if (table->previous_count) {
+                u32 previous_home = home_slot(&previous, hashes[i]);
+                LPREFETCH(&previous.slots[previous_home]);
+                LPREFETCH(value_at(&previous, previous_home));
+            }
+        }
+
+        // The home slots are (ideally) in cache now. Ask for the key each one holds, which is
+        // the next thing a probe reads, before probing any of them.
+        for (u32 i = 0; i < batch_count; ++i) {
+            hashtable_slot* slot = &current.slots[home_slot(&current, hashes[i])];
+            if (slot->key && slot->hash == hashes[i]) {
+                LPREFETCH(slot->key);
+            }
+        }
+
+        for (u32 i = 0; i < batch_count; ++i) {
+            void* out_value = (u8*)out_values + (table->element_size * (start + i));
+            slot_array array;
+            u32 index = batch_names[i] ? find_entry(table, batch_names[i], hashes[i], &array) : INVALID_ID;
+            if (index != INVALID_ID) {
+                lcopy_memory(out_value, value_at(&array, index), table->element_size);
+                found++;
+            } else if (table->is_pointer_type) {
+                *(void**)out_value = 0;
+            }
+        }
+    }
+
+    return found;
+}
+
+void hashtable_clear(hashtable* table)
+{
+    if (table && table->memory) {
+        if (table->previous_memory && table->allocator) {
+            allocator_free(table->allocator, table->previous_memory, array_size(table->element_size, table->previous_capacity), LMEMORY_DEFAULT_ALIGNMENT);
+        }
+        table->previous_memory = 0;
+        table->previous_values = 0;
+        table->previous_capacity = 0;
+        table->previous_count = 0;
+        table->rehash_index = 0;
+
+        lzero_memory(table->memory, array_size(table->element_size, table->capacity));
+        table->count = 0;
+    }
+}
+
+b8 hashtable_get_stats(hashtable* table, hashtable_stats* out_stats)
+{
+    if (!table || !out_stats) {
+        LWARN("hashtable_get_stats requires table and out_stats to exist.");
         return false;
     }
 
-    for (u32 i = 0; i < table->element_count; ++i) {
-        lcopy_memory(table->memory + (table->element_size * i), value, table->element_size);
+    lzero_memory(out_stats, sizeof(hashtable_stats));
+    out_stats->count = table->count;
+    out_stats->capacity = table->capacity;
+    out_stats->rehashing = table->previous_memory != 0;
+    if (!table->capacity) {
+        return true;
+    }
+    out_stats->load_factor = (f32)table->count / (f32)table->capacity;
+
+    // While rehashing, entries in either array count, each measured within its own array.
+    u64 total_distance = 0;
+    for (u32 a = 0; a < 2; ++a) {
+        slot_array array = a == 0 ? current_array(table) : previous_array(table);
+        for (u32 i = 0; i < array.capacity; ++i) {
+            if (array.slots[i].key) {
+                u32 distance = probe_distance(&array, array.slots[i].hash, i);
+                total_distance += distance;
+                if (distance > out_stats->max_probe_length) {
+                    out_stats->max_probe_length = distance;
+                }
+            }
+        }
+    }
+    if (table->count) {
+        out_stats->average_probe_length = (f32)total_distance / (f32)table->count;
     }
 
     return true;
 }
 
+// Private functions
+
+static u32 capacity_for(u32 element_count)
+{
+    // The smallest power of two with enough slots that element_count entries load the table to
+    // at most HASHTABLE_MAX_LOAD_FACTOR. There is always at least one empty slot, which is what
+    // ends a probe for a missing key.
+    u64 minimum = (u64)((f64)element_count / HASHTABLE_MAX_LOAD_FACTOR) + 1;
+    u64 capacity = 1;
+    while (capacity < minimum) {
+        capacity <<= 1;
+    }
+    if (capacity > (1ull << 31)) {
+        return 0;
+    }
+    return (u32)capacity;
+}
+
+static u32 max_entries(u32 capacity)
+{
+    // The most entries the given number of slots holds at HASHTABLE_MAX_LOAD_FACTOR.
+    return (u32)((f64)capacity * HASHTABLE_MAX_LOAD_FACTOR);
+}
+
+static u32 probe_distance(const slot_array* array, u64 hash, u32 index)
+{
+    return (index - home_slot(array, hash)) & (array->capacity - 1);
+}
+
+static u32 find_slot(const slot_array* array, const char* name, u64 hash)
+{
+    hashtable_slot* s = array->slots;
+    u32 index = home_slot(array, hash);
+    for (u32 distance = 0;; ++distance) {
+        if (!s[index].key) {
+            return INVALID_ID;
+        }
+        // Entries in a run are ordered by home slot, so once one is closer to its home than
+        // this probe is to the name's home, the name cannot be further along.
+        if (probe_distance(array, s[index].hash, index) < distance) {
+            return INVALID_ID;
+        }
+        // Names passed by the same pointer they were added with (ie. interned strings) skip the compare.
+        if (s[index].hash == hash && (s[index].key == name || strings_equal(s[index].key, name))) {
+            return index;
+        }
+        index = next_index(array, index);
+    }
+}
+
+static u32 find_entry(const hashtable* table, const char* name, u64 hash, slot_array* out_array)
+{
+    if (!table->count) {
+        return INVALID_ID;
+    }
+
+    // An entry is in exactly one of the arrays. Entries not yet moved by a rehash are in the previous one.
+    *out_array = current_array(table);
+    u32 index = find_slot(out_array, name, hash);
+    if (index == INVALID_ID && table->previous_count) {
+        *out_array = previous_array(table);
+        index = find_slot(out_array, name, hash);
+    }
+    return index;
+}
+
+static void place(slot_array* array, const char* name, u64 hash, const void* value)
+{
+    // Find where the entry belongs: the first slot which is empty, or whose entry is closer to
+    // its home than the new entry would be (ie. it has a later home slot).
+    hashtable_slot* s = array->slots;
+    u32 index = home_slot(array, hash);
+    for (u32 distance = 0; s[index].key; ++distance) {
+        if (probe_distance(array, s[index].hash, index) < distance) {
+            break;
+        }
+        index = next_index(array, index);
+    }
+
+    // Shift the rest of the run along by one, from its end back, which displaces each entry
+    // exactly as swapping them along the run would, without a temporary copy of a value.
+    u32 end = index;
+    while (s[end].key) {
+        end = next_index(array, end);
+    }
+    while (end != index) {
+        u32 previous = (end - 1) & (array->capacity - 1);
+        s[end] = s[previous];
+        lcopy_memory(value_at(array, end), value_at(array, previous), array->element_size);
+        end = previous;
+    }
+
+    s[index].hash = hash;
+    s[index].key = name;
+    lcopy_memory(value_at(array, index), value, array->element_size);
+}
+
+static b8 insert(hashtable* table, const char* name, u64 hash, const void* value)
+{
+    slot_array array;
+    u32 existing = find_entry(table, name, hash, &array);
+    if (existing != INVALID_ID) {
+        lcopy_memory(value_at(&array, existing), value, table->element_size);
+        return true;
+    }
+
+    if (table->count >= table->element_count) {
+        if (!table->growable) {
+            LERROR("hashtable - cannot add '%s'; the table is full at %u entries.", name, table->element_count);
+            return false;
+        }
+        if (!begin_rehash(table, table->capacity * 2)) {
+            LERROR("hashtable - cannot add '%s'; the table is full at %u entries and could not grow.", name, table->element_count);
+            return false;
+        }
+    }
+
+    array = current_array(table);
+    place(&array, name, hash, value);
+    table->count++;
+
+    if (table->growable) {
+        rehash_step(table, HASHTABLE_REHASH_SLOTS_PER_OP);
+    }
+    return true;
+}
+
+static void remove_at(slot_array* array, u32 index)
+{
+    // Shift each following entry which is not in its home slot back by one, closing the gap
+    // so no tombstone is needed to keep later entries reachable.
+    hashtable_slot* s = array->slots;
+    u32 next = next_index(array, index);
+    while (s[next].key && probe_distance(array, s[next].hash, next) > 0) {
+        s[index] = s[next];
+        lcopy_memory(value_at(array, index), value_at(array, next), array->element_size);
+        index = next;
+        next = next_index(array, next);
+    }
+
+    s[index].hash = 0;
+    s[index].key = 0;
+    lzero_memory(value_at(array, index), array->element_size);
+}
+
+static b8 begin_rehash(hashtable* table, u32 new_capacity)
+{
+    if (new_capacity > (1u << 31)) {
+        return false;
+    }
+
+    // Only one rehash runs at a time. One still running is finished first; by the time the
+    // table needs another, little (if anything) is left of it.
+    rehash_step(table, INVALID_ID);
+
+    u64 size = array_size(table->element_size, new_capacity);
+    void* memory = allocator_allocate(table->allocator, size, LMEMORY_DEFAULT_ALIGNMENT);
+    if (!memory) {
+        return false;
+    }
+    lzero_memory(memory, size);
+
+    table->previous_memory = table->memory;
+    table->previous_values = table->values;
+    table->previous_capacity = table->capacity;
+    table->previous_count = table->count;
+    table->rehash_index = 0;
+
+    table->memory = memory;
+    table->values = (u8*)memory + (sizeof(hashtable_slot) * new_capacity);
+    table->capacity = new_capacity;
+    table->element_count = max_entries(new_capacity);
+    return true;
+}
+
+static void rehash_step(hashtable* table, u32 max_slots)
+{
+    if (!table->previous_memory) {
+        return;
+    }
+
+    slot_array previous = previous_array(table);
+    slot_array current = current_array(table);
+    for (u32 i = 0; i < max_slots && table->previous_count; ++i) {
+        hashtable_slot* slot = &previous.slots[table->rehash_index];
+        if (slot->key) {
+            // Removing the entry shifts the rest of its run back into this slot, so stay here
+            // until it is empty. Nothing is ever shifted into a slot already passed.
+            place(&current, slot->key, slot->hash, value_at(&previous, table->rehash_index));
+            remove_at(&previous, table->rehash_index);
+            table->previous_count--;
+        } else {
+            table->rehash_index++;
+        }
+    }
+
+    if (!table->previous_count) {
+        allocator_free(table->allocator, table->previous_memory, array_size(table->element_size, table->previous_capacity), LMEMORY_DEFAULT_ALIGNMENT);
+        table->previous_memory = 0;
+        table->previous_values = 0;
+        table->previous_capacity = 0;
+        table->rehash_index = 0;
+    }
+}
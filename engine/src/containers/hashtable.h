@@ -2,6 +2,50 @@
 
 #include "defines.h"
 
+struct allocator_interface;
+
+/*
+Hashtable:
+
+    Open addressing with Robin Hood probing. Each slot holds the full 64-bit hash of its
+    key, a pointer to the key and the value. Lookups compare the stored hash before the
+    key string, so a collision on the home slot costs an integer compare, not a string
+    compare, and two keys can never share an entry.
+
+    Entries are kept in order of their home slot within a run of occupied slots, which
+    keeps probe lengths short and even, and lets a lookup for a missing key stop as soon
+    as it reaches an entry closer to its home than the probe is. Removal shifts the rest
+    of the run back a slot, so there are no tombstones to clean up.
+
+    Names are hashed with hash_string (see core/lhash.h). The slot count is the smallest power
+    of two above element_count / HASHTABLE_MAX_LOAD_FACTOR, so a full table is between 40%
+    and 80% loaded, and the home slot is the low bits of the hash. Robin Hood probing keeps
+    the average probe length to about 2 slots even at 80%.
+
+    Callers which already have the hash of a name (ie. one kept alongside it) can pass it to
+    the _hashed variants, which skip hashing the name again. The hash must be hash_string(name).
+
+    Growable tables (see hashtable_create_growable) own their memory and double their slots
+    when they reach the maximum load factor, halving them again when they fall to an eighth
+    full. Rather than moving every entry at once, which would stall whichever frame happened
+    to add one entry too many, the old slots are kept alongside the new ones and
+    HASHTABLE_REHASH_SLOTS_PER_OP of them are moved over by each set or remove. Lookups check
+    both sets of slots until the move is done.
+
+    The table does 'NOT' copy keys. It keeps the pointer passed in when an entry is first
+    added, so that string must stay valid and unchanged until the entry is removed.
+    Updating an entry keeps the key pointer it was added with.
+ */
+
+/** @brief The most the table will fill its slots, as a fraction of the slot count. */
+#define HASHTABLE_MAX_LOAD_FACTOR 0.8f
+
+/** @brief The number of old slots a growable table moves over per set or remove while rehashing. */
+#define HASHTABLE_REHASH_SLOTS_PER_OP 16
+
+/** @brief The fewest entries a growable table is sized for. It never shrinks below this. */
+#define HASHTABLE_GROWABLE_MIN_COUNT 8
+
 /**
  * @brief Represents a simple hashtable. Members of this structure
  * should not be modified outside the functions associated with it.
@@ -13,21 +57,93 @@
  */
 typedef struct hashtable {
     u64 element_size;
+    /** @brief The maximum number of entries the table can hold. For growable tables, the number it can hold before growing. */
     u32 element_count;
+    /** @brief The number of slots. A power of two, greater than element_count; see HASHTABLE_MAX_LOAD_FACTOR. */
+    u32 capacity;
+    /** @brief The number of entries currently held, including any not yet moved by a rehash. */
+    u32 count;
     b8 is_pointer_type;
+    /** @brief Indicates if the table grows and shrinks as entries are added and removed. */
+    b8 growable;
+    /** @brief The slot count a growable table was created with, and will not shrink below. */
+    u32 min_capacity;
+    /** @brief The block holding the slots, followed by the values. */
     void* memory;
+    /** @brief The values, one per slot, in the same block as the slots. */
+    void* values;
+    /** @brief While rehashing, the block holding the previous slots and values; otherwise 0. */
+    void* previous_memory;
+    /** @brief While rehashing, the previous values. */
+    void* previous_values;
+    /** @brief While rehashing, the previous slot count. */
+    u32 previous_capacity;
+    /** @brief While rehashing, the number of entries still to be moved out of the previous slots. */
+    u32 previous_count;
+    /** @brief While rehashing, the next previous slot to be moved. */
+    u32 rehash_index;
+    /** @brief The allocator the memory was obtained from, or 0 if it was provided by the caller. */
+    const struct allocator_interface* allocator;
 } hashtable;
 
 /**
- * @brief Creates a hashtable and stores it in out_hashtable 
+ * @brief Statistics about the entries and probe lengths of a hashtable.
+ */
+typedef struct hashtable_stats {
+    /** @brief The number of entries held. */
+    u32 count;
+    /** @brief The number of slots. */
+    u32 capacity;
+    /** @brief count / capacity. */
+    f32 load_factor;
+    /** @brief The longest distance of any entry from its home slot. A lookup reads at most this many slots plus one. */
+    u32 max_probe_length;
+    /** @brief The mean distance of entries from their home slots. */
+    f32 average_probe_length;
+    /** @brief Indicates if a rehash is in progress. */
+    b8 rehashing;
+} hashtable_stats;
+
+/**
+ * @brief Creates a hashtable or obtains the memory requirement for one. Should be called twice;
+ * once passing 0 to memory to obtain the memory requirement, then a second time passing an allocated block.
  * 
  * @param element_size The size of each element in bytes.
  * @param element_count The maximum number of elements. Cannot be resized.
- * @param memory A block of memory to be used. Should equal in size to element_size * element_count.
  * @param is_pointer_type Indicates if this hashtable will hold pointer types.
+ * @param memory_requirement A pointer to hold the memory requirement. Required.
+ * @param memory 0; or a block of memory of at least memory_requirement bytes to be used.
+ * @param out_hashtable A pointer to a hashtable in which to hold relevant data. Required if memory is passed.
+ * @return True on success; otherwise false.
+ */
+LAPI b8 hashtable_create(u64 element_size, u32 element_count, b8 is_pointer_type, u64* memory_requirement, void* memory, hashtable* out_hashtable);
+
+/**
+ * @brief Creates a hashtable whose memory is obtained from the given allocator, and stores it in out_hashtable.
+ * The memory is given back to the allocator by hashtable_destroy.
+ * 
+ * @param element_size The size of each element in bytes.
+ * @param element_count The maximum number of elements. Cannot be resized.
+ * @param is_pointer_type Indicates if this hashtable will hold pointer types.
+ * @param allocator A pointer to the allocator to obtain memory from. Must outlive the table. Required.
  * @param out_hashtable A pointer to a hashtable in which to hold relevant data.
+ * @return True on success; false if a null pointer is passed or the allocator is out of memory.
  */
-LAPI void hashtable_create(u64 element_size, u32 element_count, void* memory, b8 is_pointer_type, hashtable* out_hashtable);
+LAPI b8 hashtable_create_with_allocator(u64 element_size, u32 element_count, b8 is_pointer_type, const struct allocator_interface* allocator, hashtable* out_hashtable);
+
+/**
+ * @brief Creates a growable hashtable whose memory is obtained from the given allocator, and stores it
+ * in out_hashtable. The table starts with room for initial_count entries, grows as entries are added
+ * and shrinks as they are removed, rehashing a few slots at a time. See the notes at the top of this file.
+ * 
+ * @param element_size The size of each element in bytes.
+ * @param initial_count The number of entries to make room for up front. At least HASHTABLE_GROWABLE_MIN_COUNT is used.
+ * @param is_pointer_type Indicates if this hashtable will hold pointer types.
+ * @param allocator A pointer to the allocator to obtain memory from. Must outlive the table. Required.
+ * @param out_hashtable A pointer to a hashtable in which to hold relevant data.
+ * @return True on success; false if a null pointer is passed or the allocator is out of memory.
+ */
+LAPI b8 hashtable_create_growable(u64 element_size, u32 initial_count, b8 is_pointer_type, const struct allocator_interface* allocator, hashtable* out_hashtable);
 
 /**
  * @brief Destroys the provided hashtable. Does not release memory for pointer types
@@ -37,13 +153,13 @@ LAPI void hashtable_create(u64 element_size, u32 element_count, void* memory, b8
 LAPI void hashtable_destroy(hashtable* table);
 
 /**
- * @brief Stores a copy of the data in value in the provided hashtable.
- * Only use for tables which were 'NOT' created with is_pointer_type = true.
+ * @brief Stores a copy of the data in value in the provided hashtable, adding an entry
+ * if none exists for the name. Only use for tables which were 'NOT' created with is_pointer_type = true.
  * 
  * @param table A pointer to the table to get from. Required.
- * @param name The name of the entry to set. Required.
+ * @param name The name of the entry to set. Required. Kept by pointer if a new entry is added.
  * @param value The value to be set. Required.
- * @return True, or false if a null pointer is passed.
+ * @return True, or false if a null pointer is passed or the table is full (or could not grow).
  */
 LAPI b8 hashtable_set(hashtable* table, const char* name, void* value);
 
@@ -52,9 +168,9 @@ LAPI b8 hashtable_set(hashtable* table, const char* name, void* value);
  * Only use for tables which were created with is_pointer_type = true.
  * 
  * @param table A pointer to the table to get from. Required.
- * @param name The name of the entry to set. Required.
- * @param value The value to be set. Can pass 0 to 'unset' an entry.
- * @return True, or false if a null pointer is passed or if the entry is 0.
+ * @param name The name of the entry to set. Required. Kept by pointer if a new entry is added.
+ * @param value The value to be set. Can pass 0 (or a pointer to 0) to remove an entry.
+ * @return True, or false if a null pointer is passed or the table is full (or could not grow).
  */
 LAPI b8 hashtable_set_ptr(hashtable* table, const char* name, void** value);
 
@@ -63,9 +179,9 @@ LAPI b8 hashtable_set_ptr(hashtable* table, const char* name, void** value);
  * Only use for tables which were 'NOT' created with is_pointer_type = true.
  * 
  * @param table A pointer to the table to get from. Required.
- * @param name The name of the entry to set. Required.
- * @param out_value The value to be set. Required.
- * @return True, or false if a null pointer is passed.
+ * @param name The name of the entry to get. Required.
+ * @param out_value A pointer to hold the value. Required. Left untouched if there is no entry.
+ * @return True if an entry was found; false if there is none or a null pointer is passed.
  */
 LAPI b8 hashtable_get(hashtable* table, const char* name, void* out_value);
 
@@ -74,19 +190,114 @@ LAPI b8 hashtable_get(hashtable* table, const char* name, void* out_value);
  * Only use for tables which were created with is_pointer_type = true.
  * 
  * @param table A pointer to the table to get from. Required.
- * @param name The name of the entry to set. Required.
- * @param value The value to be set. Can pass 0 to 'unset' an entry.
- * @return True, or false if a null pointer is passed or if the entry is 0.
+ * @param name The name of the entry to get. Required.
+ * @param out_value A pointer to hold the pointer. Required. Set to 0 if there is no entry.
+ * @return True if an entry was found; false if there is none or a null pointer is passed.
  */
 LAPI b8 hashtable_get_ptr(hashtable* table, const char* name, void** out_value);
 
 /**
- * @brief Fills all entries in the hashtable with the given value.
- * Useful when non-existent names should return some default value.
- * Should not be used with pointer table types.
+ * @brief Removes the entry for the given name, if there is one. Works for either table type.
+ * 
+ * @param table A pointer to the table to remove from. Required.
+ * @param name The name of the entry to remove. Required.
+ * @return True if an entry was removed; false if there was none or a null pointer is passed.
+ */
+LAPI b8 hashtable_remove(hashtable* table, const char* name);
+
+/**
+ * @brief As hashtable_set, for a name whose hash is already known.
+ * 
+ * @param table A pointer to the table to set in. Required.
+ * @param name The name of the entry to set. Required. Kept by pointer if a new entry is added.
+ * @param hash The hash of name. Must be hash_string(name).
+ * @param value The value to be set. Required.
+ * @return True, or false if a null pointer is passed or the table is full (or could not grow).
+ */
+LAPI b8 hashtable_set_hashed(hashtable* table, const char* name, u64 hash, void* value);
+
+/**
+ * @brief As hashtable_set_ptr, for a name whose hash is already known.
+ * 
+ * @param table A pointer to the table to set in. Required.
+ * @param name The name of the entry to set. Required. Kept by pointer if a new entry is added.
+ * @param hash The hash of name. Must be hash_string(name).
+ * @param value The value to be set. Can pass 0 (or a pointer to 0) to remove an entry.
+ * @return True, or false if a null pointer is passed or the table is full (or could not grow).
+ */
+LAPI b8 hashtable_set_ptr_hashed(hashtable* table, const char* name, u64 hash, void** value);
+
+/**
+ * @brief As hashtable_get, for a name whose hash is already known.
+ * 
+ * @param table A pointer to the table to get from. Required.
+ * @param name The name of the entry to get. Required.
+ * @param hash The hash of name. Must be hash_string(name).
+ * @param out_value A pointer to hold the value. Required. Left untouched if there is no entry.
+ * @return True if an entry was found; false if there is none or a null pointer is passed.
+ */
+LAPI b8 hashtable_get_hashed(hashtable* table, const char* name, u64 hash, void* out_value);
+
+/**
+ * @brief As hashtable_get_ptr, for a name whose hash is already known.
+ * 
+ * @param table A pointer to the table to get from. Required.
+ * @param name The name of the entry to get. Required.
+ * @param hash The hash of name. Must be hash_string(name).
+ * @param out_value A pointer to hold the pointer. Required. Set to 0 if there is no entry.
+ * @return True if an entry was found; false if there is none or a null pointer is passed.
+ */
+LAPI b8 hashtable_get_ptr_hashed(hashtable* table, const char* name, u64 hash, void** out_value);
+
+/**
+ * @brief Obtains a pointer to the value stored for a name whose hash is already known, so it can be
+ * read or modified in place rather than copied out and set again. Works for either table type; for
+ * pointer tables, the value is the stored pointer.
+ * 
+ * @param table A pointer to the table to search. Required.
+ * @param name The name of the entry to find. Required.
+ * @param hash The hash of name. Must be hash_string(name).
+ * @return A pointer to the value, valid until the table is next added to or removed from; 0 if there is no entry.
+ */
+LAPI void* hashtable_find_hashed(hashtable* table, const char* name, u64 hash);
+
+/**
+ * @brief As hashtable_remove, for a name whose hash is already known.
+ * 
+ * @param table A pointer to the table to remove from. Required.
+ * @param name The name of the entry to remove. Required.
+ * @param hash The hash of name. Must be hash_string(name).
+ * @return True if an entry was removed; false if there was none or a null pointer is passed.
+ */
+LAPI b8 hashtable_remove_hashed(hashtable* table, const char* name, u64 hash);
+
+/**
+ * @brief Looks up a number of names at once. Works for either table type. The names are hashed and
+ * the slots they map to prefetched a batch at a time before any are probed, so the cache misses
+ * overlap rather than being paid one after another. Worth it whenever more than a handful of names
+ * are resolved together, such as a material list or a scene manifest.
+ * 
+ * @param table A pointer to the table to get from. Required.
+ * @param names An array of count names to look up. A 0 entry is treated as a miss.
+ * @param count The number of names.
+ * @param out_values An array of count values (of element_size each) to hold the results, in the order of names.
+ * Values for names with no entry are left untouched, or set to 0 for pointer tables. Required.
+ * @return The number of names found.
+ */
+LAPI u32 hashtable_get_batch(hashtable* table, const char** names, u32 count, void* out_values);
+
+/**
+ * @brief Removes every entry from the table.
+ * 
+ * @param table A pointer to the table to be cleared. Required.
+ */
+LAPI void hashtable_clear(hashtable* table);
+
+/**
+ * @brief Obtains statistics about the provided table. Walks every slot, so is not meant to be called per frame.
  * 
- * @param table A pointer to the table to be filled. Required.
- * @param value The value with which to fill the table. Required.
- * @return True if successful; false otherwise
+ * @param table A pointer to the table. Required.
+ * @param out_stats A pointer to hold the statistics. Required.
+ * @return True on success; false if a null pointer is passed.
  */
-LAPI b8 hashtable_fill(hashtable* table, void* value);
\ No newline at end of file
+LAPI b8 hashtable_get_stats(hashtable* table, hashtable_stats* out_stats);
@@ -0,0 +1,347 @@
+#include "ring_queue.h"
+
+#include "core/lmemory.h"
+#include "core/logger.h"
+
+// Private functions
+static u64 capacity_for(u32 capacity);
+static void copy_into_ring(u8* elements, u64 element_size, u64 capacity, u64 position, const u8* values, u64 count);
+static void copy_out_of_ring(const u8* elements, u64 element_size, u64 capacity, u64 position, u8* out_values, u64 count);
+
+LINLINE u64 load_relaxed(const u64* value)
+{
+    return __atomic_load_n(value, __ATOMIC_RELAXED);
+}
+
+LINLINE u64 load_acquire(const u64* value)
+{
+    return __atomic_load_n(value, __ATOMIC_ACQUIRE);
+}
+
+LINLINE void store_release(u64* value, u64 new_value)
+{
+    __atomic_store_n(value, new_value, __ATOMIC_RELEASE);
+}
+
+// The sequence number at the start of the slot for the given position.
+LINLINE u64* slot_sequence(const mpmc_queue* queue, u64 position)
+{
+    return (u64*)(queue->slots + ((position & queue->mask) * queue->slot_size));
+}
+
+LINLINE void* slot_element(const mpmc_queue* queue, u64 position)
+{
+    return queue->slots + ((position & queue->mask) * queue->slot_size) + sizeof(u64);
+}
+
+b8 spsc_queue_create(u64 element_size, u32 capacity, u64* memory_requirement, void* memory, spsc_queue* out_queue)
+{
+    if (!memory_requirement || element_size == 0 || capacity == 0) {
+        LERROR("spsc_queue_create requires a memory_requirement pointer, and an element_size and capacity > 0.");
+        return false;
+    }
+
+    u64 actual_capacity = capacity_for(capacity);
+    *memory_requirement = element_size * actual_capacity;
+    if (!memory) {
+        return true;
+    }
+    if (!out_queue) {
+        LERROR("spsc_queue_create requires a valid pointer to hold the queue.");
+        return false;
+    }
+
+    lzero_memory(out_queue, sizeof(spsc_queue));
+    out_queue->element_size = element_size;
+    out_queue->capacity = actual_capacity;
+    out_queue->mask = actual_capacity - 1;
+    out_queue->elements = memory;
+    return true;
+}
+
+void spsc_queue_destroy(spsc_queue* queue)
+{
+    if (queue) {
+        lzero_memory(queue, sizeof(spsc_queue));
+    }
+}
+
+b8 spsc_queue_enqueue(spsc_queue* queue, const void* value)
+{
+    u64 tail = queue->tail;
+    if (tail - queue->cached_head >= queue->capacity) {
+        // Looks full. Only now look at where the consumer actually is.
+        queue->cached_head = load_acquire(&queue->head);
+        if (tail - queue->cached_head >= queue->capacity) {
+            return false;
+        }
+    }
+
+    lcopy_memory(queue->elements + ((tail & queue->mask) * queue->element_size), value, queue->element_size);
+    // Publish the element. The consumer's acquire of tail sees the copy above.
+    store_release(&queue->tail, tail + 1);
+    return true;
+}
+
+b8 spsc_queue_dequeue(spsc_queue* queue, void* out_value)
+{
+    u64 head = queue->head;
+    if (head == queue->cached_tail) {
+        // Looks empty. Only now look at where the producer actually is.
+        queue->cached_tail = load_acquire(&queue->tail);
+        if (head == queue->cached_tail) {
+            return false;
+        }
+    }
+
+    lcopy_memory(out_value, queue->elements + ((head & queue->mask) * queue->element_size), queue->element_size);
+    // Hand the slot back. The producer's acquire of head sees the copy out finished.
+    store_release(&queue->head, head + 1);
+    return true;
+}
+
+u32 spsc_queue_enqueue_batch(spsc_queue* queue, const void* values, u32 count)
+{
+    u64 tail = queue->tail;
+    u64 space = queue->capacity - (tail - queue->cached_head);
+    if (space < count) {
+        queue->cached_head = load_acquire(&queue->head);
+        space = queue->capacity - (tail - queue->cached_head);
+    }
+
+    u64 n = space < count ? space : count;
+    if (n) {
+        copy_into_ring(queue->elements, queue->element_size, queue->capacity, tail, values, n);
+        store_release(&queue->tail, tail + n);
+    }
+    return (u32)n;
+}
+
+u32 spsc_queue_dequeue_batch(spsc_queue* queue, void* out_values, u32 max_count)
+{
+    u64 head = queue->head;
+    u64 available = queue->cached_tail - head;
+    if (available < max_count) {
+        queue->cached_tail = load_acquire(&queue->tail);
+        available = queue->cached_tail - head;
+    }
+
+    u64 n = available < max_count ? available : max_count;
+    if (n) {
+        copy_out_of_ring(queue->elements, queue->element_size, queue->capacity, head, out_values, n);
+        store_release(&queue->head, head + n);
+    }
+    return (u32)n;
+}
+
+u32 spsc_queue_count(spsc_queue* queue)
+{
+    // Head first; reading tail after it can only overcount what has since been dequeued, never underflow.
+    u64 head = load_acquire(&queue->head);
+    u64 tail = load_acquire(&queue->tail);
+    return (u32)(tail - head);
+}
+
+b8 mpmc_queue_create(u64 element_size, u32 capacity, u64* memory_requirement, void* memory, mpmc_queue* out_queue)
+{
+    if (!memory_requirement || element_size == 0 || capacity == 0) {
+        LERROR("mpmc_queue_create requires a memory_requirement pointer, and an element_size and capacity > 0.");
+        return false;
+    }
+
+    // With a single slot, a slot ready to be read for one position looks ready to be written for the next.
+    u64 actual_capacity = capacity_for(capacity < 2 ? 2 : capacity);
+    u64 slot_size = (sizeof(u64) + element_size + 7) & ~(u64)7;
+    *memory_requirement = slot_size * actual_capacity;
+    if (!memory) {
+        return true;
+    }
+    if (!out_queue) {
+        LERROR("mpmc_queue_create requires a valid pointer to hold the queue.");
+        return false;
+    }
+
+    lzero_memory(out_queue, sizeof(mpmc_queue));
+    out_queue->element_size = element_size;
+    out_queue->capacity = actual_capacity;
+    out_queue->mask = actual_capacity - 1;
+    out_queue->slot_size = slot_size;
+    out_queue->slots = memory;
+
+    // Each slot starts out ready to be written for the position of its index.
+    for (u64 i = 0; i < actual_capacity; ++i) {
+        *slot_sequence(out_queue, i) = i;
+    }
+    return true;
+}
+
+void mpmc_queue_destroy(mpmc_queue* queue)
+{
+    if (queue) {
+        lzero_memory(queue, sizeof(mpmc_queue));
+    }
+}
+
+b8 mpmc_queue_enqueue(mpmc_queue* queue, const void* value)
+{
+    u64 position = load_relaxed(&queue->enqueue_position);
+    for (;;) {
+        u64 sequence = load_acquire(slot_sequence(queue, position));
+        i64 difference = (i64)(sequence - position);
+        if (difference == 0) {
+            // The slot is free for this position. Claim it, unless another producer got there first.
+            if (__atomic_compare_exchange_n(&queue->enqueue_position, &position, position + 1, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+                break;
+            }
+        } else if (difference < 0) {
+            // The slot still holds the element from a lap ago, not yet dequeued.
+            return false;
+        } else {
+            // Another producer claimed this position already.
+            position = load_relaxed(&queue->enqueue_position);
+        }
+    }
+
+    lcopy_memory(slot_element(queue, position), value, queue->element_size);
+    // Publish the element for consumers of this position.
+    store_release(slot_sequence(queue, position), position + 1);
+    return true;
+}
+
+b8 mpmc_queue_dequeue(mpmc_queue* queue, void* out_value)
+{
+    u64 position = load_relaxed(&queue->dequeue_position);
+    for (;;) {
+        u64 sequence = load_acquire(slot_sequence(queue, position));
+        i64 difference = (i64)(sequence - (position + 1));
+        if (difference == 0) {
+            // The slot holds the element for this position. Claim it, unless another consumer got there first.
+            if (__atomic_compare_exchange_n(&queue->dequeue_position, &position, position + 1, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+                break;
+            }
+        } else if (difference < 0) {
+            // Nothing has been published for this position yet.
+            return false;
+        } else {
+            // Another consumer claimed this position already.
+            position = load_relaxed(&queue->dequeue_position);
+        }
+    }
+
+    lcopy_memory(out_value, slot_element(queue, position), queue->element_size);
+    // Free the slot for the producer of the same slot a lap from now.
+    store_release(slot_sequence(queue, position), position + queue->capacity);
+    return true;
+}
+
+u32 mpmc_queue_enqueue_batch(mpmc_queue* queue, const void* values, u32 count)
+{
+    if (!count) {
+        return 0;
+    }
+
+    u64 position = load_relaxed(&queue->enqueue_position);
+    u64 n = 0;
+    for (;;) {
+        // Count the slots from position on which are free, up to count. Until the claim below succeeds
+        // they may be claimed by others, but a slot never goes back to being free for the same position.
+        u64 limit = count < queue->capacity ? count : queue->capacity;
+        n = 0;
+        while (n < limit && load_acquire(slot_sequence(queue, position + n)) == position + n) {
+            n++;
+        }
+
+        if (n == 0) {
+            i64 difference = (i64)(load_acquire(slot_sequence(queue, position)) - position);
+            if (difference < 0) {
+                // Full.
+                return 0;
+            }
+            position = load_relaxed(&queue->enqueue_position);
+            continue;
+        }
+
+        if (__atomic_compare_exchange_n(&queue->enqueue_position, &position, position + n, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+            break;
+        }
+        // position now holds the current enqueue position; try again from there.
+    }
+
+    const u8* source = values;
+    for (u64 i = 0; i < n; ++i) {
+        lcopy_memory(slot_element(queue, position + i), source + (i * queue->element_size), queue->element_size);
+        store_release(slot_sequence(queue, position + i), position + i + 1);
+    }
+    return (u32)n;
+}
+
+u32 mpmc_queue_dequeue_batch(mpmc_queue* queue, void* out_values, u32 max_count)
+{
+    if (!max_count) {
+        return 0;
+    }
+
+    u64 position = load_relaxed(&queue->dequeue_position);
+    u64 n = 0;
+    for (;;) {
+        // Count the slots from position on which have been published, up to max_count.
+        u64 limit = max_count < queue->capacity ? max_count : queue->capacity;
+        n = 0;
+        while (n < limit && load_acquire(slot_sequence(queue, position + n)) == position + n + 1) {
+            n++;
+        }
+
+        if (n == 0) {
+            i64 difference = (i64)(load_acquire(slot_sequence(queue, position)) - (position + 1));
+            if (difference < 0) {
+                // Empty, or the next element is still being written.
+                return 0;
+            }
+            position = load_relaxed(&queue->dequeue_position);
+            continue;
+        }
+
+        if (__atomic_compare_exchange_n(&queue->dequeue_position, &position, position + n, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+            break;
+        }
+    }
+
+    u8* destination = out_values;
+    for (u64 i = 0; i < n; ++i) {
+        lcopy_memory(destination + (i * queue->element_size), slot_element(queue, position + i), queue->element_size);
+        store_release(slot_sequence(queue, position + i), position + i + queue->capacity);
+    }
+    return (u32)n;
+}
+
+// Private functions
+
+static u64 capacity_for(u32 capacity)
+{
+    u64 result = 1;
+    while (result < capacity) {
+        result <<= 1;
+    }
+    return result;
+}
+
+// Copies count elements into the ring starting at position, in up to two runs if it wraps around.
+static void copy_into_ring(u8* elements, u64 element_size, u64 capacity, u64 position, const u8* values, u64 count)
+{
+    u64 index = position & (capacity - 1);
+    u64 first = capacity - index < count ? capacity - index : count;
+    lcopy_memory(elements + (index * element_size), values, first * element_size);
+    if (first < count) {
+        lcopy_memory(elements, values + (first * element_size), (count - first) * element_size);
+    }
+}
+
+static void copy_out_of_ring(const u8* elements, u64 element_size, u64 capacity, u64 position, u8* out_values, u64 count)
+{
+    u64 index = position & (capacity - 1);
+    u64 first = capacity - index < count ? capacity - index : count;
+    lcopy_memory(out_values, elements + (index * element_size), first * element_size);
+    if (first < count) {
+        lcopy_memory(out_values + (first * element_size), elements, (count - first) * element_size);
+    }
+}
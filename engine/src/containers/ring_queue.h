@@ -0,0 +1,223 @@
+/**
+ * @file ring_queue.h
+ *
+ * @brief Definitions of bounded, lock-free ring queues: one for a single producer and a single
+ * consumer thread, and one for any number of each.
+ * @version 0.1
+ * @date 2024-05-27
+ *
+ */
+
+#pragma once
+#include "defines.h"
+
+/*
+Ring queues:
+
+    Both queues hold a fixed number of fixed size elements in a ring, copying them in on enqueue
+    and out on dequeue. The capacity is rounded up to a power of two, so a position in the ring is
+    the low bits of an ever-increasing 64-bit counter. Neither queue ever blocks or allocates:
+    enqueueing to a full queue and dequeueing from an empty one simply fail, and it is up to the
+    caller to retry, drop or wait.
+
+    The fields written by the producing side and by the consuming side are each on their own
+    cache line, so the two sides do not invalidate each other's cache line on every operation.
+
+    spsc_queue: One producer thread and one consumer thread (which may be the same thread). Each
+    side owns its own counter, and keeps a cached copy of the other side's, so it only reads the
+    other side's cache line when the queue looks full (or empty).
+
+    mpmc_queue: Any number of producer and consumer threads (Dmitry Vyukov's bounded MPMC queue).
+    Each slot holds a sequence number alongside its element, saying which position it is ready to
+    be written (or read) for. Producers claim a position with a compare-and-swap on the enqueue
+    counter, write the element, then publish it by advancing the slot's sequence; consumers do the
+    same with the dequeue counter. Threads only contend on the counter itself, never on a lock.
+
+    The batch operations move as many elements as are available (up to the count asked for) at
+    once, paying for the cross-thread synchronization once rather than per element.
+
+    Like the other containers, the queues do not allocate their own memory. Create is called
+    twice; once to obtain the memory requirement, then again with a block of at least that size,
+    which must outlive the queue.
+ */
+
+/** @brief The size in bytes of a cache line, which the queue counters are kept apart by. */
+#define RING_QUEUE_CACHE_LINE_SIZE 64
+
+/**
+ * @brief A bounded, lock-free queue for a single producer and a single consumer thread.
+ * Members of this structure should not be modified outside the functions associated with it.
+ */
+typedef struct spsc_queue {
+    // Set on create; only read after that.
+    u64 element_size;
+    u64 capacity;
+    u64 mask;
+    u8* elements;
+    u8 padding0[RING_QUEUE_CACHE_LINE_SIZE - (3 * sizeof(u64)) - sizeof(u8*)];
+
+    // Written by the consumer only. The position of the next element to dequeue, and the last tail it saw.
+    u64 head;
+    u64 cached_tail;
+    u8 padding1[RING_QUEUE_CACHE_LINE_SIZE - (2 * sizeof(u64))];
+
+    // Written by the producer only. The position of the next element to enqueue, and the last head it saw.
+    u64 tail;
+    u64 cached_head;
+    u8 padding2[RING_QUEUE_CACHE_LINE_SIZE - (2 * sizeof(u64))];
+} spsc_queue;
+
+/**
+ * @brief A bounded, lock-free queue for any number of producer and consumer threads.
+ * Members of this structure should not be modified outside the functions associated with it.
+ */
+typedef struct mpmc_queue {
+    // Set on create; only read after that.
+    u64 element_size;
+    u64 capacity;
+    u64 mask;
+    // The size of a slot: its sequence number then its element, padded to 8 bytes.
+    u64 slot_size;
+    u8* slots;
+    u8 padding0[RING_QUEUE_CACHE_LINE_SIZE - (4 * sizeof(u64)) - sizeof(u8*)];
+
+    // The position of the next element to enqueue. Claimed by producers.
+    u64 enqueue_position;
+    u8 padding1[RING_QUEUE_CACHE_LINE_SIZE - sizeof(u64)];
+
+    // The position of the next element to dequeue. Claimed by consumers.
+    u64 dequeue_position;
+    u8 padding2[RING_QUEUE_CACHE_LINE_SIZE - sizeof(u64)];
+} mpmc_queue;
+
+/**
+ * @brief Creates a new single producer, single consumer queue or obtains the memory requirement for one.
+ * Should be called twice; once passing 0 to memory to obtain the memory requirement, then a second time
+ * passing an allocated block.
+ *
+ * @param element_size The size in bytes of each element.
+ * @param capacity The number of elements the queue should hold. Rounded up to a power of two.
+ * @param memory_requirement A pointer to hold the memory requirement of the elements.
+ * @param memory 0; or a pre-allocated block of memory for the elements.
+ * @param out_queue A pointer to hold the created queue.
+ * @return True on success; otherwise false.
+ */
+LAPI b8 spsc_queue_create(u64 element_size, u32 capacity, u64* memory_requirement, void* memory, spsc_queue* out_queue);
+
+/**
+ * @brief Destroys the provided queue. The memory passed to create is not freed. Neither side may
+ * be using the queue.
+ *
+ * @param queue A pointer to the queue to be destroyed.
+ */
+LAPI void spsc_queue_destroy(spsc_queue* queue);
+
+/**
+ * @brief Adds an element to the back of the queue. Producer thread only.
+ *
+ * @param queue A pointer to the queue.
+ * @param value A pointer to the element to be copied in.
+ * @return True if the element was added; false if the queue is full.
+ */
+LAPI b8 spsc_queue_enqueue(spsc_queue* queue, const void* value);
+
+/**
+ * @brief Removes the element at the front of the queue. Consumer thread only.
+ *
+ * @param queue A pointer to the queue.
+ * @param out_value A pointer to hold the element.
+ * @return True if an element was removed; false if the queue is empty.
+ */
+LAPI b8 spsc_queue_dequeue(spsc_queue* queue, void* out_value);
+
+/**
+ * @brief Adds as many of the given elements as there is room for to the back of the queue, in
+ * order. Producer thread only.
+ *
+ * @param queue A pointer to the queue.
+ * @param values An array of count elements.
+ * @param count The number of elements to add.
+ * @return The number of elements added, from the start of values.
+ */
+LAPI u32 spsc_queue_enqueue_batch(spsc_queue* queue, const void* values, u32 count);
+
+/**
+ * @brief Removes up to max_count elements from the front of the queue, in order. Consumer thread only.
+ *
+ * @param queue A pointer to the queue.
+ * @param out_values An array with room for max_count elements.
+ * @param max_count The most elements to remove.
+ * @return The number of elements removed.
+ */
+LAPI u32 spsc_queue_dequeue_batch(spsc_queue* queue, void* out_values, u32 max_count);
+
+/**
+ * @brief Obtains the number of elements in the queue. Only a snapshot if the other side is active.
+ *
+ * @param queue A pointer to the queue.
+ * @return The number of elements.
+ */
+LAPI u32 spsc_queue_count(spsc_queue* queue);
+
+/**
+ * @brief Creates a new multiple producer, multiple consumer queue or obtains the memory requirement for one.
+ * Should be called twice; once passing 0 to memory to obtain the memory requirement, then a second time
+ * passing an allocated block.
+ *
+ * @param element_size The size in bytes of each element.
+ * @param capacity The number of elements the queue should hold. Rounded up to a power of two, and at least 2.
+ * @param memory_requirement A pointer to hold the memory requirement of the slots.
+ * @param memory 0; or a pre-allocated block of memory for the slots. Must be 8 byte aligned.
+ * @param out_queue A pointer to hold the created queue.
+ * @return True on success; otherwise false.
+ */
+LAPI b8 mpmc_queue_create(u64 element_size, u32 capacity, u64* memory_requirement, void* memory, mpmc_queue* out_queue);
+
+/**
+ * @brief Destroys the provided queue. The memory passed to create is not freed. No thread may be
+ * using the queue.
+ *
+ * @param queue A pointer to the queue to be destroyed.
+ */
+LAPI void mpmc_queue_destroy(mpmc_queue* queue);
+
+/**
+ * @brief Adds an element to the back of the queue. Any thread.
+ *
+ * @param queue A pointer to the queue.
+ * @param value A pointer to the element to be copied in.
+ * @return True if the element was added; false if the queue is full.
+ */
+LAPI b8 mpmc_queue_enqueue(mpmc_queue* queue, const void* value);
+
+/**
+ * @brief Removes the element at the front of the queue. Any thread.
+ *
+ * @param queue A pointer to the queue.
+ * @param out_value A pointer to hold the element.
+ * @return True if an element was removed; false if the queue is empty.
+ */
+LAPI b8 mpmc_queue_dequeue(mpmc_queue* queue, void* out_value);
+
+/**
+ * @brief Adds as many of the given elements as there is room for to the back of the queue, claiming
+ * all of their positions at once. They are kept in order, though elements from other producers
+ * may be dequeued before all of them are. Any thread.
+ *
+ * @param queue A pointer to the queue.
+ * @param values An array of count elements.
+ * @param count The number of elements to add.
+ * @return The number of elements added, from the start of values.
+ */
+LAPI u32 mpmc_queue_enqueue_batch(mpmc_queue* queue, const void* values, u32 count);
+
+/**
+ * @brief Removes up to max_count elements from the front of the queue, claiming all of their positions
+ * at once. Any thread.
+ *
+ * @param queue A pointer to the queue.
+ * @param out_values An array with room for max_count elements.
+ * @param max_count The most elements to remove.
+ * @return The number of elements removed.
+ */
+LAPI u32 mpmc_queue_dequeue_batch(mpmc_queue* queue, void* out_values, u32 max_count);
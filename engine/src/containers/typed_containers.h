@@ -0,0 +1,171 @@
+/**
+ * @file typed_containers.h
+ *
+ * @brief Contains macros which generate type-specialized functions for the darray and hashtable,
+ * so code working with one element type can skip the generic, runtime-sized copies.
+ * @version 0.1
+ * @date 2024-05-26
+ *
+ */
+
+#pragma once
+#include "defines.h"
+#include "containers/darray.h"
+#include "containers/hashtable.h"
+#include "core/lhash.h"
+
+/*
+Typed containers:
+
+    darray and hashtable are type-erased: every element is moved by lcopy_memory with a size
+    read from the container at runtime, which the compiler can neither inline nor vectorize.
+    Instantiating one of the macros below for a type generates small static inline functions
+    for it which move elements by plain assignment, with the size known at compile time.
+
+        DEFINE_DARRAY(vertex_3d)
+        DEFINE_HASHTABLE(texture_reference)
+
+    declare darray_vertex_3d_push, hashtable_texture_reference_find and so on in the file they
+    are used in. The type must be a single identifier (typedef pointers and qualified types first),
+    and each type should only be instantiated once per translation unit.
+
+    Nothing about the containers themselves changes. A typed darray is the same type* the generic
+    darray macros work on, and a typed hashtable is a plain hashtable, so the generic API (and
+    anything else, like darray_destroy or hashtable_get_stats) can still be used on them. Only
+    the common operations are specialized; growing, and anything rare, calls the generic code.
+ */
+
+/** @brief Obtains the header of the given darray. See darray.h for its layout. */
+#define DARRAY_HEADER(array) ((u64*)(array) - DARRAY_FIELD_LENGTH)
+
+/**
+ * @brief Generates typed darray functions for the given type, each named darray_<type>_<operation>:
+ *
+ * - type* create(void) / type* reserve(u64 capacity): As darray_create and darray_reserve.
+ * - u64 length(const type* array): As darray_length.
+ * - type* push(type* array, type value): Appends value, returning the (possibly moved) array.
+ * - type* push_n(type* array, const type* values, u64 count): Appends count values, growing at most once.
+ * - type pop(type* array): Removes and returns the last element. The array must not be empty.
+ * - b8 swap_remove(type* array, u64 index): Removes the element at index in O(1) by moving the
+ *   last element into its place. False if the index is out of bounds.
+ */
+#define DEFINE_DARRAY(type)                                                                    \
+    static inline type* darray_##type##_create(void)                                           \
+    {                                                                                          \
+        return (type*)_darray_create(DARRAY_DEFAULT_CAPACITY, sizeof(type));                   \
+    }                                                                                          \
+    static inline type* darray_##type##_reserve(u64 capacity)                                  \
+    {                                                                                          \
+        return (type*)_darray_create(capacity, sizeof(type));                                  \
+    }                                                                                          \
+    static inline u64 darray_##type##_length(const type* array)                                \
+    {                                                                                          \
+        return DARRAY_HEADER(array)[DARRAY_LENGTH];                                            \
+    }                                                                                          \
+    static inline type* darray_##type##_push(type* array, type value)                          \
+    {                                                                                          \
+        u64* header = DARRAY_HEADER(array);                                                    \
+        u64 length = header[DARRAY_LENGTH];                                                    \
+        if (length >= header[DARRAY_CAPACITY]) {                                               \
+            array = (type*)_darray_resize(array);                                              \
+            header = DARRAY_HEADER(array);                                                     \
+            if (length >= header[DARRAY_CAPACITY]) {                                           \
+                return array;                                                                  \
+            }                                                                                  \
+        }                                                                                      \
+        array[length] = value;                                                                 \
+        header[DARRAY_LENGTH] = length + 1;                                                    \
+        return array;                                                                          \
+    }                                                                                          \
+    static inline type* darray_##type##_push_n(type* array, const type* values, u64 count)     \
+    {                                                                                          \
+        u64* header = DARRAY_HEADER(array);                                                    \
+        u64 length = header[DARRAY_LENGTH];                                                    \
+        if (length + count > header[DARRAY_CAPACITY]) {                                        \
+            u64 doubled = header[DARRAY_CAPACITY] * DARRAY_RESIZE_FACTOR;                      \
+            array = (type*)_darray_reserve_exact(array, length + count > doubled ? length + count : doubled); \
+            header = DARRAY_HEADER(array);                                                     \
+            if (length + count > header[DARRAY_CAPACITY]) {                                    \
+                return array;                                                                  \
+            }                                                                                  \
+        }                                                                                      \
+        for (u64 i = 0; i < count; ++i) {                                                      \
+            array[length + i] = values[i];                                                     \
+        }                                                                                      \
+        header[DARRAY_LENGTH] = length + count;                                                \
+        return array;                                                                          \
+    }                                                                                          \
+    static inline type darray_##type##_pop(type* array)                                        \
+    {                                                                                          \
+        u64* header = DARRAY_HEADER(array);                                                    \
+        header[DARRAY_LENGTH]--;                                                               \
+        return array[header[DARRAY_LENGTH]];                                                   \
+    }                                                                                          \
+    static inline b8 darray_##type##_swap_remove(type* array, u64 index)                       \
+    {                                                                                          \
+        u64* header = DARRAY_HEADER(array);                                                    \
+        u64 length = header[DARRAY_LENGTH];                                                    \
+        if (index >= length) {                                                                 \
+            return false;                                                                      \
+        }                                                                                      \
+        array[index] = array[length - 1];                                                      \
+        header[DARRAY_LENGTH] = length - 1;                                                    \
+        return true;                                                                           \
+    }
+
+/**
+ * @brief Generates typed hashtable functions for the given (non-pointer) value type, each named
+ * hashtable_<type>_<operation>. Each has a _hashed variant as well, taking the hash of the name:
+ *
+ * - b8 create(u32 element_count, u64* memory_requirement, void* memory, hashtable* out_hashtable) /
+ *   b8 create_growable(u32 initial_count, const allocator_interface* allocator, hashtable* out_hashtable):
+ *   As hashtable_create and hashtable_create_growable.
+ * - type* find(hashtable* table, const char* name): A pointer to the stored value, to read or modify in
+ *   place; 0 if there is no entry. Valid until the table is next added to or removed from.
+ * - b8 get(hashtable* table, const char* name, type* out_value): As hashtable_get.
+ * - b8 set(hashtable* table, const char* name, type value): As hashtable_set. An existing entry is
+ *   updated in place; adding a new one goes through hashtable_set.
+ */
+#define DEFINE_HASHTABLE(type)                                                                                                      \
+    static inline b8 hashtable_##type##_create(u32 element_count, u64* memory_requirement, void* memory, hashtable* out_hashtable)  \
+    {                                                                                                                               \
+        return hashtable_create(sizeof(type), element_count, false, memory_requirement, memory, out_hashtable);                     \
+    }                                                                                                                               \
+    static inline b8 hashtable_##type##_create_growable(u32 initial_count, const struct allocator_interface* allocator, hashtable* out_hashtable) \
+    {                                                                                                                               \
+        return hashtable_create_growable(sizeof(type), initial_count, false, allocator, out_hashtable);                             \
+    }                                                                                                                               \
+    static inline type* hashtable_##type##_find_hashed(hashtable* table, const char* name, u64 hash)                                \
+    {                                                                                                                               \
+        return (type*)hashtable_find_hashed(table, name, hash);                                                                     \
+    }                                                                                                                               \
+    static inline type* hashtable_##type##_find(hashtable* table, const char* name)                                                 \
+    {                                                                                                                               \
+        return (type*)hashtable_find_hashed(table, name, name ? hash_string(name) : 0);                                             \
+    }                                                                                                                               \
+    static inline b8 hashtable_##type##_get_hashed(hashtable* table, const char* name, u64 hash, type* out_value)                   \
+    {                                                                                                                               \
+        type* value = (type*)hashtable_find_hashed(table, name, hash);                                                              \
+        if (!value) {                                                                                                               \
+            return false;                                                                                                           \
+        }                                                                                                                           \
+        *out_value = *value;                                                                                                        \
+        return true;                                                                                                                \
+    }                                                                                                                               \
+    static inline b8 hashtable_##type##_get(hashtable* table, const char* name, type* out_value)                                    \
+    {                                                                                                                               \
+        return hashtable_##type##_get_hashed(table, name, name ? hash_string(name) : 0, out_value);                                 \
+    }                                                                                                                               \
+    static inline b8 hashtable_##type##_set_hashed(hashtable* table, const char* name, u64 hash, type value)                        \
+    {                                                                                                                               \
+        type* existing = (type*)hashtable_find_hashed(table, name, hash);                                                           \
+        if (existing) {                                                                                                             \
+            *existing = value;                                                                                                      \
+            return true;                                                                                                            \
+        }                                                                                                                           \
+        return hashtable_set_hashed(table, name, hash, &value);                                                                     \
+    }                                                                                                                               \
+    static inline b8 hashtable_##type##_set(hashtable* table, const char* name, type value)                                         \
+    {                                                                                                                               \
+        return hashtable_##type##_set_hashed(table, name, name ? hash_string(name) : 0, value);                                     \
+    }
@@ -9,8 +9,10 @@
 #include "core/input.h"
 #include "core/clock.h"
 #include "core/lstring.h"
+#include "core/string_id.h"
 
 #include "memory/linear_allocator.h"
+#include "memory/frame_arena.h"
 
 #include "renderer/renderer_frontend.h"
 
@@ -33,6 +35,8 @@ typedef struct application_state {
     clock clock;
     f64 last_time;
     linear_allocator systems_allocator;
+    // Transient memory for the current frame. See frame_allocate.
+    frame_arena frame_arena;
 
     u64 event_system_memory_requirement;
     void* event_system_state;
@@ -43,6 +47,9 @@ typedef struct application_state {
     u64 input_system_memory_requirement;
     void* input_system_state;
 
+    u64 string_id_system_memory_requirement;
+    void* string_id_system_state;
+
     u64 platform_system_memory_requirement;
     void* platform_system_state;
 
@@ -114,6 +121,11 @@ b8 application_create(game* game_inst) {
     // Memory system MUST be the first subsystem we create, since we need to lallocate the application
     memory_system_configuration memory_system_config = {};
     memory_system_config.total_alloc_size = GIBIBYTES(1);
+    memory_system_config.allocator_type = DYNAMIC_ALLOCATOR_TYPE_TLSF;
+    memory_system_config.use_thread_caches = true;
+    // Set to attribute allocations to their call sites and get a leak report at shutdown.
+    memory_system_config.enable_profiling = false;
+    memory_system_config.use_huge_pages = true;
     if(!memory_system_initialize(memory_system_config)) {
         LERROR("Failed to initialize memory system; shutting down.");
         return false;
@@ -132,16 +144,20 @@ b8 application_create(game* game_inst) {
     u64 systems_allocator_total_size = 64 * 1024 * 1024;  // 64 mb
     linear_allocator_create(systems_allocator_total_size, 0, &app_state->systems_allocator);
 
+    // Create the per-frame arena.
+    u64 frame_arena_size_per_frame = MEBIBYTES(4);
+    frame_arena_create(frame_arena_size_per_frame, &app_state->frame_arena);
+
     // Initialize other systems.
 
     // Events
     event_system_initialize(&app_state->event_system_memory_requirement, 0);
-    app_state->event_system_state = linear_allocator_allocate(&app_state->systems_allocator, app_state->event_system_memory_requirement);
+    app_state->event_system_state = linear_allocator_allocate_aligned(&app_state->systems_allocator, app_state->event_system_memory_requirement, LMEMORY_DEFAULT_ALIGNMENT);
     event_system_initialize(&app_state->event_system_memory_requirement, app_state->event_system_state);
 
     // Logging
     initialize_logging(&app_state->logging_system_memory_requirement, 0);
-    app_state->logging_system_state = linear_allocator_allocate(&app_state->systems_allocator, app_state->logging_system_memory_requirement);
+    app_state->logging_system_state = linear_allocator_allocate_aligned(&app_state->systems_allocator, app_state->logging_system_memory_requirement, LMEMORY_DEFAULT_ALIGNMENT);
     if (!initialize_logging(&app_state->logging_system_memory_requirement, app_state->logging_system_state)) {
         LERROR("Failed to initialize logging system; shutting down.");
         return false;
@@ -149,9 +165,20 @@ b8 application_create(game* game_inst) {
 
     // Input
     input_system_initialize(&app_state->input_system_memory_requirement, 0);
-    app_state->input_system_state = linear_allocator_allocate(&app_state->systems_allocator, app_state->input_system_memory_requirement);
+    app_state->input_system_state = linear_allocator_allocate_aligned(&app_state->systems_allocator, app_state->input_system_memory_requirement, LMEMORY_DEFAULT_ALIGNMENT);
     input_system_initialize(&app_state->input_system_memory_requirement, app_state->input_system_state);
 
+    // String ids. Resource names are interned, so this must come before any of the resource systems.
+    string_id_system_config string_id_sys_config;
+    string_id_sys_config.max_string_count = 65536;
+    string_id_sys_config.arena_block_size = KIBIBYTES(64);
+    string_id_system_initialize(&app_state->string_id_system_memory_requirement, 0, string_id_sys_config);
+    app_state->string_id_system_state = linear_allocator_allocate_aligned(&app_state->systems_allocator, app_state->string_id_system_memory_requirement, LMEMORY_DEFAULT_ALIGNMENT);
+    if (!string_id_system_initialize(&app_state->string_id_system_memory_requirement, app_state->string_id_system_state, string_id_sys_config)) {
+        LFATAL("Failed to initialize string id system. Aborting application.");
+        return false;
+    }
+
     // Register for engine-level events.
     event_register(EVENT_CODE_APPLICATION_QUIT, 0, application_on_event);
     event_register(EVENT_CODE_KEY_PRESSED, 0, application_on_key);
@@ -163,7 +190,7 @@ b8 application_create(game* game_inst) {
 
     // Platform
     platform_system_startup(&app_state->platform_system_memory_requirement, 0, 0, 0, 0, 0, 0);
-    app_state->platform_system_state = linear_allocator_allocate(&app_state->systems_allocator, app_state->platform_system_memory_requirement);
+    app_state->platform_system_state = linear_allocator_allocate_aligned(&app_state->systems_allocator, app_state->platform_system_memory_requirement, LMEMORY_DEFAULT_ALIGNMENT);
     if (!platform_system_startup(
             &app_state->platform_system_memory_requirement,
             app_state->platform_system_state,
@@ -180,7 +207,7 @@ b8 application_create(game* game_inst) {
     resource_sys_config.asset_base_path = "../assets";
     resource_sys_config.max_loader_count = 32;
     resource_system_initialize(&app_state->resource_system_memory_requirement, 0, resource_sys_config);
-    app_state->resource_system_state = linear_allocator_allocate(&app_state->systems_allocator, app_state->resource_system_memory_requirement);
+    app_state->resource_system_state = linear_allocator_allocate_aligned(&app_state->systems_allocator, app_state->resource_system_memory_requirement, LMEMORY_DEFAULT_ALIGNMENT);
     if (!resource_system_initialize(&app_state->resource_system_memory_requirement, app_state->resource_system_state, resource_sys_config)) {
         LFATAL("Failed to initialize resource system. Aborting application.");
         return false;
@@ -188,7 +215,7 @@ b8 application_create(game* game_inst) {
 
     // Renderer system
     renderer_system_initialize(&app_state->renderer_system_memory_requirement, 0, 0);
-    app_state->renderer_system_state = linear_allocator_allocate(&app_state->systems_allocator, app_state->renderer_system_memory_requirement);
+    app_state->renderer_system_state = linear_allocator_allocate_aligned(&app_state->systems_allocator, app_state->renderer_system_memory_requirement, LMEMORY_DEFAULT_ALIGNMENT);
     if (!renderer_system_initialize(&app_state->renderer_system_memory_requirement, app_state->renderer_system_state, game_inst->app_config.name)) {
         LFATAL("Failed to initialize renderer. Aborting application.");
         return false;
@@ -198,7 +225,7 @@ b8 application_create(game* game_inst) {
     texture_system_config texture_sys_config;
     texture_sys_config.max_texture_count = 65536;
     texture_system_initialize(&app_state->texture_system_memory_requirement, 0, texture_sys_config);
-    app_state->texture_system_state = linear_allocator_allocate(&app_state->systems_allocator, app_state->texture_system_memory_requirement);
+    app_state->texture_system_state = linear_allocator_allocate_aligned(&app_state->systems_allocator, app_state->texture_system_memory_requirement, LMEMORY_DEFAULT_ALIGNMENT);
     if (!texture_system_initialize(&app_state->texture_system_memory_requirement, app_state->texture_system_state, texture_sys_config)) {
         LFATAL("Failed to initialize texture system. Application cannot continue.");
         return false;
@@ -208,7 +235,7 @@ b8 application_create(game* game_inst) {
     material_system_config material_sys_config;
     material_sys_config.max_material_count = 4096;
     material_system_initialize(&app_state->material_system_memory_requirement, 0, material_sys_config);
-    app_state->material_system_state = linear_allocator_allocate(&app_state->systems_allocator, app_state->material_system_memory_requirement);
+    app_state->material_system_state = linear_allocator_allocate_aligned(&app_state->systems_allocator, app_state->material_system_memory_requirement, LMEMORY_DEFAULT_ALIGNMENT);
     if (!material_system_initialize(&app_state->material_system_memory_requirement, app_state->material_system_state, material_sys_config)) {
         LFATAL("Failed to initialize material system. Application cannot continue.");
         return false;
@@ -218,7 +245,7 @@ b8 application_create(game* game_inst) {
     geometry_system_config geometry_sys_config;
     geometry_sys_config.max_geometry_count = 4096;
     geometry_system_initialize(&app_state->geometry_system_memory_requirement, 0, geometry_sys_config);
-    app_state->geometry_system_state = linear_allocator_allocate(&app_state->systems_allocator, app_state->geometry_system_memory_requirement);
+    app_state->geometry_system_state = linear_allocator_allocate_aligned(&app_state->systems_allocator, app_state->geometry_system_memory_requirement, LMEMORY_DEFAULT_ALIGNMENT);
     if (!geometry_system_initialize(&app_state->geometry_system_memory_requirement, app_state->geometry_system_state, geometry_sys_config)) {
         LFATAL("Failed to initialize geometry system. Application cannot continue.");
         return false;
@@ -312,6 +339,9 @@ b8 application_run() {
             f64 delta = (current_time - app_state->last_time);
             f64 frame_start_time = platform_get_absolute_time();
 
+            // Anything allocated via frame_allocate two frames ago is released here.
+            frame_arena_begin_frame(&app_state->frame_arena);
+
             if (!app_state->game_inst->update(app_state->game_inst, (f32)delta)) {
                 LFATAL("Game update failed, shutting down.");
                 app_state->is_running = false;
@@ -330,18 +360,15 @@ b8 application_run() {
             packet.delta_time = delta;
 
             // TODO: temp
-            geometry_render_data test_render;
-            test_render.geometry = app_state->test_geometry;
-            test_render.model = mat4_identity();
-
             packet.geometry_count = 1;
-            packet.geometries = &test_render;
+            packet.geometries = frame_allocate(sizeof(geometry_render_data) * packet.geometry_count);
+            packet.geometries[0].geometry = app_state->test_geometry;
+            packet.geometries[0].model = mat4_identity();
 
-            geometry_render_data test_ui_render;
-            test_ui_render.geometry = app_state->test_ui_geometry;
-            test_ui_render.model = mat4_translation((vec3){0, 0, 0});
             packet.ui_geometry_count = 1;
-            packet.ui_geometries = &test_ui_render;
+            packet.ui_geometries = frame_allocate(sizeof(geometry_render_data) * packet.ui_geometry_count);
+            packet.ui_geometries[0].geometry = app_state->test_ui_geometry;
+            packet.ui_geometries[0].model = mat4_translation((vec3){0, 0, 0});
             // TODO: end temp
 
             renderer_draw_frame(&packet);
@@ -393,6 +420,8 @@ b8 application_run() {
 
     texture_system_shutdown(app_state->texture_system_state);
 
+    string_id_system_shutdown(app_state->string_id_system_state);
+
     renderer_system_shutdown(app_state->renderer_system_state);
 
     resource_system_shutdown(app_state->resource_system_state);
@@ -401,11 +430,17 @@ b8 application_run() {
 
     event_system_shutdown(app_state->event_system_state);
 
+    frame_arena_destroy(&app_state->frame_arena);
+
     memory_system_shutdown();
 
     return true;
 }
 
+void* frame_allocate(u64 size) {
+    return frame_arena_allocate(&app_state->frame_arena, size);
+}
+
 void application_get_framebuffer_size(u32* width, u32* height) {
     *width = app_state->width;
     *height = app_state->height;
@@ -29,4 +29,14 @@ LAPI b8 application_create(struct game* game_inst);
 
 LAPI b8 application_run();
 
-void application_get_framebuffer_size(u32* width, u32* height);
\ No newline at end of file
+void application_get_framebuffer_size(u32* width, u32* height);
+
+/**
+ * @brief Allocates transient memory which is valid for the rest of this frame and the next.
+ * Reset automatically at frame boundaries, so it is never freed. Blocks are zeroed and 
+ * aligned to LMEMORY_DEFAULT_ALIGNMENT. Must only be called from the main thread.
+ * 
+ * @param size The size in bytes to allocate.
+ * @return A pointer to the block; 0 if this frame's memory is exhausted.
+ */
+LAPI void* frame_allocate(u64 size);
\ No newline at end of file
@@ -1,12 +1,14 @@
 #include "core/event.h"
 #include "core/lmemory.h"
-#include "containers/darray.h"
+#include "containers/typed_containers.h"
 
 typedef struct registered_event {
     void* listener;
     PFN_on_event callback;
 } registered_event;
 
+DEFINE_DARRAY(registered_event)
+
 typedef struct event_code_entry {
     registered_event* events;
 } event_code_entry;
@@ -57,10 +59,10 @@ b8 event_register(u16 code, void* listener, PFN_on_event on_event)
     }
 
     if (state_ptr->registered[code].events == 0) {
-        state_ptr->registered[code].events = darray_create(registered_event);
+        state_ptr->registered[code].events = darray_registered_event_create();
     }
 
-    u64 registered_count = darray_length(state_ptr->registered[code].events);
+    u64 registered_count = darray_registered_event_length(state_ptr->registered[code].events);
     for (u64 i = 0; i < registered_count; ++i){
         if (state_ptr->registered[code].events[i].listener == listener) {
             // TODO: warn
@@ -72,7 +74,7 @@ b8 event_register(u16 code, void* listener, PFN_on_event on_event)
     registered_event event;
     event.listener = listener;
     event.callback = on_event;
-    darray_push(state_ptr->registered[code].events, event);
+    state_ptr->registered[code].events = darray_registered_event_push(state_ptr->registered[code].events, event);
 
     return true;
 }
@@ -93,8 +95,9 @@ b8 event_unregister(u16 code, void* listener, PFN_on_event on_event)
     for (u64 i = 0; i < registered_count; ++i) {
         registered_event e = state_ptr->registered[code].events[i];
         if (e.listener == listener && e.callback == on_event) {
-            registered_event popped_event;
-            darray_pop_at(state_ptr->registered[code].events, i, &popped_event);
+            // Found one, remove it. The last listener takes its place, rather than shifting the rest down.
+            darray_registered_event_swap_remove(state_ptr->registered[code].events, i);
+            return true;
         }
     }
 
@@ -47,7 +47,8 @@ LAPI b8 event_register(u16 code, void* listener, PFN_on_event on_event);
 
 /**
  * Unregister from listening for when events are sent with the provided code. If no matching
- * registration is found, this function returns false.
+ * registration is found, this function returns false. The last listener registered for the code
+ * takes the place of the removed one, so the order the rest are called in may change.
  * @param code The event code to stop listening for.
  * @param listener A pointer to the listener instance Can be 0/NULL.
  * @param on_event The callback function pointer to be unregistered.
@@ -0,0 +1,119 @@
+#include "lhash.h"
+
+#include "core/lstring.h"
+
+#include <string.h>
+
+// NOTE: This is wyhash (final version 4), by Wang Yi, released into the public domain.
+
+static const u64 secret[4] = {0xa0761d6478bd642full, 0xe7037ed1a0b428dbull, 0x8ebc6af09c88c6e3ull, 0x589965cc75374cc3ull};
+
+// Private functions
+LINLINE void multiply_128(u64* a, u64* b);
+LINLINE u64 mix(u64 a, u64 b);
+LINLINE u64 read_8(const u8* p);
+LINLINE u64 read_4(const u8* p);
+LINLINE u64 read_3(const u8* p, u64 size);
+
+u64 hash_bytes(const void* data, u64 size, u64 seed)
+{
+    const u8* p = (const u8*)data;
+    seed ^= mix(seed ^ secret[0], secret[1]);
+    u64 a;
+    u64 b;
+    if (size <= 16) {
+        if (size >= 4) {
+            // Two overlapping pairs of 4 byte reads cover anything from 4 to 16 bytes.
+            u64 offset = (size >> 3) << 2;
+            a = (read_4(p) << 32) | read_4(p + offset);
+            b = (read_4(p + size - 4) << 32) | read_4(p + size - 4 - offset);
+        } else if (size > 0) {
+            a = read_3(p, size);
+            b = 0;
+        } else {
+            a = b = 0;
+        }
+    } else {
+        u64 remaining = size;
+        if (remaining > 48) {
+            // Three independent lanes, so the multiplies can overlap.
+            u64 seed1 = seed;
+            u64 seed2 = seed;
+            do {
+                seed = mix(read_8(p) ^ secret[1], read_8(p + 8) ^ seed);
+                seed1 = mix(read_8(p + 16) ^ secret[2], read_8(p + 24) ^ seed1);
+                seed2 = mix(read_8(p + 32) ^ secret[3], read_8(p + 40) ^ seed2);
+                p += 48;
+                remaining -= 48;
+            } while (remaining > 48);
+            seed ^= seed1 ^ seed2;
+        }
+        while (remaining > 16) {
+            seed = mix(read_8(p) ^ secret[1], read_8(p + 8) ^ seed);
+            remaining -= 16;
+            p += 16;
+        }
+        // The last 16 bytes of the input, overlapping what has already been consumed if need be.
+        a = read_8(p + remaining - 16);
+        b = read_8(p + remaining - 8);
+    }
+
+    a ^= secret[1];
+    b ^= seed;
+    multiply_128(&a, &b);
+    return mix(a ^ secret[0] ^ size, b ^ secret[1]);
+}
+
+u64 hash_string(const char* str)
+{
+    return hash_bytes(str, string_length(str), HASH_DEFAULT_SEED);
+}
+
+// Private functions
+
+LINLINE void multiply_128(u64* a, u64* b)
+{
+    // Replaces a and b with the low and high halves of their product.
+#if defined(__SIZEOF_INT128__)
+    __uint128_t r = (__uint128_t)*a * *b;
+    *a = (u64)r;
+    *b = (u64)(r >> 64);
+#else
+    u64 ha = *a >> 32, hb = *b >> 32, la = (u32)*a, lb = (u32)*b;
+    u64 rh = ha * hb, rm0 = ha * lb, rm1 = hb * la, rl = la * lb;
+    u64 t = rl + (rm0 << 32);
+    u64 c = t < rl;
+    u64 lo = t + (rm1 << 32);
+    c += lo < t;
+    u64 hi = rh + (rm0 >> 32) + (rm1 >> 32) + c;
+    *a = lo;
+    *b = hi;
+#endif
+}
+
+LINLINE u64 mix(u64 a, u64 b)
+{
+    multiply_128(&a, &b);
+    return a ^ b;
+}
+
+LINLINE u64 read_8(const u8* p)
+{
+    // memcpy is the portable way to make an unaligned load; compilers emit a single mov.
+    u64 v;
+    memcpy(&v, p, sizeof(u64));
+    return v;
+}
+
+LINLINE u64 read_4(const u8* p)
+{
+    u32 v;
+    memcpy(&v, p, sizeof(u32));
+    return v;
+}
+
+LINLINE u64 read_3(const u8* p, u64 size)
+{
+    // The first, middle and last bytes; the same byte more than once for sizes under 3.
+    return (((u64)p[0]) << 16) | (((u64)p[size >> 1]) << 8) | p[size - 1];
+}
@@ -0,0 +1,47 @@
+/**
+ * @file lhash.h
+ *
+ * @brief Contains the engine's non-cryptographic hash functions, used by the hashtable
+ * and anything else which needs to hash names or blocks of bytes.
+ * @version 0.1
+ * @date 2024-05-24
+ *
+ */
+
+#pragma once
+#include "defines.h"
+
+/*
+Hashing:
+
+    Hashes are 64 bits, from a wyhash-style function: 16 bytes are consumed per step
+    (48 per step for long inputs), each step folding the input into the state with a
+    64x64->128-bit multiply. Every input bit affects every output bit, so the low bits
+    are safe to use directly as a table index by masking, even for names which differ
+    only in a few characters somewhere in the middle, like paths.
+
+    These are not for anything security related, and are not stable across engine
+    versions. Nothing should write them to disk.
+ */
+
+/** @brief The seed used by hash_string. */
+#define HASH_DEFAULT_SEED 0
+
+/**
+ * @brief Hashes a block of bytes.
+ *
+ * @param data A pointer to the bytes to be hashed. May be 0 if size is 0.
+ * @param size The number of bytes to be hashed.
+ * @param seed A seed, which gives an unrelated set of hashes for each value.
+ * @return The 64-bit hash.
+ */
+LAPI u64 hash_bytes(const void* data, u64 size, u64 seed);
+
+/**
+ * @brief Hashes a null-terminated string, not including the terminator, with HASH_DEFAULT_SEED.
+ * This is the hash used for names by the hashtable.
+ *
+ * @param str The string to be hashed. Required.
+ * @return The 64-bit hash.
+ */
+LAPI u64 hash_string(const char* str);
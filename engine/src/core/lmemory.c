@@ -1,9 +1,13 @@
+// The allocation functions are defined here, so they must not be replaced by the call-site macros.
+#define LMEMORY_NO_CALL_SITES
 #include "lmemory.h"
 
 #include "core/logger.h"
+#include "core/memory_profiler.h"
+#include "core/lmutex.h"
+#include "core/lthread.h"
 #include "platform/platform.h"
 #include "core/lstring.h"
-#include "memory/dynamic_allocator.h"
 
 #include <stdio.h>
 
@@ -36,56 +40,193 @@ static const char* memory_tag_strings[MEMORY_TAG_MAX_TAGS] =
 };
 
 
+// Small allocations are rounded up to one of these size classes (16B - 1KiB), 
+// which each thread keeps a cache of.
+#define THREAD_CACHE_CLASS_COUNT 7
+#define THREAD_CACHE_MIN_BLOCK_SIZE_LOG2 4
+#define THREAD_CACHE_MIN_BLOCK_SIZE (1ULL << THREAD_CACHE_MIN_BLOCK_SIZE_LOG2)
+#define THREAD_CACHE_MAX_BLOCK_SIZE (THREAD_CACHE_MIN_BLOCK_SIZE << (THREAD_CACHE_CLASS_COUNT - 1))
+// The most blocks a thread keeps per size class. Half of this is moved at a time
+// between the thread and the shared allocator, so the lock is taken rarely.
+#define THREAD_CACHE_MAGAZINE_SIZE 32
+// The most threads which can have a cache at once. Others use the shared allocator directly.
+#define THREAD_CACHE_MAX_THREADS 64
+
+// A free block sitting in a thread cache. The link lives in the block itself.
+typedef struct cached_block {
+    struct cached_block* next;
+} cached_block;
+
+typedef struct size_class_cache {
+    cached_block* head;
+    u32 count;
+} size_class_cache;
+
+// Per-thread cache of small blocks, plus the thread's share of the stats.
+typedef struct thread_cache {
+    // Set once the cache is in the memory system's list, so its stats are merged on query.
+    b8 registered;
+    size_class_cache classes[THREAD_CACHE_CLASS_COUNT];
+    struct memory_stats stats;
+    u64 alloc_count;
+} thread_cache;
+
+// A heap dedicated to a single tag, carved from the main allocator.
+typedef struct tag_heap {
+    dynamic_allocator allocator;
+    // The carved block, or 0 if the tag has no heap.
+    void* memory;
+    u64 memory_requirement;
+    u64 size;
+} tag_heap;
+
 typedef struct memory_system_state {
     memory_system_configuration config;
+    // Stats for allocations made without a thread cache, plus those of released caches.
     struct memory_stats stats;
     u64 alloc_count;
     u64 allocator_memory_requirement;
     dynamic_allocator allocator;
     void* allocator_block;
+    // The size of the reservation holding this state, the profiler and the allocator.
+    u64 reserved_size;
+    // The profiler's state, if enabled. Lives between this state and the allocator.
+    void* profiler_state;
+    // Set if the reservation is backed by huge pages.
+    b8 huge_pages;
+
+    // Guards the allocator, the tag heaps, the shared stats and the list of thread caches.
+    lmutex allocator_mutex;
+    tag_heap tag_heaps[MEMORY_TAG_MAX_TAGS];
+    thread_cache* thread_caches[THREAD_CACHE_MAX_THREADS];
+    u32 thread_cache_count;
+    // Releases a thread's cache when it exits, whichever way the thread was started.
+    lthread_exit_hook thread_exit_hook;
 } memory_system_state;
 
 static memory_system_state* state_ptr;
+static LTHREAD_LOCAL thread_cache tls_cache;
+
+// Private method declarations
+static thread_cache* get_thread_cache();
+static void* cached_allocate(u64 size, memory_tag tag);
+static void cached_free(void* block, u64 size, memory_tag tag);
+static void flush_size_class(size_class_cache* size_class, u64 class_size, u32 keep_count);
+static void gather_stats(struct memory_stats* out_stats, u64* out_alloc_count);
+static void* allocate_internal(u64 size, u16 alignment, memory_tag tag);
+static b8 resize_internal(void* block, u64 size, u64 new_size, memory_tag tag);
+static void release_tag_usage(memory_tag tag);
+static void release_thread_cache(void* cache_block);
+static dynamic_allocator* owning_allocator(void* block, memory_tag tag, memory_tag* out_heap_tag);
+
+// Whether a block of this size and alignment is served from the thread caches, if its tag has no heap.
+LINLINE b8 is_cacheable_size(const memory_system_state* state, u64 size, u16 alignment) {
+    return state->config.use_thread_caches && size <= THREAD_CACHE_MAX_BLOCK_SIZE && alignment <= LMEMORY_DEFAULT_ALIGNMENT;
+}
+
+// Allocations for tags with their own heap are never cached, so they can all be released together.
+LINLINE b8 is_cacheable(const memory_system_state* state, u64 size, u16 alignment, memory_tag tag) {
+    return is_cacheable_size(state, size, alignment) && !state->tag_heaps[tag].memory;
+}
+
+// The allocator which serves the given tag.
+LINLINE dynamic_allocator* allocator_for(memory_system_state* state, memory_tag tag) {
+    return state->tag_heaps[tag].memory ? &state->tag_heaps[tag].allocator : &state->allocator;
+}
+
+// The smallest class which holds the given size, ie. ceil(log2(size)) - log2(min block size).
+LINLINE u32 size_class_index(u64 size) {
+    return size <= THREAD_CACHE_MIN_BLOCK_SIZE ? 0 : (64 - __builtin_clzll(size - 1)) - THREAD_CACHE_MIN_BLOCK_SIZE_LOG2;
+}
+
+// Thread caches only ever write their own counters, but are read by whichever
+// thread queries the stats. Single writer, so a relaxed load/store is enough.
+LINLINE void counter_add(u64* counter, u64 amount) {
+    __atomic_store_n(counter, __atomic_load_n(counter, __ATOMIC_RELAXED) + amount, __ATOMIC_RELAXED);
+}
+
+LINLINE u64 counter_read(u64* counter) {
+    return __atomic_load_n(counter, __ATOMIC_RELAXED);
+}
 
 b8 memory_system_initialize(memory_system_configuration config)
 {
-    // Amount needed to hold the state.
+    // Amount needed to hold the state, plus the profiler's if enabled.
     u64 state_memory_requirement = sizeof(memory_system_state);
+    u64 profiler_requirement = 0;
+    if (config.enable_profiling) {
+        memory_profiler_initialize(&profiler_requirement, 0);
+    }
 
     // Calcuate space needed for the dynamic allocator.
     u64 alloc_requirement = 0;
-    dynamic_allocator_create(config.total_alloc_size, &alloc_requirement, 0, 0);
+    if (!dynamic_allocator_create_reserved(config.allocator_type, config.total_alloc_size, &alloc_requirement, 0, 0)) {
+        LFATAL("Memory system unable to obtain the internal allocator's memory requirement.");
+        return false;
+    }
 
-    // Call the platform to get the memory for the whole systme, including state.
-    // TODO: Memory alignment.
-    void* block = platform_allocate(state_memory_requirement + alloc_requirement, false);
+    // Reserve address space for the whole system, including state. Nothing is committed yet,
+    // so startup cost and resident memory track what is actually used rather than total_alloc_size.
+    u64 reserved_size = state_memory_requirement + profiler_requirement + alloc_requirement;
+    b8 huge_pages = false;
+    void* block = 0;
+    if (config.use_huge_pages) {
+        block = platform_reserve_memory_huge(reserved_size, &huge_pages);
+        if (block && !huge_pages) {
+            LWARN("Huge pages are unavailable. The memory system is using regular pages.");
+        }
+    } else {
+        block = platform_reserve_memory(reserved_size);
+    }
 
-    if (!block) {
+    // A huge page can only back a fully committed run of memory, so committing in small steps
+    // would keep the range on regular pages. Commit everything up front instead; this only changes
+    // the protection, and pages still become resident on first touch.
+    u64 initial_commit = huge_pages ? reserved_size : state_memory_requirement + profiler_requirement;
+    if (!block || !platform_commit_memory(block, initial_commit)) {
         LFATAL("Memory system allocation failed and the system cannot continue.");
         return false;
     }
 
-    // The state is in the first part of the memory block.
+    // The state is in the first part of the memory block. Freshly committed, so already zeroed.
     state_ptr = (memory_system_state*)block;
     state_ptr->config = config;
     state_ptr->alloc_count = 0;
     state_ptr->allocator_memory_requirement = alloc_requirement;
-    platform_zero_memory(&state_ptr->stats, sizeof(state_ptr->stats));
+    state_ptr->reserved_size = reserved_size;
+    state_ptr->huge_pages = huge_pages;
+    if (!lmutex_create(&state_ptr->allocator_mutex)) {
+        LFATAL("Memory system unable to create allocator mutex. Application cannot continue.");
+        return false;
+    }
+
+    // Without a way to release a cache when its thread exits, a dead thread's cache would stay in the list.
+    if (config.use_thread_caches && !lthread_exit_hook_create(release_thread_cache, &state_ptr->thread_exit_hook)) {
+        LWARN("Memory system unable to create a thread exit hook. Thread caches are disabled.");
+        state_ptr->config.use_thread_caches = false;
+    }
     
-    // Allocator block is after the system block
-    state_ptr->allocator_block = ((void*)block + state_memory_requirement); 
-
-    if (!dynamic_allocator_create(
-        config.total_alloc_size,
-        &state_ptr->allocator_memory_requirement,
-        state_ptr->allocator_block,
-        &state_ptr->allocator
-    )) {
+    if (config.enable_profiling) {
+        state_ptr->profiler_state = ((void*)block + state_memory_requirement);
+        if (!memory_profiler_initialize(&profiler_requirement, state_ptr->profiler_state)) {
+            LFATAL("Memory system unable to start the allocation profiler.");
+            return false;
+        }
+    }
+
+    // Allocator block is after the system block and the profiler's
+    state_ptr->allocator_block = ((void*)block + state_memory_requirement + profiler_requirement); 
+
+    // Already fully committed when on huge pages, so there is nothing for the allocator to commit.
+    b8 created = huge_pages
+        ? dynamic_allocator_create_typed(config.allocator_type, config.total_alloc_size, &state_ptr->allocator_memory_requirement, state_ptr->allocator_block, &state_ptr->allocator)
+        : dynamic_allocator_create_reserved(config.allocator_type, config.total_alloc_size, &state_ptr->allocator_memory_requirement, state_ptr->allocator_block, &state_ptr->allocator);
+    if (!created) {
         LFATAL("Memory system is unable to setup internal allocator. Application cannot continue.");
         return false;
     }
 
-    LINFO("Memory system successfully allocated %llu bytes.", config.total_alloc_size);
+    LINFO("Memory system successfully reserved %llu bytes%s.", config.total_alloc_size, huge_pages ? " (huge pages)" : "");
     return true;
 }
 
@@ -96,68 +237,145 @@ void memory_system_shutdown()
         return;
     } 
 
+    // Report anything still allocated before the allocator goes away.
+    if (state_ptr->profiler_state) {
+        memory_profiler_shutdown(state_ptr->profiler_state);
+        state_ptr->profiler_state = 0;
+    }
+
+    // Any blocks still held by thread caches belong to the allocator being destroyed,
+    // so the caches are simply emptied. Caches of exited threads have already been released,
+    // so these all belong to threads still running, which lose theirs. Done under the lock, so
+    // a thread exiting meanwhile either releases its cache first or sees it unregistered.
+    lmutex_lock(&state_ptr->allocator_mutex);
+    for (u32 i = 0; i < state_ptr->thread_cache_count; ++i) {
+        platform_zero_memory(state_ptr->thread_caches[i], sizeof(thread_cache));
+    }
+    state_ptr->thread_cache_count = 0;
+    lmutex_unlock(&state_ptr->allocator_mutex);
+    // May call the release for threads which are still running, which sees their caches are no longer registered.
+    lthread_exit_hook_destroy(&state_ptr->thread_exit_hook);
+    lmutex_destroy(&state_ptr->allocator_mutex);
+
     dynamic_allocator_destroy(&state_ptr->allocator);
 
-    // Free the block.
-    platform_free(state_ptr, state_ptr->allocator_memory_requirement + sizeof(memory_system_state));
+    // Release the reservation.
+    platform_release_memory(state_ptr, state_ptr->reserved_size);
     state_ptr = 0;
 }
 
 void* lallocate(u64 size, memory_tag tag)
 {
-    if (tag == MEMORY_TAG_UNKNOWN){
-        LWARN("lallocate called using MEMORY_TAG_UNKNOWN. Re-class this allocation.");
+    return lallocate_at(size, LMEMORY_DEFAULT_ALIGNMENT, true, tag, 0, 0);
+}
+
+void* lallocate_aligned(u64 size, u16 alignment, memory_tag tag)
+{
+    return lallocate_at(size, alignment, true, tag, 0, 0);
+}
+
+void* lallocate_uninit(u64 size, memory_tag tag)
+{
+    return lallocate_at(size, LMEMORY_DEFAULT_ALIGNMENT, false, tag, 0, 0);
+}
+
+void* lallocate_at(u64 size, u16 alignment, b8 zero, memory_tag tag, const char* file, u32 line)
+{
+    void* block = allocate_internal(size, alignment, tag);
+    if (block) {
+        if (zero) {
+            platform_zero_memory(block, size);
+        }
+        if (state_ptr && state_ptr->profiler_state) {
+            memory_profiler_record_allocation(block, size, tag, file, line);
+        }
     }
+    return block;
+}
 
-    // Check whether or not the memory system has been initialized. 
-    // Will change how our allocation happens.
-    void* block = 0;
-    if (state_ptr) {
-        state_ptr->stats.total_allocated += size;
-        state_ptr->stats.tagged_allocations[tag] += size;
-        state_ptr->alloc_count++;
+void* lreallocate(void* block, u64 size, u64 new_size, memory_tag tag)
+{
+    return lreallocate_at(block, size, new_size, tag, 0, 0);
+}
 
-        block = dynamic_allocator_allocate(&state_ptr->allocator, size);
-    } else {
-        // If the system is not up yet, warn about it for now.
-        LWARN("lallocate called before the memroy system is initialized.");
-        // TODO: Memory alignment;
-        block = platform_allocate(size, false);
+void* lreallocate_at(void* block, u64 size, u64 new_size, memory_tag tag, const char* file, u32 line)
+{
+    if (!block) {
+        return lallocate_at(new_size, LMEMORY_DEFAULT_ALIGNMENT, false, tag, file, line);
     }
-    
-    if (block) {
-        platform_zero_memory(block, size);
+
+    if (!new_size) {
+        lfree(block, size, tag);
+        return 0;
+    }
+
+    if (state_ptr && resize_internal(block, size, new_size, tag)) {
+        if (state_ptr->profiler_state) {
+            memory_profiler_record_free(block);
+            memory_profiler_record_allocation(block, new_size, tag, file, line);
+        }
         return block;
     }
 
-    LFATAL("lallocate failed to allocate successfully.");
-    return 0;
+    // Could not be done in place, so move it.
+    void* new_block = lallocate_at(new_size, LMEMORY_DEFAULT_ALIGNMENT, false, tag, file, line);
+    if (!new_block) {
+        return 0;
+    }
+    platform_copy_memory(new_block, block, size < new_size ? size : new_size);
+    lfree(block, size, tag);
+    return new_block;
 }
 
 void lfree(void* block, u64 size, memory_tag tag) 
+{
+    lfree_aligned(block, size, LMEMORY_DEFAULT_ALIGNMENT, tag);
+}
+
+void lfree_aligned(void* block, u64 size, u16 alignment, memory_tag tag)
 {
     if (tag == MEMORY_TAG_UNKNOWN){
         LWARN("lfree called using MEMORY_TAG_UNKNOWN. Re-class this allocation.");
     }
 
-    // TODO: memory alignment
+    // NOTE: The alignment is only needed to tell whether the block came from a
+    // thread cache, as any alignment padding stays free in the internal allocator.
     if (state_ptr) {
-        state_ptr->stats.total_allocated -= size;
-        state_ptr->stats.tagged_allocations[tag] -= size;
+        if (state_ptr->profiler_state) {
+            memory_profiler_record_free(block);
+        }
 
-        b8 res = dynamic_allocator_free(&state_ptr->allocator, block, size);
+        // The tag only picks the allocator when allocating. Freeing goes by where the block actually
+        // lives, so a block freed with the wrong tag is not handed to an allocator which never owned it.
+        memory_tag heap_tag = tag;
+        dynamic_allocator* allocator = owning_allocator(block, tag, &heap_tag);
+        if (!allocator) {
+            // Not from any allocator, so it was allocated before the system was started.
+            platform_free_aligned(block);
+            return;
+        }
 
-        // If the free fialed, it is possible that an allocation was made
-        // before the system was statrted. Since this is an exception, try to
-        // free it on a platform level. If this fails... dont want this to fail.
+        if (allocator == &state_ptr->allocator) {
+            if (state_ptr->tag_heaps[tag].memory) {
+                LWARN("lfree - block freed with tag %s was not allocated from that tag's heap. Check the tag it was allocated with.", memory_tag_strings[tag]);
+            }
+            // Cacheability goes by the block's allocator rather than the tag, as the tag may be wrong.
+            if (is_cacheable_size(state_ptr, size, alignment)) {
+                cached_free(block, size, tag);
+                return;
+            }
+        } else if (heap_tag != tag) {
+            LWARN("lfree - block freed with tag %s was allocated from the heap of tag %s. Check the tag it was allocated with.", memory_tag_strings[tag], memory_tag_strings[heap_tag]);
+        }
 
-        if (!res) {
-            // TODO: Memory alignment
-            platform_free(block, false);
-        } 
+        // Heap blocks are charged to the heap's tag, so its usage is right when the heap is reset.
+        lmutex_lock(&state_ptr->allocator_mutex);
+        state_ptr->stats.total_allocated -= size;
+        state_ptr->stats.tagged_allocations[heap_tag] -= size;
+        dynamic_allocator_free(allocator, block, size);
+        lmutex_unlock(&state_ptr->allocator_mutex);
     } else {
-        // TODO: Memory alignment
-        platform_free(block, false);
+        platform_free_aligned(block);
     }
 
 }
@@ -183,6 +401,10 @@ char* get_memory_usage_str()
     const u64 mib = kib * kib;
     const u64 gib = mib * kib;
 
+    // Take a merged copy of the stats first, so the lock is not held while formatting.
+    struct memory_stats stats;
+    gather_stats(&stats, 0);
+
     char buffer[8000] = "System memory use (tagged): \n";
     u64 offset = string_length(buffer);
 
@@ -190,22 +412,22 @@ char* get_memory_usage_str()
 
         char unit[4] = "XiB";
         f32 amount = 1.0f;
-        if (state_ptr->stats.tagged_allocations[it] >= gib) {
+        if (stats.tagged_allocations[it] >= gib) {
             unit[0] = 'G';
-            amount = state_ptr->stats.tagged_allocations[it] / (f32) gib;
+            amount = stats.tagged_allocations[it] / (f32) gib;
         }
-        else if (state_ptr->stats.tagged_allocations[it] >= mib) {
+        else if (stats.tagged_allocations[it] >= mib) {
             unit[0] = 'M';
-            amount = state_ptr->stats.tagged_allocations[it] / (f32) mib;    
+            amount = stats.tagged_allocations[it] / (f32) mib;    
         }
-        else if (state_ptr->stats.tagged_allocations[it] >= kib) {
+        else if (stats.tagged_allocations[it] >= kib) {
             unit[0] = 'K';
-            amount = state_ptr->stats.tagged_allocations[it] / (f32) kib;    
+            amount = stats.tagged_allocations[it] / (f32) kib;    
         }
         else {
             unit[0] = 'B';
             unit[1] = 0;
-            amount = (f32)state_ptr->stats.tagged_allocations[it];
+            amount = (f32)stats.tagged_allocations[it];
         }
 
         i32 length = snprintf(buffer + offset, 8000, "  %s: %.2f%s\n", memory_tag_strings[it], amount, unit);   
@@ -218,5 +440,417 @@ char* get_memory_usage_str()
 
 u64 get_memory_alloc_count()
 {
-    return (state_ptr) ? state_ptr->alloc_count : 0;
+    if (!state_ptr) {
+        return 0;
+    }
+
+    u64 alloc_count = 0;
+    gather_stats(0, &alloc_count);
+    return alloc_count;
+}
+
+const char* get_memory_tag_name(memory_tag tag)
+{
+    return tag < MEMORY_TAG_MAX_TAGS ? memory_tag_strings[tag] : "INVALID            ";
+}
+
+u64 get_memory_usage_for_tag(memory_tag tag)
+{
+    if (!state_ptr || tag >= MEMORY_TAG_MAX_TAGS) {
+        return 0;
+    }
+
+    struct memory_stats stats;
+    gather_stats(&stats, 0);
+    return stats.tagged_allocations[tag];
+}
+
+b8 memory_system_create_tag_heap(memory_tag tag, u64 size)
+{
+    if (!state_ptr || tag >= MEMORY_TAG_MAX_TAGS || !size) {
+        LERROR("memory_system_create_tag_heap requires an initialized memory system, a valid tag and a nonzero size.");
+        return false;
+    }
+
+    if (state_ptr->tag_heaps[tag].memory) {
+        LERROR("memory_system_create_tag_heap - tag %s already has a heap.", memory_tag_strings[tag]);
+        return false;
+    }
+
+    // Anything already allocated with the tag lives in the shared allocator, so could not be released with the heap.
+    if (get_memory_usage_for_tag(tag)) {
+        LERROR("memory_system_create_tag_heap - tag %s has outstanding allocations. Create the heap before allocating with it.", memory_tag_strings[tag]);
+        return false;
+    }
+
+    // TLSF, so that both individual frees and resets take constant time.
+    tag_heap heap = {0};
+    heap.size = size;
+    dynamic_allocator_create_typed(DYNAMIC_ALLOCATOR_TYPE_TLSF, size, &heap.memory_requirement, 0, 0);
+
+    lmutex_lock(&state_ptr->allocator_mutex);
+    heap.memory = dynamic_allocator_allocate_aligned(&state_ptr->allocator, heap.memory_requirement, LMEMORY_DEFAULT_ALIGNMENT);
+    if (!heap.memory || !dynamic_allocator_create_typed(DYNAMIC_ALLOCATOR_TYPE_TLSF, size, &heap.memory_requirement, heap.memory, &heap.allocator)) {
+        if (heap.memory) {
+            dynamic_allocator_free(&state_ptr->allocator, heap.memory, heap.memory_requirement);
+        }
+        lmutex_unlock(&state_ptr->allocator_mutex);
+        LERROR("memory_system_create_tag_heap - unable to create a %lluB heap for tag %s.", size, memory_tag_strings[tag]);
+        return false;
+    }
+    state_ptr->tag_heaps[tag] = heap;
+    lmutex_unlock(&state_ptr->allocator_mutex);
+
+    LDEBUG("Created a %lluB heap for tag %s.", size, memory_tag_strings[tag]);
+    return true;
+}
+
+void memory_system_destroy_tag_heap(memory_tag tag)
+{
+    if (!state_ptr || tag >= MEMORY_TAG_MAX_TAGS || !state_ptr->tag_heaps[tag].memory) {
+        return;
+    }
+
+    if (state_ptr->profiler_state) {
+        memory_profiler_record_free_all(tag);
+    }
+
+    lmutex_lock(&state_ptr->allocator_mutex);
+    release_tag_usage(tag);
+    tag_heap* heap = &state_ptr->tag_heaps[tag];
+    dynamic_allocator_destroy(&heap->allocator);
+    dynamic_allocator_free(&state_ptr->allocator, heap->memory, heap->memory_requirement);
+    platform_zero_memory(heap, sizeof(tag_heap));
+    lmutex_unlock(&state_ptr->allocator_mutex);
+}
+
+b8 lfree_all_for_tag(memory_tag tag)
+{
+    if (!state_ptr || tag >= MEMORY_TAG_MAX_TAGS || !state_ptr->tag_heaps[tag].memory) {
+        LERROR("lfree_all_for_tag requires a tag with a heap. See memory_system_create_tag_heap.");
+        return false;
+    }
+
+    if (state_ptr->profiler_state) {
+        memory_profiler_record_free_all(tag);
+    }
+
+    lmutex_lock(&state_ptr->allocator_mutex);
+    release_tag_usage(tag);
+    // Recreating the allocator over the same memory frees everything in it at once.
+    tag_heap* heap = &state_ptr->tag_heaps[tag];
+    dynamic_allocator_destroy(&heap->allocator);
+    b8 result = dynamic_allocator_create_typed(DYNAMIC_ALLOCATOR_TYPE_TLSF, heap->size, &heap->memory_requirement, heap->memory, &heap->allocator);
+    lmutex_unlock(&state_ptr->allocator_mutex);
+    return result;
+}
+
+void memory_system_release_thread_cache()
+{
+    release_thread_cache(&tls_cache);
+}
+
+// Private functions
+// Allocates and tracks a block, without zeroing it.
+static void* allocate_internal(u64 size, u16 alignment, memory_tag tag)
+{
+    if (tag == MEMORY_TAG_UNKNOWN){
+        LWARN("lallocate called using MEMORY_TAG_UNKNOWN. Re-class this allocation.");
+    }
+
+    // Check whether or not the memory system has been initialized. 
+    // Will change how our allocation happens.
+    void* block = 0;
+    if (state_ptr) {
+        if (is_cacheable(state_ptr, size, alignment, tag)) {
+            block = cached_allocate(size, tag);
+        } else {
+            lmutex_lock(&state_ptr->allocator_mutex);
+            block = dynamic_allocator_allocate_aligned(allocator_for(state_ptr, tag), size, alignment);
+            // Only counted once it succeeds, as a full tag heap is an expected failure.
+            if (block) {
+                state_ptr->stats.total_allocated += size;
+                state_ptr->stats.tagged_allocations[tag] += size;
+                state_ptr->alloc_count++;
+            }
+            lmutex_unlock(&state_ptr->allocator_mutex);
+        }
+    } else {
+        // If the system is not up yet, warn about it for now.
+        LWARN("lallocate called before the memroy system is initialized.");
+        block = platform_allocate_aligned(size, alignment);
+    }
+    
+    if (block) {
+        return block;
+    }
+
+    // A full tag heap is expected to happen, and only affects that tag.
+    if (state_ptr && state_ptr->tag_heaps[tag].memory) {
+        LERROR("lallocate failed to allocate %lluB, as the tag heap is full. Tag: %s", size, memory_tag_strings[tag]);
+        return 0;
+    }
+    LFATAL("lallocate failed to allocate successfully.");
+    return 0;
+}
+
+// Resizes a block in place if the allocator allows it, keeping the stats in step.
+// Returns false if the block has to be moved instead.
+static b8 resize_internal(void* block, u64 size, u64 new_size, memory_tag tag)
+{
+    // As with lfree, go by where the block lives rather than the tag, which may be wrong.
+    // Blocks made before the system was started came from the platform, and can only be moved.
+    memory_tag heap_tag = tag;
+    dynamic_allocator* allocator = owning_allocator(block, tag, &heap_tag);
+    if (!allocator) {
+        return false;
+    }
+
+    // Only blocks in the main allocator are ever cached.
+    b8 in_main = allocator == &state_ptr->allocator;
+    b8 was_cached = in_main && is_cacheable_size(state_ptr, size, LMEMORY_DEFAULT_ALIGNMENT);
+    b8 now_cached = in_main && is_cacheable_size(state_ptr, new_size, LMEMORY_DEFAULT_ALIGNMENT);
+    if (was_cached || now_cached) {
+        // Cached blocks are rounded up to their size class, so can be resized freely within it.
+        if (!was_cached || !now_cached || size_class_index(size) != size_class_index(new_size)) {
+            return false;
+        }
+
+        thread_cache* cache = get_thread_cache();
+        if (cache) {
+            counter_add(&cache->stats.total_allocated, new_size - size);
+            counter_add(&cache->stats.tagged_allocations[tag], new_size - size);
+        } else {
+            lmutex_lock(&state_ptr->allocator_mutex);
+            state_ptr->stats.total_allocated += new_size - size;
+            state_ptr->stats.tagged_allocations[tag] += new_size - size;
+            lmutex_unlock(&state_ptr->allocator_mutex);
+        }
+        return true;
+    }
+
+    lmutex_lock(&state_ptr->allocator_mutex);
+    b8 resized = dynamic_allocator_resize(allocator, block, size, new_size);
+    if (resized) {
+        state_ptr->stats.total_allocated += new_size - size;
+        state_ptr->stats.tagged_allocations[heap_tag] += new_size - size;
+    }
+    lmutex_unlock(&state_ptr->allocator_mutex);
+    return resized;
+}
+
+// Drops everything allocated with the given tag from the stats. Must be called with the lock held.
+static void release_tag_usage(memory_tag tag)
+{
+    // Thread caches may still hold part of the tally from before the tag had a heap,
+    // so the shared stats take the whole adjustment, leaving the merged total at zero.
+    u64 in_use = state_ptr->stats.tagged_allocations[tag];
+    for (u32 i = 0; i < state_ptr->thread_cache_count; ++i) {
+        in_use += counter_read(&state_ptr->thread_caches[i]->stats.tagged_allocations[tag]);
+    }
+    state_ptr->stats.total_allocated -= in_use;
+    state_ptr->stats.tagged_allocations[tag] -= in_use;
+}
+
+// The allocator the block was allocated from, or 0 if none (ie. it came from the platform). out_heap_tag
+// is set to the tag whose heap holds the block, or the given tag if it is in the main allocator.
+static dynamic_allocator* owning_allocator(void* block, memory_tag tag, memory_tag* out_heap_tag)
+{
+    // Tag heaps are carved from the main allocator, so must be checked first; the given tag's most likely.
+    tag_heap* heaps = state_ptr->tag_heaps;
+    if (heaps[tag].memory && dynamic_allocator_owns(&heaps[tag].allocator, block)) {
+        *out_heap_tag = tag;
+        return &heaps[tag].allocator;
+    }
+    for (u32 i = 0; i < MEMORY_TAG_MAX_TAGS; ++i) {
+        if (i != tag && heaps[i].memory && dynamic_allocator_owns(&heaps[i].allocator, block)) {
+            *out_heap_tag = (memory_tag)i;
+            return &heaps[i].allocator;
+        }
+    }
+
+    *out_heap_tag = tag;
+    return dynamic_allocator_owns(&state_ptr->allocator, block) ? &state_ptr->allocator : 0;
+}
+
+// Gives a thread's cached blocks back and folds its stats into the shared ones. Also run by the
+// thread exit hook on the exiting thread, and on shutdown for caches which are no longer registered.
+static void release_thread_cache(void* cache_block)
+{
+    thread_cache* cache = cache_block;
+    // Unlocked check first, as the exit hook may run for caches already released.
+    if (!state_ptr || !cache->registered) {
+        return;
+    }
+
+    lmutex_lock(&state_ptr->allocator_mutex);
+    // Check again now the lock is held, as shutdown may have emptied the cache in the meantime.
+    if (!cache->registered) {
+        lmutex_unlock(&state_ptr->allocator_mutex);
+        return;
+    }
+
+    // Give every cached block back.
+    for (u32 i = 0; i < THREAD_CACHE_CLASS_COUNT; ++i) {
+        flush_size_class(&cache->classes[i], THREAD_CACHE_MIN_BLOCK_SIZE << i, 0);
+    }
+
+    // Fold the thread's stats into the shared ones, so they survive the thread.
+    state_ptr->stats.total_allocated += cache->stats.total_allocated;
+    for (u32 i = 0; i < MEMORY_TAG_MAX_TAGS; ++i) {
+        state_ptr->stats.tagged_allocations[i] += cache->stats.tagged_allocations[i];
+    }
+    state_ptr->alloc_count += cache->alloc_count;
+
+    // Swap-remove the cache from the list.
+    for (u32 i = 0; i < state_ptr->thread_cache_count; ++i) {
+        if (state_ptr->thread_caches[i] == cache) {
+            state_ptr->thread_caches[i] = state_ptr->thread_caches[state_ptr->thread_cache_count - 1];
+            state_ptr->thread_cache_count--;
+            break;
+        }
+    }
+    platform_zero_memory(cache, sizeof(thread_cache));
+
+    lmutex_unlock(&state_ptr->allocator_mutex);
+}
+
+static thread_cache* get_thread_cache()
+{
+    thread_cache* cache = &tls_cache;
+    if (cache->registered) {
+        return cache;
+    }
+
+    // First use on this thread. Add the cache to the list, if there is room.
+    lmutex_lock(&state_ptr->allocator_mutex);
+    // The hook hands the cache back when the thread exits, so the list never holds a dead thread's cache.
+    if (state_ptr->thread_cache_count < THREAD_CACHE_MAX_THREADS && lthread_exit_hook_set(&state_ptr->thread_exit_hook, cache)) {
+        state_ptr->thread_caches[state_ptr->thread_cache_count++] = cache;
+        cache->registered = true;
+    }
+    lmutex_unlock(&state_ptr->allocator_mutex);
+
+    return cache->registered ? cache : 0;
+}
+
+static void* cached_allocate(u64 size, memory_tag tag)
+{
+    u32 index = size_class_index(size);
+    u64 class_size = THREAD_CACHE_MIN_BLOCK_SIZE << index;
+
+    thread_cache* cache = get_thread_cache();
+    if (!cache) {
+        // No cache for this thread, so go to the shared allocator. The block is 
+        // still class sized, as it may be freed by a thread which has a cache.
+        lmutex_lock(&state_ptr->allocator_mutex);
+        void* block = dynamic_allocator_allocate_aligned(&state_ptr->allocator, class_size, LMEMORY_DEFAULT_ALIGNMENT);
+        if (block) {
+            state_ptr->stats.total_allocated += size;
+            state_ptr->stats.tagged_allocations[tag] += size;
+            state_ptr->alloc_count++;
+        }
+        lmutex_unlock(&state_ptr->allocator_mutex);
+        return block;
+    }
+
+    size_class_cache* size_class = &cache->classes[index];
+    if (!size_class->head) {
+        // Refill half a magazine's worth in one go.
+        lmutex_lock(&state_ptr->allocator_mutex);
+        for (u32 i = 0; i < THREAD_CACHE_MAGAZINE_SIZE / 2; ++i) {
+            cached_block* refill = dynamic_allocator_allocate_aligned(&state_ptr->allocator, class_size, LMEMORY_DEFAULT_ALIGNMENT);
+            if (!refill) {
+                break;
+            }
+            refill->next = size_class->head;
+            size_class->head = refill;
+            size_class->count++;
+        }
+        lmutex_unlock(&state_ptr->allocator_mutex);
+
+        if (!size_class->head) {
+            return 0;
+        }
+    }
+
+    cached_block* block = size_class->head;
+    size_class->head = block->next;
+    size_class->count--;
+
+    counter_add(&cache->stats.total_allocated, size);
+    counter_add(&cache->stats.tagged_allocations[tag], size);
+    counter_add(&cache->alloc_count, 1);
+    return block;
+}
+
+static void cached_free(void* block, u64 size, memory_tag tag)
+{
+    u32 index = size_class_index(size);
+    u64 class_size = THREAD_CACHE_MIN_BLOCK_SIZE << index;
+
+    thread_cache* cache = get_thread_cache();
+    if (!cache) {
+        lmutex_lock(&state_ptr->allocator_mutex);
+        state_ptr->stats.total_allocated -= size;
+        state_ptr->stats.tagged_allocations[tag] -= size;
+        dynamic_allocator_free(&state_ptr->allocator, block, class_size);
+        lmutex_unlock(&state_ptr->allocator_mutex);
+        return;
+    }
+
+    counter_add(&cache->stats.total_allocated, -size);
+    counter_add(&cache->stats.tagged_allocations[tag], -size);
+
+    size_class_cache* size_class = &cache->classes[index];
+    cached_block* cached = block;
+    cached->next = size_class->head;
+    size_class->head = cached;
+    size_class->count++;
+
+    if (size_class->count > THREAD_CACHE_MAGAZINE_SIZE) {
+        // Too many held by this thread. Give half back so other threads can use them.
+        lmutex_lock(&state_ptr->allocator_mutex);
+        flush_size_class(size_class, class_size, THREAD_CACHE_MAGAZINE_SIZE / 2);
+        lmutex_unlock(&state_ptr->allocator_mutex);
+    }
+}
+
+// Returns cached blocks to the allocator until keep_count remain. Must be called with the lock held.
+static void flush_size_class(size_class_cache* size_class, u64 class_size, u32 keep_count)
+{
+    while (size_class->count > keep_count) {
+        cached_block* block = size_class->head;
+        size_class->head = block->next;
+        size_class->count--;
+        dynamic_allocator_free(&state_ptr->allocator, block, class_size);
+    }
+}
+
+// Merges the shared stats with those of every thread cache.
+static void gather_stats(struct memory_stats* out_stats, u64* out_alloc_count)
+{
+    lmutex_lock(&state_ptr->allocator_mutex);
+
+    if (out_stats) {
+        *out_stats = state_ptr->stats;
+    }
+    if (out_alloc_count) {
+        *out_alloc_count = state_ptr->alloc_count;
+    }
+
+    for (u32 i = 0; i < state_ptr->thread_cache_count; ++i) {
+        thread_cache* cache = state_ptr->thread_caches[i];
+        if (out_stats) {
+            out_stats->total_allocated += counter_read(&cache->stats.total_allocated);
+            for (u32 tag = 0; tag < MEMORY_TAG_MAX_TAGS; ++tag) {
+                out_stats->tagged_allocations[tag] += counter_read(&cache->stats.tagged_allocations[tag]);
+            }
+        }
+        if (out_alloc_count) {
+            *out_alloc_count += counter_read(&cache->alloc_count);
+        }
+    }
+
+    lmutex_unlock(&state_ptr->allocator_mutex);
 }
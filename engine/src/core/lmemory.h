@@ -1,6 +1,7 @@
 #pragma once
 
 #include "defines.h"
+#include "memory/dynamic_allocator.h"
 
 typedef enum memory_tag{
     // For temporary use. Should be assigned one of the below or have a new tag created
@@ -30,6 +31,26 @@ typedef enum memory_tag{
 typedef struct memory_system_configuration {
     /** @brief The total memory size in bytes used by the internal allocator for this system. */
     u64 total_alloc_size;
+    /** @brief The strategy used by the internal allocator. TLSF gives constant time allocations regardless of fragmentation. */
+    dynamic_allocator_type allocator_type;
+    /** 
+     * @brief Indicates if small allocations should go through per-thread caches. This lets
+     * threads allocate without contending on the internal allocator's lock. 
+     */
+    b8 use_thread_caches;
+    /**
+     * @brief Indicates if allocations should be profiled. Each allocation is attributed to the
+     * call site which made it, and per-tag/per-site live and peak bytes, counts and size histograms
+     * are kept. A leak report is logged at shutdown. Costs a lock and a table update per
+     * allocation/free, so is off unless needed. See memory_profiler.h.
+     */
+    b8 enable_profiling;
+    /**
+     * @brief Indicates if the system's memory should be backed by huge pages where the platform
+     * supports them (transparent huge pages on Linux), to cut TLB misses. Falls back to regular
+     * pages, with a warning, where they are unavailable.
+     */
+    b8 use_huge_pages;
 } memory_system_configuration;
 
 
@@ -50,10 +71,95 @@ LAPI void memory_system_shutdown();
 // These functions are designed to be called 
 // out of the engine, so LAPI is intended here.
 
+/** @brief The alignment in bytes of blocks returned by lallocate. Enough for 16-byte aligned (SIMD) types such as vec4 and mat4. */
+#define LMEMORY_DEFAULT_ALIGNMENT 16
+
 LAPI void* lallocate(u64 size, memory_tag tag);
 
+/**
+ * @brief Allocates a zeroed block of memory aligned to the given alignment.
+ * 
+ * @param size The size in bytes to be allocated.
+ * @param alignment The alignment in bytes. Must be a power of two.
+ * @param tag The tag to track the allocation under.
+ * @return A pointer to the allocated block; 0 on failure.
+ */
+LAPI void* lallocate_aligned(u64 size, u16 alignment, memory_tag tag);
+
+/**
+ * @brief Same as lallocate, but the block is NOT zeroed. Use for memory which is
+ * immediately overwritten in full (copies, file reads, generated data), where clearing
+ * it first would be wasted work. Tracked and freed exactly like lallocate (use lfree).
+ * 
+ * @param size The size in bytes to be allocated.
+ * @param tag The tag to track the allocation under.
+ * @return A pointer to the allocated, uninitialized block; 0 on failure.
+ */
+LAPI void* lallocate_uninit(u64 size, memory_tag tag);
+
+/**
+ * @brief Resizes a block obtained from lallocate or lallocate_uninit, keeping its contents up to the
+ * smaller of the two sizes. The block is grown or shrunk in place whenever the memory after it allows,
+ * so nothing is copied. Otherwise a new block is allocated, the contents copied over and the old block
+ * freed. Any space gained is NOT zeroed. Passing a block of 0 is the same as lallocate_uninit.
+ * 
+ * @param block The block to be resized. May be 0.
+ * @param size The size in bytes the block was allocated (or last resized) with.
+ * @param new_size The size in bytes the block should have. If 0, the block is freed.
+ * @param tag The tag the block was allocated with.
+ * @return A pointer to the resized block, which may differ from block. 0 on failure, leaving block untouched.
+ */
+LAPI void* lreallocate(void* block, u64 size, u64 new_size, memory_tag tag);
+
 LAPI void lfree(void* block, u64 size, memory_tag tag);
 
+/**
+ * @brief Frees a block obtained from lallocate_aligned.
+ * 
+ * @param block The block to be freed.
+ * @param size The size in bytes the block was allocated with.
+ * @param alignment The alignment the block was allocated with.
+ * @param tag The tag the block was allocated with.
+ */
+LAPI void lfree_aligned(void* block, u64 size, u16 alignment, memory_tag tag);
+
+/**
+ * @brief Allocates a block of memory, recording the call site it was made from if profiling
+ * is enabled. Not normally called directly; lallocate, lallocate_aligned and lallocate_uninit
+ * are routed here with the caller's __FILE__ and __LINE__. Freed as usual.
+ * 
+ * @param size The size in bytes to be allocated.
+ * @param alignment The alignment in bytes. Must be a power of two.
+ * @param zero Indicates if the block should be zeroed.
+ * @param tag The tag to track the allocation under.
+ * @param file The source file the allocation is made from.
+ * @param line The line of the source file the allocation is made from.
+ * @return A pointer to the allocated block; 0 on failure.
+ */
+LAPI void* lallocate_at(u64 size, u16 alignment, b8 zero, memory_tag tag, const char* file, u32 line);
+
+/**
+ * @brief Same as lreallocate, recording the call site if profiling is enabled. lreallocate is routed here.
+ * 
+ * @param block The block to be resized. May be 0.
+ * @param size The size in bytes the block was allocated (or last resized) with.
+ * @param new_size The size in bytes the block should have. If 0, the block is freed.
+ * @param tag The tag the block was allocated with.
+ * @param file The source file the call is made from.
+ * @param line The line of the source file the call is made from.
+ * @return A pointer to the resized block, which may differ from block. 0 on failure, leaving block untouched.
+ */
+LAPI void* lreallocate_at(void* block, u64 size, u64 new_size, memory_tag tag, const char* file, u32 line);
+
+// Route allocations through lallocate_at, so the profiler can see where each was made.
+// The functions themselves remain available (and exported) for code which needs their address.
+#ifndef LMEMORY_NO_CALL_SITES
+#define lallocate(size, tag) lallocate_at(size, LMEMORY_DEFAULT_ALIGNMENT, true, tag, __FILE__, __LINE__)
+#define lallocate_aligned(size, alignment, tag) lallocate_at(size, alignment, true, tag, __FILE__, __LINE__)
+#define lallocate_uninit(size, tag) lallocate_at(size, LMEMORY_DEFAULT_ALIGNMENT, false, tag, __FILE__, __LINE__)
+#define lreallocate(block, size, new_size, tag) lreallocate_at(block, size, new_size, tag, __FILE__, __LINE__)
+#endif
+
 LAPI void* lzero_memory(void* black, u64 size);
 
 LAPI void* lcopy_memory(void* dest, const void* source, u64 size);
@@ -64,4 +170,59 @@ LAPI void* lset_memory(void* dest, i32 value, u64 size);
 // should be freed after use
 LAPI char* get_memory_usage_str();
 
-LAPI u64 get_memory_alloc_count();
\ No newline at end of file
+LAPI u64 get_memory_alloc_count();
+
+/**
+ * @brief Obtains the display name of the given tag.
+ * 
+ * @param tag The tag to obtain the name of.
+ * @return The name of the tag, padded to a fixed width for tabular output.
+ */
+LAPI const char* get_memory_tag_name(memory_tag tag);
+
+/**
+ * @brief Obtains the number of bytes currently allocated under the given tag,
+ * merged across all threads.
+ * 
+ * @param tag The tag to obtain usage for.
+ * @return The number of bytes allocated.
+ */
+LAPI u64 get_memory_usage_for_tag(memory_tag tag);
+
+/**
+ * @brief Creates a heap dedicated to the given tag, carved out of the memory system's own memory.
+ * From then on every allocation made with the tag comes from this heap, staying out of the shared
+ * allocator (and thread caches), and can be released all at once with lfree_all_for_tag. Individual
+ * frees still work as normal. Allocations with the tag fail once the heap is full. Should be set up
+ * before anything is allocated with the tag, and not while other threads are allocating with it.
+ * 
+ * @param tag The tag to create a heap for.
+ * @param size The size in bytes of the heap.
+ * @return True on success; false if the tag already has a heap or outstanding allocations, or there is not enough memory.
+ */
+LAPI b8 memory_system_create_tag_heap(memory_tag tag, u64 size);
+
+/**
+ * @brief Releases everything allocated from the given tag's heap, and gives the heap's memory back.
+ * Allocations with the tag go through the shared allocator again afterwards.
+ * 
+ * @param tag The tag whose heap should be destroyed.
+ */
+LAPI void memory_system_destroy_tag_heap(memory_tag tag);
+
+/**
+ * @brief Frees every allocation made with the given tag in one go, by resetting the tag's heap. This
+ * takes constant time however many allocations were made. Any pointers into the heap are invalid
+ * afterwards. Only available for tags with a heap (see memory_system_create_tag_heap).
+ * 
+ * @param tag The tag whose allocations should all be freed.
+ * @return True on success; false if the tag has no heap.
+ */
+LAPI b8 lfree_all_for_tag(memory_tag tag);
+
+/**
+ * @brief Gives any blocks cached by the calling thread back to the memory system,
+ * and folds its stats into the shared ones. Done automatically when a thread exits,
+ * however it was started, so only needed to release a cache early.
+ */
+LAPI void memory_system_release_thread_cache();
\ No newline at end of file
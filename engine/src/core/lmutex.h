@@ -0,0 +1,52 @@
+/**
+ * @file lmutex.h
+ *
+ * @brief Contains a mutex, used to synchronize access to shared data between threads.
+ * Implemented by the platform layer.
+ * @version 0.1
+ * @date 2024-05-10
+ *
+ */
+
+#pragma once
+#include "defines.h"
+
+/**
+ * @brief A mutex. The internal data is platform-specific and should
+ * not be touched outside of the functions below.
+ */
+typedef struct lmutex {
+    /** @brief The platform-specific mutex data. */
+    void* internal_data;
+} lmutex;
+
+/**
+ * @brief Creates a mutex.
+ *
+ * @param out_mutex A pointer to hold the created mutex.
+ * @return True on success; otherwise false.
+ */
+LAPI b8 lmutex_create(lmutex* out_mutex);
+
+/**
+ * @brief Destroys the provided mutex. It must not be locked.
+ *
+ * @param mutex A pointer to the mutex to be destroyed.
+ */
+LAPI void lmutex_destroy(lmutex* mutex);
+
+/**
+ * @brief Locks the provided mutex, blocking until it is available.
+ *
+ * @param mutex A pointer to the mutex to be locked.
+ * @return True on success; otherwise false.
+ */
+LAPI b8 lmutex_lock(lmutex* mutex);
+
+/**
+ * @brief Unlocks the provided mutex.
+ *
+ * @param mutex A pointer to the mutex to be unlocked.
+ * @return True on success; otherwise false.
+ */
+LAPI b8 lmutex_unlock(lmutex* mutex);
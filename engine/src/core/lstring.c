@@ -115,19 +115,20 @@ void string_mid(char* dest, const char* source, i32 start, i32 length)
         dest[0] = 0;
         return;
     }
+    // NOTE: The terminator goes after the last character written to dest, so dest
+    // only needs to hold the substring itself (plus the terminator).
+    u64 j = 0;
     if (length > 0) {
-        for (u64 i = start, j = 0; j < length && source[i]; ++i, ++j){
+        for (u64 i = start; j < length && source[i]; ++i, ++j){
             dest[j] = source[i];
         }
-        dest[start + length] = 0;
     } else {
         // If a negative value is passed, proceed to the end of the string.
-        u64 j = 0;
         for (u64 i = start; source[i]; ++i, ++j) {
             dest[j] = source[i];
         }
-        dest[start + j] = 0;
     }
+    dest[j] = 0;
 }
 
 i32 string_index_of(char* str, char c)
@@ -0,0 +1,123 @@
+/**
+ * @file lthread.h
+ *
+ * @brief Contains a thread, used to run work off the main thread.
+ * Implemented by the platform layer.
+ * @version 0.1
+ * @date 2024-05-10
+ *
+ */
+
+#pragma once
+#include "defines.h"
+
+/**
+ * @brief The function a thread starts in.
+ *
+ * @param params The parameters passed to lthread_create.
+ * @return The exit code of the thread.
+ */
+typedef u32 (*pfn_thread_start)(void* params);
+
+/**
+ * @brief A function run when a thread exits.
+ *
+ * @param value The value the exiting thread set with lthread_exit_hook_set.
+ */
+typedef void (*pfn_thread_exit)(void* value);
+
+/**
+ * @brief A thread. The internal data is platform-specific and should
+ * not be touched outside of the functions below.
+ */
+typedef struct lthread {
+    /** @brief The platform-specific thread handle. */
+    void* internal_data;
+    /** @brief The id of the thread. */
+    u64 thread_id;
+} lthread;
+
+/**
+ * @brief A hook run on every thread which exits with a value set on it, including threads
+ * not started with lthread_create. The internal data is platform-specific and should not be
+ * touched outside of the functions below.
+ */
+typedef struct lthread_exit_hook {
+    /** @brief The platform-specific thread-local slot. */
+    void* internal_data;
+} lthread_exit_hook;
+
+/**
+ * @brief Creates and immediately starts a new thread.
+ *
+ * @param start_function The function to run on the thread.
+ * @param params The parameters to pass to start_function. Optional.
+ * @param auto_detach Indicates if the thread should be detached immediately. Detached threads cannot be waited on.
+ * @param out_thread A pointer to hold the created thread. Only valid if not auto-detached.
+ * @return True on success; otherwise false.
+ */
+LAPI b8 lthread_create(pfn_thread_start start_function, void* params, b8 auto_detach, lthread* out_thread);
+
+/**
+ * @brief Releases the resources held by the provided thread. Does not stop it.
+ *
+ * @param thread A pointer to the thread to be destroyed.
+ */
+LAPI void lthread_destroy(lthread* thread);
+
+/**
+ * @brief Detaches the provided thread, releasing its resources once it finishes.
+ *
+ * @param thread A pointer to the thread to be detached.
+ */
+LAPI void lthread_detach(lthread* thread);
+
+/**
+ * @brief Blocks until the provided thread has finished.
+ *
+ * @param thread A pointer to the thread to wait on.
+ * @return True on success; otherwise false.
+ */
+LAPI b8 lthread_wait(lthread* thread);
+
+/**
+ * @brief Gives up the rest of the calling thread's time slice, so another thread may run.
+ * For threads waiting on another to make progress, such as on a full or empty queue.
+ */
+LAPI void lthread_yield();
+
+/**
+ * @brief Obtains the id of the calling thread.
+ *
+ * @return The id of the calling thread.
+ */
+LAPI u64 lthread_get_current_id();
+
+/**
+ * @brief Creates a thread exit hook. Each thread can set its own value on it; when a thread
+ * exits with a value set, on_exit is called with that value on the exiting thread.
+ *
+ * @param on_exit The function to call. Required.
+ * @param out_hook A pointer to hold the created hook.
+ * @return True on success; otherwise false.
+ */
+LAPI b8 lthread_exit_hook_create(pfn_thread_exit on_exit, lthread_exit_hook* out_hook);
+
+/**
+ * @brief Destroys the provided thread exit hook. On some platforms (Windows), on_exit is called
+ * on the calling thread for each thread which still has a value set, so it must cope with being
+ * called after whatever it cleans up has gone away.
+ *
+ * @param hook A pointer to the hook to be destroyed.
+ */
+LAPI void lthread_exit_hook_destroy(lthread_exit_hook* hook);
+
+/**
+ * @brief Sets the calling thread's value for the provided hook. Setting 0 means nothing is called
+ * when the thread exits.
+ *
+ * @param hook A pointer to the hook.
+ * @param value The value to pass to on_exit when the calling thread exits.
+ * @return True on success; otherwise false.
+ */
+LAPI b8 lthread_exit_hook_set(lthread_exit_hook* hook, void* value);
@@ -0,0 +1,433 @@
+#include "memory_profiler.h"
+
+#include "core/logger.h"
+#include "core/lmutex.h"
+#include "core/lstring.h"
+#include "platform/platform.h"
+#include "platform/filesystem.h"
+
+// The starting capacity of the live allocation table. Always a power of two.
+#define LIVE_TABLE_MIN_CAPACITY 1024
+// The site lookup is kept at most half full, so probe sequences stay short.
+#define SITE_LOOKUP_CAPACITY (MEMORY_PROFILER_MAX_SITES * 2)
+
+// An allocation which has not been freed yet.
+typedef struct live_allocation {
+    // 0 if the slot is empty.
+    void* block;
+    u64 size;
+    // Index into the sites array, or INVALID_ID if the site table was full.
+    u32 site;
+    memory_tag tag;
+} live_allocation;
+
+typedef struct memory_profiler_state {
+    // Guards everything below. Taken after (never while holding) the memory system's own lock.
+    lmutex mutex;
+    memory_profile_stats total;
+    memory_profile_stats tags[MEMORY_TAG_MAX_TAGS];
+    // Allocations made from sites after the site table filled up.
+    memory_profile_stats untracked_sites;
+
+    u32 site_count;
+    memory_profile_site sites[MEMORY_PROFILER_MAX_SITES];
+    // Open addressed by file pointer and line. Holds index + 1 into sites; 0 is empty.
+    u32 site_lookup[SITE_LOOKUP_CAPACITY];
+
+    // Open addressed by block address, with linear probing. Obtained from the platform
+    // directly, as the profiler cannot allocate through the system it is watching.
+    live_allocation* live;
+    u64 live_capacity;
+    u64 live_count;
+} memory_profiler_state;
+
+static memory_profiler_state* state_ptr;
+
+// Private functions
+static u32 find_or_add_site(const char* file, u32 line, memory_tag tag);
+static b8 ensure_live_capacity();
+static void live_insert(live_allocation* table, u64 capacity, live_allocation allocation);
+static void live_remove_at(u64 index);
+static void format_stats_line(char* buffer, const char* label, const memory_profile_stats* stats);
+static b8 write_stats(file_handle* file, const char* label, const memory_profile_stats* stats);
+
+LINLINE u64 hash_pointer(const void* pointer) {
+    // Blocks are at least 16-byte aligned, so the low bits carry nothing.
+    return ((u64)pointer >> 4) * 0x9E3779B97F4A7C15ULL;
+}
+
+LINLINE u32 histogram_bucket(u64 size) {
+    if (size < 32) {
+        return 0;
+    }
+    u32 bucket = (63 - __builtin_clzll(size)) - 4;
+    return bucket < MEMORY_PROFILER_HISTOGRAM_BUCKETS ? bucket : MEMORY_PROFILER_HISTOGRAM_BUCKETS - 1;
+}
+
+LINLINE void stats_add(memory_profile_stats* stats, u64 size) {
+    stats->live_bytes += size;
+    if (stats->live_bytes > stats->peak_bytes) {
+        stats->peak_bytes = stats->live_bytes;
+    }
+    stats->live_count++;
+    stats->total_count++;
+    stats->total_bytes += size;
+    stats->histogram[histogram_bucket(size)]++;
+}
+
+LINLINE void stats_remove(memory_profile_stats* stats, u64 size) {
+    stats->live_bytes -= size;
+    stats->live_count--;
+}
+
+b8 memory_profiler_initialize(u64* memory_requirement, void* state)
+{
+    *memory_requirement = sizeof(memory_profiler_state);
+    if (!state) {
+        return true;
+    }
+
+    // NOTE: The state is expected to be zeroed already.
+    state_ptr = state;
+    if (!lmutex_create(&state_ptr->mutex)) {
+        LERROR("Memory profiler unable to create its mutex.");
+        state_ptr = 0;
+        return false;
+    }
+
+    LINFO("Memory profiler enabled. Allocations are attributed to their call sites.");
+    return true;
+}
+
+void memory_profiler_shutdown(void* state)
+{
+    if (!state_ptr) {
+        return;
+    }
+
+    memory_profiler_report_leaks();
+
+    lmutex_destroy(&state_ptr->mutex);
+    if (state_ptr->live) {
+        platform_free(state_ptr->live, false);
+    }
+    state_ptr = 0;
+}
+
+void memory_profiler_record_allocation(void* block, u64 size, memory_tag tag, const char* file, u32 line)
+{
+    if (!state_ptr || !block) {
+        return;
+    }
+
+    lmutex_lock(&state_ptr->mutex);
+
+    if (!ensure_live_capacity()) {
+        lmutex_unlock(&state_ptr->mutex);
+        return;
+    }
+
+    u32 site = find_or_add_site(file, line, tag);
+    stats_add(&state_ptr->total, size);
+    stats_add(&state_ptr->tags[tag], size);
+    stats_add(site == INVALID_ID ? &state_ptr->untracked_sites : &state_ptr->sites[site].stats, size);
+
+    live_allocation allocation = {block, size, site, tag};
+    live_insert(state_ptr->live, state_ptr->live_capacity, allocation);
+    state_ptr->live_count++;
+
+    lmutex_unlock(&state_ptr->mutex);
+}
+
+void memory_profiler_record_free(void* block)
+{
+    if (!state_ptr || !block) {
+        return;
+    }
+
+    lmutex_lock(&state_ptr->mutex);
+
+    if (state_ptr->live_capacity) {
+        u64 mask = state_ptr->live_capacity - 1;
+        for (u64 i = hash_pointer(block) & mask; state_ptr->live[i].block; i = (i + 1) & mask) {
+            live_allocation* allocation = &state_ptr->live[i];
+            if (allocation->block != block) {
+                continue;
+            }
+
+            stats_remove(&state_ptr->total, allocation->size);
+            stats_remove(&state_ptr->tags[allocation->tag], allocation->size);
+            stats_remove(allocation->site == INVALID_ID ? &state_ptr->untracked_sites : &state_ptr->sites[allocation->site].stats, allocation->size);
+            live_remove_at(i);
+            state_ptr->live_count--;
+            break;
+        }
+    }
+
+    lmutex_unlock(&state_ptr->mutex);
+}
+
+void memory_profiler_record_free_all(memory_tag tag)
+{
+    if (!state_ptr) {
+        return;
+    }
+
+    lmutex_lock(&state_ptr->mutex);
+
+    // Removing entries shifts later ones back, so only advance when the slot was kept.
+    for (u64 i = 0; i < state_ptr->live_capacity;) {
+        live_allocation* allocation = &state_ptr->live[i];
+        if (!allocation->block || allocation->tag != tag) {
+            ++i;
+            continue;
+        }
+
+        stats_remove(&state_ptr->total, allocation->size);
+        stats_remove(&state_ptr->tags[tag], allocation->size);
+        stats_remove(allocation->site == INVALID_ID ? &state_ptr->untracked_sites : &state_ptr->sites[allocation->site].stats, allocation->size);
+        live_remove_at(i);
+        state_ptr->live_count--;
+    }
+
+    lmutex_unlock(&state_ptr->mutex);
+}
+
+b8 memory_profiler_is_enabled()
+{
+    return state_ptr != 0;
+}
+
+b8 memory_profiler_get_tag_stats(memory_tag tag, memory_profile_stats* out_stats)
+{
+    if (!state_ptr || tag >= MEMORY_TAG_MAX_TAGS || !out_stats) {
+        return false;
+    }
+
+    lmutex_lock(&state_ptr->mutex);
+    *out_stats = state_ptr->tags[tag];
+    lmutex_unlock(&state_ptr->mutex);
+    return true;
+}
+
+b8 memory_profiler_get_site(const char* file, u32 line, memory_profile_site* out_site)
+{
+    if (!state_ptr || !file || !out_site) {
+        return false;
+    }
+
+    // Compared by content, as the same file name may live at different addresses in different modules.
+    b8 found = false;
+    lmutex_lock(&state_ptr->mutex);
+    for (u32 i = 0; i < state_ptr->site_count; ++i) {
+        memory_profile_site* site = &state_ptr->sites[i];
+        if (site->line == line && strings_equal(site->file, file)) {
+            *out_site = *site;
+            found = true;
+            break;
+        }
+    }
+    lmutex_unlock(&state_ptr->mutex);
+    return found;
+}
+
+u64 memory_profiler_report_leaks()
+{
+    if (!state_ptr) {
+        return 0;
+    }
+
+    lmutex_lock(&state_ptr->mutex);
+
+    u64 leaked = state_ptr->total.live_count;
+    if (!leaked) {
+        LINFO("Memory profiler: no leaks detected.");
+        lmutex_unlock(&state_ptr->mutex);
+        return 0;
+    }
+
+    LWARN("Memory profiler: %llu allocation(s) totalling %llu bytes were not freed:", leaked, state_ptr->total.live_bytes);
+    for (u32 i = 0; i < state_ptr->site_count; ++i) {
+        memory_profile_site* site = &state_ptr->sites[i];
+        if (site->stats.live_count) {
+            LWARN("  %s:%u [%s] - %llu allocation(s), %llu bytes",
+                  site->file, site->line, get_memory_tag_name(site->tag), site->stats.live_count, site->stats.live_bytes);
+        }
+    }
+    if (state_ptr->untracked_sites.live_count) {
+        LWARN("  <untracked sites> - %llu allocation(s), %llu bytes",
+              state_ptr->untracked_sites.live_count, state_ptr->untracked_sites.live_bytes);
+    }
+
+    lmutex_unlock(&state_ptr->mutex);
+    return leaked;
+}
+
+b8 memory_profiler_dump(const char* path)
+{
+    if (!state_ptr) {
+        LWARN("memory_profiler_dump - the profiler is not enabled. Set enable_profiling in the memory system configuration.");
+        return false;
+    }
+
+    file_handle file;
+    if (!filesystem_open(path, FILE_MODE_WRITE, false, &file)) {
+        LERROR("memory_profiler_dump - unable to open '%s' for writing.", path);
+        return false;
+    }
+
+    // NOTE: The lock is held throughout, so the dump is a consistent snapshot. Nothing
+    // below allocates through the memory system.
+    lmutex_lock(&state_ptr->mutex);
+
+    char label[512];
+    b8 result = filesystem_write_line(&file, "# Memory profile. Histogram bucket i counts allocations of [16 << i, 32 << i) bytes.");
+    result = result && write_stats(&file, "TOTAL", &state_ptr->total);
+
+    result = result && filesystem_write_line(&file, "");
+    result = result && filesystem_write_line(&file, "# By tag");
+    for (u32 i = 0; i < MEMORY_TAG_MAX_TAGS && result; ++i) {
+        if (state_ptr->tags[i].total_count) {
+            result = write_stats(&file, get_memory_tag_name(i), &state_ptr->tags[i]);
+        }
+    }
+
+    result = result && filesystem_write_line(&file, "");
+    result = result && filesystem_write_line(&file, "# By call site");
+    for (u32 i = 0; i < state_ptr->site_count && result; ++i) {
+        memory_profile_site* site = &state_ptr->sites[i];
+        string_format(label, "%s:%u [%s]", site->file, site->line, get_memory_tag_name(site->tag));
+        result = write_stats(&file, label, &site->stats);
+    }
+    if (result && state_ptr->untracked_sites.total_count) {
+        result = write_stats(&file, "<untracked sites>", &state_ptr->untracked_sites);
+    }
+
+    lmutex_unlock(&state_ptr->mutex);
+    filesystem_close(&file);
+
+    if (!result) {
+        LERROR("memory_profiler_dump - failed writing to '%s'.", path);
+    }
+    return result;
+}
+
+// Private functions
+
+// Must be called with the lock held.
+static u32 find_or_add_site(const char* file, u32 line, memory_tag tag)
+{
+    u64 hash = hash_pointer(file) ^ ((u64)line * 0xC2B2AE3D27D4EB4FULL);
+    u32 mask = SITE_LOOKUP_CAPACITY - 1;
+    u32 slot = (u32)(hash >> 32) & mask;
+    while (state_ptr->site_lookup[slot]) {
+        u32 index = state_ptr->site_lookup[slot] - 1;
+        if (state_ptr->sites[index].file == file && state_ptr->sites[index].line == line) {
+            return index;
+        }
+        slot = (slot + 1) & mask;
+    }
+
+    if (state_ptr->site_count == MEMORY_PROFILER_MAX_SITES) {
+        return INVALID_ID;
+    }
+
+    u32 index = state_ptr->site_count++;
+    memory_profile_site* site = &state_ptr->sites[index];
+    site->file = file ? file : "<unknown>";
+    site->line = line;
+    site->tag = tag;
+    state_ptr->site_lookup[slot] = index + 1;
+    return index;
+}
+
+// Grows the live table so it stays at most half full. Must be called with the lock held.
+static b8 ensure_live_capacity()
+{
+    if ((state_ptr->live_count + 1) * 2 <= state_ptr->live_capacity) {
+        return true;
+    }
+
+    u64 new_capacity = state_ptr->live_capacity ? state_ptr->live_capacity * 2 : LIVE_TABLE_MIN_CAPACITY;
+    live_allocation* new_table = platform_allocate(sizeof(live_allocation) * new_capacity, false);
+    if (!new_table) {
+        LERROR("Memory profiler unable to grow its live allocation table. Allocations will go unrecorded.");
+        return false;
+    }
+    platform_zero_memory(new_table, sizeof(live_allocation) * new_capacity);
+
+    for (u64 i = 0; i < state_ptr->live_capacity; ++i) {
+        if (state_ptr->live[i].block) {
+            live_insert(new_table, new_capacity, state_ptr->live[i]);
+        }
+    }
+
+    if (state_ptr->live) {
+        platform_free(state_ptr->live, false);
+    }
+    state_ptr->live = new_table;
+    state_ptr->live_capacity = new_capacity;
+    return true;
+}
+
+static void live_insert(live_allocation* table, u64 capacity, live_allocation allocation)
+{
+    u64 mask = capacity - 1;
+    u64 i = hash_pointer(allocation.block) & mask;
+    while (table[i].block) {
+        i = (i + 1) & mask;
+    }
+    table[i] = allocation;
+}
+
+// Removes the entry at the given slot, shifting back any later entries in the same probe
+// run so that lookups never stop early at the hole. Must be called with the lock held.
+static void live_remove_at(u64 index)
+{
+    live_allocation* table = state_ptr->live;
+    u64 mask = state_ptr->live_capacity - 1;
+    u64 hole = index;
+    for (u64 i = (hole + 1) & mask; table[i].block; i = (i + 1) & mask) {
+        u64 home = hash_pointer(table[i].block) & mask;
+        // The entry may only move back if its home slot does not lie cyclically within (hole, i].
+        b8 home_in_range = hole <= i ? (home > hole && home <= i) : (home > hole || home <= i);
+        if (!home_in_range) {
+            table[hole] = table[i];
+            hole = i;
+        }
+    }
+    table[hole].block = 0;
+}
+
+static void format_stats_line(char* buffer, const char* label, const memory_profile_stats* stats)
+{
+    string_format(
+        buffer,
+        "%-48s live %llu B (%llu allocs), peak %llu B, total %llu B (%llu allocs)",
+        label,
+        stats->live_bytes,
+        stats->live_count,
+        stats->peak_bytes,
+        stats->total_bytes,
+        stats->total_count);
+}
+
+static b8 write_stats(file_handle* file, const char* label, const memory_profile_stats* stats)
+{
+    char line[1024];
+    format_stats_line(line, label, stats);
+    if (!filesystem_write_line(file, line)) {
+        return false;
+    }
+
+    // Histogram on its own line, trailing empty buckets omitted.
+    u32 last = MEMORY_PROFILER_HISTOGRAM_BUCKETS;
+    while (last > 0 && !stats->histogram[last - 1]) {
+        last--;
+    }
+    u64 offset = string_format(line, "    histogram:");
+    for (u32 i = 0; i < last; ++i) {
+        offset += string_format(line + offset, " %llu", stats->histogram[i]);
+    }
+    return filesystem_write_line(file, line);
+}
@@ -0,0 +1,139 @@
+/**
+ * @file memory_profiler.h
+ *
+ * @brief Contains the allocation profiler used by the memory system. When enabled, every
+ * allocation is attributed to the call site (file and line) which made it, and live bytes,
+ * peak bytes, counts and a size histogram are kept per call site and per tag.
+ * @version 0.1
+ * @date 2024-05-20
+ *
+ */
+
+#pragma once
+#include "defines.h"
+#include "core/lmemory.h"
+
+/** @brief The most distinct call sites which can be tracked. Allocations from any further sites are counted under the tag only. */
+#define MEMORY_PROFILER_MAX_SITES 1024
+
+/**
+ * @brief The number of buckets in a size histogram. Bucket i counts allocations of
+ * [16 << i, 32 << i) bytes; the first bucket also counts anything smaller and the last
+ * anything larger.
+ */
+#define MEMORY_PROFILER_HISTOGRAM_BUCKETS 16
+
+/** @brief Statistics gathered for a tag or call site while profiling is enabled. */
+typedef struct memory_profile_stats {
+    /** @brief The number of bytes currently allocated. */
+    u64 live_bytes;
+    /** @brief The highest live_bytes has been. */
+    u64 peak_bytes;
+    /** @brief The number of allocations not yet freed. */
+    u64 live_count;
+    /** @brief The number of allocations made in total. */
+    u64 total_count;
+    /** @brief The number of bytes allocated in total. */
+    u64 total_bytes;
+    /** @brief The number of allocations made in each size bucket. */
+    u64 histogram[MEMORY_PROFILER_HISTOGRAM_BUCKETS];
+} memory_profile_stats;
+
+/** @brief A single call site of lallocate and friends. */
+typedef struct memory_profile_site {
+    /** @brief The source file the allocation was made from. */
+    const char* file;
+    /** @brief The line of the source file the allocation was made from. */
+    u32 line;
+    /** @brief The tag of the first allocation made from this site. */
+    memory_tag tag;
+    /** @brief The statistics for this site. */
+    memory_profile_stats stats;
+} memory_profile_site;
+
+/**
+ * @brief Initializes the profiler. Should be called twice; once to get the memory requirement
+ * (passing state=0), and a second time passing an allocated block of memory to actually initialize.
+ * Called by the memory system when enable_profiling is set in its configuration.
+ *
+ * @param memory_requirement A pointer to hold the memory requirement of the profiler's state.
+ * @param state 0 if just requesting the memory requirement; otherwise the allocated block of memory.
+ * @return True on success; otherwise false.
+ */
+b8 memory_profiler_initialize(u64* memory_requirement, void* state);
+
+/**
+ * @brief Shuts down the profiler, logging a leak report for anything still allocated.
+ *
+ * @param state The state block of memory.
+ */
+void memory_profiler_shutdown(void* state);
+
+/**
+ * @brief Records a new allocation against the given call site. Does nothing if the profiler is not running.
+ *
+ * @param block The allocated block.
+ * @param size The size in bytes of the allocation.
+ * @param tag The tag the allocation was made under.
+ * @param file The source file the allocation was made from.
+ * @param line The line of the source file the allocation was made from.
+ */
+void memory_profiler_record_allocation(void* block, u64 size, memory_tag tag, const char* file, u32 line);
+
+/**
+ * @brief Records the freeing of a block previously passed to memory_profiler_record_allocation.
+ * Blocks the profiler never saw (ie. made before it was started) are ignored.
+ *
+ * @param block The block being freed.
+ */
+void memory_profiler_record_free(void* block);
+
+/**
+ * @brief Records the freeing of every block allocated with the given tag, for when a tag's
+ * allocations are released all at once.
+ *
+ * @param tag The tag whose allocations were freed.
+ */
+void memory_profiler_record_free_all(memory_tag tag);
+
+/**
+ * @brief Indicates if the profiler is running.
+ *
+ * @return True if allocations are being profiled; otherwise false.
+ */
+LAPI b8 memory_profiler_is_enabled();
+
+/**
+ * @brief Obtains a copy of the statistics gathered for the given tag.
+ *
+ * @param tag The tag to obtain statistics for.
+ * @param out_stats A pointer to hold the statistics.
+ * @return True on success; false if the profiler is not running or the tag is invalid.
+ */
+LAPI b8 memory_profiler_get_tag_stats(memory_tag tag, memory_profile_stats* out_stats);
+
+/**
+ * @brief Obtains a copy of the statistics gathered for the given call site.
+ *
+ * @param file The source file of the call site, exactly as captured by __FILE__.
+ * @param line The line of the call site.
+ * @param out_site A pointer to hold the call site.
+ * @return True if the site was found; otherwise false.
+ */
+LAPI b8 memory_profiler_get_site(const char* file, u32 line, memory_profile_site* out_site);
+
+/**
+ * @brief Logs a warning for every call site which still has live allocations.
+ *
+ * @return The number of allocations still live.
+ */
+LAPI u64 memory_profiler_report_leaks();
+
+/**
+ * @brief Writes every tag and call site, with its statistics and histogram, to the given
+ * file as plain text. The file is overwritten.
+ *
+ * @param path The path of the file to write.
+ * @return True on success; otherwise false.
+ */
+LAPI b8 memory_profiler_dump(const char* path);
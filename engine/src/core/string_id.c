@@ -0,0 +1,128 @@
+#include "string_id.h"
+
+#include "core/lhash.h"
+#include "core/lmemory.h"
+#include "core/lstring.h"
+#include "core/logger.h"
+#include "containers/hashtable.h"
+#include "memory/linear_allocator.h"
+
+typedef struct string_id_entry {
+    const char* str;
+    u64 hash;
+} string_id_entry;
+
+typedef struct string_id_state {
+    string_id_system_config config;
+    // Indexed by id. Entry 0 is INVALID_STRING_ID, and holds an empty string.
+    string_id_entry* entries;
+    u32 count;
+    // The interned strings, keyed by themselves. Values are ids.
+    hashtable lookup;
+    // Holds the string copies. Never rewound, so they stay put until shutdown.
+    linear_allocator arena;
+} string_id_state;
+
+static string_id_state* state_ptr = 0;
+
+b8 string_id_system_initialize(u64* memory_requirement, void* state, string_id_system_config config)
+{
+    if (config.max_string_count == 0 || config.arena_block_size == 0) {
+        LFATAL("string_id_system_initialize - config.max_string_count and config.arena_block_size must be > 0.");
+        return false;
+    }
+
+    // Block of memory will contain state structure, then the entry array, then block for hashtable.
+    // One extra entry for INVALID_STRING_ID.
+    u64 struct_requirement = sizeof(string_id_state);
+    u64 entries_requirement = sizeof(string_id_entry) * ((u64)config.max_string_count + 1);
+    u64 hashtable_requirement = 0;
+    hashtable_create(sizeof(string_id), config.max_string_count, false, &hashtable_requirement, 0, 0);
+    *memory_requirement = struct_requirement + entries_requirement + hashtable_requirement;
+
+    if (!state) {
+        return true;
+    }
+
+    state_ptr = state;
+    state_ptr->config = config;
+    state_ptr->entries = (string_id_entry*)((u8*)state + struct_requirement);
+    void* hashtable_block = (u8*)state_ptr->entries + entries_requirement;
+    hashtable_create(sizeof(string_id), config.max_string_count, false, &hashtable_requirement, hashtable_block, &state_ptr->lookup);
+    linear_allocator_create_chained(config.arena_block_size, 0, &state_ptr->arena);
+
+    state_ptr->entries[INVALID_STRING_ID].str = "";
+    state_ptr->entries[INVALID_STRING_ID].hash = 0;
+    state_ptr->count = 1;
+
+    return true;
+}
+
+void string_id_system_shutdown(void* state)
+{
+    if (state_ptr) {
+        hashtable_destroy(&state_ptr->lookup);
+        linear_allocator_destroy(&state_ptr->arena);
+        state_ptr->count = 0;
+        state_ptr = 0;
+    }
+}
+
+string_id string_id_intern(const char* str)
+{
+    if (!state_ptr || !str) {
+        return INVALID_STRING_ID;
+    }
+
+    u64 hash = hash_string(str);
+    string_id id = INVALID_STRING_ID;
+    if (hashtable_get_hashed(&state_ptr->lookup, str, hash, &id)) {
+        return id;
+    }
+
+    if (state_ptr->count > state_ptr->config.max_string_count) {
+        LERROR("string_id_intern - cannot intern '%s'; all %u strings are in use. Adjust configuration to allow more.", str, state_ptr->config.max_string_count);
+        return INVALID_STRING_ID;
+    }
+
+    u64 length = string_length(str);
+    char* copy = linear_allocator_allocate_aligned(&state_ptr->arena, length + 1, 1);
+    if (!copy) {
+        LERROR("string_id_intern - failed to allocate a copy of '%s'.", str);
+        return INVALID_STRING_ID;
+    }
+    lcopy_memory(copy, str, length + 1);
+
+    id = state_ptr->count;
+    state_ptr->entries[id].str = copy;
+    state_ptr->entries[id].hash = hash;
+    // The copy is the key, as it lives as long as the entry.
+    hashtable_set_hashed(&state_ptr->lookup, copy, hash, &id);
+    state_ptr->count++;
+    return id;
+}
+
+string_id string_id_find(const char* str)
+{
+    string_id id = INVALID_STRING_ID;
+    if (state_ptr && str) {
+        hashtable_get(&state_ptr->lookup, str, &id);
+    }
+    return id;
+}
+
+const char* string_id_str(string_id id)
+{
+    if (!state_ptr || id >= state_ptr->count) {
+        return "";
+    }
+    return state_ptr->entries[id].str;
+}
+
+u64 string_id_hash(string_id id)
+{
+    if (!state_ptr || id >= state_ptr->count) {
+        return 0;
+    }
+    return state_ptr->entries[id].hash;
+}
@@ -0,0 +1,93 @@
+/**
+ * @file string_id.h
+ *
+ * @brief Contains the string id system, which interns strings (ie. resource names) so each
+ * distinct string is stored once and can be referred to, compared and hashed as a u32.
+ * @version 0.1
+ * @date 2024-05-25
+ *
+ */
+
+#pragma once
+#include "defines.h"
+
+/*
+String ids:
+
+    Interning a string copies it into an arena the first time it is seen and hands back a
+    small id, the same one every time after. The copy and its hash live until the system
+    shuts down, so an id can be kept anywhere a name would be, and:
+
+    - compared with ==, rather than character by character;
+    - turned back into the string with string_id_str, which is also a stable key for the
+      hashtable, with its hash already known (string_id_hash);
+    - stored in 4 bytes, rather than a fixed size char array.
+
+    Interning is case sensitive. Ids are only meaningful within a run of the engine, and
+    must not be written to disk.
+ */
+
+/** @brief An interned string. */
+typedef u32 string_id;
+
+/** @brief The id of no string. Zeroed memory holds this. */
+#define INVALID_STRING_ID 0
+
+/** @brief The configuration for the string id system. */
+typedef struct string_id_system_config {
+    /** @brief The maximum number of distinct strings which can be interned. */
+    u32 max_string_count;
+    /** @brief The size in bytes of each block of the arena holding the strings. More are added as needed. */
+    u64 arena_block_size;
+} string_id_system_config;
+
+/**
+ * @brief Initializes the string id system. Call twice; once to obtain memory requirement (passing
+ * state = 0), then a second time passing allocated memory to state.
+ *
+ * @param memory_requirement The required size of the state memory.
+ * @param state Either 0 or the allocated block of state memory.
+ * @param config The configuration for the system.
+ * @return True on success; otherwise false.
+ */
+LAPI b8 string_id_system_initialize(u64* memory_requirement, void* state, string_id_system_config config);
+
+/**
+ * @brief Shuts down the string id system, releasing every interned string. Any string_id_str
+ * pointers held are invalid after this.
+ *
+ * @param state The state block of memory.
+ */
+LAPI void string_id_system_shutdown(void* state);
+
+/**
+ * @brief Obtains the id of the given string, interning it if it has not been seen before.
+ *
+ * @param str The string to intern. Required.
+ * @return The id; INVALID_STRING_ID if str is 0 or the system is full or not initialized.
+ */
+LAPI string_id string_id_intern(const char* str);
+
+/**
+ * @brief Obtains the id of the given string, without interning it.
+ *
+ * @param str The string to look up. Required.
+ * @return The id; INVALID_STRING_ID if the string has not been interned.
+ */
+LAPI string_id string_id_find(const char* str);
+
+/**
+ * @brief Obtains the interned copy of the string with the given id.
+ *
+ * @param id The id.
+ * @return The string, which is valid until the system shuts down; an empty string for INVALID_STRING_ID or an unknown id.
+ */
+LAPI const char* string_id_str(string_id id);
+
+/**
+ * @brief Obtains the hash (hash_string) of the string with the given id, computed when it was interned.
+ *
+ * @param id The id.
+ * @return The hash; 0 for INVALID_STRING_ID or an unknown id.
+ */
+LAPI u64 string_id_hash(string_id id);
@@ -122,6 +122,25 @@ STATIC_ASSERT(sizeof(f64) == 8, "Expected f64 to be 8 bytes.");
 #define LNOINLINE
 #endif
 
+// Prefetching. A hint that the cache line holding address will be read soon; never faults.
+#if defined(__clang__) || defined(__GNUC__)
+#define LPREFETCH(address) __builtin_prefetch(address)
+#elif defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <xmmintrin.h>
+#define LPREFETCH(address) _mm_prefetch((const char*)(address), _MM_HINT_T0)
+#else
+#define LPREFETCH(address)
+#endif
+
+// Thread-local storage
+#if defined(__clang__) || defined(__GNUC__)
+#define LTHREAD_LOCAL _Thread_local
+#elif defined(_MSC_VER)
+#define LTHREAD_LOCAL __declspec(thread)
+#else
+#define LTHREAD_LOCAL _Thread_local
+#endif
+
 /** @brief Gets the number of bytes from the amount of gibibytes (GiB) (1024*1024*1024)*/
 #define GIBIBYTES(amount) amount * 1024 * 1024 * 1024
 
@@ -2,6 +2,12 @@
 
 #include "defines.h"
 
+#include <stdalign.h>
+
+#if defined(LUSE_SIMD)
+#include <xmmintrin.h>
+#endif
+
 typedef union vec2 
 {
     // An array of x, y
@@ -45,17 +51,16 @@ typedef union vec3
     };
 } vec3;
 
-//TODO: ReImplement alignas for SIMD operations
-
+// NOTE: vec4 and mat4 are 16-byte aligned for SIMD loads. Heap blocks from lallocate
+// are aligned to LMEMORY_DEFAULT_ALIGNMENT, which covers this.
 typedef union vec4 
-// #if defined(LUSE_SIMD)
-//     // Used for SIMD operations
-//     alignas(16) __m128 data;
-// #endif
 {
+#if defined(LUSE_SIMD)
+    // Used for SIMD operations
+    alignas(16) __m128 data;
+#endif
     // An array of x, y, z, t.
-    // alignas(16) f32 elements[4];
-    f32 elements[4];
+    alignas(16) f32 elements[4];
     struct 
     {
         union 
@@ -85,8 +90,7 @@ typedef union vec4
 typedef vec4 quat;
 
 typedef union mat4 {
-    // alignas(16) f32 data[16];
-    f32 data[16];
+    alignas(16) f32 data[16];
 
 #if defined(LUSE_SIMD)
     // Used for SIMD operations
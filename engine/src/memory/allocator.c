@@ -0,0 +1,197 @@
+#include "allocator.h"
+
+#include "core/logger.h"
+#include "memory/linear_allocator.h"
+#include "memory/frame_arena.h"
+#include "memory/pool_allocator.h"
+
+// Private functions
+static void* default_allocate(void* user_data, u64 size, u16 alignment);
+static void default_free(void* user_data, void* block, u64 size, u16 alignment);
+static void* default_reallocate(void* user_data, void* block, u64 size, u64 new_size, u16 alignment);
+static void* linear_allocate(void* user_data, u64 size, u16 alignment);
+static void* linear_reallocate(void* user_data, void* block, u64 size, u64 new_size, u16 alignment);
+static void* frame_arena_interface_allocate(void* user_data, u64 size, u16 alignment);
+static void* frame_arena_interface_reallocate(void* user_data, void* block, u64 size, u64 new_size, u16 alignment);
+static void* pool_allocate(void* user_data, u64 size, u16 alignment);
+static void pool_free(void* user_data, void* block, u64 size, u16 alignment);
+static void* pool_reallocate(void* user_data, void* block, u64 size, u64 new_size, u16 alignment);
+static void no_free(void* user_data, void* block, u64 size, u16 alignment);
+
+allocator_interface allocator_interface_default(memory_tag tag)
+{
+    allocator_interface allocator;
+    allocator.allocate = default_allocate;
+    allocator.free = default_free;
+    allocator.reallocate = default_reallocate;
+    // The tag is small enough to be carried in the pointer itself.
+    allocator.user_data = (void*)(u64)tag;
+    return allocator;
+}
+
+allocator_interface allocator_interface_from_linear(struct linear_allocator* allocator)
+{
+    allocator_interface result;
+    result.allocate = linear_allocate;
+    result.free = no_free;
+    result.reallocate = linear_reallocate;
+    result.user_data = allocator;
+    return result;
+}
+
+allocator_interface allocator_interface_from_frame_arena(struct frame_arena* arena)
+{
+    allocator_interface result;
+    result.allocate = frame_arena_interface_allocate;
+    result.free = no_free;
+    result.reallocate = frame_arena_interface_reallocate;
+    result.user_data = arena;
+    return result;
+}
+
+allocator_interface allocator_interface_from_pool(struct pool_allocator* allocator)
+{
+    allocator_interface result;
+    result.allocate = pool_allocate;
+    result.free = pool_free;
+    result.reallocate = pool_reallocate;
+    result.user_data = allocator;
+    return result;
+}
+
+void* allocator_allocate(const allocator_interface* allocator, u64 size, u16 alignment)
+{
+    if (!allocator || !allocator->allocate) {
+        LERROR("allocator_allocate requires a valid allocator interface.");
+        return 0;
+    }
+
+    return allocator->allocate(allocator->user_data, size, alignment);
+}
+
+void allocator_free(const allocator_interface* allocator, void* block, u64 size, u16 alignment)
+{
+    if (!allocator || !block) {
+        return;
+    }
+
+    if (allocator->free) {
+        allocator->free(allocator->user_data, block, size, alignment);
+    }
+}
+
+void* allocator_reallocate(const allocator_interface* allocator, void* block, u64 size, u64 new_size, u16 alignment)
+{
+    if (!allocator || !allocator->allocate) {
+        LERROR("allocator_reallocate requires a valid allocator interface.");
+        return 0;
+    }
+
+    if (!block) {
+        return allocator->allocate(allocator->user_data, new_size, alignment);
+    }
+
+    if (allocator->reallocate) {
+        void* resized = allocator->reallocate(allocator->user_data, block, size, new_size, alignment);
+        if (resized) {
+            return resized;
+        }
+    }
+
+    void* new_block = allocator->allocate(allocator->user_data, new_size, alignment);
+    if (!new_block) {
+        return 0;
+    }
+
+    lcopy_memory(new_block, block, size < new_size ? size : new_size);
+    allocator_free(allocator, block, size, alignment);
+    return new_block;
+}
+
+// Private functions
+
+static void* default_allocate(void* user_data, u64 size, u16 alignment)
+{
+    // NOTE: Not zeroed, as the interface does not promise it.
+    if (alignment <= LMEMORY_DEFAULT_ALIGNMENT) {
+        return lallocate_uninit(size, (memory_tag)(u64)user_data);
+    }
+    return lallocate_aligned(size, alignment, (memory_tag)(u64)user_data);
+}
+
+static void default_free(void* user_data, void* block, u64 size, u16 alignment)
+{
+    if (alignment <= LMEMORY_DEFAULT_ALIGNMENT) {
+        lfree(block, size, (memory_tag)(u64)user_data);
+    } else {
+        lfree_aligned(block, size, alignment, (memory_tag)(u64)user_data);
+    }
+}
+
+static void* default_reallocate(void* user_data, void* block, u64 size, u64 new_size, u16 alignment)
+{
+    // lreallocate only deals in default aligned blocks. Anything else takes the copying path.
+    if (alignment > LMEMORY_DEFAULT_ALIGNMENT) {
+        return 0;
+    }
+    return lreallocate(block, size, new_size, (memory_tag)(u64)user_data);
+}
+
+static void* linear_allocate(void* user_data, u64 size, u16 alignment)
+{
+    return linear_allocator_allocate_aligned((linear_allocator*)user_data, size, alignment);
+}
+
+static void* linear_reallocate(void* user_data, void* block, u64 size, u64 new_size, u16 alignment)
+{
+    return linear_allocator_resize((linear_allocator*)user_data, block, size, new_size) ? block : 0;
+}
+
+static void* frame_arena_interface_allocate(void* user_data, u64 size, u16 alignment)
+{
+    frame_arena* arena = (frame_arena*)user_data;
+    return linear_allocator_allocate_aligned(&arena->allocators[arena->current], size, alignment);
+}
+
+static void* frame_arena_interface_reallocate(void* user_data, void* block, u64 size, u64 new_size, u16 alignment)
+{
+    frame_arena* arena = (frame_arena*)user_data;
+    return linear_allocator_resize(&arena->allocators[arena->current], block, size, new_size) ? block : 0;
+}
+
+static void* pool_allocate(void* user_data, u64 size, u16 alignment)
+{
+    pool_allocator* pool = (pool_allocator*)user_data;
+    if (size > pool->element_size) {
+        LERROR("Pool allocator interface - requested %lluB, but slots are only %lluB.", size, pool->element_size);
+        return 0;
+    }
+
+    u32 index = 0;
+    void* block = pool_allocator_allocate(pool, &index);
+    if (block && ((u64)block & (u64)(alignment - 1))) {
+        LERROR("Pool allocator interface - slots do not satisfy an alignment of %u.", alignment);
+        pool_allocator_free(pool, index);
+        return 0;
+    }
+    return block;
+}
+
+static void pool_free(void* user_data, void* block, u64 size, u16 alignment)
+{
+    pool_allocator* pool = (pool_allocator*)user_data;
+    u64 offset = (u64)block - (u64)pool->elements;
+    pool_allocator_free(pool, (u32)(offset / pool->element_size));
+}
+
+static void* pool_reallocate(void* user_data, void* block, u64 size, u64 new_size, u16 alignment)
+{
+    // Every slot is the same size, so anything which still fits can stay where it is.
+    pool_allocator* pool = (pool_allocator*)user_data;
+    return new_size <= pool->element_size ? block : 0;
+}
+
+static void no_free(void* user_data, void* block, u64 size, u16 alignment)
+{
+    // Arena memory is released all at once, when the arena is reset.
+}
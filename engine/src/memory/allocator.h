@@ -0,0 +1,132 @@
+/**
+ * @file allocator.h
+ *
+ * @brief Contains a small allocator interface, so containers can take their memory
+ * from any of the engine's allocators rather than always going through lallocate.
+ * @version 0.1
+ * @date 2024-05-22
+ *
+ */
+
+#pragma once
+#include "defines.h"
+#include "core/lmemory.h"
+
+struct linear_allocator;
+struct frame_arena;
+struct pool_allocator;
+
+/*
+Allocator interface:
+
+    A set of function pointers plus a user pointer handed back to each of them.
+    Containers created with an interface allocate, grow and free through it, so a
+    transient container can live in a linear allocator or frame arena and simply be
+    discarded along with everything else in it, without touching the memory system.
+
+    Interfaces are plain values. Containers keep a pointer to the one they were
+    created with, so it must outlive them.
+ */
+
+/** @brief An allocator, as seen by containers. */
+typedef struct allocator_interface {
+    /**
+     * @brief Allocates a block. The block need not be zeroed.
+     * @param user_data The interface's user_data.
+     * @param size The size in bytes to allocate.
+     * @param alignment The alignment in bytes. A power of two.
+     * @return A pointer to the block; 0 on failure.
+     */
+    void* (*allocate)(void* user_data, u64 size, u16 alignment);
+    /**
+     * @brief Frees a block obtained from allocate. May do nothing (ie. for arenas).
+     * @param user_data The interface's user_data.
+     * @param block The block to be freed.
+     * @param size The size in bytes the block was allocated (or last resized) with.
+     * @param alignment The alignment the block was allocated with.
+     */
+    void (*free)(void* user_data, void* block, u64 size, u16 alignment);
+    /**
+     * @brief Resizes a block in place. Optional; may be 0. allocator_reallocate falls back to
+     * allocate, copy and free when this is 0 or fails.
+     * @param user_data The interface's user_data.
+     * @param block The block to be resized.
+     * @param size The size in bytes the block was allocated (or last resized) with.
+     * @param new_size The size in bytes the block should have.
+     * @param alignment The alignment the block was allocated with.
+     * @return A pointer to the resized block; 0 if it could not be resized.
+     */
+    void* (*reallocate)(void* user_data, void* block, u64 size, u64 new_size, u16 alignment);
+    /** @brief Passed to each of the functions above. */
+    void* user_data;
+} allocator_interface;
+
+/**
+ * @brief Obtains an interface which allocates through the memory system with the given tag.
+ *
+ * @param tag The tag to track allocations under.
+ * @return The interface.
+ */
+LAPI allocator_interface allocator_interface_default(memory_tag tag);
+
+/**
+ * @brief Obtains an interface which allocates from the given linear allocator. Frees do
+ * nothing; the memory is released when the linear allocator is reset or rewound. The most
+ * recent allocation is grown in place.
+ *
+ * @param allocator A pointer to the linear allocator. Must outlive the interface.
+ * @return The interface.
+ */
+LAPI allocator_interface allocator_interface_from_linear(struct linear_allocator* allocator);
+
+/**
+ * @brief Obtains an interface which allocates from the current frame of the given frame arena.
+ * Anything allocated through it is only valid until the frame after next.
+ *
+ * @param arena A pointer to the frame arena. Must outlive the interface.
+ * @return The interface.
+ */
+LAPI allocator_interface allocator_interface_from_frame_arena(struct frame_arena* arena);
+
+/**
+ * @brief Obtains an interface which hands out slots of the given pool allocator. Requests
+ * larger than a slot fail.
+ *
+ * @param allocator A pointer to the pool allocator. Must outlive the interface.
+ * @return The interface.
+ */
+LAPI allocator_interface allocator_interface_from_pool(struct pool_allocator* allocator);
+
+/**
+ * @brief Allocates a block through the given interface.
+ *
+ * @param allocator A pointer to the interface.
+ * @param size The size in bytes to allocate.
+ * @param alignment The alignment in bytes. Must be a power of two.
+ * @return A pointer to the block, which is not necessarily zeroed; 0 on failure.
+ */
+LAPI void* allocator_allocate(const allocator_interface* allocator, u64 size, u16 alignment);
+
+/**
+ * @brief Frees a block obtained through the given interface.
+ *
+ * @param allocator A pointer to the interface.
+ * @param block The block to be freed.
+ * @param size The size in bytes the block was allocated (or last resized) with.
+ * @param alignment The alignment the block was allocated with.
+ */
+LAPI void allocator_free(const allocator_interface* allocator, void* block, u64 size, u16 alignment);
+
+/**
+ * @brief Resizes a block obtained through the given interface, keeping its contents up to the
+ * smaller of the two sizes. Resized in place if the interface supports it; otherwise a new block
+ * is allocated, the contents copied over and the old block freed.
+ *
+ * @param allocator A pointer to the interface.
+ * @param block The block to be resized.
+ * @param size The size in bytes the block was allocated (or last resized) with.
+ * @param new_size The size in bytes the block should have.
+ * @param alignment The alignment the block was allocated with.
+ * @return A pointer to the resized block, which may differ from block. 0 on failure, leaving block untouched.
+ */
+LAPI void* allocator_reallocate(const allocator_interface* allocator, void* block, u64 size, u64 new_size, u16 alignment);
@@ -3,19 +3,53 @@
 #include "core/lmemory.h"
 #include "core/logger.h"
 #include "containers/freelist.h"
+#include "memory/tlsf.h"
+#include "platform/platform.h"
 
 typedef struct dynamic_allocator_state {
+    dynamic_allocator_type type;
     u64 total_size;
+    // Used by DYNAMIC_ALLOCATOR_TYPE_FREELIST.
     freelist list;
     void* freelist_block;
     void* memory_block;
+    // Used by DYNAMIC_ALLOCATOR_TYPE_TLSF.
+    tlsf tlsf;
+    // The size currently handed to the TLSF pool. Only less than total_size when reserved.
+    u64 tlsf_pool_size;
+    // The end of the allocator's memory. Fixed at creation.
+    void* memory_end;
+    // Set when created over reserved address space, which is committed up to committed_end.
+    b8 reserved;
+    void* committed_end;
 } dynamic_allocator_state;
 
+// Private method declarations
+static b8 create_internal(dynamic_allocator_type type, u64 total_size, b8 reserved, u64* memory_requirement, void* memory, dynamic_allocator* out_allocator);
+static b8 commit_to(dynamic_allocator_state* state, void* end);
+static void* tlsf_allocate_growing(dynamic_allocator_state* state, u64 size, u16 alignment);
+static b8 tlsf_grow_pool(dynamic_allocator_state* state, u64 size, u16 alignment);
+static void report_allocation_failure(dynamic_allocator* allocator, u64 size);
 
 // Public function definitions
 
 
 b8 dynamic_allocator_create(u64 total_size, u64* memory_requirement, void* memory, dynamic_allocator* out_allocator)
+{
+    return dynamic_allocator_create_typed(DYNAMIC_ALLOCATOR_TYPE_FREELIST, total_size, memory_requirement, memory, out_allocator);
+}
+
+b8 dynamic_allocator_create_typed(dynamic_allocator_type type, u64 total_size, u64* memory_requirement, void* memory, dynamic_allocator* out_allocator)
+{
+    return create_internal(type, total_size, false, memory_requirement, memory, out_allocator);
+}
+
+b8 dynamic_allocator_create_reserved(dynamic_allocator_type type, u64 total_size, u64* memory_requirement, void* memory, dynamic_allocator* out_allocator)
+{
+    return create_internal(type, total_size, true, memory_requirement, memory, out_allocator);
+}
+
+static b8 create_internal(dynamic_allocator_type type, u64 total_size, b8 reserved, u64* memory_requirement, void* memory, dynamic_allocator* out_allocator)
 {
     if (total_size < 1) {
         LERROR("dynamic_allocator_create cannot have a total_size of 0. Create failed.");
@@ -27,11 +61,60 @@ b8 dynamic_allocator_create(u64 total_size, u64* memory_requirement, void* memor
         return false;
     }
 
+    if (type == DYNAMIC_ALLOCATOR_TYPE_TLSF) {
+        // The TLSF allocator keeps its pool inline with its state.
+        u64 tlsf_requirement = 0;
+        if (!tlsf_create(total_size, &tlsf_requirement, 0, 0)) {
+            LERROR("dynamic_allocator_create unable to obtain TLSF memory requirement. Create failed.");
+            return false;
+        }
+
+        *memory_requirement = sizeof(dynamic_allocator_state) + tlsf_requirement;
+        if (!memory) {
+            // First pass.
+            return true;
+        }
+
+        // Second pass.
+
+        // Memory layout:
+        // state
+        // tlsf state + pool
+        void* memory_block = (void*)(memory + sizeof(dynamic_allocator_state));
+        u64 pool_size = total_size;
+        if (reserved) {
+            // Start with a pool of a single commit step, which then grows as needed.
+            if (pool_size > DYNAMIC_ALLOCATOR_COMMIT_GRANULARITY) {
+                pool_size = DYNAMIC_ALLOCATOR_COMMIT_GRANULARITY;
+            }
+            u64 initial_requirement = 0;
+            tlsf_create(pool_size, &initial_requirement, 0, 0);
+            if (!platform_commit_memory(memory, (memory_block + initial_requirement) - memory)) {
+                LERROR("dynamic_allocator_create unable to commit initial memory. Create failed.");
+                return false;
+            }
+            tlsf_requirement = initial_requirement;
+        }
+
+        out_allocator->memory = memory;
+        dynamic_allocator_state* state = out_allocator->memory;
+        state->type = type;
+        state->total_size = total_size;
+        state->freelist_block = 0;
+        state->memory_block = memory_block;
+        state->memory_end = memory + *memory_requirement;
+        state->reserved = reserved;
+        state->committed_end = memory_block + tlsf_requirement;
+        state->tlsf_pool_size = pool_size;
+        return tlsf_create(pool_size, &tlsf_requirement, state->memory_block, &state->tlsf);
+    }
+
     u64 freelist_requirement = 0;
     // Grad the memory requirement for the free list.
     freelist_create(total_size, &freelist_requirement, 0, 0);
 
-    *memory_requirement = freelist_requirement + sizeof(dynamic_allocator_state) + total_size; 
+    // Extra room is left so the memory block can be aligned regardless of where memory lands.
+    *memory_requirement = freelist_requirement + sizeof(dynamic_allocator_state) + DYNAMIC_ALLOCATOR_MAX_ALIGNMENT + total_size; 
 
     if (!memory) {
         // First pass.
@@ -43,20 +126,37 @@ b8 dynamic_allocator_create(u64 total_size, u64* memory_requirement, void* memor
     // Memory layout:
     // state
     // freelist block
+    // alignment padding
     // memory block
 
+    void* freelist_block = (void*)(memory + sizeof(dynamic_allocator_state));
+    // Offsets aligned within the block are then aligned addresses as well.
+    u64 block_start = (u64)(freelist_block + freelist_requirement);
+    void* memory_block = (void*)((block_start + (DYNAMIC_ALLOCATOR_MAX_ALIGNMENT - 1)) & ~(u64)(DYNAMIC_ALLOCATOR_MAX_ALIGNMENT - 1));
+
+    // The freelist keeps its nodes outside the memory block, so only the state
+    // and the freelist need committing up front.
+    if (reserved && !platform_commit_memory(memory, memory_block - memory)) {
+        LERROR("dynamic_allocator_create unable to commit initial memory. Create failed.");
+        return false;
+    }
+
     out_allocator->memory = memory;
 
     // The cold cast is fine, as this is what we're actually pointing to.
     dynamic_allocator_state* state = out_allocator->memory;
+    state->type = type;
     state->total_size = total_size;
-    state->freelist_block = (void*) (out_allocator->memory + sizeof(dynamic_allocator_state));
-    state->memory_block = (void*)(state->freelist_block + freelist_requirement);
+    state->freelist_block = freelist_block;
+    state->memory_block = memory_block;
+    state->memory_end = memory_block + total_size;
+    state->reserved = reserved;
+    state->committed_end = memory_block;
+    state->tlsf_pool_size = 0;
 
     // Create the freelist.
+    // NOTE: The memory block is not cleared, as lallocate zeroes each block it hands out anyway.
     freelist_create(total_size, &freelist_requirement, state->freelist_block, &state->list);
-
-    lzero_memory(state->memory_block, total_size);
     return true;
 }
 
@@ -68,8 +168,11 @@ b8 dynamic_allocator_destroy(dynamic_allocator* allocator)
     }
     
     dynamic_allocator_state* state = allocator->memory;
-    freelist_destroy(&state->list);
-    lzero_memory(state->memory_block, state->total_size);
+    if (state->type == DYNAMIC_ALLOCATOR_TYPE_TLSF) {
+        tlsf_destroy(&state->tlsf);
+    } else {
+        freelist_destroy(&state->list);
+    }
     state->total_size = 0;
     allocator->memory = 0;
     return true;
@@ -82,17 +185,65 @@ void* dynamic_allocator_allocate(dynamic_allocator* allocator, u64 size)
     }
 
     dynamic_allocator_state* state = allocator->memory;
+    if (state->type == DYNAMIC_ALLOCATOR_TYPE_TLSF) {
+        void* block = tlsf_allocate_growing(state, size, 0);
+        if (!block) {
+            report_allocation_failure(allocator, size);
+        }
+        return block;
+    }
+
     u64 offset = 0;
-    if (!freelist_allocate_block(&state->list, size, &offset)) {
-        LERROR("dynamic_allocator_allocate no blocks of memory large enough to allocate!");
-        u64 available = freelist_free_space(&state->list);
-        LERROR("Requested size: %llu B, total space available: %llu B", size, available);
-        // TODO: Report fragmentation? Should be on the job of the freelist.
+    if (!freelist_allocate_block_best(&state->list, size, &offset)) {
+        report_allocation_failure(allocator, size);
         return 0;
     }
 
     // Use that offset against the base memory block to get the block.
     void* block = (void*)(state->memory_block + offset);
+    if (!commit_to(state, block + size)) {
+        freelist_free_block(&state->list, size, offset);
+        return 0;
+    }
+    return block;
+}
+
+void* dynamic_allocator_allocate_aligned(dynamic_allocator* allocator, u64 size, u16 alignment)
+{
+    if (!allocator || !size) {
+        return 0;
+    }
+
+    if (!alignment || (alignment & (alignment - 1))) {
+        LERROR("dynamic_allocator_allocate_aligned requires a power of two alignment (got %u).", alignment);
+        return 0;
+    }
+
+    dynamic_allocator_state* state = allocator->memory;
+    if (state->type == DYNAMIC_ALLOCATOR_TYPE_TLSF) {
+        void* block = tlsf_allocate_growing(state, size, alignment);
+        if (!block) {
+            report_allocation_failure(allocator, size);
+        }
+        return block;
+    }
+
+    if (alignment > DYNAMIC_ALLOCATOR_MAX_ALIGNMENT) {
+        LERROR("dynamic_allocator_allocate_aligned alignment of %u exceeds the maximum of %u.", alignment, DYNAMIC_ALLOCATOR_MAX_ALIGNMENT);
+        return 0;
+    }
+
+    u64 offset = 0;
+    if (!freelist_allocate_block_aligned(&state->list, size, alignment, &offset)) {
+        report_allocation_failure(allocator, size);
+        return 0;
+    }
+
+    void* block = (void*)(state->memory_block + offset);
+    if (!commit_to(state, block + size)) {
+        freelist_free_block(&state->list, size, offset);
+        return 0;
+    }
     return block;
 }
 
@@ -105,6 +256,19 @@ b8 dynamic_allocator_free(dynamic_allocator* allocator, void* block, u64 size)
     }
 
     dynamic_allocator_state* state = allocator->memory;
+    if (state->type == DYNAMIC_ALLOCATOR_TYPE_TLSF) {
+        // NOTE: The size is tracked in-band by TLSF, so only the block is needed.
+        if (!tlsf_owns(&state->tlsf, block)) {
+            LERROR("dynamic_allocator_free trying to release block (0x%p) outside the allocator range.", block);
+            return false;
+        }
+        if (!tlsf_free(&state->tlsf, block)) {
+            LERROR("dynamic_allocator_free failed");
+            return false;
+        }
+        return true;
+    }
+
     if (block < state->memory_block || block > state->memory_block + state->total_size) {
         void* end_of_block = (void*)(state->memory_block + state->total_size);
         LERROR("dynamic_allocator_free trying to release block (0x%p) outside the allocator range: (0x%p) - (0x%p)", 
@@ -121,9 +285,156 @@ b8 dynamic_allocator_free(dynamic_allocator* allocator, void* block, u64 size)
     return true;
 }
 
+b8 dynamic_allocator_resize(dynamic_allocator* allocator, void* block, u64 size, u64 new_size)
+{
+    if (!allocator || !allocator->memory || !block || !size || !new_size) {
+        return false;
+    }
+
+    dynamic_allocator_state* state = allocator->memory;
+    if (state->type == DYNAMIC_ALLOCATOR_TYPE_TLSF) {
+        if (tlsf_resize(&state->tlsf, block, new_size)) {
+            return true;
+        }
+
+        // A block at the end of a reserved pool can still grow in place, by growing the pool under it.
+        if (new_size > size && state->tlsf_pool_size < state->total_size && tlsf_block_at_end(&state->tlsf, block)) {
+            return tlsf_grow_pool(state, new_size - size, 0) && tlsf_resize(&state->tlsf, block, new_size);
+        }
+        return false;
+    }
+
+    if (block < state->memory_block || block + size > state->memory_block + state->total_size) {
+        LERROR("dynamic_allocator_resize trying to resize block (0x%p) outside the allocator range.", block);
+        return false;
+    }
+
+    u64 offset = (block - state->memory_block);
+    if (!freelist_resize_block(&state->list, offset, size, new_size)) {
+        return false;
+    }
+
+    if (!commit_to(state, block + new_size)) {
+        // Put the block back the way it was.
+        freelist_resize_block(&state->list, offset, new_size, size);
+        return false;
+    }
+    return true;
+}
+
+b8 dynamic_allocator_owns(dynamic_allocator* allocator, void* block)
+{
+    if (!allocator || !allocator->memory || !block) {
+        return false;
+    }
+
+    // NOTE: Checked against the bounds fixed at creation rather than the TLSF pool, which grows when reserved.
+    dynamic_allocator_state* state = allocator->memory;
+    return block >= state->memory_block && block < state->memory_end;
+}
+
 u64 dynamic_allocator_free_space(dynamic_allocator* allocator)
 {
     dynamic_allocator_state* state = allocator->memory;
+    if (state->type == DYNAMIC_ALLOCATOR_TYPE_TLSF) {
+        // Space not yet handed to the pool is free as well.
+        return tlsf_free_space(&state->tlsf) + (state->total_size - state->tlsf_pool_size);
+    }
     return freelist_free_space(&state->list);
 }
 
+b8 dynamic_allocator_get_stats(dynamic_allocator* allocator, dynamic_allocator_stats* out_stats)
+{
+    if (!allocator || !allocator->memory || !out_stats) {
+        return false;
+    }
+
+    dynamic_allocator_state* state = allocator->memory;
+    if (state->type == DYNAMIC_ALLOCATOR_TYPE_TLSF) {
+        // Space not yet handed to the pool counts as free. It continues whatever free block ends the pool.
+        u64 ungrown = state->total_size - state->tlsf_pool_size;
+        u64 tail = ungrown ? tlsf_trailing_free_space(&state->tlsf) + ungrown : 0;
+        out_stats->total_free = tlsf_free_space(&state->tlsf) + ungrown;
+        out_stats->largest_free_block = tlsf_largest_free_block(&state->tlsf);
+        if (tail > out_stats->largest_free_block) {
+            out_stats->largest_free_block = tail;
+        }
+        out_stats->free_range_count = tlsf_free_block_count(&state->tlsf);
+        out_stats->fragmentation = out_stats->total_free ? 1.0f - ((f32)out_stats->largest_free_block / (f32)out_stats->total_free) : 0.0f;
+        return true;
+    }
+
+    freelist_stats stats;
+    if (!freelist_get_stats(&state->list, &stats)) {
+        return false;
+    }
+    out_stats->total_free = stats.total_free;
+    out_stats->largest_free_block = stats.largest_free_block;
+    out_stats->free_range_count = stats.free_range_count;
+    out_stats->fragmentation = stats.fragmentation;
+    return true;
+}
+
+// Private functions
+
+// Commits the memory of a reserved allocator up to at least the given address.
+static b8 commit_to(dynamic_allocator_state* state, void* end)
+{
+    if (!state->reserved || end <= state->committed_end) {
+        return true;
+    }
+
+    // Commit in whole steps, without going past the end of the reservation.
+    void* new_end = (void*)(((u64)end + (DYNAMIC_ALLOCATOR_COMMIT_GRANULARITY - 1)) & ~(u64)(DYNAMIC_ALLOCATOR_COMMIT_GRANULARITY - 1));
+    if (new_end > state->memory_end) {
+        new_end = state->memory_end;
+    }
+
+    if (!platform_commit_memory(state->committed_end, new_end - state->committed_end)) {
+        LERROR("dynamic_allocator unable to commit %lluB of reserved memory.", (u64)(new_end - state->committed_end));
+        return false;
+    }
+    state->committed_end = new_end;
+    return true;
+}
+
+// Allocates from the TLSF pool, growing it into the rest of the reservation when it runs out.
+static void* tlsf_allocate_growing(dynamic_allocator_state* state, u64 size, u16 alignment)
+{
+    void* block = alignment ? tlsf_allocate_aligned(&state->tlsf, size, alignment) : tlsf_allocate(&state->tlsf, size);
+    while (!block && state->tlsf_pool_size < state->total_size) {
+        if (!tlsf_grow_pool(state, size, alignment)) {
+            return 0;
+        }
+        block = alignment ? tlsf_allocate_aligned(&state->tlsf, size, alignment) : tlsf_allocate(&state->tlsf, size);
+    }
+    return block;
+}
+
+// Grows a reserved TLSF pool by enough to cover a request of the given size and alignment.
+static b8 tlsf_grow_pool(dynamic_allocator_state* state, u64 size, u16 alignment)
+{
+    // Grow by enough to cover the request, headers, alignment and bin rounding (at most 1/32 of the size).
+    u64 grow = size + (size / 16) + alignment + 256;
+    grow = (grow + (DYNAMIC_ALLOCATOR_COMMIT_GRANULARITY - 1)) & ~(u64)(DYNAMIC_ALLOCATOR_COMMIT_GRANULARITY - 1);
+    u64 remaining = state->total_size - state->tlsf_pool_size;
+    if (grow > remaining) {
+        grow = remaining;
+    }
+
+    // The pool ends where the committed range does, so the new space always directly follows it.
+    if (!commit_to(state, state->committed_end + grow) || !tlsf_extend(&state->tlsf, grow)) {
+        return false;
+    }
+    state->tlsf_pool_size += grow;
+    return true;
+}
+
+static void report_allocation_failure(dynamic_allocator* allocator, u64 size)
+{
+    dynamic_allocator_stats stats = {0};
+    dynamic_allocator_get_stats(allocator, &stats);
+    LERROR("dynamic_allocator_allocate no blocks of memory large enough to allocate!");
+    LERROR("Requested size: %llu B, total space available: %llu B, largest free block: %llu B, free ranges: %llu, fragmentation: %.2f%%",
+        size, stats.total_free, stats.largest_free_block, stats.free_range_count, stats.fragmentation * 100.0f);
+}
@@ -10,6 +10,38 @@
 #pragma once
 #include "defines.h"
 
+/** @brief The strategy used by a dynamic allocator to track its free space. */
+typedef enum dynamic_allocator_type {
+    /** @brief An address-ordered freelist. Allocation cost grows with the number of free ranges. */
+    DYNAMIC_ALLOCATOR_TYPE_FREELIST,
+    /** @brief A two-level segregated fit (TLSF) allocator. Constant time allocate and free. */
+    DYNAMIC_ALLOCATOR_TYPE_TLSF
+} dynamic_allocator_type;
+
+/**
+ * @brief The largest alignment supported by dynamic_allocator_allocate_aligned for freelist based
+ * allocators, which align offsets from a block aligned to this amount. TLSF allocators have no limit.
+ */
+#define DYNAMIC_ALLOCATOR_MAX_ALIGNMENT 4096
+
+/**
+ * @brief The step in which allocators created with dynamic_allocator_create_reserved commit their
+ * memory. A multiple of the page size on every supported platform.
+ */
+#define DYNAMIC_ALLOCATOR_COMMIT_GRANULARITY (64 * 1024)
+
+/** @brief A snapshot of the free space within a dynamic allocator. */
+typedef struct dynamic_allocator_stats {
+    /** @brief The total amount of free space in bytes. */
+    u64 total_free;
+    /** @brief The size of the largest contiguous free block in bytes. */
+    u64 largest_free_block;
+    /** @brief The number of distinct free ranges. */
+    u64 free_range_count;
+    /** @brief The share of free space unusable for a single allocation, 0 (none) to 1. Computed as 1 - largest/total. */
+    f32 fragmentation;
+} dynamic_allocator_stats;
+
 /** @brief The dynamic allocator stucture.*/
 typedef struct dynamic_allocator
 {
@@ -18,7 +50,7 @@ typedef struct dynamic_allocator
 } dynamic_allocator; 
 
 /**
- * @brief Creates a new dynamic allocator. Should be called twice; once to obtain the desired memory 
+ * @brief Creates a new dynamic allocator backed by a freelist. Should be called twice; once to obtain the desired memory 
  * amount (passing 0 for memory), then a second time to set the allocated block.
  * 
  * @param total_size The total size in bytes the allocator should hold. Note that this size does not include the size of the internal state.
@@ -29,6 +61,36 @@ typedef struct dynamic_allocator
  */
 LAPI b8 dynamic_allocator_create(u64 total_size, u64* memory_requirement, void* memory, dynamic_allocator* out_allocator);
 
+/**
+ * @brief Creates a new dynamic allocator using the given strategy. Should be called twice; once to obtain 
+ * the desired memory amount (passing 0 for memory), then a second time to set the allocated block.
+ * NOTE: The same type must be passed for both calls, as the memory requirement differs between types.
+ * 
+ * @param type The strategy the allocator should use to track free space.
+ * @param total_size The total size in bytes the allocator should hold. Note that this size does not include the size of the internal state.
+ * @param memory_requirement A pointer to hold the required memory for the internam state PLUS total_size.
+ * @param memory An allocated block of memory.
+ * @param out_allocator A pointer to hold the allocator.
+ * @return True if success; false otherwise.
+ */
+LAPI b8 dynamic_allocator_create_typed(dynamic_allocator_type type, u64 total_size, u64* memory_requirement, void* memory, dynamic_allocator* out_allocator);
+
+/**
+ * @brief Creates a new dynamic allocator over reserved, but not yet committed, address space (see
+ * platform_reserve_memory). Pages are committed in DYNAMIC_ALLOCATOR_COMMIT_GRANULARITY steps as the
+ * allocator's high-water mark grows, so resident memory tracks actual use. Freshly committed pages
+ * are zero, so the memory block is never cleared up front. Called twice, like dynamic_allocator_create_typed,
+ * and has the same memory requirement.
+ * 
+ * @param type The strategy the allocator should use to track free space.
+ * @param total_size The total size in bytes the allocator should hold. Note that this size does not include the size of the internal state.
+ * @param memory_requirement A pointer to hold the required memory for the internam state PLUS total_size.
+ * @param memory 0; or a reserved range of at least memory_requirement bytes. Nothing in it needs to be committed.
+ * @param out_allocator A pointer to hold the allocator.
+ * @return True if success; false otherwise.
+ */
+LAPI b8 dynamic_allocator_create_reserved(dynamic_allocator_type type, u64 total_size, u64* memory_requirement, void* memory, dynamic_allocator* out_allocator);
+
 /**
  * @brief Destroys the given allocator.
  * 
@@ -46,6 +108,18 @@ LAPI b8 dynamic_allocator_destroy(dynamic_allocator* allocator);
  */
 LAPI void* dynamic_allocator_allocate(dynamic_allocator* allocator, u64 size);
 
+/**
+ * @brief Allocates the given amount of memory from the provided allocator, aligned to the given
+ * alignment. Space skipped to reach the alignment remains free. Blocks are freed as normal with
+ * dynamic_allocator_free, passing the same size.
+ * 
+ * @param allocator A pointer to the allocator to allocate from.
+ * @param size The amount in bytes to be allocated.
+ * @param alignment The alignment in bytes. Must be a power of two.
+ * @return The allocated block of memory unless this operation fails, then 0.
+ */
+LAPI void* dynamic_allocator_allocate_aligned(dynamic_allocator* allocator, u64 size, u16 alignment);
+
 /**
  * @brief Frees the given block of memory.
  * 
@@ -57,9 +131,43 @@ LAPI void* dynamic_allocator_allocate(dynamic_allocator* allocator, u64 size);
 LAPI b8 dynamic_allocator_free(dynamic_allocator* allocator, void* block, u64 size);
 
 /**
- * @brief Obtains the amount of free space left in the provided allocator.
+ * @brief Attempts to resize the given block in place. Shrinking always succeeds. Growing succeeds
+ * only if the memory directly after the block is free and large enough; otherwise nothing is
+ * changed and the caller must allocate, copy and free instead.
+ * 
+ * @param allocator A pointer to the allocator the block was allocated from.
+ * @param block The block to be resized.
+ * @param size The size the block currently has.
+ * @param new_size The size the block should have.
+ * @return True if the block now holds new_size bytes at the same address; otherwise false.
+ */
+LAPI b8 dynamic_allocator_resize(dynamic_allocator* allocator, void* block, u64 size, u64 new_size);
+
+/**
+ * @brief Indicates if the given block lies within the memory managed by the provided allocator.
+ * Only reads state fixed at creation, so it is safe to call without synchronization.
+ * 
+ * @param allocator A pointer to the allocator to be examined.
+ * @param block The block to be checked.
+ * @return True if the block lies within the allocator's memory; otherwise false.
+ */
+LAPI b8 dynamic_allocator_owns(dynamic_allocator* allocator, void* block);
+
+/**
+ * @brief Obtains the amount of free space left in the provided allocator. For reserved
+ * allocators this includes space which is not committed yet.
  * 
  * @param allocator A pointer to the allocator to be examined. 
  * @return The amount of free space in bytes.
  */
-LAPI u64 dynamic_allocator_free_space(dynamic_allocator* allocator);
\ No newline at end of file
+LAPI u64 dynamic_allocator_free_space(dynamic_allocator* allocator);
+
+/**
+ * @brief Obtains statistics about the free space in the provided allocator, which
+ * can be used to gauge fragmentation. This is cheap enough to call every frame.
+ * 
+ * @param allocator A pointer to the allocator to be examined.
+ * @param out_stats A pointer to hold the statistics.
+ * @return True on success; otherwise false.
+ */
+LAPI b8 dynamic_allocator_get_stats(dynamic_allocator* allocator, dynamic_allocator_stats* out_stats);
@@ -0,0 +1,58 @@
+#include "frame_arena.h"
+
+#include "core/lmemory.h"
+#include "core/logger.h"
+
+void frame_arena_create(u64 size_per_frame, frame_arena* out_arena)
+{
+    if (!out_arena) {
+        return;
+    }
+
+    for (u32 i = 0; i < FRAME_ARENA_BUFFER_COUNT; ++i) {
+        linear_allocator_create(size_per_frame, 0, &out_arena->allocators[i]);
+    }
+    out_arena->current = 0;
+    out_arena->peak_allocated = 0;
+}
+
+void frame_arena_destroy(frame_arena* arena)
+{
+    if (!arena) {
+        return;
+    }
+
+    for (u32 i = 0; i < FRAME_ARENA_BUFFER_COUNT; ++i) {
+        linear_allocator_destroy(&arena->allocators[i]);
+    }
+    arena->current = 0;
+    arena->peak_allocated = 0;
+}
+
+void frame_arena_begin_frame(frame_arena* arena)
+{
+    if (!arena) {
+        return;
+    }
+
+    linear_allocator* previous = &arena->allocators[arena->current];
+    if (previous->allocated > arena->peak_allocated) {
+        arena->peak_allocated = previous->allocated;
+    }
+
+    arena->current = (arena->current + 1) % FRAME_ARENA_BUFFER_COUNT;
+    linear_allocator_free_all(&arena->allocators[arena->current]);
+}
+
+void* frame_arena_allocate(frame_arena* arena, u64 size)
+{
+    if (!arena || !size) {
+        return 0;
+    }
+
+    void* block = linear_allocator_allocate_aligned(&arena->allocators[arena->current], size, LMEMORY_DEFAULT_ALIGNMENT);
+    if (!block) {
+        LERROR("frame_arena_allocate - frame buffer exhausted. Consider increasing the size per frame (peak so far: %lluB).", arena->peak_allocated);
+    }
+    return block;
+}
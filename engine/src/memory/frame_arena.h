@@ -0,0 +1,74 @@
+/**
+ * @file frame_arena.h
+ *
+ * @brief Contains a double-buffered arena for memory which only needs to live for a frame or two.
+ * @version 0.1
+ * @date 2024-05-12
+ *
+ */
+
+#pragma once
+
+#include "defines.h"
+#include "memory/linear_allocator.h"
+
+/** @brief The number of frames' worth of memory held by a frame arena. */
+#define FRAME_ARENA_BUFFER_COUNT 2
+
+/*
+Frame arena:
+
+    A pair of linear allocators, one per frame in flight. At the start of each
+    frame the arena switches to the allocator it used two frames ago and resets it,
+    so anything allocated during a frame stays valid through the following frame.
+
+    Allocation is a pointer bump and reset is a single zeroing of the used range,
+    so transient per-frame data (render lists, sort keys, temp strings) needs no
+    heap allocations in steady state.
+ */
+
+/**
+ * @brief A double-buffered frame arena. Members of this structure should not
+ * be modified outside the functions associated with it.
+ */
+typedef struct frame_arena {
+    /** @brief The per-frame allocators. */
+    linear_allocator allocators[FRAME_ARENA_BUFFER_COUNT];
+    /** @brief The index of the allocator used by the current frame. */
+    u32 current;
+    /** @brief The most bytes used by a single frame so far. Useful for sizing the arena. */
+    u64 peak_allocated;
+} frame_arena;
+
+/**
+ * @brief Creates a new frame arena. Each frame's buffer is obtained up front via lallocate.
+ *
+ * @param size_per_frame The size in bytes available to each frame.
+ * @param out_arena A pointer to hold the created arena.
+ */
+LAPI void frame_arena_create(u64 size_per_frame, frame_arena* out_arena);
+
+/**
+ * @brief Destroys the provided arena, releasing its buffers.
+ *
+ * @param arena A pointer to the arena to be destroyed.
+ */
+LAPI void frame_arena_destroy(frame_arena* arena);
+
+/**
+ * @brief Begins a new frame. Switches to the next buffer and resets it, which
+ * invalidates everything allocated from it two frames ago.
+ *
+ * @param arena A pointer to the arena.
+ */
+LAPI void frame_arena_begin_frame(frame_arena* arena);
+
+/**
+ * @brief Allocates zeroed memory from the current frame's buffer, aligned to
+ * LMEMORY_DEFAULT_ALIGNMENT. Valid until the next frame ends.
+ *
+ * @param arena A pointer to the arena to allocate from.
+ * @param size The size in bytes to allocate.
+ * @return A pointer to the block; 0 if the frame's buffer is exhausted.
+ */
+LAPI void* frame_arena_allocate(frame_arena* arena, u64 size);
@@ -1,21 +1,49 @@
 #include "linear_allocator.h"
 #include "core/lmemory.h"
 #include "core/logger.h"
-void linear_allocator_create(u64 total_size, void* memory, linear_allocator* out_allocator)
-{
-    if (!out_allocator) {
-        return;
-    }
 
+// Header of a chained overflow block. The block's memory directly follows it.
+typedef struct linear_allocator_block {
+    struct linear_allocator_block* previous;
+    u64 total_size;
+    u64 allocated;
+} linear_allocator_block;
+
+// Private functions
+static void* bump(void* memory, u64 total_size, u64* allocated, u64 size, u16 alignment);
+static void* allocate_internal(linear_allocator* allocator, u64 size, u16 alignment, const char* caller);
+static void release_overflow_until(linear_allocator* allocator, linear_allocator_block* stop);
+
+static void create_internal(u64 total_size, void* memory, b8 chained, linear_allocator* out_allocator)
+{
     out_allocator->total_size = total_size;
     out_allocator->allocated = 0;
     out_allocator->owns_memory = (memory == 0);
+    out_allocator->chained = chained;
+    out_allocator->overflow = 0;
     if (memory) {
         out_allocator->memory = memory;
     } else {
         out_allocator->memory = lallocate(total_size, MEMORY_TAG_LINEAR_ALLOCATOR);
     }
+}
 
+void linear_allocator_create(u64 total_size, void* memory, linear_allocator* out_allocator)
+{
+    if (!out_allocator) {
+        return;
+    }
+
+    create_internal(total_size, memory, false, out_allocator);
+}
+
+void linear_allocator_create_chained(u64 total_size, void* memory, linear_allocator* out_allocator)
+{
+    if (!out_allocator) {
+        return;
+    }
+
+    create_internal(total_size, memory, true, out_allocator);
 }
 
 void linear_allocator_destroy(linear_allocator* allocator)
@@ -24,6 +52,8 @@ void linear_allocator_destroy(linear_allocator* allocator)
         return;
     }
 
+    release_overflow_until(allocator, 0);
+
     allocator->allocated = 0;
     if (allocator->owns_memory && allocator->memory) {
         lfree(allocator->memory, allocator->total_size, MEMORY_TAG_LINEAR_ALLOCATOR);
@@ -32,6 +62,7 @@ void linear_allocator_destroy(linear_allocator* allocator)
     allocator->memory = 0;
     allocator->total_size = 0;
     allocator->owns_memory = false;
+    allocator->chained = false;
 }
 
 void* linear_allocator_allocate(linear_allocator* allocator, u64 size)
@@ -41,16 +72,22 @@ void* linear_allocator_allocate(linear_allocator* allocator, u64 size)
         return 0;
     }
 
-    if (allocator->allocated + size > allocator->total_size) {
-        u64 remaining = allocator->total_size - allocator->allocated;
-        LERROR("linear_allocator_allocate - Tried to allocate %lluB, only %lluB remaining", size, remaining);
+    return allocate_internal(allocator, size, 1, "linear_allocator_allocate");
+}
+
+void* linear_allocator_allocate_aligned(linear_allocator* allocator, u64 size, u16 alignment)
+{
+    if (!allocator || !allocator->memory) {
+        LERROR("linear_allocator_allocate_aligned - provided allocator not initialized!");
+        return 0;
+    }
+
+    if (!alignment || (alignment & (alignment - 1))) {
+        LERROR("linear_allocator_allocate_aligned - alignment must be a power of two (got %u)", alignment);
         return 0;
     }
 
-    void* block = ((u8*)allocator->memory) + allocator->allocated;
-    allocator->allocated += size;
-    allocator->total_size += size;
-    return block;
+    return allocate_internal(allocator, size, alignment, "linear_allocator_allocate_aligned");
 }
 
 void linear_allocator_free_all(linear_allocator* allocator)
@@ -60,6 +97,160 @@ void linear_allocator_free_all(linear_allocator* allocator)
         return;
     }
 
+    release_overflow_until(allocator, 0);
+
+    // Only the range handed out since the last reset can be dirty, so only that is zeroed.
+    lzero_memory(allocator->memory, allocator->allocated);
     allocator->allocated = 0;
-    lzero_memory(allocator->memory, allocator->total_size);
+}
+
+b8 linear_allocator_resize(linear_allocator* allocator, void* block, u64 size, u64 new_size)
+{
+    if (!allocator || !allocator->memory || !block) {
+        return false;
+    }
+
+    linear_allocator_block* overflow = allocator->overflow;
+    u8* memory = overflow ? (u8*)(overflow + 1) : (u8*)allocator->memory;
+    u64 total_size = overflow ? overflow->total_size : allocator->total_size;
+    u64* allocated = overflow ? &overflow->allocated : &allocator->allocated;
+
+    // Only the allocation right at the current position can change size.
+    if ((u8*)block + size != memory + *allocated) {
+        return false;
+    }
+
+    u64 start = *allocated - size;
+    if (new_size > total_size - start) {
+        return false;
+    }
+
+    if (new_size < size) {
+        lzero_memory((u8*)block + new_size, size - new_size);
+    }
+    *allocated = start + new_size;
+    return true;
+}
+
+linear_allocator_marker linear_allocator_get_marker(linear_allocator* allocator)
+{
+    linear_allocator_marker marker = {0};
+    if (!allocator) {
+        return marker;
+    }
+
+    marker.block = allocator->overflow;
+    marker.allocated = allocator->overflow ? allocator->overflow->allocated : allocator->allocated;
+    return marker;
+}
+
+b8 linear_allocator_rewind(linear_allocator* allocator, linear_allocator_marker marker)
+{
+    if (!allocator || !allocator->memory) {
+        LERROR("linear_allocator_rewind - provided allocator not initialized!");
+        return false;
+    }
+
+    // Make sure the marker's block is still part of the chain before releasing anything.
+    linear_allocator_block* block = allocator->overflow;
+    while (block && block != marker.block) {
+        block = block->previous;
+    }
+    if (block != marker.block) {
+        LERROR("linear_allocator_rewind - marker does not belong to this allocator, or was already rewound past.");
+        return false;
+    }
+
+    release_overflow_until(allocator, marker.block);
+
+    u8* memory = marker.block ? (u8*)(marker.block + 1) : (u8*)allocator->memory;
+    u64* allocated = marker.block ? &marker.block->allocated : &allocator->allocated;
+    if (marker.allocated > *allocated) {
+        LERROR("linear_allocator_rewind - marker lies past the current position. Markers must be rewound in LIFO order.");
+        return false;
+    }
+
+    lzero_memory(memory + marker.allocated, *allocated - marker.allocated);
+    *allocated = marker.allocated;
+    return true;
+}
+
+linear_allocator_scope linear_allocator_scope_begin(linear_allocator* allocator)
+{
+    linear_allocator_scope scope;
+    scope.allocator = allocator;
+    scope.marker = linear_allocator_get_marker(allocator);
+    return scope;
+}
+
+void linear_allocator_scope_end(linear_allocator_scope* scope)
+{
+    if (!scope || !scope->allocator) {
+        return;
+    }
+
+    linear_allocator_rewind(scope->allocator, scope->marker);
+    scope->allocator = 0;
+}
+
+// Private functions
+
+static void* bump(void* memory, u64 total_size, u64* allocated, u64 size, u16 alignment)
+{
+    // Skip ahead to the next aligned address, then allocate as normal.
+    u64 current = (u64)memory + *allocated;
+    u64 padding = ((current + (alignment - 1)) & ~(u64)(alignment - 1)) - current;
+    if (*allocated + padding + size > total_size) {
+        return 0;
+    }
+
+    *allocated += padding + size;
+    return (void*)(current + padding);
+}
+
+static void* allocate_internal(linear_allocator* allocator, u64 size, u16 alignment, const char* caller)
+{
+    void* block = 0;
+    linear_allocator_block* overflow = allocator->overflow;
+    if (overflow) {
+        block = bump(overflow + 1, overflow->total_size, &overflow->allocated, size, alignment);
+    } else {
+        block = bump(allocator->memory, allocator->total_size, &allocator->allocated, size, alignment);
+    }
+
+    if (block) {
+        return block;
+    }
+
+    if (!allocator->chained) {
+        u64 remaining = allocator->total_size - allocator->allocated;
+        LERROR("%s - Tried to allocate %lluB, only %lluB remaining", caller, size, remaining);
+        return 0;
+    }
+
+    // Chain a new block, large enough for this request regardless of where the alignment lands.
+    u64 block_size = allocator->total_size;
+    if (size + alignment - 1 > block_size) {
+        block_size = size + alignment - 1;
+    }
+    overflow = lallocate(sizeof(linear_allocator_block) + block_size, MEMORY_TAG_LINEAR_ALLOCATOR);
+    if (!overflow) {
+        LERROR("%s - Unable to chain a new %lluB block for a %lluB allocation.", caller, block_size, size);
+        return 0;
+    }
+    overflow->previous = allocator->overflow;
+    overflow->total_size = block_size;
+    overflow->allocated = 0;
+    allocator->overflow = overflow;
+
+    return bump(overflow + 1, overflow->total_size, &overflow->allocated, size, alignment);
+}
+
+static void release_overflow_until(linear_allocator* allocator, linear_allocator_block* stop)
+{
+    while (allocator->overflow && allocator->overflow != stop) {
+        linear_allocator_block* block = allocator->overflow;
+        allocator->overflow = block->previous;
+        lfree(block, sizeof(linear_allocator_block) + block->total_size, MEMORY_TAG_LINEAR_ALLOCATOR);
+    }
 }
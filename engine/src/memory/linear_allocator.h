@@ -33,15 +33,63 @@ Disadvantages of a linear memory allocator:
  
  */
 
+/*
+Markers and chaining:
+
+    A marker records the allocator's current position. Rewinding to a marker releases
+    everything allocated after it in one step, so nested code can take scratch memory
+    and hand it back in LIFO order at pointer-bump cost.
+
+    A chained allocator does not fail when its block runs out. Instead a new block is
+    obtained via lallocate and linked in front of the previous one. Chained blocks are
+    released again when rewound past, on free_all, or on destroy.
+ */
+
 typedef struct linear_allocator {
     u64 total_size;
     u64 allocated;
     void* memory;
     b8 owns_memory;
+    // If true, running out of space chains a new block instead of failing.
+    b8 chained;
+    // The most recently chained block, or 0 if allocating from memory.
+    struct linear_allocator_block* overflow;
 } linear_allocator;
 
+// A position within a linear allocator, obtained with linear_allocator_get_marker.
+typedef struct linear_allocator_marker {
+    // The block the position lies in, or 0 for the allocator's own memory.
+    struct linear_allocator_block* block;
+    // The number of bytes allocated within that block.
+    u64 allocated;
+} linear_allocator_marker;
+
+// A temporary allocation scope. Everything allocated between begin and end is released by end.
+typedef struct linear_allocator_scope {
+    linear_allocator* allocator;
+    linear_allocator_marker marker;
+} linear_allocator_scope;
+
 LAPI void linear_allocator_create(u64 total_size, void* memory, linear_allocator* out_allocator);
+// Same as linear_allocator_create, but overflow chains a new block of at least total_size bytes instead of failing.
+LAPI void linear_allocator_create_chained(u64 total_size, void* memory, linear_allocator* out_allocator);
 LAPI void linear_allocator_destroy(linear_allocator* allocator);
 
 LAPI void* linear_allocator_allocate(linear_allocator* allocator, u64 size);
+// Same as linear_allocator_allocate, but the block is aligned to the given (power of two) alignment.
+// Any padding skipped to reach the alignment counts as allocated.
+LAPI void* linear_allocator_allocate_aligned(linear_allocator* allocator, u64 size, u16 alignment);
 LAPI void linear_allocator_free_all(linear_allocator* allocator);
+// Grows or shrinks the most recent allocation in place. Fails if block is not the most recent
+// allocation, or there is not enough space left after it. Space given back on shrinking is zeroed.
+LAPI b8 linear_allocator_resize(linear_allocator* allocator, void* block, u64 size, u64 new_size);
+
+// Obtains the current position of the allocator.
+LAPI linear_allocator_marker linear_allocator_get_marker(linear_allocator* allocator);
+// Releases (and zeroes) everything allocated since the marker was taken. Markers must be rewound in LIFO order.
+LAPI b8 linear_allocator_rewind(linear_allocator* allocator, linear_allocator_marker marker);
+
+// Begins a temporary allocation scope on the given allocator.
+LAPI linear_allocator_scope linear_allocator_scope_begin(linear_allocator* allocator);
+// Ends the given scope, releasing everything allocated within it.
+LAPI void linear_allocator_scope_end(linear_allocator_scope* scope);
@@ -0,0 +1,124 @@
+#include "pool_allocator.h"
+
+#include "core/logger.h"
+
+// The free stack and flags follow the slots, so the slot array is padded to keep them aligned.
+#define POOL_ALLOCATOR_ALIGNMENT 8
+
+b8 pool_allocator_create(u64 element_size, u32 capacity, u64* memory_requirement, void* memory, pool_allocator* out_allocator)
+{
+    if (element_size == 0 || capacity == 0) {
+        LERROR("pool_allocator_create requires a nonzero element_size and capacity. Create failed.");
+        return false;
+    }
+
+    if (!memory_requirement) {
+        LERROR("pool_allocator_create requires memory_requirement to exist. Create failed.");
+        return false;
+    }
+
+    // Memory layout:
+    // slots (padded)
+    // free index stack
+    // in use flags
+    u64 elements_requirement = ((element_size * capacity) + (POOL_ALLOCATOR_ALIGNMENT - 1)) & ~(u64)(POOL_ALLOCATOR_ALIGNMENT - 1);
+    u64 stack_requirement = sizeof(u32) * capacity;
+    *memory_requirement = elements_requirement + stack_requirement + (sizeof(b8) * capacity);
+
+    if (!memory) {
+        // First pass.
+        return true;
+    }
+
+    // Second pass.
+    out_allocator->element_size = element_size;
+    out_allocator->capacity = capacity;
+    out_allocator->elements = memory;
+    out_allocator->free_indices = (u32*)((u8*)memory + elements_requirement);
+    out_allocator->in_use = (b8*)((u8*)out_allocator->free_indices + stack_requirement);
+
+    // Push in reverse so the lowest indices are handed out first.
+    out_allocator->free_count = capacity;
+    for (u32 i = 0; i < capacity; ++i) {
+        out_allocator->free_indices[i] = capacity - 1 - i;
+        out_allocator->in_use[i] = false;
+    }
+
+    return true;
+}
+
+void pool_allocator_destroy(pool_allocator* allocator)
+{
+    if (!allocator) {
+        return;
+    }
+
+    allocator->element_size = 0;
+    allocator->capacity = 0;
+    allocator->free_count = 0;
+    allocator->elements = 0;
+    allocator->free_indices = 0;
+    allocator->in_use = 0;
+}
+
+void* pool_allocator_allocate(pool_allocator* allocator, u32* out_index)
+{
+    if (!allocator || !allocator->elements) {
+        LERROR("pool_allocator_allocate - provided allocator not initialized!");
+        return 0;
+    }
+
+    if (allocator->free_count == 0) {
+        LERROR("pool_allocator_allocate - All %u slots are in use.", allocator->capacity);
+        return 0;
+    }
+
+    allocator->free_count--;
+    u32 index = allocator->free_indices[allocator->free_count];
+    allocator->in_use[index] = true;
+    if (out_index) {
+        *out_index = index;
+    }
+    return (u8*)allocator->elements + (allocator->element_size * index);
+}
+
+b8 pool_allocator_free(pool_allocator* allocator, u32 index)
+{
+    if (!allocator || !allocator->elements) {
+        LERROR("pool_allocator_free - provided allocator not initialized!");
+        return false;
+    }
+
+    if (index >= allocator->capacity) {
+        LERROR("pool_allocator_free - index %u is out of range (capacity %u).", index, allocator->capacity);
+        return false;
+    }
+
+    if (!allocator->in_use[index]) {
+        LWARN("pool_allocator_free - slot %u is not in use. Nothing was done.", index);
+        return false;
+    }
+
+    allocator->in_use[index] = false;
+    allocator->free_indices[allocator->free_count] = index;
+    allocator->free_count++;
+    return true;
+}
+
+void* pool_allocator_get(pool_allocator* allocator, u32 index)
+{
+    if (!allocator || !allocator->elements || index >= allocator->capacity) {
+        return 0;
+    }
+
+    return (u8*)allocator->elements + (allocator->element_size * index);
+}
+
+b8 pool_allocator_is_allocated(pool_allocator* allocator, u32 index)
+{
+    if (!allocator || !allocator->elements || index >= allocator->capacity) {
+        return false;
+    }
+
+    return allocator->in_use[index];
+}
@@ -0,0 +1,100 @@
+/**
+ * @file pool_allocator.h
+ *
+ * @brief Contains a fixed-size pool allocator, which hands out equally sized
+ * slots by index in constant time.
+ * @version 0.1
+ * @date 2024-05-14
+ *
+ */
+
+#pragma once
+#include "defines.h"
+
+/*
+Pool allocator:
+
+    A fixed number of equally sized slots, laid out as a plain array so callers can
+    still index into them directly. Free slot indices are kept on an embedded stack,
+    so acquiring a slot is a pop and releasing one is a push, regardless of how many
+    slots are in use. This replaces linear scans for a free slot in registries.
+
+    Slots are handed out lowest index first from a fresh pool, and the most recently
+    released slot is the next one handed out again. Slot contents are left untouched
+    by both allocate and free; the owner is responsible for initializing them.
+ */
+
+/**
+ * @brief A fixed-size pool allocator. Members of this structure should not be
+ * modified outside the functions associated with it.
+ */
+typedef struct pool_allocator {
+    /** @brief The size in bytes of a single slot. */
+    u64 element_size;
+    /** @brief The total number of slots. */
+    u32 capacity;
+    /** @brief The number of slots currently free, which is also the height of the free stack. */
+    u32 free_count;
+    /** @brief The slot storage, an array of capacity elements. */
+    void* elements;
+    /** @brief The stack of free slot indices. The top is at free_count - 1. */
+    u32* free_indices;
+    /** @brief One flag per slot, used to catch double frees. */
+    b8* in_use;
+} pool_allocator;
+
+/**
+ * @brief Creates a new pool allocator or obtains the memory requirement for one. Should be called twice;
+ * once passing 0 to memory to obtain the memory requirement, then a second time passing an allocated block.
+ *
+ * @param element_size The size in bytes of a single slot.
+ * @param capacity The number of slots in the pool.
+ * @param memory_requirement A pointer to hold the memory requirement for the slots PLUS the free stack.
+ * @param memory 0; or a pre-allocated block of memory for the allocator to use.
+ * @param out_allocator A pointer to hold the created allocator.
+ * @return True on success; otherwise false.
+ */
+LAPI b8 pool_allocator_create(u64 element_size, u32 capacity, u64* memory_requirement, void* memory, pool_allocator* out_allocator);
+
+/**
+ * @brief Destroys the provided allocator. The memory block passed to create is not freed.
+ *
+ * @param allocator A pointer to the allocator to be destroyed.
+ */
+LAPI void pool_allocator_destroy(pool_allocator* allocator);
+
+/**
+ * @brief Acquires a free slot in constant time.
+ *
+ * @param allocator A pointer to the allocator to allocate from.
+ * @param out_index A pointer to hold the index of the acquired slot. Optional.
+ * @return A pointer to the slot; 0 if the pool is full.
+ */
+LAPI void* pool_allocator_allocate(pool_allocator* allocator, u32* out_index);
+
+/**
+ * @brief Releases the slot at the given index in constant time.
+ *
+ * @param allocator A pointer to the allocator to free from.
+ * @param index The index of the slot to be released.
+ * @return True on success; false if the index is out of range or not in use.
+ */
+LAPI b8 pool_allocator_free(pool_allocator* allocator, u32 index);
+
+/**
+ * @brief Obtains a pointer to the slot at the given index, whether or not it is in use.
+ *
+ * @param allocator A pointer to the allocator.
+ * @param index The index of the slot.
+ * @return A pointer to the slot; 0 if the index is out of range.
+ */
+LAPI void* pool_allocator_get(pool_allocator* allocator, u32 index);
+
+/**
+ * @brief Indicates if the slot at the given index is currently allocated.
+ *
+ * @param allocator A pointer to the allocator.
+ * @param index The index of the slot.
+ * @return True if the slot is in use; otherwise false.
+ */
+LAPI b8 pool_allocator_is_allocated(pool_allocator* allocator, u32 index);
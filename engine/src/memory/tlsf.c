@@ -0,0 +1,623 @@
+#include "tlsf.h"
+
+#include "core/lmemory.h"
+#include "core/logger.h"
+
+// log2 of the block alignment.
+#define TLSF_ALIGN_SIZE_LOG2 4
+
+// Number of second-level subdivisions per first-level class (log2).
+#define TLSF_SL_INDEX_COUNT_LOG2 5
+#define TLSF_SL_INDEX_COUNT (1 << TLSF_SL_INDEX_COUNT_LOG2)
+
+// Blocks of up to 2^TLSF_FL_INDEX_MAX bytes are supported (1 TiB).
+#define TLSF_FL_INDEX_MAX 40
+#define TLSF_FL_INDEX_SHIFT (TLSF_SL_INDEX_COUNT_LOG2 + TLSF_ALIGN_SIZE_LOG2)
+#define TLSF_FL_INDEX_COUNT (TLSF_FL_INDEX_MAX - TLSF_FL_INDEX_SHIFT + 1)
+
+// Sizes below this are all kept in the first first-level class, split linearly.
+#define TLSF_SMALL_BLOCK_SIZE (1ULL << TLSF_FL_INDEX_SHIFT)
+
+// Block flags, stored in the low bits of the size (sizes are always aligned).
+#define BLOCK_FREE 0x1ULL
+#define BLOCK_PREV_FREE 0x2ULL
+#define BLOCK_LAST 0x4ULL
+#define BLOCK_FLAG_MASK (TLSF_ALIGN_SIZE - 1)
+
+typedef struct tlsf_block {
+    // The physically previous block. Null for the first block in the pool.
+    struct tlsf_block* prev_phys;
+    // Size of the block payload in bytes, with flags in the low bits.
+    u64 size;
+
+    // NOTE: The following are only valid while the block is free, and
+    // overlap the payload otherwise.
+    struct tlsf_block* next_free;
+    struct tlsf_block* prev_free;
+} tlsf_block;
+
+// The in-band overhead of every block.
+#define BLOCK_HEADER_SIZE (sizeof(tlsf_block*) + sizeof(u64))
+// The smallest payload a block can have, which must hold the free links.
+#define BLOCK_SIZE_MIN (sizeof(tlsf_block) - BLOCK_HEADER_SIZE)
+
+STATIC_ASSERT(BLOCK_HEADER_SIZE % TLSF_ALIGN_SIZE == 0, "TLSF block header must preserve block alignment.");
+
+// Internal state of the allocator.
+typedef struct internal_state {
+    u64 total_size;
+    u64 free_space;
+    u64 free_block_count;
+    u8* pool;
+    u64 pool_size;
+    // The physically last block, which tlsf_extend grows or appends to.
+    tlsf_block* last_block;
+    u32 fl_bitmap;
+    u32 sl_bitmap[TLSF_FL_INDEX_COUNT];
+    tlsf_block* blocks[TLSF_FL_INDEX_COUNT][TLSF_SL_INDEX_COUNT];
+} internal_state;
+
+// Private method declarations
+static void mapping_insert(u64 size, u32* fl, u32* sl);
+static void mapping_search(u64 size, u32* fl, u32* sl);
+static tlsf_block* search_suitable_block(internal_state* state, u32* fl, u32* sl);
+static void insert_free_block(internal_state* state, tlsf_block* block);
+static void remove_free_block(internal_state* state, tlsf_block* block);
+static tlsf_block* locate_free_block(internal_state* state, u64 size);
+static void* prepare_used_block(internal_state* state, tlsf_block* block, u64 size);
+static void trim_used_block(internal_state* state, tlsf_block* block, u64 size);
+
+LINLINE u64 align_up(u64 value, u64 alignment) {
+    return (value + (alignment - 1)) & ~(alignment - 1);
+}
+
+// Index of the most significant set bit.
+LINLINE u32 bit_fls(u64 value) {
+    return 63 - __builtin_clzll(value);
+}
+
+// Index of the least significant set bit.
+LINLINE u32 bit_ffs(u32 value) {
+    return __builtin_ctz(value);
+}
+
+LINLINE u64 adjust_request_size(u64 size) {
+    return align_up(size < BLOCK_SIZE_MIN ? BLOCK_SIZE_MIN : size, TLSF_ALIGN_SIZE);
+}
+
+LINLINE u64 block_size(const tlsf_block* block) {
+    return block->size & ~(u64)BLOCK_FLAG_MASK;
+}
+
+LINLINE void block_set_size(tlsf_block* block, u64 size) {
+    block->size = size | (block->size & BLOCK_FLAG_MASK);
+}
+
+LINLINE void* block_to_ptr(const tlsf_block* block) {
+    return (void*)((u8*)block + BLOCK_HEADER_SIZE);
+}
+
+LINLINE tlsf_block* block_from_ptr(const void* ptr) {
+    return (tlsf_block*)((u8*)ptr - BLOCK_HEADER_SIZE);
+}
+
+// Keeps the state's last block up to date whenever the last flag moves.
+LINLINE void track_last_block(internal_state* state, tlsf_block* block) {
+    if (block->size & BLOCK_LAST) {
+        state->last_block = block;
+    }
+}
+
+LINLINE tlsf_block* block_next(const tlsf_block* block) {
+    if (block->size & BLOCK_LAST) {
+        return 0;
+    }
+    return (tlsf_block*)((u8*)block_to_ptr(block) + block_size(block));
+}
+
+// Public functions
+b8 tlsf_create(u64 total_size, u64* memory_requirement, void* memory, tlsf* out_allocator)
+{
+    if (!memory_requirement) {
+        LERROR("tlsf_create requires memory_requirement to exist. Create failed.");
+        return false;
+    }
+
+    if (total_size < BLOCK_SIZE_MIN || total_size >= (1ULL << TLSF_FL_INDEX_MAX)) {
+        LERROR("tlsf_create requires a total_size between %lluB and %lluB. Create failed.", (u64)BLOCK_SIZE_MIN, (1ULL << TLSF_FL_INDEX_MAX));
+        return false;
+    }
+
+    // The pool holds a single block covering the requested size, plus its header.
+    // Extra room is left so the pool can be aligned regardless of where memory lands.
+    u64 pool_size = BLOCK_HEADER_SIZE + align_up(total_size, TLSF_ALIGN_SIZE);
+    *memory_requirement = sizeof(internal_state) + TLSF_ALIGN_SIZE + pool_size;
+    if (!memory) {
+        // First pass.
+        return true;
+    }
+
+    // Second pass.
+    // Memory layout:
+    // state
+    // alignment padding
+    // pool
+    out_allocator->memory = memory;
+    internal_state* state = out_allocator->memory;
+    lzero_memory(state, sizeof(internal_state));
+    state->total_size = total_size;
+    state->pool_size = pool_size;
+    state->pool = (u8*)align_up((u64)memory + sizeof(internal_state), TLSF_ALIGN_SIZE);
+
+    // The whole pool starts out as one free block.
+    tlsf_block* block = (tlsf_block*)state->pool;
+    block->prev_phys = 0;
+    block->size = (pool_size - BLOCK_HEADER_SIZE) | BLOCK_FREE | BLOCK_LAST;
+    state->last_block = block;
+    insert_free_block(state, block);
+
+    return true;
+}
+
+b8 tlsf_extend(tlsf* allocator, u64 size)
+{
+    if (!allocator || !allocator->memory) {
+        return false;
+    }
+
+    internal_state* state = allocator->memory;
+    size &= ~(u64)(TLSF_ALIGN_SIZE - 1);
+    if (state->total_size + size >= (1ULL << TLSF_FL_INDEX_MAX)) {
+        LERROR("tlsf_extend cannot grow the pool beyond %lluB.", (1ULL << TLSF_FL_INDEX_MAX));
+        return false;
+    }
+
+    tlsf_block* last = state->last_block;
+    if (last->size & BLOCK_FREE) {
+        // The new space simply becomes part of the free block at the end.
+        remove_free_block(state, last);
+        block_set_size(last, block_size(last) + size);
+        insert_free_block(state, last);
+    } else {
+        // Otherwise it becomes a new free block after the used one.
+        if (size < BLOCK_HEADER_SIZE + BLOCK_SIZE_MIN) {
+            LERROR("tlsf_extend requires at least %lluB to append a block.", (u64)(BLOCK_HEADER_SIZE + BLOCK_SIZE_MIN));
+            return false;
+        }
+        tlsf_block* block = (tlsf_block*)(state->pool + state->pool_size);
+        block->prev_phys = last;
+        block->size = (size - BLOCK_HEADER_SIZE) | BLOCK_FREE | BLOCK_LAST;
+        last->size &= ~BLOCK_LAST;
+        state->last_block = block;
+        insert_free_block(state, block);
+    }
+
+    state->total_size += size;
+    state->pool_size += size;
+    return true;
+}
+
+void tlsf_destroy(tlsf* allocator)
+{
+    if (!allocator || !allocator->memory) {
+        return;
+    }
+
+    lzero_memory(allocator->memory, sizeof(internal_state));
+    allocator->memory = 0;
+}
+
+void* tlsf_allocate(tlsf* allocator, u64 size)
+{
+    if (!allocator || !allocator->memory || !size) {
+        return 0;
+    }
+
+    internal_state* state = allocator->memory;
+    u64 adjusted = adjust_request_size(size);
+    tlsf_block* block = locate_free_block(state, adjusted);
+    if (!block) {
+        return 0;
+    }
+
+    return prepare_used_block(state, block, adjusted);
+}
+
+void* tlsf_allocate_aligned(tlsf* allocator, u64 size, u64 alignment)
+{
+    if (!allocator || !allocator->memory || !size) {
+        return 0;
+    }
+
+    if (alignment & (alignment - 1)) {
+        LERROR("tlsf_allocate_aligned requires a power of two alignment (got %llu).", alignment);
+        return 0;
+    }
+
+    // Every block is already aligned this much.
+    if (alignment <= TLSF_ALIGN_SIZE) {
+        return tlsf_allocate(allocator, size);
+    }
+
+    internal_state* state = allocator->memory;
+    u64 adjusted = adjust_request_size(size);
+
+    // Any gap in front of the aligned address is given back as a free block,
+    // so it must be able to hold one. Search for enough room to cover the worst case.
+    const u64 gap_minimum = sizeof(tlsf_block);
+    tlsf_block* block = locate_free_block(state, adjusted + alignment + gap_minimum);
+    if (!block) {
+        return 0;
+    }
+
+    u8* ptr = block_to_ptr(block);
+    u8* aligned = (u8*)align_up((u64)ptr, alignment);
+    u64 gap = (u64)(aligned - ptr);
+    if (gap && gap < gap_minimum) {
+        // Too small to be a block of its own, so use the next aligned address beyond it.
+        aligned = (u8*)align_up((u64)ptr + gap_minimum, alignment);
+        gap = (u64)(aligned - ptr);
+    }
+
+    if (gap) {
+        // Split the gap off into a free block of its own, ahead of the aligned block.
+        tlsf_block* remaining = block_from_ptr(aligned);
+        remaining->prev_phys = block;
+        remaining->size = (block_size(block) - gap) | BLOCK_FREE | BLOCK_PREV_FREE | (block->size & BLOCK_LAST);
+        block->size = (gap - BLOCK_HEADER_SIZE) | BLOCK_FREE | (block->size & BLOCK_PREV_FREE);
+
+        track_last_block(state, remaining);
+
+        tlsf_block* next = block_next(remaining);
+        if (next) {
+            next->prev_phys = remaining;
+        }
+        insert_free_block(state, block);
+        block = remaining;
+    }
+
+    return prepare_used_block(state, block, adjusted);
+}
+
+b8 tlsf_free(tlsf* allocator, void* ptr)
+{
+    if (!allocator || !allocator->memory || !ptr) {
+        return false;
+    }
+
+    internal_state* state = allocator->memory;
+    if (!tlsf_owns(allocator, ptr)) {
+        LERROR("tlsf_free trying to release block (0x%p) outside of the pool.", ptr);
+        return false;
+    }
+
+    tlsf_block* block = block_from_ptr(ptr);
+    if (block->size & BLOCK_FREE) {
+        LWARN("tlsf_free called on a block which is already free. Corruption possible.");
+        return false;
+    }
+
+    block->size |= BLOCK_FREE;
+
+    // Merge with the previous block if it is free.
+    if (block->size & BLOCK_PREV_FREE) {
+        tlsf_block* prev = block->prev_phys;
+        remove_free_block(state, prev);
+        block_set_size(prev, block_size(prev) + BLOCK_HEADER_SIZE + block_size(block));
+        prev->size |= (block->size & BLOCK_LAST);
+        track_last_block(state, prev);
+        block = prev;
+    }
+
+    // Merge with the next block if it is free.
+    tlsf_block* next = block_next(block);
+    if (next && (next->size & BLOCK_FREE)) {
+        remove_free_block(state, next);
+        block_set_size(block, block_size(block) + BLOCK_HEADER_SIZE + block_size(next));
+        block->size |= (next->size & BLOCK_LAST);
+        track_last_block(state, block);
+    }
+
+    // Let the next block know this one is free, so it may merge later.
+    next = block_next(block);
+    if (next) {
+        next->prev_phys = block;
+        next->size |= BLOCK_PREV_FREE;
+    }
+
+    insert_free_block(state, block);
+    return true;
+}
+
+b8 tlsf_resize(tlsf* allocator, void* ptr, u64 size)
+{
+    if (!allocator || !allocator->memory || !ptr || !size) {
+        return false;
+    }
+
+    internal_state* state = allocator->memory;
+    if (!tlsf_owns(allocator, ptr)) {
+        LERROR("tlsf_resize trying to resize block (0x%p) outside of the pool.", ptr);
+        return false;
+    }
+
+    tlsf_block* block = block_from_ptr(ptr);
+    if (block->size & BLOCK_FREE) {
+        LWARN("tlsf_resize called on a block which is free. Corruption possible.");
+        return false;
+    }
+
+    u64 adjusted = adjust_request_size(size);
+    u64 current = block_size(block);
+    if (adjusted > current) {
+        // Growing is only possible by absorbing the next block, which must be free and big enough.
+        tlsf_block* next = block_next(block);
+        if (!next || !(next->size & BLOCK_FREE) || current + BLOCK_HEADER_SIZE + block_size(next) < adjusted) {
+            return false;
+        }
+
+        remove_free_block(state, next);
+        block_set_size(block, current + BLOCK_HEADER_SIZE + block_size(next));
+        block->size |= (next->size & BLOCK_LAST);
+        track_last_block(state, block);
+
+        // The block after is now preceded by a used block.
+        tlsf_block* after = block_next(block);
+        if (after) {
+            after->prev_phys = block;
+            after->size &= ~BLOCK_PREV_FREE;
+        }
+    }
+
+    // Give back whatever is not needed.
+    trim_used_block(state, block, adjusted);
+    return true;
+}
+
+b8 tlsf_block_at_end(tlsf* allocator, void* ptr)
+{
+    if (!tlsf_owns(allocator, ptr)) {
+        return false;
+    }
+
+    tlsf_block* last = ((internal_state*)allocator->memory)->last_block;
+    tlsf_block* block = block_from_ptr(ptr);
+    return block == last || ((last->size & BLOCK_FREE) && last->prev_phys == block);
+}
+
+b8 tlsf_owns(tlsf* allocator, void* block)
+{
+    if (!allocator || !allocator->memory) {
+        return false;
+    }
+
+    internal_state* state = allocator->memory;
+    u8* ptr = block;
+    return ptr >= state->pool + BLOCK_HEADER_SIZE && ptr < state->pool + state->pool_size;
+}
+
+u64 tlsf_free_space(tlsf* allocator)
+{
+    if (!allocator || !allocator->memory) {
+        return 0;
+    }
+
+    return ((internal_state*)allocator->memory)->free_space;
+}
+
+u64 tlsf_free_block_count(tlsf* allocator)
+{
+    if (!allocator || !allocator->memory) {
+        return 0;
+    }
+
+    return ((internal_state*)allocator->memory)->free_block_count;
+}
+
+u64 tlsf_largest_free_block(tlsf* allocator)
+{
+    if (!allocator || !allocator->memory) {
+        return 0;
+    }
+
+    internal_state* state = allocator->memory;
+    if (!state->fl_bitmap) {
+        return 0;
+    }
+
+    // The largest block is in the highest non-empty bin. Blocks within a bin
+    // differ by less than the bin width, so that bin is walked for the exact size.
+    u32 fl = bit_fls(state->fl_bitmap);
+    u32 sl = bit_fls(state->sl_bitmap[fl]);
+    u64 largest = 0;
+    for (tlsf_block* block = state->blocks[fl][sl]; block; block = block->next_free) {
+        if (block_size(block) > largest) {
+            largest = block_size(block);
+        }
+    }
+    return largest;
+}
+
+u64 tlsf_trailing_free_space(tlsf* allocator)
+{
+    if (!allocator || !allocator->memory) {
+        return 0;
+    }
+
+    tlsf_block* last = ((internal_state*)allocator->memory)->last_block;
+    return (last->size & BLOCK_FREE) ? block_size(last) : 0;
+}
+
+// Private functions
+static void mapping_insert(u64 size, u32* fl, u32* sl)
+{
+    if (size < TLSF_SMALL_BLOCK_SIZE) {
+        // Small sizes are split linearly within the first class.
+        *fl = 0;
+        *sl = (u32)(size / (TLSF_SMALL_BLOCK_SIZE / TLSF_SL_INDEX_COUNT));
+    } else {
+        u32 f = bit_fls(size);
+        *sl = (u32)(size >> (f - TLSF_SL_INDEX_COUNT_LOG2)) ^ TLSF_SL_INDEX_COUNT;
+        *fl = f - (TLSF_FL_INDEX_SHIFT - 1);
+    }
+}
+
+static void mapping_search(u64 size, u32* fl, u32* sl)
+{
+    // Round up to the next second-level boundary so that any block
+    // in the resulting bin is guaranteed to be large enough.
+    if (size >= TLSF_SMALL_BLOCK_SIZE) {
+        size += (1ULL << (bit_fls(size) - TLSF_SL_INDEX_COUNT_LOG2)) - 1;
+    }
+    mapping_insert(size, fl, sl);
+}
+
+static tlsf_block* search_suitable_block(internal_state* state, u32* fl, u32* sl)
+{
+    // Look for a non-empty bin in the same first-level class first.
+    u32 sl_map = state->sl_bitmap[*fl] & (~0U << *sl);
+    if (!sl_map) {
+        // Otherwise take the next larger first-level class.
+        u32 fl_map = (*fl + 1 < 32) ? state->fl_bitmap & (~0U << (*fl + 1)) : 0;
+        if (!fl_map) {
+            return 0;
+        }
+
+        *fl = bit_ffs(fl_map);
+        sl_map = state->sl_bitmap[*fl];
+    }
+
+    *sl = bit_ffs(sl_map);
+    return state->blocks[*fl][*sl];
+}
+
+static void insert_free_block(internal_state* state, tlsf_block* block)
+{
+    u32 fl = 0, sl = 0;
+    mapping_insert(block_size(block), &fl, &sl);
+
+    tlsf_block* current = state->blocks[fl][sl];
+    block->next_free = current;
+    block->prev_free = 0;
+    if (current) {
+        current->prev_free = block;
+    }
+
+    state->blocks[fl][sl] = block;
+    state->fl_bitmap |= (1U << fl);
+    state->sl_bitmap[fl] |= (1U << sl);
+    state->free_space += block_size(block);
+    state->free_block_count++;
+}
+
+static void remove_free_block(internal_state* state, tlsf_block* block)
+{
+    u32 fl = 0, sl = 0;
+    mapping_insert(block_size(block), &fl, &sl);
+
+    tlsf_block* prev = block->prev_free;
+    tlsf_block* next = block->next_free;
+    if (next) {
+        next->prev_free = prev;
+    }
+    if (prev) {
+        prev->next_free = next;
+    }
+
+    // If this was the head of its bin, update the bin and the bitmaps.
+    if (state->blocks[fl][sl] == block) {
+        state->blocks[fl][sl] = next;
+        if (!next) {
+            state->sl_bitmap[fl] &= ~(1U << sl);
+            if (!state->sl_bitmap[fl]) {
+                state->fl_bitmap &= ~(1U << fl);
+            }
+        }
+    }
+
+    state->free_space -= block_size(block);
+    state->free_block_count--;
+}
+
+// Finds a free block of at least the given size and takes it out of its bin.
+static tlsf_block* locate_free_block(internal_state* state, u64 size)
+{
+    u32 fl = 0, sl = 0;
+    mapping_search(size, &fl, &sl);
+    if (fl >= TLSF_FL_INDEX_COUNT) {
+        return 0;
+    }
+
+    tlsf_block* block = search_suitable_block(state, &fl, &sl);
+    if (block) {
+        remove_free_block(state, block);
+    }
+    return block;
+}
+
+// Trims the given (removed) free block down to size and marks it as used.
+static void* prepare_used_block(internal_state* state, tlsf_block* block, u64 size)
+{
+    // Split off the remainder if it is large enough to hold a block of its own.
+    u64 available = block_size(block);
+    if (available >= size + BLOCK_HEADER_SIZE + BLOCK_SIZE_MIN) {
+        tlsf_block* remaining = (tlsf_block*)((u8*)block_to_ptr(block) + size);
+        remaining->prev_phys = block;
+        // The remainder inherits the last flag from the block it was split from.
+        remaining->size = (available - size - BLOCK_HEADER_SIZE) | BLOCK_FREE | (block->size & BLOCK_LAST);
+        block->size = size | (block->size & BLOCK_PREV_FREE);
+        track_last_block(state, remaining);
+
+        tlsf_block* next = block_next(remaining);
+        if (next) {
+            next->prev_phys = remaining;
+        }
+        insert_free_block(state, remaining);
+    }
+
+    // Mark the block as used, and let the next block know.
+    block->size &= ~BLOCK_FREE;
+    tlsf_block* next = block_next(block);
+    if (next) {
+        next->size &= ~BLOCK_PREV_FREE;
+    }
+
+    return block_to_ptr(block);
+}
+
+// Gives the space past size in a used block back to the pool, merging it into the next block if
+// that is free. Space too small to hold a block of its own stays with the used block.
+static void trim_used_block(internal_state* state, tlsf_block* block, u64 size)
+{
+    u64 spare = block_size(block) - size;
+    if (!spare) {
+        return;
+    }
+
+    tlsf_block* remaining = (tlsf_block*)((u8*)block_to_ptr(block) + size);
+    tlsf_block* next = block_next(block);
+    if (next && (next->size & BLOCK_FREE)) {
+        // Move the start of the next block back. Its header may be overwritten below, so read it first.
+        remove_free_block(state, next);
+        u64 next_size = block_size(next);
+        u64 next_last = next->size & BLOCK_LAST;
+
+        remaining->prev_phys = block;
+        remaining->size = (spare + next_size) | BLOCK_FREE | next_last;
+    } else if (spare >= BLOCK_HEADER_SIZE + BLOCK_SIZE_MIN) {
+        remaining->prev_phys = block;
+        remaining->size = (spare - BLOCK_HEADER_SIZE) | BLOCK_FREE | (block->size & BLOCK_LAST);
+    } else {
+        return;
+    }
+
+    block->size = size | (block->size & BLOCK_PREV_FREE);
+    track_last_block(state, remaining);
+
+    tlsf_block* after = block_next(remaining);
+    if (after) {
+        after->prev_phys = remaining;
+        after->size |= BLOCK_PREV_FREE;
+    }
+    insert_free_block(state, remaining);
+}
@@ -0,0 +1,166 @@
+/**
+ * @file tlsf.h
+ *
+ * @brief Contains a two-level segregated fit (TLSF) allocator, used as a constant-time
+ * backend for the dynamic allocator.
+ * @version 0.1
+ * @date 2024-05-02
+ *
+ */
+
+#pragma once
+#include "defines.h"
+
+/*
+Two-level segregated fit:
+
+    Free blocks are binned by size into first-level classes (powers of two) which are
+    further divided linearly into second-level classes. A bitmap per level records which
+    bins are non-empty, so finding a suitable block is a pair of bit scans rather than
+    a walk over the free ranges.
+
+    Each block carries a small in-band header (previous physical block and size), which
+    allows a freed block to be merged with its physical neighbours in constant time.
+
+    Both allocation and free are O(1), regardless of how fragmented the pool becomes.
+ */
+
+/**
+ * @brief A two-level segregated fit allocator. Members of this structure should
+ * not be modified outside the functions associated with it.
+ */
+typedef struct tlsf {
+    /** @brief The internal state of the allocator. */
+    void* memory;
+} tlsf;
+
+/**
+ * @brief Creates a new TLSF allocator or obtains the memory requirement for one. Should be called twice;
+ * once passing 0 to memory to obtain the memory requirement, then a second time passing an allocated block.
+ *
+ * @param total_size The total size in bytes that should be available for allocations.
+ * @param memory_requirement A pointer to hold the memory requirement for the internal state PLUS the pool itself.
+ * @param memory 0; or a pre-allocated block of memory for the allocator to use.
+ * @param out_allocator A pointer to hold the created allocator.
+ * @return True on success; otherwise false.
+ */
+LAPI b8 tlsf_create(u64 total_size, u64* memory_requirement, void* memory, tlsf* out_allocator);
+
+/**
+ * @brief Destroys the provided allocator.
+ *
+ * @param allocator A pointer to the allocator to be destroyed.
+ */
+LAPI void tlsf_destroy(tlsf* allocator);
+
+/**
+ * @brief Grows the pool by the given number of bytes, which must directly follow the current
+ * end of the pool and be accessible. The space is merged into the last block if it is free,
+ * otherwise it becomes a new free block. Used to commit memory to the pool as it is needed.
+ *
+ * @param allocator A pointer to the allocator to be grown.
+ * @param size The number of bytes to add. Rounded down to a multiple of TLSF_ALIGN_SIZE.
+ * @return True on success; otherwise false.
+ */
+LAPI b8 tlsf_extend(tlsf* allocator, u64 size);
+
+/**
+ * @brief Allocates a block of the given size in constant time. Blocks are
+ * aligned to TLSF_ALIGN_SIZE bytes.
+ *
+ * @param allocator A pointer to the allocator to allocate from.
+ * @param size The size in bytes to be allocated.
+ * @return A pointer to the allocated block; 0 if no block large enough is available.
+ */
+LAPI void* tlsf_allocate(tlsf* allocator, u64 size);
+
+/**
+ * @brief Allocates a block of the given size aligned to the given alignment, in constant time.
+ * Any space skipped to reach the alignment is split off and stays free. Freed with tlsf_free.
+ *
+ * @param allocator A pointer to the allocator to allocate from.
+ * @param size The size in bytes to be allocated.
+ * @param alignment The alignment in bytes. Must be a power of two.
+ * @return A pointer to the allocated block; 0 if no block large enough is available.
+ */
+LAPI void* tlsf_allocate_aligned(tlsf* allocator, u64 size, u64 alignment);
+
+/**
+ * @brief Frees the given block in constant time, merging it with any free physical neighbours.
+ *
+ * @param allocator A pointer to the allocator to free from.
+ * @param block The block to be freed. Must have been allocated by the provided allocator.
+ * @return True on success; otherwise false. False should be treated as an error.
+ */
+LAPI b8 tlsf_free(tlsf* allocator, void* block);
+
+/**
+ * @brief Attempts to resize an allocated block in place, in constant time. Shrinking always
+ * succeeds, with any spare space given back (merged into a free next block if there is one).
+ * Growing only succeeds if the physically next block is free and large enough to cover the
+ * difference; otherwise nothing is changed.
+ *
+ * @param allocator A pointer to the allocator the block was allocated from.
+ * @param block The block to be resized.
+ * @param size The size in bytes the block should have.
+ * @return True if the block now holds at least size bytes at the same address; otherwise false.
+ */
+LAPI b8 tlsf_resize(tlsf* allocator, void* block, u64 size);
+
+/**
+ * @brief Indicates if the given block is at the physical end of the pool, ie. nothing but free
+ * space follows it. Such a block can always be grown in place once the pool is extended.
+ *
+ * @param allocator A pointer to the allocator the block was allocated from.
+ * @param block The block to be checked.
+ * @return True if only free space lies between the block and the end of the pool; otherwise false.
+ */
+LAPI b8 tlsf_block_at_end(tlsf* allocator, void* block);
+
+/**
+ * @brief Indicates if the given block lies within the pool owned by the provided allocator.
+ *
+ * @param allocator A pointer to the allocator to be examined.
+ * @param block The block to be checked.
+ * @return True if the block lies within the pool; otherwise false.
+ */
+LAPI b8 tlsf_owns(tlsf* allocator, void* block);
+
+/**
+ * @brief Obtains the amount of free space left in the provided allocator. This
+ * is a maintained counter, so it is cheap to call.
+ *
+ * @param allocator A pointer to the allocator to be examined.
+ * @return The amount of free space in bytes.
+ */
+LAPI u64 tlsf_free_space(tlsf* allocator);
+
+/**
+ * @brief Obtains the number of distinct free blocks in the provided allocator. This
+ * is a maintained counter, so it is cheap to call.
+ *
+ * @param allocator A pointer to the allocator to be examined.
+ * @return The number of free blocks.
+ */
+LAPI u64 tlsf_free_block_count(tlsf* allocator);
+
+/**
+ * @brief Obtains the size of the largest free block in the provided allocator. Found
+ * via the bitmaps, so only the highest non-empty bin is examined.
+ *
+ * @param allocator A pointer to the allocator to be examined.
+ * @return The size of the largest free block in bytes.
+ */
+LAPI u64 tlsf_largest_free_block(tlsf* allocator);
+
+/**
+ * @brief Obtains the size of the free block at the physical end of the pool, which is the
+ * space tlsf_extend would add to.
+ *
+ * @param allocator A pointer to the allocator to be examined.
+ * @return The size of the trailing free block in bytes; 0 if the last block is in use.
+ */
+LAPI u64 tlsf_trailing_free_space(tlsf* allocator);
+
+/** @brief The alignment in bytes of every block handed out by the allocator. */
+#define TLSF_ALIGN_SIZE 16
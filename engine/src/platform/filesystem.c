@@ -6,7 +6,7 @@
 #include <stdio.h>
 #include <string.h>
 
-#include <sys\stat.h>
+#include <sys/stat.h>
 
 
 b8 filesystem_exists(const char* path)
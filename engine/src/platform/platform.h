@@ -18,8 +18,28 @@ void platform_system_shutdown(void* plat_state);
 b8 platform_pump_messages();
 
 
+/** @brief The alignment in bytes of blocks obtained from platform_allocate when aligned is requested. */
+#define PLATFORM_DEFAULT_ALIGNMENT 16
+
+// Blocks obtained with aligned set must be freed with aligned set.
 void* platform_allocate(u64 size, b8 aligned);
 void platform_free(void* block, b8 aligned);
+// Alignment must be a power of two. Blocks must be freed with platform_free_aligned.
+void* platform_allocate_aligned(u64 size, u64 alignment);
+void platform_free_aligned(void* block);
+// Reserves a range of address space without committing any memory to it. Reserved
+// pages are inaccessible until committed. Returns 0 on failure.
+LAPI void* platform_reserve_memory(u64 size);
+// Same as platform_reserve_memory, but the range is aligned to and advised for transparent huge
+// pages where the platform supports them (Linux), cutting TLB misses for large, randomly accessed
+// ranges. out_huge_pages is set to whether that worked; if not, the range is an ordinary reservation.
+// Huge pages can only back whole huge-page-sized runs of committed memory, so commit in large steps.
+LAPI void* platform_reserve_memory_huge(u64 size, b8* out_huge_pages);
+// Commits part of a reserved range, rounded out to whole pages. Newly committed pages read as zero.
+LAPI b8 platform_commit_memory(void* block, u64 size);
+// Releases a whole reservation, including any committed pages.
+LAPI void platform_release_memory(void* block, u64 size);
+LAPI u64 platform_get_page_size();
 void* platform_zero_memory(void* block, u64 size);
 void* platform_copy_memory(void* dest, const void* source, u64 size);
 void* platform_set_memory(void* dest, i32 value, u64 size);
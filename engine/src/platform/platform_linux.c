@@ -1,11 +1,13 @@
-#ifdef KPLATFROM_LINUX
-#pragma once 
-
 #include "platform/platform.h"
+
+#if LPLATFORM_LINUX
+
 #include "containers/darray.h"
 #include "core/logger.h"
 #include "core/input.h"
 #include "core/event.h"
+#include "core/lmutex.h"
+#include "core/lthread.h"
 #include <xcb/xcb.h>
 #include <X11/keysym.h>
 #include <X11/XKBlib.h>
@@ -22,16 +24,24 @@
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
+#include <pthread.h>
+#include <sched.h> // sched_yield
+#include <sys/mman.h> // mmap
+#include <unistd.h> // sysconf
+
+// The size of a transparent huge page on x86-64 (and arm64 with 4KiB pages).
+#define PLATFORM_HUGE_PAGE_SIZE (2 * 1024 * 1024)
 
 // for surface creation
 #define VK_USE_PLATFORM_XCB_KHR
 #include <vulkan/vulkan.h>
 #include "renderer/vulkan/vulkan_types.inl"
+#include "renderer/vulkan/vulkan_platform.h"
 
 typedef struct platform_state {
     Display* display;
-    xcb_connextion_t* connection;
-    xcb_window_t* window;
+    xcb_connection_t* connection;
+    xcb_window_t window;
     xcb_screen_t* screen;
     xcb_atom_t wm_protocols;
     xcb_atom_t wm_delete_win;
@@ -60,7 +70,7 @@ b8 platform_system_startup(
     state_ptr = state;
 
     // Connect to X
-    state_ptr->Display = XOpenDisplay(NULL);
+    state_ptr->display = XOpenDisplay(NULL);
 
     // Turn off key repeats. This 
     // is global across the OS, so
@@ -106,7 +116,7 @@ b8 platform_system_startup(
     u32 value_list[] = {state_ptr->screen->black_pixel, event_values};
 
     // Create the window
-    xcb_void_cookie_t cookie = xcb_create_window(
+    xcb_create_window(
         state_ptr->connection,
         XCB_COPY_FROM_PARENT,           // depth
         state_ptr->window,
@@ -144,12 +154,13 @@ b8 platform_system_startup(
     
     xcb_intern_atom_cookie_t wm_protocols_cookie = xcb_intern_atom(
         state_ptr->connection,
-        wm_delete_cookie,
-        NULL);
+        0,
+        strlen("WM_PROTOCOLS"),
+        "WM_PROTOCOLS");
 
     xcb_intern_atom_reply_t* wm_delete_reply = xcb_intern_atom_reply(
         state_ptr->connection,
-        wm_protocols_cookie,
+        wm_delete_cookie,
         NULL);
 
     xcb_intern_atom_reply_t* wm_protocols_reply = xcb_intern_atom_reply(
@@ -204,11 +215,7 @@ b8 platform_pump_messages()
         b8 quit_flagged = false;
 
         // Poll for events until null is returned.
-        while (event != 0) {
-            event = xcb_poll_for_event(state_ptr->connection);
-            if (event == 0) {
-                break;
-            }
+        while ((event = xcb_poll_for_event(state_ptr->connection)) != 0) {
 
             // Input events
             switch (event->response_type & ~0x80) {
@@ -296,14 +303,93 @@ b8 platform_pump_messages()
 
 void* platform_allocate(u64 size, b8 aligned)
 {
+    if (aligned) {
+        return platform_allocate_aligned(size, PLATFORM_DEFAULT_ALIGNMENT);
+    }
     return malloc(size);
 }
 
 void platform_free(void* block, b8 aligned)
 {
+    // NOTE: posix_memalign blocks are released with free() as well.
     free(block);
 }
 
+void* platform_allocate_aligned(u64 size, u64 alignment)
+{
+    // posix_memalign requires at least pointer alignment.
+    if (alignment < sizeof(void*)) {
+        alignment = sizeof(void*);
+    }
+
+    void* block = 0;
+    if (posix_memalign(&block, alignment, size) != 0) {
+        return 0;
+    }
+    return block;
+}
+
+void platform_free_aligned(void* block)
+{
+    free(block);
+}
+
+void* platform_reserve_memory(u64 size)
+{
+    // PROT_NONE keeps the range inaccessible (and uncharged) until committed.
+    void* block = mmap(0, size, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    return block == MAP_FAILED ? 0 : block;
+}
+
+void* platform_reserve_memory_huge(u64 size, b8* out_huge_pages)
+{
+    *out_huge_pages = false;
+
+    // Over-reserve so a huge page aligned range can be cut out, then give back the rest.
+    u64 page_size = platform_get_page_size();
+    size = (size + (page_size - 1)) & ~(page_size - 1);
+    u64 padded = size + PLATFORM_HUGE_PAGE_SIZE;
+    u8* raw = mmap(0, padded, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if (raw == MAP_FAILED) {
+        return 0;
+    }
+
+    u8* aligned = (u8*)(((u64)raw + (PLATFORM_HUGE_PAGE_SIZE - 1)) & ~(u64)(PLATFORM_HUGE_PAGE_SIZE - 1));
+    u64 head = aligned - raw;
+    u64 tail = padded - head - size;
+    if (head) {
+        munmap(raw, head);
+    }
+    if (tail) {
+        munmap(aligned + size, tail);
+    }
+
+#ifdef MADV_HUGEPAGE
+    // Fails when transparent huge pages are disabled outright. The range is still usable with regular pages.
+    *out_huge_pages = madvise(aligned, size, MADV_HUGEPAGE) == 0;
+#endif
+    return aligned;
+}
+
+b8 platform_commit_memory(void* block, u64 size)
+{
+    u64 page_size = platform_get_page_size();
+    u64 start = (u64)block & ~(page_size - 1);
+    u64 end = ((u64)block + size + (page_size - 1)) & ~(page_size - 1);
+    // Anonymous pages are zero-filled by the kernel on first touch.
+    return mprotect((void*)start, end - start, PROT_READ | PROT_WRITE) == 0;
+}
+
+void platform_release_memory(void* block, u64 size)
+{
+    munmap(block, size);
+}
+
+u64 platform_get_page_size()
+{
+    return (u64)sysconf(_SC_PAGESIZE);
+}
+
 void* platform_zero_memory(void* block, u64 size)
 {
     return memset(block, 0, size);
@@ -311,7 +397,7 @@ void* platform_zero_memory(void* block, u64 size)
 
 void* platform_copy_memory(void* dest, const void* source, u64 size)
 {
-    return memset(dest, source, size);
+    return memcpy(dest, source, size);
 }
 
 void* platform_set_memory(void* dest, i32 value, u64 size)
@@ -351,26 +437,192 @@ void platform_sleep(u64 ms)
     ts.tv_nsec = (ms % 1000) * 1e6;
     nanosleep(&ts, 0);
 #else
-    if (ms >- 1000) {
+    if (ms >= 1000) {
         sleep(ms / 1000);
     }
     usleep( (ms % 1000) * 1000);
 #endif
 }
 
+// Threads
+
+// Wraps the user's start function, which has a different signature to the platform's.
+typedef struct thread_start_info {
+    pfn_thread_start start_function;
+    void* params;
+} thread_start_info;
+
+static void* thread_start_trampoline(void* params)
+{
+    thread_start_info info = *(thread_start_info*)params;
+    platform_free(params, false);
+
+    u32 result = info.start_function(info.params);
+    return (void*)(u64)result;
+}
+
+b8 lthread_create(pfn_thread_start start_function, void* params, b8 auto_detach, lthread* out_thread)
+{
+    if (!start_function || !out_thread) {
+        return false;
+    }
+
+    thread_start_info* info = platform_allocate(sizeof(thread_start_info), false);
+    info->start_function = start_function;
+    info->params = params;
+
+    pthread_t handle;
+    i32 result = pthread_create(&handle, 0, thread_start_trampoline, info);
+    if (result != 0) {
+        LERROR("lthread_create failed to create thread. Error: %i", result);
+        platform_free(info, false);
+        return false;
+    }
+
+    out_thread->thread_id = (u64)handle;
+    if (auto_detach) {
+        pthread_detach(handle);
+        out_thread->internal_data = 0;
+        return true;
+    }
+
+    out_thread->internal_data = platform_allocate(sizeof(pthread_t), false);
+    *(pthread_t*)out_thread->internal_data = handle;
+    return true;
+}
+
+void lthread_destroy(lthread* thread)
+{
+    if (thread && thread->internal_data) {
+        platform_free(thread->internal_data, false);
+        thread->internal_data = 0;
+        thread->thread_id = 0;
+    }
+}
+
+void lthread_detach(lthread* thread)
+{
+    if (thread && thread->internal_data) {
+        pthread_detach(*(pthread_t*)thread->internal_data);
+        lthread_destroy(thread);
+    }
+}
+
+b8 lthread_wait(lthread* thread)
+{
+    if (!thread || !thread->internal_data) {
+        return false;
+    }
+
+    return pthread_join(*(pthread_t*)thread->internal_data, 0) == 0;
+}
+
+void lthread_yield()
+{
+    sched_yield();
+}
+
+u64 lthread_get_current_id()
+{
+    return (u64)pthread_self();
+}
+
+b8 lthread_exit_hook_create(pfn_thread_exit on_exit, lthread_exit_hook* out_hook)
+{
+    if (!on_exit || !out_hook) {
+        return false;
+    }
+
+    // Thread-specific data destructors run for any thread which exits with a non-null value.
+    pthread_key_t* key = platform_allocate(sizeof(pthread_key_t), false);
+    i32 result = pthread_key_create(key, on_exit);
+    if (result != 0) {
+        LERROR("lthread_exit_hook_create failed to create a thread key. Error: %i", result);
+        platform_free(key, false);
+        return false;
+    }
+
+    out_hook->internal_data = key;
+    return true;
+}
+
+void lthread_exit_hook_destroy(lthread_exit_hook* hook)
+{
+    if (hook && hook->internal_data) {
+        pthread_key_delete(*(pthread_key_t*)hook->internal_data);
+        platform_free(hook->internal_data, false);
+        hook->internal_data = 0;
+    }
+}
+
+b8 lthread_exit_hook_set(lthread_exit_hook* hook, void* value)
+{
+    if (!hook || !hook->internal_data) {
+        return false;
+    }
+
+    return pthread_setspecific(*(pthread_key_t*)hook->internal_data, value) == 0;
+}
+
+// Mutexes
+
+b8 lmutex_create(lmutex* out_mutex)
+{
+    if (!out_mutex) {
+        return false;
+    }
+
+    pthread_mutex_t* mutex = platform_allocate(sizeof(pthread_mutex_t), false);
+    if (pthread_mutex_init(mutex, 0) != 0) {
+        LERROR("lmutex_create failed to create mutex.");
+        platform_free(mutex, false);
+        return false;
+    }
+
+    out_mutex->internal_data = mutex;
+    return true;
+}
+
+void lmutex_destroy(lmutex* mutex)
+{
+    if (mutex && mutex->internal_data) {
+        pthread_mutex_destroy(mutex->internal_data);
+        platform_free(mutex->internal_data, false);
+        mutex->internal_data = 0;
+    }
+}
+
+b8 lmutex_lock(lmutex* mutex)
+{
+    if (!mutex || !mutex->internal_data) {
+        return false;
+    }
+
+    return pthread_mutex_lock(mutex->internal_data) == 0;
+}
+
+b8 lmutex_unlock(lmutex* mutex)
+{
+    if (!mutex || !mutex->internal_data) {
+        return false;
+    }
+
+    return pthread_mutex_unlock(mutex->internal_data) == 0;
+}
+
 void platform_get_required_extension_names(const char*** names_darray)
 {
     darray_push(*names_darray, &"VK_KHR_xcb_surface");
 }
 
 // Surface creation for Vulkan
-b8 platform_create_vulkan_surface(platform_state* plat_state, vulkan_context* context)
+b8 platform_create_vulkan_surface(vulkan_context* context)
 {
     if (!state_ptr) {
         return false;
     }
 
-    VkXcbSurfaceCreateInfoKHR create_info = {VK_STRUCTURE_TYPE_XCB_SURFACE_CREATE_INFO};
+    VkXcbSurfaceCreateInfoKHR create_info = {VK_STRUCTURE_TYPE_XCB_SURFACE_CREATE_INFO_KHR};
     create_info.connection = state_ptr->connection;
     create_info.window = state_ptr->window;
 
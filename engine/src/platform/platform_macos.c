@@ -7,6 +7,8 @@
 #include "core/input.h"
 #include "core/lstring.h"
 #include "core/logger.h"
+#include "core/lmutex.h"
+#include "core/lthread.h"
 #include "renderer/vulkan/vulkan_types.inl"  // For surface creation.
 
 // Include Vulkan before GLFW.
@@ -21,6 +23,10 @@
 #include <stdlib.h>
 #include <string.h>
 #include <time.h>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/mman.h>
+#include <unistd.h>
 
 typedef struct platform_state {
     GLFWwindow* glfw_window;
@@ -108,13 +114,63 @@ b8 platform_pump_messages() {
 }
 
 void* platform_allocate(u64 size, b8 aligned) {
+    if (aligned) {
+        return platform_allocate_aligned(size, PLATFORM_DEFAULT_ALIGNMENT);
+    }
     return malloc(size);
 }
 
 void platform_free(void* block, b8 aligned) {
+    // NOTE: posix_memalign blocks are released with free() as well.
+    free(block);
+}
+
+void* platform_allocate_aligned(u64 size, u64 alignment) {
+    // posix_memalign requires at least pointer alignment.
+    if (alignment < sizeof(void*)) {
+        alignment = sizeof(void*);
+    }
+
+    void* block = 0;
+    if (posix_memalign(&block, alignment, size) != 0) {
+        return 0;
+    }
+    return block;
+}
+
+void platform_free_aligned(void* block) {
     free(block);
 }
 
+void* platform_reserve_memory(u64 size) {
+    // PROT_NONE keeps the range inaccessible (and uncharged) until committed.
+    void* block = mmap(0, size, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    return block == MAP_FAILED ? 0 : block;
+}
+
+void* platform_reserve_memory_huge(u64 size, b8* out_huge_pages) {
+    // NOTE: macOS only offers superpages through explicit Mach allocations, which cannot be
+    // reserved and committed separately. Fall back to regular pages.
+    *out_huge_pages = false;
+    return platform_reserve_memory(size);
+}
+
+b8 platform_commit_memory(void* block, u64 size) {
+    u64 page_size = platform_get_page_size();
+    u64 start = (u64)block & ~(page_size - 1);
+    u64 end = ((u64)block + size + (page_size - 1)) & ~(page_size - 1);
+    // Anonymous pages are zero-filled by the kernel on first touch.
+    return mprotect((void*)start, end - start, PROT_READ | PROT_WRITE) == 0;
+}
+
+void platform_release_memory(void* block, u64 size) {
+    munmap(block, size);
+}
+
+u64 platform_get_page_size() {
+    return (u64)sysconf(_SC_PAGESIZE);
+}
+
 void* platform_zero_memory(void* block, u64 size) {
     return memset(block, 0, size);
 }
@@ -153,6 +209,158 @@ void platform_sleep(u64 ms) {
     nanosleep(&ts, 0);
 }
 
+// Threads
+
+// Wraps the user's start function, which has a different signature to the platform's.
+typedef struct thread_start_info {
+    pfn_thread_start start_function;
+    void* params;
+} thread_start_info;
+
+static void* thread_start_trampoline(void* params) {
+    thread_start_info info = *(thread_start_info*)params;
+    platform_free(params, false);
+
+    u32 result = info.start_function(info.params);
+    return (void*)(u64)result;
+}
+
+b8 lthread_create(pfn_thread_start start_function, void* params, b8 auto_detach, lthread* out_thread) {
+    if (!start_function || !out_thread) {
+        return false;
+    }
+
+    thread_start_info* info = platform_allocate(sizeof(thread_start_info), false);
+    info->start_function = start_function;
+    info->params = params;
+
+    pthread_t handle;
+    i32 result = pthread_create(&handle, 0, thread_start_trampoline, info);
+    if (result != 0) {
+        LERROR("lthread_create failed to create thread. Error: %i", result);
+        platform_free(info, false);
+        return false;
+    }
+
+    out_thread->thread_id = (u64)handle;
+    if (auto_detach) {
+        pthread_detach(handle);
+        out_thread->internal_data = 0;
+        return true;
+    }
+
+    out_thread->internal_data = platform_allocate(sizeof(pthread_t), false);
+    *(pthread_t*)out_thread->internal_data = handle;
+    return true;
+}
+
+void lthread_destroy(lthread* thread) {
+    if (thread && thread->internal_data) {
+        platform_free(thread->internal_data, false);
+        thread->internal_data = 0;
+        thread->thread_id = 0;
+    }
+}
+
+void lthread_detach(lthread* thread) {
+    if (thread && thread->internal_data) {
+        pthread_detach(*(pthread_t*)thread->internal_data);
+        lthread_destroy(thread);
+    }
+}
+
+b8 lthread_wait(lthread* thread) {
+    if (!thread || !thread->internal_data) {
+        return false;
+    }
+
+    return pthread_join(*(pthread_t*)thread->internal_data, 0) == 0;
+}
+
+void lthread_yield() {
+    sched_yield();
+}
+
+u64 lthread_get_current_id() {
+    return (u64)pthread_self();
+}
+
+b8 lthread_exit_hook_create(pfn_thread_exit on_exit, lthread_exit_hook* out_hook) {
+    if (!on_exit || !out_hook) {
+        return false;
+    }
+
+    // Thread-specific data destructors run for any thread which exits with a non-null value.
+    pthread_key_t* key = platform_allocate(sizeof(pthread_key_t), false);
+    i32 result = pthread_key_create(key, on_exit);
+    if (result != 0) {
+        LERROR("lthread_exit_hook_create failed to create a thread key. Error: %i", result);
+        platform_free(key, false);
+        return false;
+    }
+
+    out_hook->internal_data = key;
+    return true;
+}
+
+void lthread_exit_hook_destroy(lthread_exit_hook* hook) {
+    if (hook && hook->internal_data) {
+        pthread_key_delete(*(pthread_key_t*)hook->internal_data);
+        platform_free(hook->internal_data, false);
+        hook->internal_data = 0;
+    }
+}
+
+b8 lthread_exit_hook_set(lthread_exit_hook* hook, void* value) {
+    if (!hook || !hook->internal_data) {
+        return false;
+    }
+
+    return pthread_setspecific(*(pthread_key_t*)hook->internal_data, value) == 0;
+}
+
+// Mutexes
+
+b8 lmutex_create(lmutex* out_mutex) {
+    if (!out_mutex) {
+        return false;
+    }
+
+    pthread_mutex_t* mutex = platform_allocate(sizeof(pthread_mutex_t), false);
+    if (pthread_mutex_init(mutex, 0) != 0) {
+        LERROR("lmutex_create failed to create mutex.");
+        platform_free(mutex, false);
+        return false;
+    }
+
+    out_mutex->internal_data = mutex;
+    return true;
+}
+
+void lmutex_destroy(lmutex* mutex) {
+    if (mutex && mutex->internal_data) {
+        pthread_mutex_destroy(mutex->internal_data);
+        platform_free(mutex->internal_data, false);
+        mutex->internal_data = 0;
+    }
+}
+
+b8 lmutex_lock(lmutex* mutex) {
+    if (!mutex || !mutex->internal_data) {
+        return false;
+    }
+
+    return pthread_mutex_lock(mutex->internal_data) == 0;
+}
+
+b8 lmutex_unlock(lmutex* mutex) {
+    if (!mutex || !mutex->internal_data) {
+        return false;
+    }
+
+    return pthread_mutex_unlock(mutex->internal_data) == 0;
+}
+
 void platform_get_required_extension_names(const char*** names_darray) {
     u32 count = 0;
     const char** extensions = glfwGetRequiredInstanceExtensions(&count);
@@ -4,12 +4,15 @@
 #include "core/logger.h"
 #include "core/input.h"
 #include "core/event.h"
+#include "core/lmutex.h"
+#include "core/lthread.h"
 
 // Windows platform layer.
 #if LPLATFORM_WINDOWS
 
 
 #include <stdio.h>
+#include <malloc.h> // _aligned_malloc
 #include <windows.h>
 #include <windowsx.h> // param input extraction
 
@@ -166,14 +169,64 @@ b8 platform_pump_messages(platform_state* plat_state)
 
 void* platform_allocate(u64 size, b8 aligned)
 {
+    if (aligned) {
+        return platform_allocate_aligned(size, PLATFORM_DEFAULT_ALIGNMENT);
+    }
     return malloc(size);
 }
 
 void platform_free(void* block, b8 aligned)
 {
+    // Aligned blocks must go back through _aligned_free.
+    if (aligned) {
+        platform_free_aligned(block);
+        return;
+    }
     free(block);
 }
 
+void* platform_allocate_aligned(u64 size, u64 alignment)
+{
+    return _aligned_malloc(size, alignment);
+}
+
+void platform_free_aligned(void* block)
+{
+    _aligned_free(block);
+}
+
+void* platform_reserve_memory(u64 size)
+{
+    return VirtualAlloc(0, size, MEM_RESERVE, PAGE_NOACCESS);
+}
+
+void* platform_reserve_memory_huge(u64 size, b8* out_huge_pages)
+{
+    // NOTE: Large pages on Windows need the "Lock pages in memory" privilege and must be
+    // committed in full up front, which defeats lazy commit. Fall back to regular pages.
+    *out_huge_pages = false;
+    return platform_reserve_memory(size);
+}
+
+b8 platform_commit_memory(void* block, u64 size)
+{
+    // Committing rounds out to whole pages, and newly committed pages are zero.
+    return VirtualAlloc(block, size, MEM_COMMIT, PAGE_READWRITE) != 0;
+}
+
+void platform_release_memory(void* block, u64 size)
+{
+    // NOTE: Releasing a reservation requires a size of 0.
+    VirtualFree(block, 0, MEM_RELEASE);
+}
+
+u64 platform_get_page_size()
+{
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    return (u64)info.dwPageSize;
+}
+
 void* platform_zero_memory(void* block, u64 size)
 {
     return memset(block, 0, size);
@@ -231,6 +284,166 @@ void platform_sleep(u64 ms)
     Sleep(ms);
 }
 
+// Threads
+
+// Wraps the user's start function, which has a different signature to the platform's.
+typedef struct thread_start_info {
+    pfn_thread_start start_function;
+    void* params;
+} thread_start_info;
+
+static DWORD WINAPI thread_start_trampoline(LPVOID params)
+{
+    thread_start_info info = *(thread_start_info*)params;
+    platform_free(params, false);
+
+    u32 result = info.start_function(info.params);
+    return result;
+}
+
+b8 lthread_create(pfn_thread_start start_function, void* params, b8 auto_detach, lthread* out_thread)
+{
+    if (!start_function || !out_thread) {
+        return false;
+    }
+
+    thread_start_info* info = platform_allocate(sizeof(thread_start_info), false);
+    info->start_function = start_function;
+    info->params = params;
+
+    DWORD thread_id = 0;
+    HANDLE handle = CreateThread(0, 0, thread_start_trampoline, info, 0, &thread_id);
+    if (!handle) {
+        LERROR("lthread_create failed to create thread. Error: %u", GetLastError());
+        platform_free(info, false);
+        return false;
+    }
+
+    out_thread->thread_id = thread_id;
+    out_thread->internal_data = handle;
+    if (auto_detach) {
+        lthread_detach(out_thread);
+    }
+    return true;
+}
+
+void lthread_destroy(lthread* thread)
+{
+    if (thread && thread->internal_data) {
+        CloseHandle((HANDLE)thread->internal_data);
+        thread->internal_data = 0;
+        thread->thread_id = 0;
+    }
+}
+
+void lthread_detach(lthread* thread)
+{
+    // Closing the handle lets the thread clean up after itself once it finishes.
+    lthread_destroy(thread);
+}
+
+b8 lthread_wait(lthread* thread)
+{
+    if (!thread || !thread->internal_data) {
+        return false;
+    }
+
+    return WaitForSingleObject((HANDLE)thread->internal_data, INFINITE) == WAIT_OBJECT_0;
+}
+
+void lthread_yield()
+{
+    SwitchToThread();
+}
+
+u64 lthread_get_current_id()
+{
+    return (u64)GetCurrentThreadId();
+}
+
+b8 lthread_exit_hook_create(pfn_thread_exit on_exit, lthread_exit_hook* out_hook)
+{
+    if (!on_exit || !out_hook) {
+        return false;
+    }
+
+    // Unlike thread local storage callbacks, fiber local storage callbacks also run for
+    // threads which exit with a value set. NOTE: x64 has the one calling convention, so
+    // on_exit can be the callback as is.
+    DWORD index = FlsAlloc((PFLS_CALLBACK_FUNCTION)on_exit);
+    if (index == FLS_OUT_OF_INDEXES) {
+        LERROR("lthread_exit_hook_create failed to allocate a fiber local slot. Error: %u", GetLastError());
+        return false;
+    }
+
+    DWORD* slot = platform_allocate(sizeof(DWORD), false);
+    *slot = index;
+    out_hook->internal_data = slot;
+    return true;
+}
+
+void lthread_exit_hook_destroy(lthread_exit_hook* hook)
+{
+    if (hook && hook->internal_data) {
+        // NOTE: Calls the callback for every thread which still has a value set.
+        FlsFree(*(DWORD*)hook->internal_data);
+        platform_free(hook->internal_data, false);
+        hook->internal_data = 0;
+    }
+}
+
+b8 lthread_exit_hook_set(lthread_exit_hook* hook, void* value)
+{
+    if (!hook || !hook->internal_data) {
+        return false;
+    }
+
+    return FlsSetValue(*(DWORD*)hook->internal_data, value) != 0;
+}
+
+// Mutexes
+
+b8 lmutex_create(lmutex* out_mutex)
+{
+    if (!out_mutex) {
+        return false;
+    }
+
+    CRITICAL_SECTION* section = platform_allocate(sizeof(CRITICAL_SECTION), false);
+    InitializeCriticalSection(section);
+    out_mutex->internal_data = section;
+    return true;
+}
+
+void lmutex_destroy(lmutex* mutex)
+{
+    if (mutex && mutex->internal_data) {
+        DeleteCriticalSection(mutex->internal_data);
+        platform_free(mutex->internal_data, false);
+        mutex->internal_data = 0;
+    }
+}
+
+b8 lmutex_lock(lmutex* mutex)
+{
+    if (!mutex || !mutex->internal_data) {
+        return false;
+    }
+
+    EnterCriticalSection(mutex->internal_data);
+    return true;
+}
+
+b8 lmutex_unlock(lmutex* mutex)
+{
+    if (!mutex || !mutex->internal_data) {
+        return false;
+    }
+
+    LeaveCriticalSection(mutex->internal_data);
+    return true;
+}
+
 void platform_get_required_extension_names(const char*** names_darray)
 {
     darray_push(*names_darray, &"VK_KHR_win32_surface");
@@ -40,6 +40,7 @@ VKAPI_ATTR VkBool32 VKAPI_CALL vk_debug_callback(
 
 i32 find_memory_index(u32 type_filter, u32 property_flags);
 b8 create_buffers(vulkan_context* context);
+void relocate_geometry(void* user_data, vulkan_buffer* buffer, const buddy_allocator_move* moves, u32 move_count);
 
 void create_command_buffers(renderer_backend* backend);
 void regenerate_framebuffers();
@@ -271,7 +272,12 @@ b8 vulkan_renderer_backend_initialize(renderer_backend* backend, const char* app
 
     create_buffers(&context);
 
-    // Mark all geometries as invalid
+    // Create the geometry slot pool, and mark all geometries as invalid
+    u64 geometry_pool_requirement = 0;
+    pool_allocator_create(sizeof(vulkan_geometry_data), VULKAN_MAX_GEOMETRY_COUNT, &geometry_pool_requirement, 0, 0);
+    void* geometry_pool_block = lallocate(geometry_pool_requirement, MEMORY_TAG_RENDERER);
+    pool_allocator_create(sizeof(vulkan_geometry_data), VULKAN_MAX_GEOMETRY_COUNT, &geometry_pool_requirement, geometry_pool_block, &context.geometry_pool);
+    context.geometries = context.geometry_pool.elements;
     for (u32 i = 0; i < VULKAN_MAX_GEOMETRY_COUNT; ++i) {
         context.geometries[i].id = INVALID_ID;
     }
@@ -284,7 +290,16 @@ void vulkan_renderer_backend_shutdown(renderer_backend* backend) {
     vkDeviceWaitIdle(context.device.logical_device);
 
     // Destroy in the opposite order of creation.
+    // Geometry slots
+    u64 geometry_pool_requirement = 0;
+    pool_allocator_create(sizeof(vulkan_geometry_data), VULKAN_MAX_GEOMETRY_COUNT, &geometry_pool_requirement, 0, 0);
+    lfree(context.geometry_pool.elements, geometry_pool_requirement, MEMORY_TAG_RENDERER);
+    pool_allocator_destroy(&context.geometry_pool);
+    context.geometries = 0;
+
     // Destroy buffers
+    vulkan_buffer_report_usage(&context.object_vertex_buffer);
+    vulkan_buffer_report_usage(&context.object_index_buffer);
     vulkan_buffer_destroy(&context, &context.object_vertex_buffer);
     vulkan_buffer_destroy(&context, &context.object_index_buffer);
 
@@ -412,6 +427,11 @@ b8 vulkan_renderer_backend_begin_frame(renderer_backend* backend, f32 delta_time
         LFATAL("In-flight fence wait failure! error: %s", vulkan_result_string(result, true));
         return false;
     }
+    context.frame_number++;
+
+    // Nothing for this frame has been recorded yet, so geometry can be moved about before it is.
+    vulkan_buffer_compaction_step(&context, &context.object_vertex_buffer, device->graphics_queue, device->graphics_command_pool, context.frame_number, context.swapchain.max_frames_in_flight);
+    vulkan_buffer_compaction_step(&context, &context.object_index_buffer, device->graphics_queue, device->graphics_command_pool, context.frame_number, context.swapchain.max_frames_in_flight);
 
     // Acquire the next image from the swap chain. Pass along the semaphore that should signaled when this completes.
     // This same semaphore will later be waited on by the queue submission to ensure this image is available.
@@ -774,14 +794,23 @@ b8 recreate_swapchain(renderer_backend* backend) {
 b8 create_buffers(vulkan_context* context) {
     VkMemoryPropertyFlagBits memory_property_flags = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
 
+    // Geometry is uploaded and released constantly, so its ranges come from buddy allocators,
+    // which cannot fragment the way a freelist does. Aligned so ranges can also be bound as storage buffers.
+    u64 geometry_alignment = context->device.properties.limits.minStorageBufferOffsetAlignment;
+    if (geometry_alignment < 1) {
+        geometry_alignment = 1;
+    }
+
     // Geometry vertex buffer
     const u64 vertex_buffer_size = sizeof(vertex_3d) * 1024 * 1024;
-    if (!vulkan_buffer_create(
+    if (!vulkan_buffer_create_with_allocator(
             context,
             vertex_buffer_size,
             VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
             memory_property_flags,
             true,
+            VULKAN_BUFFER_ALLOCATOR_TYPE_BUDDY,
+            geometry_alignment,
             &context->object_vertex_buffer)) {
         LERROR("Error creating vertex buffer.");
         return false;
@@ -789,20 +818,50 @@ b8 create_buffers(vulkan_context* context) {
 
     // Geometry index buffer
     const u64 index_buffer_size = sizeof(u32) * 1024 * 1024;
-    if (!vulkan_buffer_create(
+    if (!vulkan_buffer_create_with_allocator(
             context,
             index_buffer_size,
             VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
             memory_property_flags,
             true,
+            VULKAN_BUFFER_ALLOCATOR_TYPE_BUDDY,
+            geometry_alignment,
             &context->object_index_buffer)) {
         LERROR("Error creating vertex buffer.");
         return false;
     }
 
+    // Streaming geometry in and out fragments the buffers over time, so they are compacted as they go.
+    vulkan_buffer_enable_compaction(&context->object_vertex_buffer, VULKAN_GEOMETRY_COMPACTION_THRESHOLD, VULKAN_GEOMETRY_COMPACTION_BYTES_PER_FRAME, relocate_geometry, context);
+    vulkan_buffer_enable_compaction(&context->object_index_buffer, VULKAN_GEOMETRY_COMPACTION_THRESHOLD, VULKAN_GEOMETRY_COMPACTION_BYTES_PER_FRAME, relocate_geometry, context);
+
     return true;
 }
 
+void relocate_geometry(void* user_data, vulkan_buffer* buffer, const buddy_allocator_move* moves, u32 move_count) {
+    vulkan_context* context = user_data;
+    b8 is_vertex_buffer = buffer == &context->object_vertex_buffer;
+
+    for (u32 i = 0; i < context->geometry_pool.capacity; ++i) {
+        if (!pool_allocator_is_allocated(&context->geometry_pool, i)) {
+            continue;
+        }
+
+        vulkan_geometry_data* data = &context->geometries[i];
+        if (!is_vertex_buffer && !data->index_count) {
+            continue;
+        }
+
+        u64* offset = is_vertex_buffer ? &data->vertex_buffer_offset : &data->index_buffer_offset;
+        for (u32 m = 0; m < move_count; ++m) {
+            if (*offset == moves[m].old_offset) {
+                *offset = moves[m].new_offset;
+                break;
+            }
+        }
+    }
+}
+
 void vulkan_renderer_create_texture(const u8* pixels, texture* texture) {
     // Internal data creation.
     // TODO: Use an allocator for this.
@@ -981,14 +1040,11 @@ b8 vulkan_renderer_create_geometry(geometry* geometry, u32 vertex_size, u32 vert
         old_range.vertex_count = internal_data->vertex_count;
         old_range.vertex_element_size = internal_data->vertex_element_size;
     } else {
-        for (u32 i = 0; i < VULKAN_MAX_GEOMETRY_COUNT; ++i) {
-            if (context.geometries[i].id == INVALID_ID) {
-                // Found a free index.
-                geometry->internal_id = i;
-                context.geometries[i].id = i;
-                internal_data = &context.geometries[i];
-                break;
-            }
+        u32 index = INVALID_ID;
+        internal_data = pool_allocator_allocate(&context.geometry_pool, &index);
+        if (internal_data) {
+            geometry->internal_id = index;
+            internal_data->id = index;
         }
     }
     if (!internal_data) {
@@ -1066,10 +1122,11 @@ void vulkan_renderer_destroy_geometry(geometry* geometry) {
             free_data_range(&context.object_index_buffer, internal_data->index_buffer_offset, internal_data->index_element_size * internal_data->index_count);
         }
 
-        // Clean up data.
+        // Clean up data, and hand the slot back.
         lzero_memory(internal_data, sizeof(vulkan_geometry_data));
         internal_data->id = INVALID_ID;
         internal_data->generation = INVALID_ID;
+        pool_allocator_free(&context.geometry_pool, geometry->internal_id);
     }
 }
 
@@ -7,13 +7,20 @@
 #include "core/logger.h"
 #include "core/lmemory.h"
 #include "containers/freelist.h"
+#include "containers/buddy_allocator.h"
+#include "containers/typed_containers.h"
 
+DEFINE_DARRAY(vulkan_buffer_retired_range)
 
-void cleanup_freelist(vulkan_buffer* buffer) {
-    freelist_destroy(&buffer->buffer_freelist);
-    lfree(buffer->freelist_block, buffer->freelist_memory_requirement, MEMORY_TAG_RENDERER);
-    buffer->freelist_memory_requirement = 0;
-    buffer->freelist_block = 0;
+void cleanup_allocator(vulkan_buffer* buffer) {
+    if (buffer->allocator_type == VULKAN_BUFFER_ALLOCATOR_TYPE_BUDDY) {
+        buddy_allocator_destroy(&buffer->buffer_buddy);
+    } else {
+        freelist_destroy(&buffer->buffer_freelist);
+    }
+    lfree(buffer->allocator_block, buffer->allocator_memory_requirement, MEMORY_TAG_RENDERER);
+    buffer->allocator_memory_requirement = 0;
+    buffer->allocator_block = 0;
 }
 
 b8 vulkan_buffer_create(
@@ -25,16 +32,49 @@ b8 vulkan_buffer_create(
     vulkan_buffer* out_buffer
 )
 {
+    return vulkan_buffer_create_with_allocator(context, size, usage, memory_property_flags, bind_on_create, VULKAN_BUFFER_ALLOCATOR_TYPE_FREELIST, 1, out_buffer);
+}
+
+b8 vulkan_buffer_create_with_allocator(
+    vulkan_context* context,
+    u64 size,
+    VkBufferUsageFlagBits usage,
+    u32 memory_property_flags,
+    b8 bind_on_create,
+    vulkan_buffer_allocator_type allocator_type,
+    u64 alignment,
+    vulkan_buffer* out_buffer
+)
+{
+    if (!alignment || (alignment & (alignment - 1))) {
+        LERROR("vulkan_buffer_create_with_allocator - alignment must be a power of two (got %llu).", alignment);
+        return false;
+    }
+
     lzero_memory(out_buffer, sizeof(vulkan_buffer));
     out_buffer->total_size = size;
     out_buffer->usage = usage;
     out_buffer->memory_property_flags = memory_property_flags;
-
-    // Create a new freelist.
-    out_buffer->freelist_memory_requirement = 0;
-    freelist_create(size, &out_buffer->freelist_memory_requirement, 0, 0);
-    out_buffer->freelist_block = lallocate(out_buffer->freelist_memory_requirement, MEMORY_TAG_RENDERER);
-    freelist_create(size, &out_buffer->freelist_memory_requirement, out_buffer->freelist_block, &out_buffer->buffer_freelist);
+    out_buffer->allocator_type = allocator_type;
+    out_buffer->alignment = alignment;
+
+    if (allocator_type == VULKAN_BUFFER_ALLOCATOR_TYPE_BUDDY) {
+        // Create a new buddy allocator. Every block is aligned to its own size, so a minimum
+        // block of at least the alignment keeps every offset aligned.
+        u64 min_block_size = alignment > VULKAN_BUFFER_BUDDY_MIN_BLOCK_SIZE ? alignment : VULKAN_BUFFER_BUDDY_MIN_BLOCK_SIZE;
+        if (!buddy_allocator_create(size, min_block_size, &out_buffer->allocator_memory_requirement, 0, 0)) {
+            LERROR("Unable to create vulkan buffer because its buddy allocator could not be created.");
+            return false;
+        }
+        out_buffer->allocator_block = lallocate(out_buffer->allocator_memory_requirement, MEMORY_TAG_RENDERER);
+        buddy_allocator_create(size, min_block_size, &out_buffer->allocator_memory_requirement, out_buffer->allocator_block, &out_buffer->buffer_buddy);
+    } else {
+        // Create a new freelist.
+        out_buffer->allocator_memory_requirement = 0;
+        freelist_create(size, &out_buffer->allocator_memory_requirement, 0, 0);
+        out_buffer->allocator_block = lallocate(out_buffer->allocator_memory_requirement, MEMORY_TAG_RENDERER);
+        freelist_create(size, &out_buffer->allocator_memory_requirement, out_buffer->allocator_block, &out_buffer->buffer_freelist);
+    }
 
     VkBufferCreateInfo buffer_info = {VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO};
     buffer_info.size = size;
@@ -65,8 +105,8 @@ b8 vulkan_buffer_create(
     if (out_buffer->memory_index == -1) {
         LERROR("Unable to create vulkan buffer because the required memory type index was not found.");
 
-        // Make sure to clean up the freelist.
-        cleanup_freelist(out_buffer);
+        // Make sure to clean up the allocator.
+        cleanup_allocator(out_buffer);
         return false;
     }
 
@@ -86,8 +126,8 @@ b8 vulkan_buffer_create(
     if (result != VK_SUCCESS) {
         LERROR("Unable to create vulkan buffer because the required memory allocation failed. Error: &i", result);
 
-        // Make sure to clean up the freelist.
-        cleanup_freelist(out_buffer);
+        // Make sure to clean up the allocator.
+        cleanup_allocator(out_buffer);
         return false;
     } 
 
@@ -103,9 +143,14 @@ void vulkan_buffer_destroy(
     vulkan_buffer* buffer
 )
 {
-    if(buffer->freelist_block) {
-        // Make sure to clean up the freelist.
-        cleanup_freelist(buffer);
+    if(buffer->allocator_block) {
+        // Make sure to clean up the allocator.
+        cleanup_allocator(buffer);
+    }
+
+    if (buffer->retired_ranges) {
+        darray_destroy(buffer->retired_ranges);
+        buffer->retired_ranges = 0;
     }
 
     if (buffer->memory) {
@@ -169,7 +214,21 @@ b8 vulkan_buffer_allocate(
         return false;
     }
 
-    return freelist_allocate_block(&buffer->buffer_freelist, size, out_offset);
+    b8 result = false;
+    if (buffer->allocator_type == VULKAN_BUFFER_ALLOCATOR_TYPE_BUDDY) {
+        result = buddy_allocator_allocate(&buffer->buffer_buddy, size, buffer->alignment, out_offset);
+    } else if (buffer->alignment > 1) {
+        result = freelist_allocate_block_aligned(&buffer->buffer_freelist, size, buffer->alignment, out_offset);
+    } else {
+        // Best fit keeps small geometry uploads from carving up the larger free ranges.
+        result = freelist_allocate_block_best(&buffer->buffer_freelist, size, out_offset);
+    }
+
+    if (!result) {
+        LERROR("vulkan_buffer_allocate failed to allocate %lluB.", size);
+        vulkan_buffer_report_usage(buffer);
+    }
+    return result;
 }
 
 b8 vulkan_buffer_free(
@@ -178,14 +237,168 @@ b8 vulkan_buffer_free(
     u64 offset
 )
 {
-    if(!buffer || !size || !offset) {
-        LERROR("vulkan_buffer_allocate requires a vaild buffer, a nonzero size, and a nonzero buffer offset.");
+    // NOTE: An offset of 0 is valid, as it is the first range handed out.
+    if(!buffer || !size) {
+        LERROR("vulkan_buffer_free requires a vaild buffer and a nonzero size.");
         return false;
     }
 
+    buffer->free_generation++;
+    if (buffer->allocator_type == VULKAN_BUFFER_ALLOCATOR_TYPE_BUDDY) {
+        return buddy_allocator_free(&buffer->buffer_buddy, size, offset);
+    }
     return freelist_free_block(&buffer->buffer_freelist, size, offset);
 }
 
+f32 vulkan_buffer_fragmentation(vulkan_buffer* buffer)
+{
+    if (!buffer || !buffer->allocator_block) {
+        return 0.0f;
+    }
+
+    if (buffer->allocator_type == VULKAN_BUFFER_ALLOCATOR_TYPE_BUDDY) {
+        buddy_allocator_stats stats = {0};
+        buddy_allocator_get_stats(&buffer->buffer_buddy, &stats);
+        return stats.fragmentation;
+    }
+
+    freelist_stats stats = {0};
+    freelist_get_stats(&buffer->buffer_freelist, &stats);
+    return stats.fragmentation;
+}
+
+b8 vulkan_buffer_enable_compaction(
+    vulkan_buffer* buffer,
+    f32 fragmentation_threshold,
+    u64 bytes_per_frame,
+    PFN_vulkan_buffer_relocate relocate,
+    void* user_data
+)
+{
+    if (!buffer || !relocate || !bytes_per_frame) {
+        LERROR("vulkan_buffer_enable_compaction requires a valid buffer, relocate callback and a nonzero bytes_per_frame.");
+        return false;
+    }
+
+    // Freelist ranges cannot be moved without knowing where each allocation begins and ends.
+    if (buffer->allocator_type != VULKAN_BUFFER_ALLOCATOR_TYPE_BUDDY) {
+        LERROR("vulkan_buffer_enable_compaction is only supported for buddy allocated buffers.");
+        return false;
+    }
+
+    buffer->compaction_threshold = fragmentation_threshold;
+    buffer->compaction_bytes_per_frame = bytes_per_frame;
+    buffer->relocate = relocate;
+    buffer->relocate_user_data = user_data;
+    buffer->compaction_cursor = 0;
+    buffer->compaction_generation = buffer->free_generation;
+    if (!buffer->retired_ranges) {
+        buffer->retired_ranges = darray_vulkan_buffer_retired_range_create();
+    }
+    return true;
+}
+
+b8 vulkan_buffer_compaction_step(
+    vulkan_context* context,
+    vulkan_buffer* buffer,
+    VkQueue queue,
+    VkCommandPool pool,
+    u64 frame_number,
+    u32 frames_in_flight
+)
+{
+    if (!buffer || !buffer->relocate) {
+        return false;
+    }
+
+    // Free the ranges moved out of which no frame in flight can still be reading.
+    u64 retired_count = darray_length(buffer->retired_ranges);
+    u64 kept = 0;
+    for (u64 i = 0; i < retired_count; ++i) {
+        vulkan_buffer_retired_range* range = &buffer->retired_ranges[i];
+        if (range->free_frame <= frame_number) {
+            buddy_allocator_free(&buffer->buffer_buddy, range->size, range->offset);
+        } else {
+            buffer->retired_ranges[kept++] = *range;
+        }
+    }
+    darray_length_set(buffer->retired_ranges, kept);
+
+    if (!buffer->compaction_cursor) {
+        // Only start a pass if something has been freed since the last one, or it would find the same nothing.
+        if (buffer->compaction_threshold <= 0.0f || buffer->compaction_generation == buffer->free_generation) {
+            return true;
+        }
+        f32 fragmentation = vulkan_buffer_fragmentation(buffer);
+        if (fragmentation <= buffer->compaction_threshold) {
+            return true;
+        }
+
+        LDEBUG("vulkan_buffer_compaction_step - fragmentation at %.2f%%, starting compaction.", fragmentation * 100.0f);
+        buffer->compaction_cursor = buffer->total_size;
+        buffer->compaction_generation = buffer->free_generation;
+    }
+
+    buddy_allocator_move moves[VULKAN_BUFFER_MAX_COMPACTION_MOVES];
+    u32 move_count = buddy_allocator_compact_step(
+        &buffer->buffer_buddy,
+        &buffer->compaction_cursor,
+        buffer->compaction_bytes_per_frame,
+        moves,
+        VULKAN_BUFFER_MAX_COMPACTION_MOVES);
+
+    if (move_count) {
+        // Copy every moved range in one submission. The old and new ranges are all allocated, so never overlap.
+        VkBufferCopy regions[VULKAN_BUFFER_MAX_COMPACTION_MOVES];
+        for (u32 i = 0; i < move_count; ++i) {
+            regions[i].srcOffset = moves[i].old_offset;
+            regions[i].dstOffset = moves[i].new_offset;
+            regions[i].size = moves[i].size;
+        }
+
+        vulkan_command_buffer temp_command_buffer;
+        vulkan_command_buffer_allocate_and_begin_single_use(context, pool, &temp_command_buffer);
+        vkCmdCopyBuffer(temp_command_buffer.handle, buffer->handle, buffer->handle, move_count, regions);
+        vulkan_command_buffer_end_single_use(context, pool, &temp_command_buffer, queue);
+
+        // The copies are complete, so switch everything over to the new ranges at once.
+        buffer->relocate(buffer->relocate_user_data, buffer, moves, move_count);
+
+        // Frames still in flight may be reading the old ranges, so they are freed later.
+        for (u32 i = 0; i < move_count; ++i) {
+            vulkan_buffer_retired_range range;
+            range.offset = moves[i].old_offset;
+            range.size = moves[i].size;
+            range.free_frame = frame_number + frames_in_flight;
+            buffer->retired_ranges = darray_vulkan_buffer_retired_range_push(buffer->retired_ranges, range);
+        }
+    }
+
+    if (!buffer->compaction_cursor) {
+        LDEBUG("vulkan_buffer_compaction_step - compaction pass complete.");
+    }
+    return true;
+}
+
+void vulkan_buffer_report_usage(vulkan_buffer* buffer)
+{
+    if (!buffer || !buffer->allocator_block) {
+        return;
+    }
+
+    if (buffer->allocator_type == VULKAN_BUFFER_ALLOCATOR_TYPE_BUDDY) {
+        buddy_allocator_stats stats = {0};
+        buddy_allocator_get_stats(&buffer->buffer_buddy, &stats);
+        LINFO("vulkan_buffer (buddy): Free: %lluB, largest free block: %lluB, allocations: %llu, requested: %lluB, internal waste: %lluB (%.2f%%)",
+            stats.total_free, stats.largest_free_block, stats.allocation_count, stats.requested_bytes, stats.internal_waste, stats.waste_ratio * 100.0f);
+    } else {
+        freelist_stats stats = {0};
+        freelist_get_stats(&buffer->buffer_freelist, &stats);
+        LINFO("vulkan_buffer (freelist): Free: %lluB, largest free range: %lluB, free ranges: %llu, fragmentation: %.2f%%",
+            stats.total_free, stats.largest_free_block, stats.free_range_count, stats.fragmentation * 100.0f);
+    }
+}
+
 
 
 
@@ -272,21 +485,32 @@ b8 vulkan_buffer_resize(
         return false;
     }
 
-    // Resize the freelist first.
+    // Resize the allocator first.
     u64 new_memory_requirement = 0;
-    freelist_resize(&buffer->buffer_freelist, &new_memory_requirement, 0, 0, 0);
-    void* new_block = lallocate(new_memory_requirement, MEMORY_TAG_RENDERER);
+    void* new_block = 0;
     void* old_block = 0;
-    if(!freelist_resize(&buffer->buffer_freelist, &new_memory_requirement, new_block, new_size, &old_block)) {
-        LERROR("vulkan_buffer_resize failed to resize internal free list.");
-        lfree(new_block, new_memory_requirement, MEMORY_TAG_RENDERER);
-        return false;
+    if (buffer->allocator_type == VULKAN_BUFFER_ALLOCATOR_TYPE_BUDDY) {
+        buddy_allocator_resize(&buffer->buffer_buddy, &new_memory_requirement, 0, new_size, 0);
+        new_block = lallocate(new_memory_requirement, MEMORY_TAG_RENDERER);
+        if (!buddy_allocator_resize(&buffer->buffer_buddy, &new_memory_requirement, new_block, new_size, &old_block)) {
+            LERROR("vulkan_buffer_resize failed to resize internal buddy allocator.");
+            lfree(new_block, new_memory_requirement, MEMORY_TAG_RENDERER);
+            return false;
+        }
+    } else {
+        freelist_resize(&buffer->buffer_freelist, &new_memory_requirement, 0, 0, 0);
+        new_block = lallocate(new_memory_requirement, MEMORY_TAG_RENDERER);
+        if(!freelist_resize(&buffer->buffer_freelist, &new_memory_requirement, new_block, new_size, &old_block)) {
+            LERROR("vulkan_buffer_resize failed to resize internal free list.");
+            lfree(new_block, new_memory_requirement, MEMORY_TAG_RENDERER);
+            return false;
+        }
     }
     
     // Clean up the old memory, then assign the new properties over.
-    lfree(old_block, buffer->freelist_memory_requirement, MEMORY_TAG_RENDERER);
-    buffer->freelist_memory_requirement = new_memory_requirement;
-    buffer->freelist_block= new_block;
+    lfree(old_block, buffer->allocator_memory_requirement, MEMORY_TAG_RENDERER);
+    buffer->allocator_memory_requirement = new_memory_requirement;
+    buffer->allocator_block= new_block;
     buffer->total_size = new_size;
 
     // Create new buffer
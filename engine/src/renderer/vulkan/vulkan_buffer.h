@@ -11,6 +11,31 @@ b8 vulkan_buffer_create(
     vulkan_buffer* out_buffer
 );
 
+/**
+ * @brief Creates a buffer whose ranges are handed out by the given allocator type.
+ * vulkan_buffer_create is the same as passing VULKAN_BUFFER_ALLOCATOR_TYPE_FREELIST and an alignment of 1.
+ * 
+ * @param context A pointer to the Vulkan context.
+ * @param size The size of the buffer in bytes.
+ * @param usage The usage flags of the buffer.
+ * @param memory_property_flags The property flags of the buffer's memory.
+ * @param bind_on_create Indicates if the buffer's memory should be bound once created.
+ * @param allocator_type The strategy used to hand out ranges of the buffer.
+ * @param alignment The alignment of every offset handed out (ie. minStorageBufferOffsetAlignment). Must be a power of two.
+ * @param out_buffer A pointer to hold the created buffer.
+ * @return True if successful; false otherwise.
+ */
+b8 vulkan_buffer_create_with_allocator(
+    vulkan_context* context,
+    u64 size,
+    VkBufferUsageFlagBits usage,
+    u32 memory_property_flags,
+    b8 bind_on_create,
+    vulkan_buffer_allocator_type allocator_type,
+    u64 alignment,
+    vulkan_buffer* out_buffer
+);
+
 void vulkan_buffer_destroy(
     vulkan_context* context,
     vulkan_buffer* buffer
@@ -58,6 +83,65 @@ b8 vulkan_buffer_free(
     u64 offset
 );
 
+/**
+ * @brief Logs how the buffer's space is being used: free space, the largest free range and,
+ * for buddy allocated buffers, the internal waste from rounding allocations up to their block size.
+ * 
+ * @param buffer A pointer to the buffer to report on.
+ */
+void vulkan_buffer_report_usage(vulkan_buffer* buffer);
+
+/**
+ * @brief Obtains the share of the buffer's free space which cannot be used for a single allocation.
+ * 
+ * @param buffer A pointer to the buffer.
+ * @return The fragmentation, from 0 (none) to 1.
+ */
+f32 vulkan_buffer_fragmentation(vulkan_buffer* buffer);
+
+/**
+ * @brief Enables incremental compaction of a buddy allocated buffer. Once the buffer's fragmentation passes
+ * the threshold, vulkan_buffer_compaction_step moves live ranges into lower free space a few at a time,
+ * copying them on the GPU, so that free space gathers into large ranges again.
+ * 
+ * @param buffer A pointer to the buffer. Must have been created with VULKAN_BUFFER_ALLOCATOR_TYPE_BUDDY.
+ * @param fragmentation_threshold The fragmentation (0-1) above which a compaction pass is started.
+ * @param bytes_per_frame The most bytes to move each step.
+ * @param relocate Called with each step's moves, to update whatever refers to the old offsets. Required.
+ * @param user_data Passed to relocate.
+ * @return True on success; otherwise false.
+ */
+b8 vulkan_buffer_enable_compaction(
+    vulkan_buffer* buffer,
+    f32 fragmentation_threshold,
+    u64 bytes_per_frame,
+    PFN_vulkan_buffer_relocate relocate,
+    void* user_data
+);
+
+/**
+ * @brief Performs one step of compaction, if enabled. Should be called at a frame boundary, before any commands
+ * referring to the buffer are recorded. Moved ranges are copied and waited on, then the relocate callback is
+ * invoked, so all offsets change together. Ranges moved out of are only freed once the frames in flight which
+ * could still read them have finished.
+ * 
+ * @param context A pointer to the Vulkan context.
+ * @param buffer A pointer to the buffer.
+ * @param queue The queue to perform the copies on.
+ * @param pool The command pool to allocate the copy command buffer from.
+ * @param frame_number The number of the frame about to begin.
+ * @param frames_in_flight The number of frames which may be in flight at once.
+ * @return True on success; otherwise false.
+ */
+b8 vulkan_buffer_compaction_step(
+    vulkan_context* context,
+    vulkan_buffer* buffer,
+    VkQueue queue,
+    VkCommandPool pool,
+    u64 frame_number,
+    u32 frames_in_flight
+);
+
 void vulkan_buffer_load_data(
     vulkan_context* context,
     vulkan_buffer* buffer,
@@ -5,6 +5,8 @@
 #include "core/asserts.h"
 #include "renderer/renderer_types.inl"
 #include "containers/freelist.h"
+#include "containers/buddy_allocator.h"
+#include "memory/pool_allocator.h"
 
 #include <vulkan/vulkan.h>
 
@@ -29,6 +31,17 @@
 // TODO: Make this configurable
 #define VULKAN_MAX_GEOMETRY_COUNT 4096
 
+// Fragmentation (0-1) of a geometry buffer above which it is compacted
+// TODO: Make this configurable
+#define VULKAN_GEOMETRY_COMPACTION_THRESHOLD 0.5f
+
+// Most bytes of geometry moved by compaction each frame
+// TODO: Make this configurable
+#define VULKAN_GEOMETRY_COMPACTION_BYTES_PER_FRAME (4 * 1024 * 1024)
+
+// Most ranges moved by a single compaction step
+#define VULKAN_BUFFER_MAX_COMPACTION_MOVES 64
+
 // Checks the given expresion's return type value agains VK_SUCCESS
 #define VK_CHECK(expr)              \
     {                               \
@@ -76,6 +89,40 @@ typedef struct vulkan_pipeline {
     VkPipelineLayout pipeline_layout;
 } vulkan_pipeline;
 
+/** @brief The strategy used to hand out ranges of a vulkan_buffer. */
+typedef enum vulkan_buffer_allocator_type {
+    /** @brief A best fit freelist. No internal waste, but fragments under churn. */
+    VULKAN_BUFFER_ALLOCATOR_TYPE_FREELIST,
+    /** @brief A buddy allocator. Power-of-two size classes and O(log n) operations; wastes up to half a block per range. */
+    VULKAN_BUFFER_ALLOCATOR_TYPE_BUDDY
+} vulkan_buffer_allocator_type;
+
+/** @brief The smallest block handed out by buddy allocated buffers. Raised to the buffer's alignment where that is larger. */
+#define VULKAN_BUFFER_BUDDY_MIN_BLOCK_SIZE 256
+
+struct vulkan_buffer;
+
+/**
+ * @brief Called by vulkan_buffer_compaction_step once ranges of a buffer have been moved, and their
+ * contents copied, so that anything referring to the old offsets can be updated.
+ * 
+ * @param user_data The user data passed to vulkan_buffer_enable_compaction.
+ * @param buffer A pointer to the buffer the ranges were moved within.
+ * @param moves An array of the moves made.
+ * @param move_count The number of moves made.
+ */
+typedef void (*PFN_vulkan_buffer_relocate)(void* user_data, struct vulkan_buffer* buffer, const buddy_allocator_move* moves, u32 move_count);
+
+/** @brief A range moved out of by compaction. Freed once no frame in flight can still be reading it. */
+typedef struct vulkan_buffer_retired_range {
+    /** @brief The offset of the range. */
+    u64 offset;
+    /** @brief The size of the range. */
+    u64 size;
+    /** @brief The frame number from which the range may be freed. */
+    u64 free_frame;
+} vulkan_buffer_retired_range;
+
 /** 
  * @brief Represents a Vulkan-specific buffer.
  * Used to load data onto the GPU. 
@@ -96,12 +143,34 @@ typedef struct vulkan_buffer {
     i32 memory_index;
     /** @brief The property flags for the memory used by the buffer.*/
     u32 memory_property_flags;
-    /** @brief The amount of memory required for the freelist.*/
-    u64 freelist_memory_requirement;
-    /** @brief The memory block used by the internal freelist.*/
-    void* freelist_block;
-    /** @brief A freelist used to track allocations.*/
+    /** @brief The strategy used to track allocations.*/
+    vulkan_buffer_allocator_type allocator_type;
+    /** @brief The alignment of every offset handed out by vulkan_buffer_allocate.*/
+    u64 alignment;
+    /** @brief The amount of memory required for the internal freelist or buddy allocator.*/
+    u64 allocator_memory_requirement;
+    /** @brief The memory block used by the internal freelist or buddy allocator.*/
+    void* allocator_block;
+    /** @brief A freelist used to track allocations. Only used with VULKAN_BUFFER_ALLOCATOR_TYPE_FREELIST.*/
     freelist buffer_freelist;
+    /** @brief A buddy allocator used to track allocations. Only used with VULKAN_BUFFER_ALLOCATOR_TYPE_BUDDY.*/
+    buddy_allocator buffer_buddy;
+    /** @brief The fragmentation (0-1) above which a compaction pass is started. 0 if compaction is disabled.*/
+    f32 compaction_threshold;
+    /** @brief The most bytes moved by each compaction step.*/
+    u64 compaction_bytes_per_frame;
+    /** @brief Called with the moves made by each compaction step.*/
+    PFN_vulkan_buffer_relocate relocate;
+    /** @brief Passed to relocate.*/
+    void* relocate_user_data;
+    /** @brief The offset the running compaction pass continues from; 0 if no pass is running.*/
+    u64 compaction_cursor;
+    /** @brief Incremented whenever a range is freed.*/
+    u64 free_generation;
+    /** @brief The free_generation when the last compaction pass started. A pass is not repeated until something else is freed.*/
+    u64 compaction_generation;
+    /** @brief darray of ranges moved out of by compaction, waiting to be freed.*/
+    vulkan_buffer_retired_range* retired_ranges;
 }vulkan_buffer;
 
 
@@ -373,6 +442,9 @@ typedef struct vulkan_context {
     u32 image_index;
     u32 current_frame;
 
+    // The number of frames begun so far. Used to tell when the frames in flight are done with something.
+    u64 frame_number;
+
     b8 recreating_swapchain;
 
     vulkan_material_shader material_shader;
@@ -383,8 +455,9 @@ typedef struct vulkan_context {
     // Framebuffers used for world rendering, one per frame.
     VkFramebuffer world_framebuffers[3];
 
-    // TODO: Make dynamic
-    vulkan_geometry_data geometries[VULKAN_MAX_GEOMETRY_COUNT];
+    // Geometry slots, handed out by the pool. Indexed by a geometry's internal_id.
+    pool_allocator geometry_pool;
+    vulkan_geometry_data* geometries;
 
 } vulkan_context;
 
@@ -6,6 +6,7 @@
 #include "resources/resource_types.h"
 #include "systems/resource_system.h"
 #include "math/lmath.h"
+#include "memory/linear_allocator.h"
 
 #include "platform/filesystem.h"
 #include "loader_utils.h"
@@ -38,12 +39,18 @@ b8 material_loader_load(struct resource_loader* self, const char* name, resource
     resource_data->diffuse_map_name[0] = 0;
     string_ncopy(resource_data->name, name, MAX_MATERIAL_NAME_LENGTH);
 
+    // Temporary parsing memory comes from the resource system's scratch allocator, and
+    // is all handed back when the scope ends.
+    linear_allocator* scratch = resource_system_scratch_allocator();
+    linear_allocator_scope load_scope = linear_allocator_scope_begin(scratch);
+
     // Read each line of the file.
-    char line_buf[512] = "";
-    char* p = &line_buf[0];
+    const u64 line_buf_size = 512;
+    char* line_buf = linear_allocator_allocate(scratch, sizeof(char) * line_buf_size);
+    char* p = line_buf;
     u64 line_length = 0;
     u32 line_number = 1;
-    while (filesystem_read_line(&f, 511, &p, &line_length)) {
+    while (filesystem_read_line(&f, line_buf_size - 1, &p, &line_length)) {
         // Trim the string.
         char* trimmed = string_trim(line_buf);
 
@@ -64,15 +71,14 @@ b8 material_loader_load(struct resource_loader* self, const char* name, resource
             continue;
         }
 
-        // Assume a max of 64 characters for the variable name.
-        char raw_var_name[64];
-        lzero_memory(raw_var_name, sizeof(char) * 64);
+        // The var/value copies only live for this line.
+        linear_allocator_scope line_scope = linear_allocator_scope_begin(scratch);
+
+        char* raw_var_name = linear_allocator_allocate(scratch, sizeof(char) * (equal_index + 1));
         string_mid(raw_var_name, trimmed, 0, equal_index);
         char* trimmed_var_name = string_trim(raw_var_name);
 
-        // Assume a max of 511-65 (446) for the max length of the value to account for the variable name and the '='.
-        char raw_value[446];
-        lzero_memory(raw_value, sizeof(char) * 446);
+        char* raw_value = linear_allocator_allocate(scratch, sizeof(char) * (line_length - equal_index));
         string_mid(raw_value, trimmed, equal_index + 1, -1);  // Read the rest of the line
         char* trimmed_value = string_trim(raw_value);
 
@@ -102,11 +108,14 @@ b8 material_loader_load(struct resource_loader* self, const char* name, resource
 
         // TODO: more fields.
 
+        linear_allocator_scope_end(&line_scope);
+
         // Clear the line buffer.
-        lzero_memory(line_buf, sizeof(char) * 512);
+        lzero_memory(line_buf, sizeof(char) * line_buf_size);
         line_number++;
     }
 
+    linear_allocator_scope_end(&load_scope);
     filesystem_close(&f);
 
     out_resource->data = resource_data;
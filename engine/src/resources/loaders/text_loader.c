@@ -37,7 +37,7 @@ b8 text_loader_load(struct resource_loader* self, const char* name, resource* ou
     }
 
     // TODO: Should be using an allocator here.
-    char* resource_data = lallocate(sizeof(char) * file_size, MEMORY_TAG_ARRAY);
+    char* resource_data = lallocate_uninit(sizeof(char) * file_size, MEMORY_TAG_ARRAY);
     u64 read_size = 0;
     if (!filesystem_read_all_text(&f, resource_data, &read_size)) {
         LERROR("Unable to text read file: %s.", full_file_path);
@@ -45,6 +45,11 @@ b8 text_loader_load(struct resource_loader* self, const char* name, resource* ou
         return false;
     }
 
+    // Text mode reads can come up short (line ending conversion), so only the tail needs clearing.
+    if (read_size < file_size) {
+        lzero_memory(resource_data + read_size, file_size - read_size);
+    }
+
     filesystem_close(&f);
 
     out_resource->data = resource_data;
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "math/math_types.h"
+#include "core/string_id.h"
 #define MAX_TEXTURE_NAME_LENGTH 512
 #define MAX_MATERIAL_NAME_LENGTH 512
 #define MAX_GEOMETRY_NAME_LENGTH 256
@@ -37,7 +38,7 @@ typedef struct texture {
     u8 channel_count;
     b8 has_transparency;
     u32 generation;
-    char name[MAX_TEXTURE_NAME_LENGTH];
+    string_id name;
     void* internal_data;
 } texture;
 
@@ -69,7 +70,7 @@ typedef struct material {
     u32 generation;
     u32 internal_id;
     material_type type;
-    char name[MAX_MATERIAL_NAME_LENGTH];
+    string_id name;
     vec4 diffuse_color;
     texture_map diffuse_map;
 } material;
@@ -82,6 +83,6 @@ typedef struct geometry {
     u32 id;
     u32 internal_id;
     u32 generation;
-    char name[MAX_GEOMETRY_NAME_LENGTH];
+    string_id name;
     material* material;
 } geometry;
\ No newline at end of file
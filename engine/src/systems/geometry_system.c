@@ -3,6 +3,7 @@
 #include "core/logger.h"
 #include "core/lmemory.h"
 #include "core/lstring.h"
+#include "memory/pool_allocator.h"
 #include "systems/material_system.h"
 #include "renderer/renderer_frontend.h"
 
@@ -18,8 +19,9 @@ typedef struct geometry_system_state {
     geometry default_geometry;
     geometry default_2d_geometry;
 
-    // Array of registered meshes.
+    // Array of registered meshes, with slots handed out by the pool.
     geometry_reference* registered_geometries;
+    pool_allocator geometry_pool;
 } geometry_system_state;
 
 static geometry_system_state* state_ptr = 0;
@@ -34,9 +36,10 @@ b8 geometry_system_initialize(u64* memory_requirement, void* state, geometry_sys
         return false;
     }
 
-    // Block of memory will contain state structure, then block for array, then block for hashtable.
+    // Block of memory will contain state structure, then block for pool (array).
     u64 struct_requirement = sizeof(geometry_system_state);
-    u64 array_requirement = sizeof(geometry_reference) * config.max_geometry_count;
+    u64 array_requirement = 0;
+    pool_allocator_create(sizeof(geometry_reference), config.max_geometry_count, &array_requirement, 0, 0);
     *memory_requirement = struct_requirement + array_requirement;
 
     if (!state) {
@@ -46,9 +49,10 @@ b8 geometry_system_initialize(u64* memory_requirement, void* state, geometry_sys
     state_ptr = state;
     state_ptr->config = config;
 
-    // The array block is after the state. Already allocated, so just set the pointer.
+    // The pool block is after the state. Its slots are the geometry array.
     void* array_block = state + struct_requirement;
-    state_ptr->registered_geometries = array_block;
+    pool_allocator_create(sizeof(geometry_reference), config.max_geometry_count, &array_requirement, array_block, &state_ptr->geometry_pool);
+    state_ptr->registered_geometries = state_ptr->geometry_pool.elements;
 
     // Invalidate all geometries in the array.
     u32 count = state_ptr->config.max_geometry_count;
@@ -82,25 +86,21 @@ geometry* geometry_system_acquire_by_id(u32 id) {
 }
 
 geometry* geometry_system_acquire_from_config(geometry_config config, b8 auto_release) {
-    geometry* g = 0;
-    for (u32 i = 0; i < state_ptr->config.max_geometry_count; ++i) {
-        if (state_ptr->registered_geometries[i].geometry.id == INVALID_ID) {
-            // Found empty slot.
-            state_ptr->registered_geometries[i].auto_release = auto_release;
-            state_ptr->registered_geometries[i].reference_count = 1;
-            g = &state_ptr->registered_geometries[i].geometry;
-            g->id = i;
-            break;
-        }
-    }
-
-    if (!g) {
+    u32 index = INVALID_ID;
+    geometry_reference* ref = pool_allocator_allocate(&state_ptr->geometry_pool, &index);
+    if (!ref) {
         LERROR("Unable to obtain free slot for geometry. Adjust configuration to allow more space. Returning nullptr.");
         return 0;
     }
 
+    ref->auto_release = auto_release;
+    ref->reference_count = 1;
+    geometry* g = &ref->geometry;
+    g->id = index;
+
     if (!create_geometry(state_ptr, config, g)) {
         LERROR("Failed to create geometry. Returning nullptr.");
+        pool_allocator_free(&state_ptr->geometry_pool, index);
         return 0;
     }
 
@@ -123,6 +123,7 @@ void geometry_system_release(geometry* geometry) {
                 destroy_geometry(state_ptr, &ref->geometry);
                 ref->reference_count = 0;
                 ref->auto_release = false;
+                pool_allocator_free(&state_ptr->geometry_pool, id);
             }
         } else {
             LFATAL("Geometry id mismatch. Check registration logic, as this should never occur.");
@@ -164,6 +165,8 @@ b8 create_geometry(geometry_system_state* state, geometry_config config, geometr
         return false;
     }
 
+    g->name = string_id_intern(config.name);
+
     // Acquire the material
     if (string_length(config.material_name) > 0) {
         g->material = material_system_acquire(config.material_name);
@@ -181,11 +184,11 @@ void destroy_geometry(geometry_system_state* state, geometry* g) {
     g->generation = INVALID_ID;
     g->id = INVALID_ID;
 
-    string_empty(g->name);
+    g->name = INVALID_STRING_ID;
 
     // Release the material.
-    if (g->material && string_length(g->material->name) > 0) {
-        material_system_release(g->material->name);
+    if (g->material && g->material->name != INVALID_STRING_ID) {
+        material_system_release_id(g->material->name);
         g->material = 0;
     }
 }
@@ -295,10 +298,11 @@ geometry_config geometry_system_generate_plane_config(f32 width, f32 height, u32
     geometry_config config;
     config.vertex_size = sizeof(vertex_3d);
     config.vertex_count = x_segment_count * y_segment_count * 4;  // 4 verts per segment
-    config.vertices = lallocate(sizeof(vertex_3d) * config.vertex_count, MEMORY_TAG_ARRAY);
+    // NOTE: Every vertex and index is written below, so neither array needs zeroing.
+    config.vertices = lallocate_uninit(sizeof(vertex_3d) * config.vertex_count, MEMORY_TAG_ARRAY);
     config.index_size = sizeof(u32);
     config.index_count = x_segment_count * y_segment_count * 6;  // 6 indices per segment
-    config.indices = lallocate(sizeof(u32) * config.index_count, MEMORY_TAG_ARRAY);
+    config.indices = lallocate_uninit(sizeof(u32) * config.index_count, MEMORY_TAG_ARRAY);
 
     // TODO: This generates extra vertices, but we can always deduplicate them later.
     f32 seg_width = width / x_segment_count;
@@ -325,21 +329,25 @@ geometry_config geometry_system_generate_plane_config(f32 width, f32 height, u32
 
             v0->position.x = min_x;
             v0->position.y = min_y;
+            v0->position.z = 0.0f;
             v0->texcoord.x = min_uvx;
             v0->texcoord.y = min_uvy;
 
             v1->position.x = max_x;
             v1->position.y = max_y;
+            v1->position.z = 0.0f;
             v1->texcoord.x = max_uvx;
             v1->texcoord.y = max_uvy;
 
             v2->position.x = min_x;
             v2->position.y = max_y;
+            v2->position.z = 0.0f;
             v2->texcoord.x = min_uvx;
             v2->texcoord.y = max_uvy;
 
             v3->position.x = max_x;
             v3->position.y = min_y;
+            v3->position.z = 0.0f;
             v3->texcoord.x = max_uvx;
             v3->texcoord.y = min_uvy;
 
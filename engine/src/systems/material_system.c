@@ -2,7 +2,8 @@
 
 #include "core/logger.h"
 #include "core/lstring.h"
-#include "containers/hashtable.h"
+#include "containers/typed_containers.h"
+#include "memory/pool_allocator.h"
 #include "math/lmath.h"
 #include "renderer/renderer_frontend.h"
 #include "systems/texture_system.h"
@@ -14,8 +15,9 @@ typedef struct material_system_state {
 
     material default_material;
 
-    // Array of registered materials.
+    // Array of registered materials, with slots handed out by the pool.
     material* registered_materials;
+    pool_allocator material_pool;
 
     // Hashtable for material lookups.
     hashtable registered_material_table;
@@ -27,10 +29,12 @@ typedef struct material_reference {
     b8 auto_release;
 } material_reference;
 
+DEFINE_HASHTABLE(material_reference)
+
 static material_system_state* state_ptr = 0;
 
 b8 create_default_material(material_system_state* state);
-b8 load_material(material_config config, material* m);
+b8 load_material(material_config config, string_id name, material* m);
 void destroy_material(material* m);
 
 b8 material_system_initialize(u64* memory_requirement, void* state, material_system_config config) {
@@ -39,10 +43,12 @@ b8 material_system_initialize(u64* memory_requirement, void* state, material_sys
         return false;
     }
 
-    // Block of memory will contain state structure, then block for array, then block for hashtable.
+    // Block of memory will contain state structure, then block for pool (array), then block for hashtable.
     u64 struct_requirement = sizeof(material_system_state);
-    u64 array_requirement = sizeof(material) * config.max_material_count;
-    u64 hashtable_requirement = sizeof(material_reference) * config.max_material_count;
+    u64 array_requirement = 0;
+    pool_allocator_create(sizeof(material), config.max_material_count, &array_requirement, 0, 0);
+    u64 hashtable_requirement = 0;
+    hashtable_material_reference_create(config.max_material_count, &hashtable_requirement, 0, 0);
     *memory_requirement = struct_requirement + array_requirement + hashtable_requirement;
 
     if (!state) {
@@ -52,22 +58,17 @@ b8 material_system_initialize(u64* memory_requirement, void* state, material_sys
     state_ptr = state;
     state_ptr->config = config;
 
-    // The array block is after the state. Already allocated, so just set the pointer.
+    // The pool block is after the state. Its slots are the material array.
     void* array_block = state + struct_requirement;
-    state_ptr->registered_materials = array_block;
+    pool_allocator_create(sizeof(material), config.max_material_count, &array_requirement, array_block, &state_ptr->material_pool);
+    state_ptr->registered_materials = state_ptr->material_pool.elements;
 
     // Hashtable block is after array.
     void* hashtable_block = array_block + array_requirement;
 
     // Create a hashtable for material lookups.
-    hashtable_create(sizeof(material_reference), config.max_material_count, hashtable_block, false, &state_ptr->registered_material_table);
-
-    // Fill the hashtable with invalid references to use as a default.
-    material_reference invalid_ref;
-    invalid_ref.auto_release = false;
-    invalid_ref.handle = INVALID_ID;  // Primary reason for needing default values.
-    invalid_ref.reference_count = 0;
-    hashtable_fill(&state_ptr->registered_material_table, &invalid_ref);
+    // Entries only exist while their material is loaded, and are keyed by the material's own name.
+    hashtable_material_reference_create(config.max_material_count, &hashtable_requirement, hashtable_block, &state_ptr->registered_material_table);
 
     // Invalidate all materials in the array.
     u32 count = state_ptr->config.max_material_count;
@@ -98,6 +99,8 @@ void material_system_shutdown(void* state) {
 
         // Destroy the default material.
         destroy_material(&s->default_material);
+
+        pool_allocator_destroy(&s->material_pool);
     }
 
     state_ptr = 0;
@@ -128,96 +131,112 @@ material* material_system_acquire(const char* name) {
 }
 
 material* material_system_acquire_from_config(material_config config) {
+    if (!state_ptr) {
+        LERROR("material_system_acquire_from_config failed to acquire material '%s'. Null pointer will be returned.", config.name);
+        return 0;
+    }
+
+    string_id name = string_id_intern(config.name);
+    if (name == INVALID_STRING_ID) {
+        LERROR("material_system_acquire_from_config failed to acquire material '%s'. Null pointer will be returned.", config.name);
+        return 0;
+    }
+
     // Return default material.
-    if (strings_equali(config.name, DEFAULT_MATERIAL_NAME)) {
+    if (name == state_ptr->default_material.name) {
         return &state_ptr->default_material;
     }
 
-    material_reference ref;
-    if (state_ptr && hashtable_get(&state_ptr->registered_material_table, config.name, &ref)) {
+    // The interned string is the key, and its hash was computed when it was interned.
+    const char* key = string_id_str(name);
+    u64 hash = string_id_hash(name);
+
+    // An existing entry is updated in place.
+    material_reference* existing = hashtable_material_reference_find_hashed(&state_ptr->registered_material_table, key, hash);
+    if (existing) {
         // This can only be changed the first time a material is loaded.
-        if (ref.reference_count == 0) {
-            ref.auto_release = config.auto_release;
+        if (existing->reference_count == 0) {
+            existing->auto_release = config.auto_release;
         }
-        ref.reference_count++;
-        if (ref.handle == INVALID_ID) {
-            // This means no material exists here. Find a free index first.
-            u32 count = state_ptr->config.max_material_count;
-            material* m = 0;
-            for (u32 i = 0; i < count; ++i) {
-                if (state_ptr->registered_materials[i].id == INVALID_ID) {
-                    // A free slot has been found. Use its index as the handle.
-                    ref.handle = i;
-                    m = &state_ptr->registered_materials[i];
-                    break;
-                }
-            }
+        existing->reference_count++;
+        LTRACE("Material '%s' already exists, ref_count increased to %i.", config.name, existing->reference_count);
+        return &state_ptr->registered_materials[existing->handle];
+    }
 
-            // Make sure an empty slot was actually found.
-            if (!m || ref.handle == INVALID_ID) {
-                LFATAL("material_system_acquire - Material system cannot hold anymore materials. Adjust configuration to allow more.");
-                return 0;
-            }
+    // This means no material exists yet. Take a free slot and use its index as the handle.
+    material_reference ref;
+    material* m = pool_allocator_allocate(&state_ptr->material_pool, &ref.handle);
+    if (!m) {
+        LFATAL("material_system_acquire - Material system cannot hold anymore materials. Adjust configuration to allow more.");
+        return 0;
+    }
 
-            // Create new material.
-            if (!load_material(config, m)) {
-                LERROR("Failed to load material '%s'.", config.name);
-                return 0;
-            }
+    // Create new material.
+    if (!load_material(config, name, m)) {
+        LERROR("Failed to load material '%s'.", config.name);
+        pool_allocator_free(&state_ptr->material_pool, ref.handle);
+        return 0;
+    }
 
-            if (m->generation == INVALID_ID) {
-                m->generation = 0;
-            } else {
-                m->generation++;
-            }
+    if (m->generation == INVALID_ID) {
+        m->generation = 0;
+    } else {
+        m->generation++;
+    }
 
-            // Also use the handle as the material id.
-            m->id = ref.handle;
-            LTRACE("Material '%s' does not yet exist. Created, and ref_count is now %i.", config.name, ref.reference_count);
-        } else {
-            LTRACE("Material '%s' already exists, ref_count increased to %i.", config.name, ref.reference_count);
-        }
+    // Also use the handle as the material id.
+    m->id = ref.handle;
+    ref.reference_count = 1;
+    ref.auto_release = config.auto_release;
+    LTRACE("Material '%s' does not yet exist. Created, and ref_count is now %i.", config.name, ref.reference_count);
 
-        // Update the entry.
-        hashtable_set(&state_ptr->registered_material_table, config.name, &ref);
-        return &state_ptr->registered_materials[ref.handle];
+    // Add the entry. The table has room for every slot in the pool, so this cannot fail.
+    hashtable_material_reference_set_hashed(&state_ptr->registered_material_table, key, hash, ref);
+    return m;
+}
+
+void material_system_release(const char* name) {
+    // A name which was never interned cannot have been acquired.
+    string_id id = string_id_find(name);
+    if (id == INVALID_STRING_ID) {
+        LERROR("material_system_release failed to release material '%s'.", name);
+        return;
     }
 
-    // NOTE: This would only happen in the event something went wrong with the state.
-    LERROR("material_system_acquire_from_config failed to acquire material '%s'. Null pointer will be returned.", config.name);
-    return 0;
+    material_system_release_id(id);
 }
 
-void material_system_release(const char* name) {
+void material_system_release_id(string_id name) {
     // Ignore release requests for the default material.
-    if (strings_equali(name, DEFAULT_MATERIAL_NAME)) {
+    if (!state_ptr || name == state_ptr->default_material.name) {
         return;
     }
-    material_reference ref;
-    if (state_ptr && hashtable_get(&state_ptr->registered_material_table, name, &ref)) {
-        if (ref.reference_count == 0) {
-            LWARN("Tried to release non-existent material: '%s'", name);
+
+    const char* key = string_id_str(name);
+    u64 hash = string_id_hash(name);
+
+    // The entry is updated in place.
+    material_reference* ref = hashtable_material_reference_find_hashed(&state_ptr->registered_material_table, key, hash);
+    if (ref) {
+        if (ref->reference_count == 0) {
+            LWARN("Tried to release non-existent material: '%s'", key);
             return;
         }
-        ref.reference_count--;
-        if (ref.reference_count == 0 && ref.auto_release) {
-            material* m = &state_ptr->registered_materials[ref.handle];
+        ref->reference_count--;
+        if (ref->reference_count == 0 && ref->auto_release) {
+            u32 handle = ref->handle;
+            material* m = &state_ptr->registered_materials[handle];
 
-            // Destroy/reset material.
+            // Destroy/reset material, and hand its slot back. Removing the entry invalidates ref.
+            hashtable_remove_hashed(&state_ptr->registered_material_table, key, hash);
             destroy_material(m);
-
-            // Reset the reference.
-            ref.handle = INVALID_ID;
-            ref.auto_release = false;
-            LTRACE("Released material '%s'., Material unloaded because reference count=0 and auto_release=true.", name);
+            pool_allocator_free(&state_ptr->material_pool, handle);
+            LTRACE("Released material '%s'., Material unloaded because reference count=0 and auto_release=true.", key);
         } else {
-            LTRACE("Released material '%s', now has a reference count of '%i' (auto_release=%s).", name, ref.reference_count, ref.auto_release ? "true" : "false");
+            LTRACE("Released material '%s', now has a reference count of '%i' (auto_release=%s).", key, ref->reference_count, ref->auto_release ? "true" : "false");
         }
-
-        // Update the entry.
-        hashtable_set(&state_ptr->registered_material_table, name, &ref);
     } else {
-        LERROR("material_system_release failed to release material '%s'.", name);
+        LERROR("material_system_release failed to release material '%s'.", key);
     }
 }
 
@@ -230,11 +249,11 @@ material* material_system_get_default() {
     return 0;
 }
 
-b8 load_material(material_config config, material* m) {
+b8 load_material(material_config config, string_id name, material* m) {
     lzero_memory(m, sizeof(material));
 
     // name
-    string_ncopy(m->name, config.name, MAX_MATERIAL_NAME_LENGTH);
+    m->name = name;
 
     // Type
     m->type = config.type;
@@ -247,7 +266,7 @@ b8 load_material(material_config config, material* m) {
         m->diffuse_map.use = TEXTURE_USE_MAP_DIFFUSE;
         m->diffuse_map.texture = texture_system_acquire(config.diffuse_map_name, true);
         if (!m->diffuse_map.texture) {
-            LWARN("Unable to load texture '%s' for material '%s', using default.", config.diffuse_map_name, m->name);
+            LWARN("Unable to load texture '%s' for material '%s', using default.", config.diffuse_map_name, config.name);
             m->diffuse_map.texture = texture_system_get_default_texture();
         }
     } else {
@@ -260,7 +279,7 @@ b8 load_material(material_config config, material* m) {
 
     // Send it off to the renderer to acquire resources.
     if (!renderer_create_material(m)) {
-        LERROR("Failed to acquire renderer resources for material '%s'.", m->name);
+        LERROR("Failed to acquire renderer resources for material '%s'.", config.name);
         return false;
     }
 
@@ -268,11 +287,11 @@ b8 load_material(material_config config, material* m) {
 }
 
 void destroy_material(material* m) {
-    LTRACE("Destroying material '%s'...", m->name);
+    LTRACE("Destroying material '%s'...", string_id_str(m->name));
 
     // Release texture references.
     if (m->diffuse_map.texture) {
-        texture_system_release(m->diffuse_map.texture->name);
+        texture_system_release_id(m->diffuse_map.texture->name);
     }
 
     // Release renderer resources.
@@ -289,7 +308,7 @@ b8 create_default_material(material_system_state* state) {
     lzero_memory(&state->default_material, sizeof(material));
     state->default_material.id = INVALID_ID;
     state->default_material.generation = INVALID_ID;
-    string_ncopy(state->default_material.name, DEFAULT_MATERIAL_NAME, MAX_MATERIAL_NAME_LENGTH);
+    state->default_material.name = string_id_intern(DEFAULT_MATERIAL_NAME);
     state->default_material.diffuse_color = vec4_set(1.0f);  // white
     state->default_material.diffuse_map.use = TEXTURE_USE_MAP_DIFFUSE;
     state->default_material.diffuse_map.texture = texture_system_get_default_texture();
@@ -20,4 +20,7 @@ material* material_system_acquire_from_config(material_config config);
 
 void material_system_release(const char* name);
 
+// As material_system_release, for an already interned name.
+void material_system_release_id(string_id name);
+
 material* material_system_get_default();
\ No newline at end of file
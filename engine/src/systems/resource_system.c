@@ -2,6 +2,7 @@
 
 #include "core/logger.h"
 #include "core/lstring.h"
+#include "memory/linear_allocator.h"
 
 // Known resource loaders.
 #include "resources/loaders/text_loader.h"
@@ -9,9 +10,14 @@
 #include "resources/loaders/image_loader.h"
 #include "resources/loaders/material_loader.h"
 
+// The size of the scratch block handed to loaders. Overflow chains further blocks.
+#define RESOURCE_SYSTEM_SCRATCH_SIZE KIBIBYTES(64)
+
 typedef struct resource_system_state {
     resource_system_config config;
     resource_loader* registered_loaders;
+    // Temporary memory for loaders, taken and released via scopes.
+    linear_allocator scratch;
 } resource_system_state;
 
 static resource_system_state* state_ptr = 0;
@@ -24,7 +30,8 @@ b8 resource_system_initialize(u64* memory_requirement, void* state, resource_sys
         return false;
     }
 
-    *memory_requirement = sizeof(resource_system_state) + (sizeof(resource_loader) * config.max_loader_count);
+    u64 loaders_requirement = sizeof(resource_loader) * config.max_loader_count;
+    *memory_requirement = sizeof(resource_system_state) + loaders_requirement + RESOURCE_SYSTEM_SCRATCH_SIZE;
 
     if (!state) {
         return true;
@@ -36,6 +43,9 @@ b8 resource_system_initialize(u64* memory_requirement, void* state, resource_sys
     void* array_block = state + sizeof(resource_system_state);
     state_ptr->registered_loaders = array_block;
 
+    void* scratch_block = array_block + loaders_requirement;
+    linear_allocator_create_chained(RESOURCE_SYSTEM_SCRATCH_SIZE, scratch_block, &state_ptr->scratch);
+
     // Invalidate all loaders
     u32 count = config.max_loader_count;
     for (u32 i = 0; i < count; ++i) {
@@ -55,6 +65,7 @@ b8 resource_system_initialize(u64* memory_requirement, void* state, resource_sys
 
 void resource_system_shutdown(void* state) {
     if (state_ptr) {
+        linear_allocator_destroy(&state_ptr->scratch);
         state_ptr = 0;
     }
 }
@@ -142,6 +153,15 @@ const char* resource_system_base_path() {
     return "";
 }
 
+linear_allocator* resource_system_scratch_allocator() {
+    if (state_ptr) {
+        return &state_ptr->scratch;
+    }
+
+    LERROR("resource_system_scratch_allocator called before initialization.");
+    return 0;
+}
+
 b8 load(const char* name, resource_loader* loader, resource* out_resource) {
     if (!name || !loader || !loader->load || !out_resource) {
         if (out_resource) {
@@ -152,4 +172,4 @@ b8 load(const char* name, resource_loader* loader, resource* out_resource) {
 
     out_resource->loader_id = loader->id;
     return loader->load(loader, name, out_resource);
-}
\ No newline at end of file
+}
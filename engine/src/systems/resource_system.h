@@ -2,6 +2,8 @@
 
 #include "resources/resource_types.h"
 
+struct linear_allocator;
+
 typedef struct resource_system_config {
     u32 max_loader_count;
     // The relative base path for assets.
@@ -27,4 +29,13 @@ LAPI b8 resource_system_load_custom(const char* name, const char* custom_type, r
 
 LAPI void resource_system_unload(resource* resource);
 
-LAPI const char* resource_system_base_path();
\ No newline at end of file
+LAPI const char* resource_system_base_path();
+
+/**
+ * @brief Obtains the scratch allocator shared by loaders for temporary memory. Callers should
+ * wrap their use in linear_allocator_scope_begin/linear_allocator_scope_end so that memory
+ * is released in LIFO order once they are done with it.
+ *
+ * @return A pointer to the scratch allocator; 0 if the system is not initialized.
+ */
+LAPI struct linear_allocator* resource_system_scratch_allocator();
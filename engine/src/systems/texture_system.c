@@ -3,7 +3,9 @@
 #include "core/logger.h"
 #include "core/lstring.h"
 #include "core/lmemory.h"
-#include "containers/hashtable.h"
+#include "containers/typed_containers.h"
+#include "memory/allocator.h"
+#include "memory/pool_allocator.h"
 
 #include "renderer/renderer_frontend.h"
 
@@ -13,24 +15,31 @@ typedef struct texture_system_state {
     texture_system_config config;
     texture default_texture;
 
-    // Array of registered textures.
+    // Array of registered textures, with slots handed out by the pool.
     texture* registered_textures;
+    pool_allocator texture_pool;
 
-    // Hashtable for texture lookups.
+    // Hashtable for texture lookups. Grows with the number of textures loaded.
+    allocator_interface table_allocator;
     hashtable registered_texture_table;
 } texture_system_state;
 
+// The number of textures the lookup table has room for before it first grows.
+#define TEXTURE_TABLE_INITIAL_COUNT 128
+
 typedef struct texture_reference {
     u64 reference_count;
     u32 handle;
     b8 auto_release;
 } texture_reference;
 
+DEFINE_HASHTABLE(texture_reference)
+
 static texture_system_state* state_ptr = 0;
 
 b8 create_default_textures(texture_system_state* state);
 void destroy_default_textures(texture_system_state* state);
-b8 load_texture(const char* texture_name, texture* t);
+b8 load_texture(string_id texture_name, texture* t);
 void destroy_texture(texture* t);
 
 b8 texture_system_initialize(u64* memory_requirement, void* state, texture_system_config config) {
@@ -39,11 +48,12 @@ b8 texture_system_initialize(u64* memory_requirement, void* state, texture_syste
         return false;
     }
 
-    // Block of memory will contain state structure, then block for array, then block for hashtable.
+    // Block of memory will contain state structure, then block for pool (array).
+    // The hashtable allocates its own memory as it grows.
     u64 struct_requirement = sizeof(texture_system_state);
-    u64 array_requirement = sizeof(texture) * config.max_texture_count;
-    u64 hashtable_requirement = sizeof(texture_reference) * config.max_texture_count;
-    *memory_requirement = struct_requirement + array_requirement + hashtable_requirement;
+    u64 array_requirement = 0;
+    pool_allocator_create(sizeof(texture), config.max_texture_count, &array_requirement, 0, 0);
+    *memory_requirement = struct_requirement + array_requirement;
 
     if (!state) {
         return true;
@@ -52,22 +62,19 @@ b8 texture_system_initialize(u64* memory_requirement, void* state, texture_syste
     state_ptr = state;
     state_ptr->config = config;
 
-    // The array block is after the state. Already allocated, so just set the pointer.
+    // The pool block is after the state. Its slots are the texture array.
     void* array_block = state + struct_requirement;
-    state_ptr->registered_textures = array_block;
-
-    // Hashtable block is after array.
-    void* hashtable_block = array_block + array_requirement;
-
-    // Create a hashtable for texture lookups.
-    hashtable_create(sizeof(texture_reference), config.max_texture_count, hashtable_block, false, &state_ptr->registered_texture_table);
-
-    // Fill the hashtable with invalid references to use as a default.
-    texture_reference invalid_ref;
-    invalid_ref.auto_release = false;
-    invalid_ref.handle = INVALID_ID;  // Primary reason for needing default values.
-    invalid_ref.reference_count = 0;
-    hashtable_fill(&state_ptr->registered_texture_table, &invalid_ref);
+    pool_allocator_create(sizeof(texture), config.max_texture_count, &array_requirement, array_block, &state_ptr->texture_pool);
+    state_ptr->registered_textures = state_ptr->texture_pool.elements;
+
+    // Create a hashtable for texture lookups. It starts small and grows (and shrinks) with the textures loaded.
+    // Entries only exist while their texture is loaded, and are keyed by the texture's interned name.
+    state_ptr->table_allocator = allocator_interface_default(MEMORY_TAG_DICT);
+    u32 initial_count = config.max_texture_count < TEXTURE_TABLE_INITIAL_COUNT ? config.max_texture_count : TEXTURE_TABLE_INITIAL_COUNT;
+    if (!hashtable_texture_reference_create_growable(initial_count, &state_ptr->table_allocator, &state_ptr->registered_texture_table)) {
+        LFATAL("texture_system_initialize - failed to create the texture lookup table.");
+        return false;
+    }
 
     // Invalidate all textures in the array.
     u32 count = state_ptr->config.max_texture_count;
@@ -93,103 +100,125 @@ void texture_system_shutdown(void* state) {
         }
 
         destroy_default_textures(state_ptr);
+        hashtable_destroy(&state_ptr->registered_texture_table);
+        pool_allocator_destroy(&state_ptr->texture_pool);
 
         state_ptr = 0;
     }
 }
 
 texture* texture_system_acquire(const char* name, b8 auto_release) {
+    if (!state_ptr) {
+        LERROR("texture_system_acquire failed to acquire texture '%s'. Null pointer will be returned.", name);
+        return 0;
+    }
+
+    return texture_system_acquire_id(string_id_intern(name), auto_release);
+}
+
+texture* texture_system_acquire_id(string_id name, b8 auto_release) {
+    if (!state_ptr || name == INVALID_STRING_ID) {
+        LERROR("texture_system_acquire failed to acquire texture '%s'. Null pointer will be returned.", string_id_str(name));
+        return 0;
+    }
+
     // Return default texture, but warn about it since this should be returned via get_default_texture();
-    if (strings_equali(name, DEFAULT_TEXTURE_NAME)) {
+    if (name == state_ptr->default_texture.name) {
         LWARN("texture_system_acquire called for default texture. Use texture_system_get_default_texture for texture 'default'.");
         return &state_ptr->default_texture;
     }
 
-    texture_reference ref;
-    if (state_ptr && hashtable_get(&state_ptr->registered_texture_table, name, &ref)) {
+    // The interned string is the key, and its hash was computed when it was interned.
+    const char* key = string_id_str(name);
+    u64 hash = string_id_hash(name);
+
+    // An existing entry is updated in place.
+    texture_reference* existing = hashtable_texture_reference_find_hashed(&state_ptr->registered_texture_table, key, hash);
+    if (existing) {
         // This can only be changed the first time a texture is loaded.
-        if (ref.reference_count == 0) {
-            ref.auto_release = auto_release;
+        if (existing->reference_count == 0) {
+            existing->auto_release = auto_release;
         }
-        ref.reference_count++;
-        if (ref.handle == INVALID_ID) {
-            // This means no texture exists here. Find a free index first.
-            u32 count = state_ptr->config.max_texture_count;
-            texture* t = 0;
-            for (u32 i = 0; i < count; ++i) {
-                if (state_ptr->registered_textures[i].id == INVALID_ID) {
-                    // A free slot has been found. Use its index as the handle.
-                    ref.handle = i;
-                    t = &state_ptr->registered_textures[i];
-                    break;
-                }
-            }
+        existing->reference_count++;
+        LTRACE("Texture '%s' already exists, ref_count increased to %i.", key, existing->reference_count);
+        return &state_ptr->registered_textures[existing->handle];
+    }
 
-            // Make sure an empty slot was actually found.
-            if (!t || ref.handle == INVALID_ID) {
-                LFATAL("texture_system_acquire - Texture system cannot hold anymore textures. Adjust configuration to allow more.");
-                return 0;
-            }
+    // This means no texture exists yet. Take a free slot and use its index as the handle.
+    texture_reference ref;
+    texture* t = pool_allocator_allocate(&state_ptr->texture_pool, &ref.handle);
+    if (!t) {
+        LFATAL("texture_system_acquire - Texture system cannot hold anymore textures. Adjust configuration to allow more.");
+        return 0;
+    }
 
-            // Create new texture.
-            if (!load_texture(name, t)) {
-                LERROR("Failed to load texture '%s'.", name);
-                return 0;
-            }
+    // Create new texture.
+    if (!load_texture(name, t)) {
+        LERROR("Failed to load texture '%s'.", key);
+        pool_allocator_free(&state_ptr->texture_pool, ref.handle);
+        return 0;
+    }
 
-            // Also use the handle as the texture id.
-            t->id = ref.handle;
-            LTRACE("Texture '%s' does not yet exist. Created, and ref_count is now %i.", name, ref.reference_count);
-        } else {
-            LTRACE("Texture '%s' already exists, ref_count increased to %i.", name, ref.reference_count);
-        }
+    // Also use the handle as the texture id.
+    t->id = ref.handle;
+    ref.reference_count = 1;
+    ref.auto_release = auto_release;
+    LTRACE("Texture '%s' does not yet exist. Created, and ref_count is now %i.", key, ref.reference_count);
+
+    // Add the entry.
+    if (!hashtable_texture_reference_set_hashed(&state_ptr->registered_texture_table, key, hash, ref)) {
+        // Only adding a new entry can fail, if the table could not grow.
+        LERROR("texture_system_acquire failed to register texture '%s'. Null pointer will be returned.", key);
+        destroy_texture(t);
+        pool_allocator_free(&state_ptr->texture_pool, ref.handle);
+        return 0;
+    }
+    return t;
+}
 
-        // Update the entry.
-        hashtable_set(&state_ptr->registered_texture_table, name, &ref);
-        return &state_ptr->registered_textures[ref.handle];
+void texture_system_release(const char* name) {
+    // A name which was never interned cannot have been acquired.
+    string_id id = string_id_find(name);
+    if (id == INVALID_STRING_ID) {
+        LERROR("texture_system_release failed to release texture '%s'.", name);
+        return;
     }
 
-    // NOTE: This would only happen in the event something went wrong with the state.
-    LERROR("texture_system_acquire failed to acquire texture '%s'. Null pointer will be returned.", name);
-    return 0;
+    texture_system_release_id(id);
 }
 
-void texture_system_release(const char* name) {
+void texture_system_release_id(string_id name) {
     // Ignore release requests for the default texture.
-    if (strings_equali(name, DEFAULT_TEXTURE_NAME)) {
+    if (!state_ptr || name == state_ptr->default_texture.name) {
         return;
     }
-    texture_reference ref;
-    if (state_ptr && hashtable_get(&state_ptr->registered_texture_table, name, &ref)) {
-        if (ref.reference_count == 0) {
-            LWARN("Tried to release non-existent texture: '%s'", name);
+
+    const char* key = string_id_str(name);
+    u64 hash = string_id_hash(name);
+
+    // The entry is updated in place.
+    texture_reference* ref = hashtable_texture_reference_find_hashed(&state_ptr->registered_texture_table, key, hash);
+    if (ref) {
+        if (ref->reference_count == 0) {
+            LWARN("Tried to release non-existent texture: '%s'", key);
             return;
         }
 
-        // Take a copy of the name since it will be wiped out by destroy,
-        // (as passed in name is generally a pointer to the actual texture's name).
-        char name_copy[MAX_TEXTURE_NAME_LENGTH];
-        string_ncopy(name_copy, name, MAX_TEXTURE_NAME_LENGTH);
+        ref->reference_count--;
+        if (ref->reference_count == 0 && ref->auto_release) {
+            u32 handle = ref->handle;
+            texture* t = &state_ptr->registered_textures[handle];
 
-        ref.reference_count--;
-        if (ref.reference_count == 0 && ref.auto_release) {
-            texture* t = &state_ptr->registered_textures[ref.handle];
-
-            // Destroy/reset texture.
+            // Destroy/reset texture, and hand its slot back. Removing the entry invalidates ref.
+            hashtable_remove_hashed(&state_ptr->registered_texture_table, key, hash);
             destroy_texture(t);
-
-            // Reset the reference.
-            ref.handle = INVALID_ID;
-            ref.auto_release = false;
-            LTRACE("Released texture '%s'., Texture unloaded because reference count=0 and auto_release=true.", name_copy);
+            pool_allocator_free(&state_ptr->texture_pool, handle);
+            LTRACE("Released texture '%s'., Texture unloaded because reference count=0 and auto_release=true.", key);
         } else {
-            LTRACE("Released texture '%s', now has a reference count of '%i' (auto_release=%s).", name_copy, ref.reference_count, ref.auto_release ? "true" : "false");
+            LTRACE("Released texture '%s', now has a reference count of '%i' (auto_release=%s).", key, ref->reference_count, ref->auto_release ? "true" : "false");
         }
-
-        // Update the entry.
-        hashtable_set(&state_ptr->registered_texture_table, name_copy, &ref);
     } else {
-        LERROR("texture_system_release failed to release texture '%s'.", name);
+        LERROR("texture_system_release failed to release texture '%s'.", key);
     }
 }
 
@@ -231,7 +260,7 @@ b8 create_default_textures(texture_system_state* state) {
         }
     }
 
-    string_ncopy(state->default_texture.name, DEFAULT_TEXTURE_NAME, MAX_TEXTURE_NAME_LENGTH);
+    state->default_texture.name = string_id_intern(DEFAULT_TEXTURE_NAME);
     state->default_texture.width = tex_dimension;
     state->default_texture.height = tex_dimension;
     state->default_texture.channel_count = 4;
@@ -250,10 +279,10 @@ void destroy_default_textures(texture_system_state* state) {
     }
 }
 
-b8 load_texture(const char* texture_name, texture* t) {
+b8 load_texture(string_id texture_name, texture* t) {
     resource img_resource;
-    if (!resource_system_load(texture_name, RESOURCE_TYPE_IMAGE, &img_resource)) {
-        LERROR("Failed to load image resource for texture '%s'", texture_name);
+    if (!resource_system_load(string_id_str(texture_name), RESOURCE_TYPE_IMAGE, &img_resource)) {
+        LERROR("Failed to load image resource for texture '%s'", string_id_str(texture_name));
         return false;
     }
 
@@ -279,8 +308,7 @@ b8 load_texture(const char* texture_name, texture* t) {
         }
     }
 
-    // Take a copy of the name.
-    string_ncopy(temp_texture.name, texture_name, MAX_TEXTURE_NAME_LENGTH);
+    temp_texture.name = texture_name;
     temp_texture.generation = INVALID_ID;
     temp_texture.has_transparency = has_transparency;
 
@@ -311,7 +339,6 @@ void destroy_texture(texture* t) {
     // Clean up backend resources.
     renderer_destroy_texture(t);
 
-    lzero_memory(t->name, sizeof(char) * MAX_TEXTURE_NAME_LENGTH);
     lzero_memory(t, sizeof(texture));
     t->id = INVALID_ID;
     t->generation = INVALID_ID;
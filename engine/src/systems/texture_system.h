@@ -1,6 +1,7 @@
 #pragma once
 
 #include "renderer/renderer_types.inl"
+#include "core/string_id.h"
 
 typedef struct texture_system_config {
     u32 max_texture_count;
@@ -14,6 +15,12 @@ void texture_system_shutdown(void* state);
 
 texture* texture_system_acquire(const char* name, b8 auto_release);
 
+// As texture_system_acquire, for an already interned name.
+texture* texture_system_acquire_id(string_id name, b8 auto_release);
+
 void texture_system_release(const char* name);
 
+// As texture_system_release, for an already interned name.
+void texture_system_release_id(string_id name);
+
 texture* texture_system_get_default_texture();
@@ -2,6 +2,7 @@
 #include <core/logger.h>
 #include <core/input.h>
 #include <core/lmemory.h>
+#include <core/memory_profiler.h>
 
 #include <math/lmath.h>
 #include <core/event.h>
@@ -44,6 +45,12 @@ b8 game_update(game* game_inst, f32 delta_time)
         LDEBUG("Allocations: %llu (%llu this frame)", alloc_count, alloc_count - prev_alloc_count);
     }
 
+    if (input_is_key_up('P') && input_was_key_down('P') && memory_profiler_is_enabled()) {
+        if (memory_profiler_dump("memory_profile.txt")) {
+            LDEBUG("Memory profile written to memory_profile.txt");
+        }
+    }
+
     // TODO: temp
     if (input_is_key_up('T') && input_was_key_down('T')) {
         LDEBUG("Swapping texture!");
@@ -0,0 +1,328 @@
+#include "buddy_allocator_tests.h"
+#include "../test_manager.h"
+#include "../expect.h"
+
+#include <defines.h>
+#include <containers/buddy_allocator.h>
+#include <core/lmemory.h>
+
+u8 buddy_allocator_should_create_and_destroy() {
+    buddy_allocator allocator;
+
+    // Get the memory requirement, then allocate and create the allocator.
+    u64 memory_requirement = 0;
+    expect_to_be_true(buddy_allocator_create(1024, 64, &memory_requirement, 0, 0));
+    void* block = lallocate(memory_requirement, MEMORY_TAG_APPLICATION);
+    expect_to_be_true(buddy_allocator_create(1024, 64, &memory_requirement, block, &allocator));
+    expect_should_not_be(0, allocator.memory);
+
+    // Verify that the entire range is free, as one block.
+    buddy_allocator_stats stats;
+    expect_to_be_true(buddy_allocator_get_stats(&allocator, &stats));
+    expect_should_be(1024, stats.total_size);
+    expect_should_be(1024, stats.total_free);
+    expect_should_be(1024, stats.largest_free_block);
+    expect_should_be(0, stats.allocation_count);
+
+    // Minimum block sizes which are not a power of two are rejected.
+    expect_to_be_false(buddy_allocator_create(1024, 48, &memory_requirement, 0, 0));
+
+    buddy_allocator_destroy(&allocator);
+    expect_should_be(0, allocator.memory);
+    lfree(block, memory_requirement, MEMORY_TAG_APPLICATION);
+
+    return true;
+}
+
+u8 buddy_allocator_should_split_and_merge_buddies() {
+    buddy_allocator allocator;
+    u64 memory_requirement = 0;
+    buddy_allocator_create(1024, 64, &memory_requirement, 0, 0);
+    void* block = lallocate(memory_requirement, MEMORY_TAG_APPLICATION);
+    buddy_allocator_create(1024, 64, &memory_requirement, block, &allocator);
+
+    // Sizes are rounded up to a power of two, and placed at the lowest offset which fits.
+    u64 a = INVALID_ID, b = INVALID_ID, c = INVALID_ID;
+    expect_to_be_true(buddy_allocator_allocate(&allocator, 64, 0, &a));
+    expect_should_be(0, a);
+    expect_to_be_true(buddy_allocator_allocate(&allocator, 100, 0, &b));
+    expect_should_be(128, b);
+    expect_to_be_true(buddy_allocator_allocate(&allocator, 40, 0, &c));
+    expect_should_be(64, c);
+
+    buddy_allocator_stats stats;
+    buddy_allocator_get_stats(&allocator, &stats);
+    expect_should_be(3, stats.allocation_count);
+    expect_should_be(64 + 128 + 64, stats.allocated_bytes);
+    expect_should_be(64 + 100 + 40, stats.requested_bytes);
+    expect_should_be(28 + 24, stats.internal_waste);
+    expect_should_be(1024 - 256, stats.total_free);
+    expect_should_be(512, stats.largest_free_block);
+
+    // Freeing the blocks merges them back into one.
+    expect_to_be_true(buddy_allocator_free(&allocator, 64, a));
+    expect_to_be_true(buddy_allocator_free(&allocator, 40, c));
+    buddy_allocator_get_stats(&allocator, &stats);
+    expect_should_be(512, stats.largest_free_block);
+    expect_to_be_true(buddy_allocator_free(&allocator, 100, b));
+    buddy_allocator_get_stats(&allocator, &stats);
+    expect_should_be(1024, stats.largest_free_block);
+    expect_should_be(1024, stats.total_free);
+    expect_should_be(0, stats.internal_waste);
+
+    // Double frees are caught.
+    LDEBUG("The following warning message is intentional.");
+    expect_to_be_false(buddy_allocator_free(&allocator, 64, a));
+
+    buddy_allocator_destroy(&allocator);
+    lfree(block, memory_requirement, MEMORY_TAG_APPLICATION);
+    return true;
+}
+
+u8 buddy_allocator_should_respect_alignment() {
+    buddy_allocator allocator;
+    u64 memory_requirement = 0;
+    buddy_allocator_create(4096, 16, &memory_requirement, 0, 0);
+    void* block = lallocate(memory_requirement, MEMORY_TAG_APPLICATION);
+    buddy_allocator_create(4096, 16, &memory_requirement, block, &allocator);
+
+    u64 small = 0;
+    expect_to_be_true(buddy_allocator_allocate(&allocator, 16, 0, &small));
+    expect_should_be(0, small);
+
+    // A small allocation with a large alignment takes a block of the alignment's size.
+    expect_should_be(256, buddy_allocator_block_size(&allocator, 20, 256));
+    u64 aligned = 0;
+    expect_to_be_true(buddy_allocator_allocate(&allocator, 20, 256, &aligned));
+    expect_should_be(0, aligned % 256);
+    expect_should_be(256, aligned);
+
+    buddy_allocator_stats stats;
+    buddy_allocator_get_stats(&allocator, &stats);
+    expect_should_be(16 + 256, stats.allocated_bytes);
+    expect_should_be(256 - 20, stats.internal_waste);
+
+    // Freed without the alignment.
+    expect_to_be_true(buddy_allocator_free(&allocator, 20, aligned));
+    expect_to_be_true(buddy_allocator_free(&allocator, 16, small));
+    buddy_allocator_get_stats(&allocator, &stats);
+    expect_should_be(4096, stats.largest_free_block);
+
+    buddy_allocator_destroy(&allocator);
+    lfree(block, memory_requirement, MEMORY_TAG_APPLICATION);
+    return true;
+}
+
+u8 buddy_allocator_should_handle_non_power_of_two_sizes() {
+    buddy_allocator allocator;
+    u64 memory_requirement = 0;
+    u64 total_size = 1000;
+    buddy_allocator_create(total_size, 64, &memory_requirement, 0, 0);
+    void* block = lallocate(memory_requirement, MEMORY_TAG_APPLICATION);
+    buddy_allocator_create(total_size, 64, &memory_requirement, block, &allocator);
+
+    // Only whole minimum blocks within the range can be handed out: 512 + 256 + 128 + 64.
+    buddy_allocator_stats stats;
+    buddy_allocator_get_stats(&allocator, &stats);
+    expect_should_be(960, stats.total_free);
+    expect_should_be(512, stats.largest_free_block);
+
+    // Fill it with minimum blocks, none of which may run past the end.
+    u64 offsets[16];
+    u32 count = 0;
+    u64 offset = 0;
+    while (buddy_allocator_allocate(&allocator, 64, 0, &offset)) {
+        expect_to_be_true((offset + 64 <= total_size));
+        offsets[count++] = offset;
+    }
+    expect_should_be(15, count);
+    buddy_allocator_get_stats(&allocator, &stats);
+    expect_should_be(0, stats.total_free);
+    expect_should_be(0, stats.largest_free_block);
+
+    for (u32 i = 0; i < count; ++i) {
+        expect_to_be_true(buddy_allocator_free(&allocator, 64, offsets[i]));
+    }
+    buddy_allocator_get_stats(&allocator, &stats);
+    expect_should_be(960, stats.total_free);
+    expect_should_be(512, stats.largest_free_block);
+
+    buddy_allocator_destroy(&allocator);
+    lfree(block, memory_requirement, MEMORY_TAG_APPLICATION);
+    return true;
+}
+
+u8 buddy_allocator_should_survive_churn() {
+    buddy_allocator allocator;
+    u64 memory_requirement = 0;
+    u64 total_size = 64 * 1024;
+    buddy_allocator_create(total_size, 16, &memory_requirement, 0, 0);
+    void* block = lallocate(memory_requirement, MEMORY_TAG_APPLICATION);
+    buddy_allocator_create(total_size, 16, &memory_requirement, block, &allocator);
+
+    // Random allocations and frees, checking no two live blocks ever overlap.
+    #define CHURN_SLOTS 64
+    u64 offsets[CHURN_SLOTS];
+    u64 sizes[CHURN_SLOTS] = {0};
+    u32 seed = 0x2545F491u;
+    for (u32 i = 0; i < 20000; ++i) {
+        seed = seed * 1664525u + 1013904223u;
+        u32 slot = (seed >> 8) % CHURN_SLOTS;
+        if (sizes[slot]) {
+            expect_to_be_true(buddy_allocator_free(&allocator, sizes[slot], offsets[slot]));
+            sizes[slot] = 0;
+            continue;
+        }
+
+        u64 size = 1 + ((seed >> 16) % 1500);
+        if (!buddy_allocator_allocate(&allocator, size, 0, &offsets[slot])) {
+            continue;
+        }
+        sizes[slot] = size;
+        u64 block_size = buddy_allocator_block_size(&allocator, size, 0);
+        expect_should_be(0, offsets[slot] % block_size);
+        for (u32 j = 0; j < CHURN_SLOTS; ++j) {
+            if (j != slot && sizes[j]) {
+                b8 overlaps = offsets[j] < offsets[slot] + size && offsets[slot] < offsets[j] + sizes[j];
+                expect_to_be_false(overlaps);
+            }
+        }
+    }
+
+    for (u32 i = 0; i < CHURN_SLOTS; ++i) {
+        if (sizes[i]) {
+            expect_to_be_true(buddy_allocator_free(&allocator, sizes[i], offsets[i]));
+        }
+    }
+    #undef CHURN_SLOTS
+
+    // Everything merges back into a single block.
+    buddy_allocator_stats stats;
+    buddy_allocator_get_stats(&allocator, &stats);
+    expect_should_be(total_size, stats.largest_free_block);
+    expect_should_be(0, stats.allocation_count);
+    expect_should_be(0, stats.requested_bytes);
+
+    buddy_allocator_destroy(&allocator);
+    lfree(block, memory_requirement, MEMORY_TAG_APPLICATION);
+    return true;
+}
+
+u8 buddy_allocator_should_resize_keeping_allocations() {
+    buddy_allocator allocator;
+    u64 memory_requirement = 0;
+    buddy_allocator_create(512, 64, &memory_requirement, 0, 0);
+    void* block = lallocate(memory_requirement, MEMORY_TAG_APPLICATION);
+    buddy_allocator_create(512, 64, &memory_requirement, block, &allocator);
+
+    u64 a = 0, b = 0;
+    expect_to_be_true(buddy_allocator_allocate(&allocator, 256, 0, &a));
+    expect_to_be_true(buddy_allocator_allocate(&allocator, 60, 0, &b));
+    expect_should_be(0, a);
+    expect_should_be(256, b);
+    u64 full = 0;
+    expect_to_be_false(buddy_allocator_allocate(&allocator, 512, 0, &full));
+
+    // Resize, then free the old state memory.
+    u64 new_memory_requirement = 0;
+    expect_to_be_true(buddy_allocator_resize(&allocator, &new_memory_requirement, 0, 2048, 0));
+    void* new_block = lallocate(new_memory_requirement, MEMORY_TAG_APPLICATION);
+    void* old_block = 0;
+    expect_to_be_true(buddy_allocator_resize(&allocator, &new_memory_requirement, new_block, 2048, &old_block));
+    expect_should_be(block, old_block);
+    lfree(old_block, memory_requirement, MEMORY_TAG_APPLICATION);
+
+    buddy_allocator_stats stats;
+    buddy_allocator_get_stats(&allocator, &stats);
+    expect_should_be(2048, stats.total_size);
+    expect_should_be(2048 - 256 - 64, stats.total_free);
+    expect_should_be(256 + 60, stats.requested_bytes);
+    expect_should_be(2, stats.allocation_count);
+
+    // The new space is usable, and the old allocations can still be freed.
+    expect_to_be_true(buddy_allocator_allocate(&allocator, 1024, 0, &full));
+    expect_should_be(1024, full);
+    expect_to_be_true(buddy_allocator_free(&allocator, 256, a));
+    expect_to_be_true(buddy_allocator_free(&allocator, 60, b));
+    expect_to_be_true(buddy_allocator_free(&allocator, 1024, full));
+    buddy_allocator_get_stats(&allocator, &stats);
+    expect_should_be(2048, stats.largest_free_block);
+
+    buddy_allocator_destroy(&allocator);
+    lfree(new_block, new_memory_requirement, MEMORY_TAG_APPLICATION);
+    return true;
+}
+
+u8 buddy_allocator_should_compact_incrementally() {
+    buddy_allocator allocator;
+    u64 memory_requirement = 0;
+    buddy_allocator_create(1024, 64, &memory_requirement, 0, 0);
+    void* block = lallocate(memory_requirement, MEMORY_TAG_APPLICATION);
+    buddy_allocator_create(1024, 64, &memory_requirement, block, &allocator);
+
+    // Fill with minimum blocks, then free every other one so no two free blocks are buddies.
+    u64 offsets[16];
+    for (u32 i = 0; i < 16; ++i) {
+        expect_to_be_true(buddy_allocator_allocate(&allocator, 64, 0, &offsets[i]));
+    }
+    for (u32 i = 0; i < 16; i += 2) {
+        expect_to_be_true(buddy_allocator_free(&allocator, 64, offsets[i]));
+    }
+    buddy_allocator_stats stats;
+    buddy_allocator_get_stats(&allocator, &stats);
+    expect_should_be(512, stats.total_free);
+    expect_should_be(64, stats.largest_free_block);
+    expect_to_be_true((stats.fragmentation > 0.8f));
+
+    // Limited to two moves, the highest blocks go into the lowest holes.
+    u64 cursor = 1024;
+    buddy_allocator_move moves[8];
+    u32 count = buddy_allocator_compact_step(&allocator, &cursor, 1024, moves, 2);
+    expect_should_be(2, count);
+    expect_should_be(960, moves[0].old_offset);
+    expect_should_be(0, moves[0].new_offset);
+    expect_should_be(64, moves[0].size);
+    expect_should_be(832, moves[1].old_offset);
+    expect_should_be(128, moves[1].new_offset);
+    expect_should_be(832, cursor);
+
+    // The rest of the pass picks up from the cursor. Blocks with no lower hole stay put.
+    u32 more = buddy_allocator_compact_step(&allocator, &cursor, 1024, moves + count, 8 - count);
+    expect_should_be(2, more);
+    count += more;
+    expect_should_be(0, cursor);
+
+    // Old blocks stay allocated until the caller frees them.
+    buddy_allocator_get_stats(&allocator, &stats);
+    expect_should_be(12, stats.allocation_count);
+    for (u32 i = 0; i < count; ++i) {
+        expect_to_be_true((moves[i].new_offset < moves[i].old_offset));
+        expect_to_be_true(buddy_allocator_free(&allocator, moves[i].size, moves[i].old_offset));
+    }
+
+    // Everything live is now packed into the lower half.
+    buddy_allocator_get_stats(&allocator, &stats);
+    expect_should_be(8, stats.allocation_count);
+    expect_should_be(512, stats.largest_free_block);
+    expect_should_be(0, stats.internal_waste);
+    expect_to_be_true((stats.fragmentation < 0.01f));
+
+    // Another pass finds nothing to move.
+    cursor = 1024;
+    expect_should_be(0, buddy_allocator_compact_step(&allocator, &cursor, 1024, moves, 8));
+    expect_should_be(0, cursor);
+
+    buddy_allocator_destroy(&allocator);
+    lfree(block, memory_requirement, MEMORY_TAG_APPLICATION);
+    return true;
+}
+
+void buddy_allocator_register_tests() {
+    test_manager_register_test(buddy_allocator_should_create_and_destroy, "Buddy allocator should create and destroy");
+    test_manager_register_test(buddy_allocator_should_split_and_merge_buddies, "Buddy allocator splits blocks and merges freed buddies");
+    test_manager_register_test(buddy_allocator_should_respect_alignment, "Buddy allocator respects alignment");
+    test_manager_register_test(buddy_allocator_should_handle_non_power_of_two_sizes, "Buddy allocator handles sizes which are not a power of two");
+    test_manager_register_test(buddy_allocator_should_survive_churn, "Buddy allocator never overlaps blocks under churn");
+    test_manager_register_test(buddy_allocator_should_resize_keeping_allocations, "Buddy allocator resizes keeping live allocations");
+    test_manager_register_test(buddy_allocator_should_compact_incrementally, "Buddy allocator compacts live blocks incrementally");
+}
@@ -0,0 +1,3 @@
+#pragma once
+
+void buddy_allocator_register_tests();
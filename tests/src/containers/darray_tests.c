@@ -0,0 +1,206 @@
+#include "darray_tests.h"
+#include "../test_manager.h"
+#include "../expect.h"
+
+#include <defines.h>
+#include <core/lmemory.h>
+#include <memory/allocator.h>
+#include <memory/linear_allocator.h>
+#include <containers/darray.h>
+
+u8 darray_should_insert_and_pop_at()
+{
+    u32* array = darray_create(u32);
+    for (u32 i = 0; i < 8; ++i) {
+        darray_push(array, i * 10);
+    }
+
+    // Front, middle and end (an index of the length appends).
+    darray_insert_at(array, 0, 1);
+    darray_insert_at(array, 4, 2);
+    darray_insert_at(array, darray_length(array), 3);
+    expect_should_be(11, darray_length(array));
+    u32 expected[] = {1, 0, 10, 20, 2, 30, 40, 50, 60, 70, 3};
+    for (u32 i = 0; i < 11; ++i) {
+        expect_should_be(expected[i], array[i]);
+    }
+
+    // Out of bounds does nothing.
+    darray_insert_at(array, 12, 4);
+    expect_should_be(11, darray_length(array));
+
+    // Popping keeps the order of the rest, and touches nothing past the end.
+    u32 popped = 0;
+    darray_pop_at(array, 4, &popped);
+    expect_should_be(2, popped);
+    darray_pop_at(array, 0, &popped);
+    expect_should_be(1, popped);
+    darray_pop_at(array, darray_length(array) - 1, &popped);
+    expect_should_be(3, popped);
+    expect_should_be(8, darray_length(array));
+    for (u32 i = 0; i < 8; ++i) {
+        expect_should_be(i * 10, array[i]);
+    }
+
+    darray_destroy(array);
+    return true;
+}
+
+u8 darray_should_push_n_and_resize()
+{
+    u32 values[100];
+    for (u32 i = 0; i < 100; ++i) {
+        values[i] = i;
+    }
+
+    u32* array = darray_create(u32);
+    darray_push(array, (u32)1000);
+
+    // Grows straight to what is needed, when that is more than doubling.
+    darray_push_n(array, values, 100);
+    expect_should_be(101, darray_length(array));
+    expect_should_be(101, darray_capacity(array));
+    expect_should_be(1000, array[0]);
+    for (u32 i = 0; i < 100; ++i) {
+        expect_should_be(i, array[i + 1]);
+    }
+
+    // Otherwise grows as push would.
+    darray_push_n(array, values, 2);
+    expect_should_be(103, darray_length(array));
+    expect_should_be(202, darray_capacity(array));
+
+    // Nothing to push is fine.
+    darray_push_n(array, values, 0);
+    expect_should_be(103, darray_length(array));
+
+    // Resizing keeps what was there, and leaves the rest to be written.
+    darray_resize_uninit(array, 500);
+    expect_should_be(500, darray_length(array));
+    expect_to_be_true((darray_capacity(array) >= 500));
+    expect_should_be(99, array[100]);
+    array[499] = 499;
+    darray_resize_uninit(array, 2);
+    expect_should_be(2, darray_length(array));
+    expect_should_be(0, array[1]);
+
+    darray_destroy(array);
+    return true;
+}
+
+u8 darray_should_reserve_exact_and_shrink_to_fit()
+{
+    u64* array = darray_create(u64);
+    darray_reserve_exact(array, 37);
+    expect_should_be(37, darray_capacity(array));
+
+    // Never shrinks.
+    darray_reserve_exact(array, 5);
+    expect_should_be(37, darray_capacity(array));
+
+    for (u64 i = 0; i < 10; ++i) {
+        darray_push(array, i);
+    }
+    darray_shrink_to_fit(array);
+    expect_should_be(10, darray_capacity(array));
+    for (u64 i = 0; i < 10; ++i) {
+        expect_should_be(i, array[i]);
+    }
+
+    // An empty array keeps room for one, so pushing still grows.
+    darray_clear(array);
+    darray_shrink_to_fit(array);
+    expect_should_be(DARRAY_DEFAULT_CAPACITY, darray_capacity(array));
+    darray_push(array, (u64)7);
+    darray_push(array, (u64)8);
+    expect_should_be(2, darray_length(array));
+    expect_should_be(8, array[1]);
+
+    darray_destroy(array);
+
+    // Even one created with no room at all.
+    array = darray_reserve(u64, 0);
+    darray_push(array, (u64)9);
+    expect_should_be(1, darray_length(array));
+    expect_should_be(9, array[0]);
+    darray_destroy(array);
+    return true;
+}
+
+u8 darray_should_swap_remove()
+{
+    u32* array = darray_create(u32);
+    for (u32 i = 0; i < 5; ++i) {
+        darray_push(array, i);
+    }
+
+    // The last element fills the hole.
+    u32 removed = 0;
+    darray_swap_remove(array, 1, &removed);
+    expect_should_be(1, removed);
+    expect_should_be(4, darray_length(array));
+    expect_should_be(4, array[1]);
+
+    // Removing the last element just drops it.
+    darray_swap_remove(array, 3, &removed);
+    expect_should_be(3, removed);
+    expect_should_be(3, darray_length(array));
+
+    // The removed element may be discarded.
+    darray_swap_remove(array, 0, 0);
+    expect_should_be(2, darray_length(array));
+    expect_should_be(2, array[0]);
+    expect_should_be(4, array[1]);
+
+    // Out of bounds does nothing.
+    darray_swap_remove(array, 2, 0);
+    expect_should_be(2, darray_length(array));
+
+    darray_destroy(array);
+    return true;
+}
+
+u8 darray_push_n_should_grow_in_place()
+{
+    linear_allocator linear;
+    linear_allocator_create(4096, 0, &linear);
+    allocator_interface scratch = allocator_interface_from_linear(&linear);
+
+    u16 values[64];
+    for (u16 i = 0; i < 64; ++i) {
+        values[i] = i;
+    }
+
+    u16* array = darray_create_with_allocator(u16, &scratch);
+    u16* first = array;
+    for (u32 i = 0; i < 8; ++i) {
+        darray_push_n(array, values, 64);
+    }
+
+    // As the most recent allocation, the array grows in place every time.
+    expect_should_be(first, array);
+    expect_should_be(512, darray_length(array));
+    for (u32 i = 0; i < 512; ++i) {
+        expect_should_be(i % 64, array[i]);
+    }
+
+    // Shrinking in place hands the rest back to the arena.
+    u64 used = linear.allocated;
+    darray_resize_uninit(array, 100);
+    darray_shrink_to_fit(array);
+    expect_should_be(first, array);
+    expect_to_be_true((linear.allocated < used));
+
+    darray_destroy(array);
+    linear_allocator_destroy(&linear);
+    return true;
+}
+
+void darray_register_tests()
+{
+    test_manager_register_test(darray_should_insert_and_pop_at, "Darray inserts and pops at any index, keeping order");
+    test_manager_register_test(darray_should_push_n_and_resize, "Darray pushes many at once and resizes uninitialized");
+    test_manager_register_test(darray_should_reserve_exact_and_shrink_to_fit, "Darray reserves exactly and shrinks to fit");
+    test_manager_register_test(darray_should_swap_remove, "Darray swap removes in O(1)");
+    test_manager_register_test(darray_push_n_should_grow_in_place, "Darray push_n grows in place in a linear allocator");
+}
@@ -285,10 +285,176 @@ u8 freelist_should_allocate_to_full_and_fail_to_allocate_more() {
     return true;
 }
 
+u8 freelist_should_grow_node_pool_with_fragment_count() {
+    freelist list;
+
+    // The memory requirement should not depend on the size being tracked.
+    u64 small_requirement = 0;
+    freelist_create(512, &small_requirement, 0, 0);
+    u64 memory_requirement = 0;
+    u64 total_size = 64 * 1024;
+    freelist_create(total_size, &memory_requirement, 0, 0);
+    expect_should_be(small_requirement, memory_requirement);
+
+    void* block = lallocate(memory_requirement, MEMORY_TAG_APPLICATION);
+    freelist_create(total_size, &memory_requirement, block, &list);
+
+    // Fill the list with small allocations.
+    const u64 alloc_size = 64;
+    const u64 alloc_count = total_size / alloc_size;
+    for (u64 i = 0; i < alloc_count; ++i) {
+        u64 offset = INVALID_ID;
+        b8 result = freelist_allocate_block(&list, alloc_size, &offset);
+        expect_to_be_true(result);
+        expect_should_be(i * alloc_size, offset);
+    }
+
+    // Free every other block. This creates many more free ranges than
+    // there are inline nodes, forcing the node pool to grow.
+    for (u64 i = 0; i < alloc_count; i += 2) {
+        b8 result = freelist_free_block(&list, alloc_size, i * alloc_size);
+        expect_to_be_true(result);
+    }
+    u64 free_space = freelist_free_space(&list);
+    expect_should_be(total_size / 2, free_space);
+
+    // Free the rest, which should merge everything back into one range.
+    for (u64 i = 1; i < alloc_count; i += 2) {
+        b8 result = freelist_free_block(&list, alloc_size, i * alloc_size);
+        expect_to_be_true(result);
+    }
+    free_space = freelist_free_space(&list);
+    expect_should_be(total_size, free_space);
+
+    u64 offset = INVALID_ID;
+    b8 result = freelist_allocate_block(&list, total_size, &offset);
+    expect_to_be_true(result);
+    expect_should_be(0, offset);
+
+    freelist_destroy(&list);
+    expect_should_be(0, list.memory);
+    lfree(block, memory_requirement, MEMORY_TAG_APPLICATION);
+
+    return true;
+}
+
+u8 freelist_should_allocate_best_fit_and_report_stats() {
+    freelist list;
+
+    // Get the memory requirement
+    u64 memory_requirement = 0;
+    u64 total_size = 4096;
+    freelist_create(total_size, &memory_requirement, 0, 0);
+
+    // Allocate and create the freelist.
+    void* block = lallocate(memory_requirement, MEMORY_TAG_APPLICATION);
+    freelist_create(total_size, &memory_requirement, block, &list);
+
+    // Fill the list with blocks of 256, 64, 256, 128, 256 and 256, then the remainder.
+    u64 sizes[7] = {256, 64, 256, 128, 256, 256, total_size - 1216};
+    u64 offsets[7];
+    for (u32 i = 0; i < 7; ++i) {
+        b8 result = freelist_allocate_block(&list, sizes[i], &offsets[i]);
+        expect_to_be_true(result);
+    }
+    expect_should_be(0, freelist_free_space(&list));
+
+    // Free the 64, 128 and last 256 blocks, leaving three holes separated by allocations.
+    freelist_free_block(&list, sizes[1], offsets[1]);
+    freelist_free_block(&list, sizes[3], offsets[3]);
+    freelist_free_block(&list, sizes[5], offsets[5]);
+
+    freelist_stats stats;
+    expect_to_be_true(freelist_get_stats(&list, &stats));
+    expect_should_be(448, stats.total_free);
+    expect_should_be(256, stats.largest_free_block);
+    expect_should_be(3, stats.free_range_count);
+    expect_float_to_be(1.0f - (256.0f / 448.0f), stats.fragmentation);
+
+    // A 100 byte request should land in the 128 hole, not the first (64) or largest (256) one.
+    u64 offset = INVALID_ID;
+    expect_to_be_true(freelist_allocate_block_best(&list, 100, &offset));
+    expect_should_be(offsets[3], offset);
+
+    // An exact fit should consume the 64 hole entirely.
+    expect_to_be_true(freelist_allocate_block_best(&list, 64, &offset));
+    expect_should_be(offsets[1], offset);
+
+    expect_to_be_true(freelist_get_stats(&list, &stats));
+    expect_should_be(284, stats.total_free);
+    expect_should_be(256, stats.largest_free_block);
+    expect_should_be(2, stats.free_range_count);
+
+    // Consuming the largest range should update the largest free block.
+    expect_to_be_true(freelist_allocate_block_best(&list, 256, &offset));
+    expect_should_be(offsets[5], offset);
+    expect_to_be_true(freelist_get_stats(&list, &stats));
+    expect_should_be(28, stats.largest_free_block);
+    expect_should_be(1, stats.free_range_count);
+
+    // Too large for any range.
+    LDEBUG("The following warning message is intentional.");
+    expect_to_be_false(freelist_allocate_block_best(&list, 64, &offset));
+
+    freelist_destroy(&list);
+    lfree(block, memory_requirement, MEMORY_TAG_APPLICATION);
+
+    return true;
+}
+
+u8 freelist_should_allocate_aligned_and_keep_padding_free() {
+    freelist list;
+
+    // Get the memory requirement
+    u64 memory_requirement = 0;
+    u64 total_size = 1024;
+    freelist_create(total_size, &memory_requirement, 0, 0);
+
+    // Allocate and create the freelist.
+    void* block = lallocate(memory_requirement, MEMORY_TAG_APPLICATION);
+    freelist_create(total_size, &memory_requirement, block, &list);
+
+    // Take an odd amount, so the next free offset is unaligned.
+    u64 odd_offset = INVALID_ID;
+    expect_to_be_true(freelist_allocate_block(&list, 10, &odd_offset));
+    expect_should_be(0, odd_offset);
+
+    // The aligned block should skip ahead to offset 64, leaving the 54 bytes before it free.
+    u64 offset = INVALID_ID;
+    expect_to_be_true(freelist_allocate_block_aligned(&list, 100, 64, &offset));
+    expect_should_be(64, offset);
+    expect_should_be(total_size - 110, freelist_free_space(&list));
+
+    freelist_stats stats;
+    freelist_get_stats(&list, &stats);
+    expect_should_be(2, stats.free_range_count);
+
+    // The padding can still be handed out.
+    u64 padding_offset = INVALID_ID;
+    expect_to_be_true(freelist_allocate_block_aligned(&list, 32, 16, &padding_offset));
+    expect_should_be(16, padding_offset);
+
+    // Free everything, which should merge back into a single range.
+    expect_to_be_true(freelist_free_block(&list, 32, padding_offset));
+    expect_to_be_true(freelist_free_block(&list, 100, offset));
+    expect_to_be_true(freelist_free_block(&list, 10, odd_offset));
+    freelist_get_stats(&list, &stats);
+    expect_should_be(total_size, stats.total_free);
+    expect_should_be(1, stats.free_range_count);
+
+    freelist_destroy(&list);
+    lfree(block, memory_requirement, MEMORY_TAG_APPLICATION);
+
+    return true;
+}
+
 void freelist_register_tests() {
     test_manager_register_test(freelist_should_create_and_destroy, "Freelist should create and destroy");
     test_manager_register_test(freelist_should_allocate_one_and_free_one, "Freelist allocate and free one entry.");
     test_manager_register_test(freelist_should_allocate_one_and_free_multi, "Freelist allocate and free multiple entries.");
     test_manager_register_test(freelist_should_allocate_one_and_free_multi_varying_sizes, "Freelist allocate and free multiple entries of varying sizes.");
     test_manager_register_test(freelist_should_allocate_to_full_and_fail_to_allocate_more, "Freelist allocate to full and fail when trying to allocate more.");
+    test_manager_register_test(freelist_should_grow_node_pool_with_fragment_count, "Freelist grows its node pool as free ranges are created.");
+    test_manager_register_test(freelist_should_allocate_best_fit_and_report_stats, "Freelist allocates by best fit and reports fragmentation stats.");
+    test_manager_register_test(freelist_should_allocate_aligned_and_keep_padding_free, "Freelist allocates aligned blocks and keeps the padding free.");
 }
\ No newline at end of file
@@ -3,16 +3,23 @@
 #include "../expect.h"
 
 #include <defines.h>
+#include <core/lhash.h>
+#include <core/lmemory.h>
+#include <core/lstring.h>
 #include <containers/hashtable.h>
+#include <memory/allocator.h>
+#include <core/clock.h>
 
 u8 hashtable_should_create_and_destroy() 
 {
     hashtable table;
     u64 element_size = sizeof(u64);
     u64 element_count = 3;
-    u64 memory[3];
+    u64 memory_requirement = 0;
+    expect_to_be_true(hashtable_create(element_size, element_count, false, &memory_requirement, 0, 0));
+    void* memory = lallocate(memory_requirement, MEMORY_TAG_APPLICATION);
 
-    hashtable_create(element_size, element_count, memory, false, &table);
+    expect_to_be_true(hashtable_create(element_size, element_count, false, &memory_requirement, memory, &table));
 
     expect_should_not_be(0, table.memory);
     expect_should_be(sizeof(u64), table.element_size);
@@ -24,6 +31,8 @@ u8 hashtable_should_create_and_destroy()
     expect_should_be(0, table.element_size);
     expect_should_be(0, table.element_count);
 
+    lfree(memory, memory_requirement, MEMORY_TAG_APPLICATION);
+
     return true;
 }
 
@@ -33,9 +42,11 @@ u8 hashtable_should_set_and_get_successfully()
     hashtable table;
     u64 element_size = sizeof(u64);
     u64 element_count = 3;
-    u64 memory[3];
+    u64 memory_requirement = 0;
+    expect_to_be_true(hashtable_create(element_size, element_count, false, &memory_requirement, 0, 0));
+    void* memory = lallocate(memory_requirement, MEMORY_TAG_APPLICATION);
 
-    hashtable_create(element_size, element_count, memory, false, &table);
+    expect_to_be_true(hashtable_create(element_size, element_count, false, &memory_requirement, memory, &table));
 
     expect_should_not_be(0, table.memory);
     expect_should_be(sizeof(u64), table.element_size);
@@ -53,6 +64,8 @@ u8 hashtable_should_set_and_get_successfully()
     expect_should_be(0, table.element_size);
     expect_should_be(0, table.element_count);
 
+    lfree(memory, memory_requirement, MEMORY_TAG_APPLICATION);
+
     return true;
 }
 
@@ -67,9 +80,11 @@ u8 hashtable_should_set_and_get_ptr_successfully()
     hashtable table;
     u64 element_size = sizeof(ht_test_struct*);
     u64 element_count = 3;
-    ht_test_struct* memory[3];
+    u64 memory_requirement = 0;
+    expect_to_be_true(hashtable_create(element_size, element_count, true, &memory_requirement, 0, 0));
+    void* memory = lallocate(memory_requirement, MEMORY_TAG_APPLICATION);
 
-    hashtable_create(element_size, element_count, memory, true, &table);
+    expect_to_be_true(hashtable_create(element_size, element_count, true, &memory_requirement, memory, &table));
 
     expect_should_not_be(0, table.memory);
     expect_should_be(sizeof(ht_test_struct*), table.element_size);
@@ -94,6 +109,8 @@ u8 hashtable_should_set_and_get_ptr_successfully()
     expect_should_be(0, table.element_size);
     expect_should_be(0, table.element_count);
 
+    lfree(memory, memory_requirement, MEMORY_TAG_APPLICATION);
+
     return true;
 }
 
@@ -102,9 +119,11 @@ u8 hashtable_should_set_and_get_nonexistant()
     hashtable table;
     u64 element_size = sizeof(u64);
     u64 element_count = 3;
-    u64 memory[3];
+    u64 memory_requirement = 0;
+    expect_to_be_true(hashtable_create(element_size, element_count, false, &memory_requirement, 0, 0));
+    void* memory = lallocate(memory_requirement, MEMORY_TAG_APPLICATION);
 
-    hashtable_create(element_size, element_count, memory, false, &table);
+    expect_to_be_true(hashtable_create(element_size, element_count, false, &memory_requirement, memory, &table));
 
     expect_should_not_be(0, table.memory);
     expect_should_be(sizeof(u64), table.element_size);
@@ -113,7 +132,7 @@ u8 hashtable_should_set_and_get_nonexistant()
     u64 testval1 = 23;
     hashtable_set(&table, "test1", &testval1);
     u64 get_testval_1 = 0;
-    hashtable_get(&table, "test2", &get_testval_1);
+    expect_to_be_false(hashtable_get(&table, "test2", &get_testval_1));
     expect_should_be(0, get_testval_1);
 
     hashtable_destroy(&table);
@@ -122,6 +141,8 @@ u8 hashtable_should_set_and_get_nonexistant()
     expect_should_be(0, table.element_size);
     expect_should_be(0, table.element_count);
 
+    lfree(memory, memory_requirement, MEMORY_TAG_APPLICATION);
+
     return true;
 }
 
@@ -130,9 +151,11 @@ u8 hashtable_should_set_and_get_ptr_nonexistant()
     hashtable table;
     u64 element_size = sizeof(ht_test_struct*);
     u64 element_count = 3;
-    ht_test_struct* memory[3];
+    u64 memory_requirement = 0;
+    expect_to_be_true(hashtable_create(element_size, element_count, true, &memory_requirement, 0, 0));
+    void* memory = lallocate(memory_requirement, MEMORY_TAG_APPLICATION);
 
-    hashtable_create(element_size, element_count, memory, true, &table);
+    expect_to_be_true(hashtable_create(element_size, element_count, true, &memory_requirement, memory, &table));
 
     expect_should_not_be(0, table.memory);
     expect_should_be(sizeof(ht_test_struct*), table.element_size);
@@ -157,6 +180,8 @@ u8 hashtable_should_set_and_get_ptr_nonexistant()
     expect_should_be(0, table.element_size);
     expect_should_be(0, table.element_count);
 
+    lfree(memory, memory_requirement, MEMORY_TAG_APPLICATION);
+
     return true;
 }
 
@@ -165,9 +190,11 @@ u8 hashtable_should_set_and_unset_ptr()
     hashtable table;
     u64 element_size = sizeof(ht_test_struct*);
     u64 element_count = 3;
-    ht_test_struct* memory[3];
+    u64 memory_requirement = 0;
+    expect_to_be_true(hashtable_create(element_size, element_count, true, &memory_requirement, 0, 0));
+    void* memory = lallocate(memory_requirement, MEMORY_TAG_APPLICATION);
 
-    hashtable_create(element_size, element_count, memory, true, &table);
+    expect_to_be_true(hashtable_create(element_size, element_count, true, &memory_requirement, memory, &table));
 
     expect_should_not_be(0, table.memory);
     expect_should_be(sizeof(ht_test_struct*), table.element_size);
@@ -204,6 +231,8 @@ u8 hashtable_should_set_and_unset_ptr()
     expect_should_be(0, table.element_size);
     expect_should_be(0, table.element_count);
 
+    lfree(memory, memory_requirement, MEMORY_TAG_APPLICATION);
+
     return true;
 }
 
@@ -212,9 +241,11 @@ u8 hashtable_try_call_non_ptr_on_ptr_table()
     hashtable table;
     u64 element_size = sizeof(ht_test_struct*);
     u64 element_count = 3;
-    ht_test_struct* memory[3];
+    u64 memory_requirement = 0;
+    expect_to_be_true(hashtable_create(element_size, element_count, true, &memory_requirement, 0, 0));
+    void* memory = lallocate(memory_requirement, MEMORY_TAG_APPLICATION);
 
-    hashtable_create(element_size, element_count, memory, true, &table);
+    expect_to_be_true(hashtable_create(element_size, element_count, true, &memory_requirement, memory, &table));
 
     expect_should_not_be(0, table.memory);
     expect_should_be(sizeof(ht_test_struct*), table.element_size);
@@ -241,6 +272,8 @@ u8 hashtable_try_call_non_ptr_on_ptr_table()
     expect_should_be(0, table.element_size);
     expect_should_be(0, table.element_count);
 
+    lfree(memory, memory_requirement, MEMORY_TAG_APPLICATION);
+
     return true;
 }
 
@@ -249,9 +282,11 @@ u8 hashtable_try_call_ptr_on_non_ptr_table()
     hashtable table;
     u64 element_size = sizeof(ht_test_struct);
     u64 element_count = 3;
-    ht_test_struct memory[3];
+    u64 memory_requirement = 0;
+    expect_to_be_true(hashtable_create(element_size, element_count, false, &memory_requirement, 0, 0));
+    void* memory = lallocate(memory_requirement, MEMORY_TAG_APPLICATION);
 
-    hashtable_create(element_size, element_count, memory, false, &table);
+    expect_to_be_true(hashtable_create(element_size, element_count, false, &memory_requirement, memory, &table));
 
     expect_should_not_be(0, table.memory);
     expect_should_be(sizeof(ht_test_struct), table.element_size);
@@ -279,6 +314,8 @@ u8 hashtable_try_call_ptr_on_non_ptr_table()
     expect_should_be(0, table.element_size);
     expect_should_be(0, table.element_count);
 
+    lfree(memory, memory_requirement, MEMORY_TAG_APPLICATION);
+
     return true;
 }
 
@@ -287,9 +324,11 @@ u8 hashtable_should_set_get_and_update_ptr_successfully()
     hashtable table;
     u64 element_size = sizeof(ht_test_struct*);
     u64 element_count = 3;
-    ht_test_struct* memory[3];
+    u64 memory_requirement = 0;
+    expect_to_be_true(hashtable_create(element_size, element_count, true, &memory_requirement, 0, 0));
+    void* memory = lallocate(memory_requirement, MEMORY_TAG_APPLICATION);
 
-    hashtable_create(element_size, element_count, memory, true, &table);
+    expect_to_be_true(hashtable_create(element_size, element_count, true, &memory_requirement, memory, &table));
 
     expect_should_not_be(0, table.memory);
     expect_should_be(sizeof(ht_test_struct*), table.element_size);
@@ -325,6 +364,377 @@ u8 hashtable_should_set_get_and_update_ptr_successfully()
     expect_should_be(0, table.element_size);
     expect_should_be(0, table.element_count);
 
+    lfree(memory, memory_requirement, MEMORY_TAG_APPLICATION);
+
+    return true;
+}
+
+u8 hashtable_should_keep_colliding_entries_apart()
+{
+    // Filling the table means many names share a home slot and must probe past each other.
+    const u32 entry_count = 64;
+    hashtable table;
+    u64 memory_requirement = 0;
+    expect_to_be_true(hashtable_create(sizeof(u32), entry_count, false, &memory_requirement, 0, 0));
+    void* memory = lallocate(memory_requirement, MEMORY_TAG_APPLICATION);
+    expect_to_be_true(hashtable_create(sizeof(u32), entry_count, false, &memory_requirement, memory, &table));
+
+    char names[64][32];
+    for (u32 i = 0; i < entry_count; ++i) {
+        string_format(names[i], "textures/level03/wall_%u", i);
+        expect_to_be_true(hashtable_set(&table, names[i], &i));
+    }
+    expect_should_be(entry_count, table.count);
+
+    // Every entry reads back its own value.
+    for (u32 i = 0; i < entry_count; ++i) {
+        u32 value = INVALID_ID;
+        expect_to_be_true(hashtable_get(&table, names[i], &value));
+        expect_should_be(i, value);
+    }
+
+    // The table is full, so a new name is refused, but existing ones can still be updated.
+    u32 extra = 1000;
+    LDEBUG("The following error message is intentional.");
+    expect_to_be_false(hashtable_set(&table, "textures/level03/one_too_many", &extra));
+    expect_to_be_true(hashtable_set(&table, names[7], &extra));
+    u32 value = 0;
+    expect_to_be_true(hashtable_get(&table, names[7], &value));
+    expect_should_be(1000, value);
+
+    hashtable_destroy(&table);
+    lfree(memory, memory_requirement, MEMORY_TAG_APPLICATION);
+
+    return true;
+}
+
+u8 hashtable_should_remove_entries()
+{
+    const u32 entry_count = 32;
+    hashtable table;
+    u64 memory_requirement = 0;
+    expect_to_be_true(hashtable_create(sizeof(u32), entry_count, false, &memory_requirement, 0, 0));
+    void* memory = lallocate(memory_requirement, MEMORY_TAG_APPLICATION);
+    expect_to_be_true(hashtable_create(sizeof(u32), entry_count, false, &memory_requirement, memory, &table));
+
+    char names[32][32];
+    for (u32 i = 0; i < entry_count; ++i) {
+        string_format(names[i], "materials/brick_%u", i);
+        expect_to_be_true(hashtable_set(&table, names[i], &i));
+    }
+
+    // Remove every other entry.
+    for (u32 i = 0; i < entry_count; i += 2) {
+        expect_to_be_true(hashtable_remove(&table, names[i]));
+    }
+    expect_should_be(entry_count / 2, table.count);
+
+    // Removing again finds nothing.
+    expect_to_be_false(hashtable_remove(&table, names[0]));
+
+    // Removed entries miss, and the rest are still reachable past the gaps.
+    for (u32 i = 0; i < entry_count; ++i) {
+        u32 value = INVALID_ID;
+        b8 found = hashtable_get(&table, names[i], &value);
+        if (i % 2) {
+            expect_to_be_true(found);
+            expect_should_be(i, value);
+        } else {
+            expect_to_be_false(found);
+            expect_should_be(INVALID_ID, value);
+        }
+    }
+
+    // The space is usable again.
+    for (u32 i = 0; i < entry_count; i += 2) {
+        expect_to_be_true(hashtable_set(&table, names[i], &i));
+    }
+    expect_should_be(entry_count, table.count);
+
+    hashtable_clear(&table);
+    expect_should_be(0, table.count);
+    u32 value = 0;
+    expect_to_be_false(hashtable_get(&table, names[1], &value));
+
+    hashtable_destroy(&table);
+    lfree(memory, memory_requirement, MEMORY_TAG_APPLICATION);
+
+    return true;
+}
+
+u8 hashtable_should_keep_probes_short_when_full()
+{
+    // Matches the texture system's default capacity.
+    const u32 entry_count = 65536;
+    hashtable table;
+    u64 memory_requirement = 0;
+    expect_to_be_true(hashtable_create(sizeof(u32), entry_count, false, &memory_requirement, 0, 0));
+    void* memory = lallocate(memory_requirement, MEMORY_TAG_APPLICATION);
+    expect_to_be_true(hashtable_create(sizeof(u32), entry_count, false, &memory_requirement, memory, &table));
+
+    // Keys must outlive their entries, so keep them all in one block.
+    const u64 name_length = 48;
+    char* names = lallocate(name_length * entry_count, MEMORY_TAG_APPLICATION);
+    for (u32 i = 0; i < entry_count; ++i) {
+        char* name = names + (name_length * i);
+        string_format(name, "textures/level%02u/prop_%05u_diff", i % 32, i);
+        expect_to_be_true(hashtable_set(&table, name, &i));
+    }
+
+    hashtable_stats stats;
+    expect_to_be_true(hashtable_get_stats(&table, &stats));
+    expect_should_be(entry_count, stats.count);
+    expect_to_be_true((stats.load_factor <= HASHTABLE_MAX_LOAD_FACTOR));
+    expect_to_be_true((stats.average_probe_length < 3.0f));
+    expect_to_be_true((stats.max_probe_length < 64));
+
+    for (u32 i = 0; i < entry_count; ++i) {
+        u32 value = INVALID_ID;
+        expect_to_be_true(hashtable_get(&table, names + (name_length * i), &value));
+        expect_should_be(i, value);
+    }
+    u32 value = 0;
+    expect_to_be_false(hashtable_get(&table, "textures/level99/missing", &value));
+
+    hashtable_destroy(&table);
+    lfree(names, name_length * entry_count, MEMORY_TAG_APPLICATION);
+    lfree(memory, memory_requirement, MEMORY_TAG_APPLICATION);
+
+    return true;
+}
+
+u8 hashtable_should_accept_precomputed_hashes()
+{
+    hashtable table;
+    u64 memory_requirement = 0;
+    expect_to_be_true(hashtable_create(sizeof(u64), 8, false, &memory_requirement, 0, 0));
+    void* memory = lallocate(memory_requirement, MEMORY_TAG_APPLICATION);
+    expect_to_be_true(hashtable_create(sizeof(u64), 8, false, &memory_requirement, memory, &table));
+
+    // Capacity is a power of two, at or under the maximum load factor when full.
+    expect_should_be(0, (table.capacity & (table.capacity - 1)));
+    expect_to_be_true(((f32)table.element_count / (f32)table.capacity <= HASHTABLE_MAX_LOAD_FACTOR));
+
+    const char* name = "materials/stone_floor";
+    u64 hash = hash_string(name);
+    u64 value = 17;
+    expect_to_be_true(hashtable_set_hashed(&table, name, hash, &value));
+
+    // Hashed and unhashed calls find the same entry.
+    u64 out_value = 0;
+    expect_to_be_true(hashtable_get(&table, name, &out_value));
+    expect_should_be(17, out_value);
+    out_value = 0;
+    expect_to_be_true(hashtable_get_hashed(&table, name, hash, &out_value));
+    expect_should_be(17, out_value);
+
+    expect_to_be_true(hashtable_remove_hashed(&table, name, hash));
+    expect_to_be_false(hashtable_get(&table, name, &out_value));
+
+    hashtable_destroy(&table);
+    lfree(memory, memory_requirement, MEMORY_TAG_APPLICATION);
+
+    return true;
+}
+
+u8 hashtable_growable_should_rehash_incrementally()
+{
+    allocator_interface allocator = allocator_interface_default(MEMORY_TAG_DICT);
+    hashtable table;
+    expect_to_be_true(hashtable_create_growable(sizeof(u32), 16, false, &allocator, &table));
+    expect_to_be_true(table.growable);
+    u32 initial_capacity = table.capacity;
+
+    const u32 entry_count = 20000;
+    const u64 name_length = 40;
+    char* names = lallocate(name_length * entry_count, MEMORY_TAG_APPLICATION);
+
+    b8 saw_rehash = false;
+    for (u32 i = 0; i < entry_count; ++i) {
+        char* name = names + (name_length * i);
+        string_format(name, "textures/level%02u/decal_%05u", i % 16, i);
+        u32 capacity_before = table.capacity;
+        expect_to_be_true(hashtable_set(&table, name, &i));
+
+        if (table.capacity != capacity_before) {
+            // Growing only moves a few slots over; the rest stay where they were for now.
+            expect_should_be(capacity_before * 2, table.capacity);
+            expect_should_not_be(0, table.previous_count);
+            saw_rehash = true;
+        }
+
+        if (table.previous_memory) {
+            // Every entry is still found while entries are split across both sets of slots.
+            u32 value = INVALID_ID;
+            expect_to_be_true(hashtable_get(&table, names, &value));
+            expect_should_be(0, value);
+            expect_to_be_true(hashtable_get(&table, name, &value));
+            expect_should_be(i, value);
+        }
+    }
+    expect_to_be_true(saw_rehash);
+    expect_should_be(entry_count, table.count);
+    expect_to_be_true((table.capacity > initial_capacity));
+
+    for (u32 i = 0; i < entry_count; ++i) {
+        u32 value = INVALID_ID;
+        expect_to_be_true(hashtable_get(&table, names + (name_length * i), &value));
+        expect_should_be(i, value);
+    }
+
+    hashtable_stats stats;
+    expect_to_be_true(hashtable_get_stats(&table, &stats));
+    expect_to_be_true((stats.load_factor <= HASHTABLE_MAX_LOAD_FACTOR));
+    u32 grown_capacity = table.capacity;
+
+    // Unload most of it, as when a level goes away. The table gives memory back as it empties.
+    for (u32 i = 16; i < entry_count; ++i) {
+        expect_to_be_true(hashtable_remove(&table, names + (name_length * i)));
+    }
+    expect_should_be(16, table.count);
+    expect_to_be_true((table.capacity < grown_capacity));
+    expect_to_be_true((table.capacity >= initial_capacity));
+    for (u32 i = 0; i < 16; ++i) {
+        u32 value = INVALID_ID;
+        expect_to_be_true(hashtable_get(&table, names + (name_length * i), &value));
+        expect_should_be(i, value);
+    }
+
+    hashtable_destroy(&table);
+    expect_should_be(0, table.memory);
+    expect_should_be(0, table.previous_memory);
+    lfree(names, name_length * entry_count, MEMORY_TAG_APPLICATION);
+
+    return true;
+}
+
+u8 hashtable_should_get_batch()
+{
+    hashtable table;
+    u64 memory_requirement = 0;
+    expect_to_be_true(hashtable_create(sizeof(u32), 64, false, &memory_requirement, 0, 0));
+    void* memory = lallocate(memory_requirement, MEMORY_TAG_APPLICATION);
+    expect_to_be_true(hashtable_create(sizeof(u32), 64, false, &memory_requirement, memory, &table));
+
+    char names[64][32];
+    for (u32 i = 0; i < 64; ++i) {
+        string_format(names[i], "materials/tile_%u", i);
+        if (i % 3) {
+            expect_to_be_true(hashtable_set(&table, names[i], &i));
+        }
+    }
+
+    // More names than a single batch, with every third one missing and one null.
+    const char* lookups[64];
+    u32 values[64];
+    for (u32 i = 0; i < 64; ++i) {
+        lookups[i] = names[63 - i];
+        values[i] = INVALID_ID;
+    }
+    lookups[10] = 0;
+
+    u32 found = hashtable_get_batch(&table, lookups, 64, values);
+    u32 expected_found = 0;
+    for (u32 i = 0; i < 64; ++i) {
+        u32 name_index = 63 - i;
+        if (lookups[i] && (name_index % 3)) {
+            expected_found++;
+            expect_should_be(name_index, values[i]);
+        } else {
+            expect_should_be(INVALID_ID, values[i]);
+        }
+    }
+    expect_should_be(expected_found, found);
+
+    hashtable_destroy(&table);
+    lfree(memory, memory_requirement, MEMORY_TAG_APPLICATION);
+
+    return true;
+}
+
+// Times resolving every name in a table of the given size once per round, one at a time and
+// then in batches of 256, in a shuffled order so consecutive lookups land in unrelated slots.
+static b8 time_lookups(u32 entry_count, u32 rounds, f64* out_single, f64* out_batch)
+{
+    const u64 name_length = 48;
+    const u32 batch = 256;
+    allocator_interface allocator = allocator_interface_default(MEMORY_TAG_DICT);
+    hashtable table;
+    if (!hashtable_create_with_allocator(sizeof(u32), entry_count, false, &allocator, &table)) {
+        return false;
+    }
+
+    char* names = lallocate(name_length * entry_count, MEMORY_TAG_APPLICATION);
+    const char** lookups = lallocate(sizeof(const char*) * entry_count, MEMORY_TAG_APPLICATION);
+    u32* values = lallocate(sizeof(u32) * entry_count, MEMORY_TAG_APPLICATION);
+    for (u32 i = 0; i < entry_count; ++i) {
+        char* name = names + (name_length * i);
+        string_format(name, "textures/level%02u/prop_%05u_diff", i % 32, i);
+        hashtable_set(&table, name, &i);
+        lookups[i] = name;
+    }
+    u32 random = 0x9E3779B9;
+    for (u32 i = entry_count - 1; i > 0; --i) {
+        random ^= random << 13;
+        random ^= random >> 17;
+        random ^= random << 5;
+        u32 j = random % (i + 1);
+        const char* temp = lookups[i];
+        lookups[i] = lookups[j];
+        lookups[j] = temp;
+    }
+
+    b8 matched = true;
+    clock timer;
+    clock_start(&timer);
+    for (u32 r = 0; r < rounds; ++r) {
+        for (u32 i = 0; i < entry_count; ++i) {
+            hashtable_get(&table, lookups[i], &values[i]);
+        }
+    }
+    clock_update(&timer);
+    *out_single = timer.elapsed;
+    u64 single_sum = 0;
+    for (u32 i = 0; i < entry_count; ++i) {
+        single_sum += values[i];
+        values[i] = INVALID_ID;
+    }
+
+    clock_start(&timer);
+    for (u32 r = 0; r < rounds; ++r) {
+        for (u32 i = 0; i < entry_count; i += batch) {
+            u32 n = entry_count - i < batch ? entry_count - i : batch;
+            matched = matched && hashtable_get_batch(&table, lookups + i, n, values + i) == n;
+        }
+    }
+    clock_update(&timer);
+    *out_batch = timer.elapsed;
+    u64 batch_sum = 0;
+    for (u32 i = 0; i < entry_count; ++i) {
+        batch_sum += values[i];
+    }
+    matched = matched && single_sum == batch_sum;
+
+    lfree(values, sizeof(u32) * entry_count, MEMORY_TAG_APPLICATION);
+    lfree(lookups, sizeof(const char*) * entry_count, MEMORY_TAG_APPLICATION);
+    lfree(names, name_length * entry_count, MEMORY_TAG_APPLICATION);
+    hashtable_destroy(&table);
+    return matched;
+}
+
+// Benchmark. Only the results are checked, as the gain depends on the machine's memory system.
+u8 hashtable_get_batch_benchmark()
+{
+    f64 small_single = 0;
+    f64 small_batch = 0;
+    f64 large_single = 0;
+    f64 large_batch = 0;
+    expect_to_be_true(time_lookups(1024, 256, &small_single, &small_batch));
+    expect_to_be_true(time_lookups(65536, 4, &large_single, &large_batch));
+
+    LINFO("Hashtable lookups, 1K entries x256: single %.2fms, batch %.2fms (%.2fx). 64K entries x4: single %.2fms, batch %.2fms (%.2fx).",
+          small_single * 1000.0, small_batch * 1000.0, small_batch > 0.0 ? small_single / small_batch : 0.0,
+          large_single * 1000.0, large_batch * 1000.0, large_batch > 0.0 ? large_single / large_batch : 0.0);
     return true;
 }
 
@@ -339,4 +749,11 @@ void hashtable_register_tests()
     test_manager_register_test(hashtable_try_call_non_ptr_on_ptr_table, "Hashtable try calling non-pointer functions on pointer type table.");
     test_manager_register_test(hashtable_try_call_ptr_on_non_ptr_table, "Hashtable try calling pointer functions on non-pointer type table.");
     test_manager_register_test(hashtable_should_set_get_and_update_ptr_successfully, "Hashtable Should get pointer, update, and get again successfully.");
+    test_manager_register_test(hashtable_should_keep_colliding_entries_apart, "Hashtable should keep entries sharing a home slot apart.");
+    test_manager_register_test(hashtable_should_remove_entries, "Hashtable should remove entries and keep the rest reachable.");
+    test_manager_register_test(hashtable_should_keep_probes_short_when_full, "Hashtable should keep probes short with 65536 entries.");
+    test_manager_register_test(hashtable_should_accept_precomputed_hashes, "Hashtable should accept precomputed hashes.");
+    test_manager_register_test(hashtable_growable_should_rehash_incrementally, "Growable hashtable should grow and shrink, rehashing incrementally.");
+    test_manager_register_test(hashtable_should_get_batch, "Hashtable should look up a batch of names.");
+    test_manager_register_test(hashtable_get_batch_benchmark, "Hashtable single and batch lookups at 1K and 64K entries (benchmark)");
 }
\ No newline at end of file
@@ -0,0 +1,317 @@
+#include "ring_queue_tests.h"
+#include "../test_manager.h"
+#include "../expect.h"
+
+#include <defines.h>
+#include <core/lmemory.h>
+#include <core/lthread.h>
+#include <containers/ring_queue.h>
+
+#define QUEUE_THREAD_COUNT 4
+#define QUEUE_ITEMS_PER_PRODUCER 50000
+#define QUEUE_BATCH_SIZE 16
+
+u8 spsc_queue_should_enqueue_and_dequeue()
+{
+    u64 memory_requirement = 0;
+    spsc_queue queue;
+    // Rounded up to a power of two.
+    expect_to_be_true(spsc_queue_create(sizeof(u32), 6, &memory_requirement, 0, 0));
+    expect_should_be(sizeof(u32) * 8, memory_requirement);
+    void* memory = lallocate(memory_requirement, MEMORY_TAG_RING_QUEUE);
+    expect_to_be_true(spsc_queue_create(sizeof(u32), 6, &memory_requirement, memory, &queue));
+    expect_should_be(8, queue.capacity);
+
+    u32 value = 0;
+    expect_to_be_false(spsc_queue_dequeue(&queue, &value));
+
+    for (u32 i = 0; i < 8; ++i) {
+        expect_to_be_true(spsc_queue_enqueue(&queue, &i));
+    }
+    u32 extra = 8;
+    expect_to_be_false(spsc_queue_enqueue(&queue, &extra));
+    expect_should_be(8, spsc_queue_count(&queue));
+
+    for (u32 i = 0; i < 5; ++i) {
+        expect_to_be_true(spsc_queue_dequeue(&queue, &value));
+        expect_should_be(i, value);
+    }
+
+    // Only as many as fit are added, wrapping around the end of the ring.
+    u32 batch[8] = {10, 11, 12, 13, 14, 15, 16, 17};
+    expect_should_be(5, spsc_queue_enqueue_batch(&queue, batch, 8));
+    expect_should_be(0, spsc_queue_enqueue_batch(&queue, batch, 8));
+
+    u32 out[16];
+    expect_should_be(8, spsc_queue_dequeue_batch(&queue, out, 16));
+    u32 expected[] = {5, 6, 7, 10, 11, 12, 13, 14};
+    for (u32 i = 0; i < 8; ++i) {
+        expect_should_be(expected[i], out[i]);
+    }
+    expect_should_be(0, spsc_queue_dequeue_batch(&queue, out, 16));
+    expect_should_be(0, spsc_queue_count(&queue));
+
+    spsc_queue_destroy(&queue);
+    lfree(memory, memory_requirement, MEMORY_TAG_RING_QUEUE);
+    return true;
+}
+
+u8 mpmc_queue_should_enqueue_and_dequeue()
+{
+    u64 memory_requirement = 0;
+    mpmc_queue queue;
+    expect_to_be_true(mpmc_queue_create(3, 4, &memory_requirement, 0, 0));
+    // Each slot is its sequence number then the element, padded to 8 bytes.
+    expect_should_be(16 * 4, memory_requirement);
+    void* memory = lallocate(memory_requirement, MEMORY_TAG_RING_QUEUE);
+    expect_to_be_true(mpmc_queue_create(3, 4, &memory_requirement, memory, &queue));
+
+    u8 value[3];
+    expect_to_be_false(mpmc_queue_dequeue(&queue, value));
+    for (u8 i = 0; i < 4; ++i) {
+        u8 element[3] = {i, (u8)(i + 1), (u8)(i + 2)};
+        expect_to_be_true(mpmc_queue_enqueue(&queue, element));
+    }
+    expect_to_be_false(mpmc_queue_enqueue(&queue, value));
+
+    for (u8 i = 0; i < 2; ++i) {
+        expect_to_be_true(mpmc_queue_dequeue(&queue, value));
+        expect_should_be(i, value[0]);
+        expect_should_be(i + 2, value[2]);
+    }
+
+    u8 batch[4][3] = {{10, 0, 0}, {11, 0, 0}, {12, 0, 0}, {13, 0, 0}};
+    expect_should_be(2, mpmc_queue_enqueue_batch(&queue, batch, 4));
+    expect_should_be(0, mpmc_queue_enqueue_batch(&queue, batch, 4));
+
+    u8 out[8][3];
+    expect_should_be(4, mpmc_queue_dequeue_batch(&queue, out, 8));
+    u8 expected[] = {2, 3, 10, 11};
+    for (u32 i = 0; i < 4; ++i) {
+        expect_should_be(expected[i], out[i][0]);
+    }
+    expect_should_be(0, mpmc_queue_dequeue_batch(&queue, out, 8));
+
+    // A single slot would let a full queue look empty to producers, so there are always at least two.
+    mpmc_queue small;
+    u64 small_requirement = 0;
+    expect_to_be_true(mpmc_queue_create(sizeof(u64), 1, &small_requirement, memory, &small));
+    expect_should_be(2, small.capacity);
+
+    mpmc_queue_destroy(&small);
+    mpmc_queue_destroy(&queue);
+    lfree(memory, memory_requirement, MEMORY_TAG_RING_QUEUE);
+    return true;
+}
+
+typedef struct spsc_producer_params {
+    spsc_queue* queue;
+    u64 count;
+} spsc_producer_params;
+
+static u32 spsc_producer(void* params)
+{
+    spsc_producer_params* p = params;
+    u64 next = 0;
+    u64 batch[QUEUE_BATCH_SIZE];
+    while (next < p->count) {
+        // Alternate single and batch enqueues, so both are exercised against the consumer.
+        if ((next / QUEUE_BATCH_SIZE) % 2) {
+            u64 n = p->count - next < QUEUE_BATCH_SIZE ? p->count - next : QUEUE_BATCH_SIZE;
+            for (u64 i = 0; i < n; ++i) {
+                batch[i] = next + i;
+            }
+            u32 added = spsc_queue_enqueue_batch(p->queue, batch, (u32)n);
+            if (!added) {
+                lthread_yield();
+            }
+            next += added;
+        } else if (spsc_queue_enqueue(p->queue, &next)) {
+            next++;
+        } else {
+            // Full. Let the consumer catch up.
+            lthread_yield();
+        }
+    }
+    return 0;
+}
+
+u8 spsc_queue_should_keep_order_across_threads()
+{
+    u64 memory_requirement = 0;
+    spsc_queue queue;
+    spsc_queue_create(sizeof(u64), 256, &memory_requirement, 0, 0);
+    void* memory = lallocate(memory_requirement, MEMORY_TAG_RING_QUEUE);
+    expect_to_be_true(spsc_queue_create(sizeof(u64), 256, &memory_requirement, memory, &queue));
+
+    spsc_producer_params params = {&queue, QUEUE_ITEMS_PER_PRODUCER * QUEUE_THREAD_COUNT};
+    lthread producer;
+    expect_to_be_true(lthread_create(spsc_producer, &params, false, &producer));
+
+    // Every value arrives exactly once, in the order it was sent.
+    u64 expected = 0;
+    b8 in_order = true;
+    u64 out[QUEUE_BATCH_SIZE];
+    while (expected < params.count) {
+        u32 n = 0;
+        if (expected % 3) {
+            n = spsc_queue_dequeue_batch(&queue, out, QUEUE_BATCH_SIZE);
+        } else {
+            n = spsc_queue_dequeue(&queue, out) ? 1 : 0;
+        }
+        if (!n) {
+            // Empty. Let the producer catch up.
+            lthread_yield();
+        }
+        for (u32 i = 0; i < n; ++i) {
+            in_order = in_order && (out[i] == expected);
+            expected++;
+        }
+    }
+
+    expect_to_be_true(lthread_wait(&producer));
+    lthread_destroy(&producer);
+    expect_to_be_true(in_order);
+    expect_should_be(0, spsc_queue_count(&queue));
+
+    spsc_queue_destroy(&queue);
+    lfree(memory, memory_requirement, MEMORY_TAG_RING_QUEUE);
+    return true;
+}
+
+typedef struct mpmc_thread_params {
+    mpmc_queue* queue;
+    u32 index;
+    b8 use_batches;
+    // Consumers: whether each producer's values came in the order they were sent.
+    b8 in_order;
+    // Shared by the consumers. The number of times each value was taken, and the number still to be taken.
+    u8* seen;
+    u64* remaining;
+} mpmc_thread_params;
+
+// Values are the producer's index in the top bits and a running count in the rest.
+#define MPMC_VALUE(producer, count) (((u64)(producer) << 48) | (count))
+
+static u32 mpmc_producer(void* params)
+{
+    mpmc_thread_params* p = params;
+    u64 next = 0;
+    u64 batch[QUEUE_BATCH_SIZE];
+    while (next < QUEUE_ITEMS_PER_PRODUCER) {
+        if (p->use_batches) {
+            u64 n = QUEUE_ITEMS_PER_PRODUCER - next < QUEUE_BATCH_SIZE ? QUEUE_ITEMS_PER_PRODUCER - next : QUEUE_BATCH_SIZE;
+            for (u64 i = 0; i < n; ++i) {
+                batch[i] = MPMC_VALUE(p->index, next + i);
+            }
+            u32 added = mpmc_queue_enqueue_batch(p->queue, batch, (u32)n);
+            if (!added) {
+                lthread_yield();
+            }
+            next += added;
+        } else {
+            u64 value = MPMC_VALUE(p->index, next);
+            if (mpmc_queue_enqueue(p->queue, &value)) {
+                next++;
+            } else {
+                lthread_yield();
+            }
+        }
+    }
+    return 0;
+}
+
+static u32 mpmc_consumer(void* params)
+{
+    mpmc_thread_params* p = params;
+    // Positions are dequeued in increasing order, and each producer's values were given increasing
+    // positions, so any one consumer sees each producer's values in order, if not all of them.
+    u64 next_expected[QUEUE_THREAD_COUNT] = {0};
+    u64 out[QUEUE_BATCH_SIZE];
+    while (__atomic_load_n(p->remaining, __ATOMIC_RELAXED) > 0) {
+        u32 n = 0;
+        if (p->use_batches) {
+            n = mpmc_queue_dequeue_batch(p->queue, out, QUEUE_BATCH_SIZE);
+        } else {
+            n = mpmc_queue_dequeue(p->queue, out) ? 1 : 0;
+        }
+        for (u32 i = 0; i < n; ++i) {
+            u32 producer = (u32)(out[i] >> 48);
+            u64 count = out[i] & ((1ull << 48) - 1);
+            if (producer >= QUEUE_THREAD_COUNT || count >= QUEUE_ITEMS_PER_PRODUCER || count < next_expected[producer]) {
+                p->in_order = false;
+                continue;
+            }
+            next_expected[producer] = count + 1;
+            __atomic_fetch_add(&p->seen[(producer * QUEUE_ITEMS_PER_PRODUCER) + count], 1, __ATOMIC_RELAXED);
+        }
+        if (n) {
+            __atomic_fetch_sub(p->remaining, n, __ATOMIC_RELAXED);
+        } else {
+            lthread_yield();
+        }
+    }
+    return 0;
+}
+
+u8 mpmc_queue_should_deliver_everything_once_across_threads()
+{
+    // Small, so producers and consumers keep lapping each other and the full and empty cases are hit.
+    u64 memory_requirement = 0;
+    mpmc_queue queue;
+    mpmc_queue_create(sizeof(u64), 64, &memory_requirement, 0, 0);
+    void* memory = lallocate(memory_requirement, MEMORY_TAG_RING_QUEUE);
+    expect_to_be_true(mpmc_queue_create(sizeof(u64), 64, &memory_requirement, memory, &queue));
+
+    u64 value_count = (u64)QUEUE_ITEMS_PER_PRODUCER * QUEUE_THREAD_COUNT;
+    u8* seen = lallocate(value_count, MEMORY_TAG_APPLICATION);
+    u64 remaining = value_count;
+
+    // Half of each side uses the batch operations.
+    mpmc_thread_params producer_params[QUEUE_THREAD_COUNT];
+    mpmc_thread_params consumer_params[QUEUE_THREAD_COUNT];
+    lthread producers[QUEUE_THREAD_COUNT];
+    lthread consumers[QUEUE_THREAD_COUNT];
+    for (u32 i = 0; i < QUEUE_THREAD_COUNT; ++i) {
+        mpmc_thread_params params = {&queue, i, (i % 2) == 1, true, seen, &remaining};
+        producer_params[i] = params;
+        consumer_params[i] = params;
+        expect_to_be_true(lthread_create(mpmc_consumer, &consumer_params[i], false, &consumers[i]));
+    }
+    for (u32 i = 0; i < QUEUE_THREAD_COUNT; ++i) {
+        expect_to_be_true(lthread_create(mpmc_producer, &producer_params[i], false, &producers[i]));
+    }
+
+    for (u32 i = 0; i < QUEUE_THREAD_COUNT; ++i) {
+        expect_to_be_true(lthread_wait(&producers[i]));
+        lthread_destroy(&producers[i]);
+    }
+    for (u32 i = 0; i < QUEUE_THREAD_COUNT; ++i) {
+        expect_to_be_true(lthread_wait(&consumers[i]));
+        lthread_destroy(&consumers[i]);
+        expect_to_be_true(consumer_params[i].in_order);
+    }
+
+    expect_should_be(0, remaining);
+    u64 missing_or_repeated = 0;
+    for (u64 i = 0; i < value_count; ++i) {
+        missing_or_repeated += seen[i] != 1;
+    }
+    expect_should_be(0, missing_or_repeated);
+
+    u64 leftover = 0;
+    expect_to_be_false(mpmc_queue_dequeue(&queue, &leftover));
+
+    mpmc_queue_destroy(&queue);
+    lfree(seen, value_count, MEMORY_TAG_APPLICATION);
+    lfree(memory, memory_requirement, MEMORY_TAG_RING_QUEUE);
+    return true;
+}
+
+void ring_queue_register_tests()
+{
+    test_manager_register_test(spsc_queue_should_enqueue_and_dequeue, "SPSC queue enqueues and dequeues, singly and in batches");
+    test_manager_register_test(mpmc_queue_should_enqueue_and_dequeue, "MPMC queue enqueues and dequeues, singly and in batches");
+    test_manager_register_test(spsc_queue_should_keep_order_across_threads, "SPSC queue keeps order between a producer and consumer thread");
+    test_manager_register_test(mpmc_queue_should_deliver_everything_once_across_threads, "MPMC queue delivers every value once across many threads");
+}
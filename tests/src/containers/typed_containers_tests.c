@@ -0,0 +1,196 @@
+#include "typed_containers_tests.h"
+#include "../test_manager.h"
+#include "../expect.h"
+
+#include <defines.h>
+#include <core/clock.h>
+#include <core/lmemory.h>
+#include <core/logger.h>
+#include <core/lstring.h>
+#include <math/math_types.h>
+#include <memory/allocator.h>
+#include <containers/typed_containers.h>
+
+typedef struct test_reference {
+    u64 reference_count;
+    u32 handle;
+    b8 auto_release;
+} test_reference;
+
+DEFINE_DARRAY(vertex_3d)
+DEFINE_DARRAY(u32)
+DEFINE_HASHTABLE(test_reference)
+
+static vertex_3d make_vertex(u32 i)
+{
+    vertex_3d v;
+    v.position.x = (f32)i;
+    v.position.y = (f32)(i * 2);
+    v.position.z = (f32)(i * 3);
+    v.texcoord.x = (f32)i * 0.5f;
+    v.texcoord.y = 1.0f;
+    return v;
+}
+
+u8 typed_darray_should_push_pop_and_swap_remove()
+{
+    vertex_3d* array = darray_vertex_3d_create();
+    for (u32 i = 0; i < 100; ++i) {
+        array = darray_vertex_3d_push(array, make_vertex(i));
+    }
+    expect_should_be(100, darray_vertex_3d_length(array));
+    expect_float_to_be(99.0f * 3.0f, array[99].position.z);
+
+    // The same array, as far as the generic API is concerned.
+    expect_should_be(100, darray_length(array));
+    expect_should_be(sizeof(vertex_3d), darray_stride(array));
+
+    vertex_3d batch[50];
+    for (u32 i = 0; i < 50; ++i) {
+        batch[i] = make_vertex(100 + i);
+    }
+    array = darray_vertex_3d_push_n(array, batch, 50);
+    expect_should_be(150, darray_vertex_3d_length(array));
+    expect_float_to_be(149.0f, array[149].position.x);
+
+    vertex_3d last = darray_vertex_3d_pop(array);
+    expect_float_to_be(149.0f, last.position.x);
+    expect_should_be(149, darray_vertex_3d_length(array));
+
+    expect_to_be_true(darray_vertex_3d_swap_remove(array, 0));
+    expect_float_to_be(148.0f, array[0].position.x);
+    expect_should_be(148, darray_vertex_3d_length(array));
+    expect_to_be_false(darray_vertex_3d_swap_remove(array, 148));
+
+    darray_destroy(array);
+
+    // Created with no room, or created by the generic API, still grows.
+    u32* numbers = darray_u32_reserve(0);
+    numbers = darray_u32_push(numbers, 7);
+    expect_should_be(7, numbers[0]);
+    darray_destroy(numbers);
+    numbers = darray_create(u32);
+    numbers = darray_u32_push_n(numbers, (u32[]){1, 2, 3}, 3);
+    expect_should_be(3, darray_length(numbers));
+    expect_should_be(3, numbers[2]);
+    darray_destroy(numbers);
+    return true;
+}
+
+u8 typed_hashtable_should_find_and_update_in_place()
+{
+    u64 memory_requirement = 0;
+    hashtable table;
+    expect_to_be_true(hashtable_test_reference_create(8, &memory_requirement, 0, 0));
+    void* memory = lallocate(memory_requirement, MEMORY_TAG_APPLICATION);
+    expect_to_be_true(hashtable_test_reference_create(8, &memory_requirement, memory, &table));
+    expect_should_be(sizeof(test_reference), table.element_size);
+
+    expect_should_be(0, hashtable_test_reference_find(&table, "crate"));
+
+    test_reference ref = {1, 4, true};
+    expect_to_be_true(hashtable_test_reference_set(&table, "crate", ref));
+    test_reference* found = hashtable_test_reference_find(&table, "crate");
+    expect_should_not_be(0, found);
+    expect_should_be(4, found->handle);
+
+    // Changes through the pointer are the entry's.
+    found->reference_count++;
+    test_reference got;
+    expect_to_be_true(hashtable_test_reference_get(&table, "crate", &got));
+    expect_should_be(2, got.reference_count);
+    expect_to_be_true(hashtable_get(&table, "crate", &got));
+    expect_should_be(2, got.reference_count);
+
+    // Setting an existing entry updates it, rather than adding another.
+    ref.handle = 9;
+    expect_to_be_true(hashtable_test_reference_set(&table, "crate", ref));
+    expect_should_be(1, table.count);
+    expect_to_be_true(hashtable_test_reference_get(&table, "crate", &got));
+    expect_should_be(9, got.handle);
+
+    expect_to_be_false(hashtable_test_reference_get(&table, "barrel", &got));
+    expect_to_be_true(hashtable_remove(&table, "crate"));
+    expect_should_be(0, hashtable_test_reference_find(&table, "crate"));
+
+    hashtable_destroy(&table);
+    lfree(memory, memory_requirement, MEMORY_TAG_APPLICATION);
+    return true;
+}
+
+u8 typed_hashtable_should_grow()
+{
+    allocator_interface allocator = allocator_interface_default(MEMORY_TAG_DICT);
+    hashtable table;
+    expect_to_be_true(hashtable_test_reference_create_growable(8, &allocator, &table));
+
+    char* names = lallocate(32 * 1000, MEMORY_TAG_APPLICATION);
+    for (u32 i = 0; i < 1000; ++i) {
+        string_format(names + (32 * i), "textures/crate_%04u", i);
+        test_reference ref = {1, i, false};
+        expect_to_be_true(hashtable_test_reference_set(&table, names + (32 * i), ref));
+    }
+    expect_should_be(1000, table.count);
+
+    // Entries are found whether or not the rehash has moved them yet.
+    for (u32 i = 0; i < 1000; ++i) {
+        test_reference* ref = hashtable_test_reference_find(&table, names + (32 * i));
+        expect_should_not_be(0, ref);
+        expect_should_be(i, ref->handle);
+    }
+
+    hashtable_destroy(&table);
+    lfree(names, 32 * 1000, MEMORY_TAG_APPLICATION);
+    return true;
+}
+
+u8 typed_darray_benchmark_against_generic()
+{
+    const u32 count = 1 << 20;
+    const u32 rounds = 8;
+    clock timer;
+
+    vertex_3d* generic = darray_reserve(vertex_3d, count);
+    clock_start(&timer);
+    for (u32 r = 0; r < rounds; ++r) {
+        darray_clear(generic);
+        for (u32 i = 0; i < count; ++i) {
+            vertex_3d v = make_vertex(i);
+            generic = _darray_push(generic, &v);
+        }
+    }
+    clock_update(&timer);
+    f64 generic_time = timer.elapsed;
+
+    vertex_3d* typed = darray_vertex_3d_reserve(count);
+    clock_start(&timer);
+    for (u32 r = 0; r < rounds; ++r) {
+        darray_clear(typed);
+        for (u32 i = 0; i < count; ++i) {
+            typed = darray_vertex_3d_push(typed, make_vertex(i));
+        }
+    }
+    clock_update(&timer);
+    f64 typed_time = timer.elapsed;
+
+    expect_should_be(count, darray_length(generic));
+    expect_should_be(count, darray_length(typed));
+    for (u32 i = 0; i < count; i += 4099) {
+        expect_float_to_be(generic[i].position.y, typed[i].position.y);
+    }
+
+    LINFO("Pushing %u vertices x%u: generic %.2fms, typed %.2fms (%.2fx).",
+          count, rounds, generic_time * 1000.0, typed_time * 1000.0, typed_time > 0.0 ? generic_time / typed_time : 0.0);
+
+    darray_destroy(generic);
+    darray_destroy(typed);
+    return true;
+}
+
+void typed_containers_register_tests()
+{
+    test_manager_register_test(typed_darray_should_push_pop_and_swap_remove, "Typed darray pushes, pops and swap removes, sharing the generic layout");
+    test_manager_register_test(typed_hashtable_should_find_and_update_in_place, "Typed hashtable finds entries and updates them in place");
+    test_manager_register_test(typed_hashtable_should_grow, "Typed hashtable works with growable tables");
+    test_manager_register_test(typed_darray_benchmark_against_generic, "Typed darray push speed against the generic push (benchmark)");
+}
@@ -0,0 +1,3 @@
+#pragma once
+
+void typed_containers_register_tests();
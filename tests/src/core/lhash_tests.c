@@ -0,0 +1,155 @@
+#include "lhash_tests.h"
+#include "../test_manager.h"
+#include "../expect.h"
+
+#include <defines.h>
+#include <core/clock.h>
+#include <core/lhash.h>
+#include <core/lmemory.h>
+#include <core/lstring.h>
+
+// The hash the hashtable used before hash_string, kept here for comparison.
+static u64 legacy_hash_name(const char* name, u32 element_count)
+{
+    static const u64 multiplier = 97;
+
+    unsigned const char* us;
+    u64 hash = 0;
+
+    for (us = (unsigned const char*)name; *us; us++) {
+        hash = hash * multiplier + *us;
+    }
+
+    hash %= element_count;
+
+    return hash;
+}
+
+#define KEY_LENGTH 64
+
+// Fills keys with count names laid out like the engine's asset paths.
+static void make_path_keys(char* keys, u32 count)
+{
+    static const char* kinds[] = {"diff", "norm", "spec", "rough"};
+    static const char* props[] = {"wall", "floor", "crate", "barrel", "door", "pillar", "stair", "window"};
+    for (u32 i = 0; i < count; ++i) {
+        string_format(keys + (KEY_LENGTH * i), "textures/level%02u/%s_%04u_%s", (i / 2048) % 100, props[(i / 4) % 8], i / 32, kinds[i % 4]);
+    }
+}
+
+u8 hash_should_be_deterministic_and_seeded()
+{
+    const char* name = "textures/level03/wall_0001_diff";
+    u64 length = string_length(name);
+
+    expect_should_be(hash_string(name), hash_string(name));
+    expect_should_be(hash_bytes(name, length, HASH_DEFAULT_SEED), hash_string(name));
+    expect_should_not_be(hash_bytes(name, length, 1), hash_string(name));
+
+    // The terminator is not part of the hash, so copies hash the same.
+    char copy[64];
+    string_ncopy(copy, name, 64);
+    expect_should_be(hash_string(name), hash_string(copy));
+
+    // Lengths are part of the hash.
+    expect_should_not_be(hash_bytes(name, length - 1, 0), hash_bytes(name, length, 0));
+    expect_should_not_be(hash_bytes(0, 0, 0), hash_bytes("\0", 1, 0));
+
+    return true;
+}
+
+u8 hash_should_use_every_byte()
+{
+    // Covers each of the short, medium and long (multi-lane) paths through the hash.
+    u8 data[160];
+    for (u32 i = 0; i < 160; ++i) {
+        data[i] = (u8)(i * 7 + 3);
+    }
+
+    for (u64 size = 1; size <= 160; ++size) {
+        u64 original = hash_bytes(data, size, 0);
+        for (u64 i = 0; i < size; ++i) {
+            data[i] ^= 0x10;
+            u64 changed = hash_bytes(data, size, 0);
+            data[i] ^= 0x10;
+            expect_should_not_be(original, changed);
+        }
+    }
+
+    return true;
+}
+
+// Benchmark. Compares hash_string against the old multiply-by-97 hash over path-like names,
+// both for speed and for how evenly the low bits (the table index) spread the names.
+u8 hash_benchmark_against_legacy()
+{
+    const u32 count = 65536;
+    const u32 rounds = 16;
+    // The power-of-two table size the hashtable would use for count entries.
+    const u32 capacity = 131072;
+
+    char* keys = lallocate(KEY_LENGTH * count, MEMORY_TAG_APPLICATION);
+    make_path_keys(keys, count);
+
+    u64 legacy_sum = 0;
+    clock timer;
+    clock_start(&timer);
+    for (u32 r = 0; r < rounds; ++r) {
+        for (u32 i = 0; i < count; ++i) {
+            legacy_sum += legacy_hash_name(keys + (KEY_LENGTH * i), capacity - 1);
+        }
+    }
+    clock_update(&timer);
+    f64 legacy_time = timer.elapsed;
+
+    u64 sum = 0;
+    clock_start(&timer);
+    for (u32 r = 0; r < rounds; ++r) {
+        for (u32 i = 0; i < count; ++i) {
+            sum += hash_string(keys + (KEY_LENGTH * i));
+        }
+    }
+    clock_update(&timer);
+    f64 time = timer.elapsed;
+
+    // Count the names which land in an already used slot. The legacy hash is indexed both by
+    // modulo (as the old table did, here with a prime) and by mask (as a power-of-two table would).
+    u8* used = lallocate(capacity, MEMORY_TAG_APPLICATION);
+    u32 legacy_collisions = 0;
+    u32 legacy_masked_collisions = 0;
+    u32 collisions = 0;
+    for (u32 i = 0; i < count; ++i) {
+        const char* key = keys + (KEY_LENGTH * i);
+        u64 legacy_index = legacy_hash_name(key, capacity - 1);
+        u64 legacy_masked_index = legacy_hash_name(key, INVALID_ID) & (capacity - 1);
+        u64 index = hash_string(key) & (capacity - 1);
+        legacy_collisions += used[legacy_index] & 1;
+        legacy_masked_collisions += (used[legacy_masked_index] >> 1) & 1;
+        collisions += (used[index] >> 2) & 1;
+        used[legacy_index] |= 1;
+        used[legacy_masked_index] |= 2;
+        used[index] |= 4;
+    }
+
+    // A uniform hash puts at most about count^2 / (2 * capacity) names in used slots; allow some slack.
+    u32 expected = (u32)(((u64)count * count) / (2ull * capacity));
+    expect_to_be_true((collisions < expected + (expected / 4)));
+    // Keep the sums alive so the loops are not optimized away.
+    expect_to_be_true((sum != 0 || legacy_sum != 0));
+
+    LINFO("Hashing %u path names x%u: legacy %.2fms, hash_string %.2fms (%.2fx).",
+          count, rounds, legacy_time * 1000.0, time * 1000.0, time > 0.0 ? legacy_time / time : 0.0);
+    LINFO("Slot collisions at %u slots (uniform under %u): legacy modulo %u, legacy masked %u, hash_string masked %u.",
+          capacity, expected, legacy_collisions, legacy_masked_collisions, collisions);
+
+    lfree(used, capacity, MEMORY_TAG_APPLICATION);
+    lfree(keys, KEY_LENGTH * count, MEMORY_TAG_APPLICATION);
+    return true;
+}
+
+void lhash_register_tests()
+{
+    test_manager_register_test(hash_should_be_deterministic_and_seeded, "Hash is deterministic, seeded and length sensitive");
+    test_manager_register_test(hash_should_use_every_byte, "Hash changes when any byte of the input changes");
+    test_manager_register_test(hash_benchmark_against_legacy, "Hash speed and spread against the legacy hash (benchmark)");
+}
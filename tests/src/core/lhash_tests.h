@@ -0,0 +1,3 @@
+#pragma once
+
+void lhash_register_tests();
@@ -0,0 +1,468 @@
+#include "lmemory_tests.h"
+#include "../test_manager.h"
+#include "../expect.h"
+
+#include <defines.h>
+#include <core/lmemory.h>
+#include <core/lthread.h>
+#include <core/clock.h>
+#include <core/memory_profiler.h>
+
+#define WORKER_THREAD_COUNT 4
+#define WORKER_SLOT_COUNT 64
+
+typedef struct alloc_worker_params {
+    u32 seed;
+    u32 iterations;
+    u64 allocation_count;
+    b8 corrupted;
+} alloc_worker_params;
+
+static u32 next_random(u32* state) {
+    // xorshift32
+    *state ^= *state << 13;
+    *state ^= *state >> 17;
+    *state ^= *state << 5;
+    return *state;
+}
+
+static memory_system_configuration test_memory_config() {
+    memory_system_configuration config = {0};
+    config.total_alloc_size = MEBIBYTES(32);
+    config.allocator_type = DYNAMIC_ALLOCATOR_TYPE_TLSF;
+    config.use_thread_caches = true;
+    return config;
+}
+
+// Randomly allocates and frees blocks of varying size, some too large to be cached,
+// checking that no other thread has written over them in the meantime.
+static u32 alloc_worker(void* params) {
+    alloc_worker_params* worker = params;
+    void* blocks[WORKER_SLOT_COUNT] = {0};
+    u64 sizes[WORKER_SLOT_COUNT] = {0};
+    u32 random = worker->seed;
+
+    for (u32 i = 0; i < worker->iterations; ++i) {
+        u32 slot = next_random(&random) % WORKER_SLOT_COUNT;
+        u8 pattern = (u8)(worker->seed + slot);
+        if (blocks[slot]) {
+            u8* bytes = blocks[slot];
+            if (bytes[0] != pattern || bytes[sizes[slot] - 1] != pattern) {
+                worker->corrupted = true;
+            }
+            lfree(blocks[slot], sizes[slot], MEMORY_TAG_JOB);
+            blocks[slot] = 0;
+        } else {
+            sizes[slot] = 1 + next_random(&random) % 2048;
+            blocks[slot] = lallocate(sizes[slot], MEMORY_TAG_JOB);
+            worker->allocation_count++;
+            lset_memory(blocks[slot], pattern, sizes[slot]);
+        }
+    }
+
+    for (u32 i = 0; i < WORKER_SLOT_COUNT; ++i) {
+        if (blocks[i]) {
+            lfree(blocks[i], sizes[i], MEMORY_TAG_JOB);
+        }
+    }
+    return 0;
+}
+
+u8 memory_system_should_track_cached_allocations() {
+    expect_to_be_true(memory_system_initialize(test_memory_config()));
+
+    u64 base_count = get_memory_alloc_count();
+    u64 sizes[5] = {1, 16, 17, 1000, 64 * 1024};
+    void* blocks[5];
+    u64 total = 0;
+    for (u32 i = 0; i < 5; ++i) {
+        blocks[i] = lallocate(sizes[i], MEMORY_TAG_JOB);
+        expect_should_not_be(0, blocks[i]);
+        expect_should_be(0, ((u64)blocks[i]) % LMEMORY_DEFAULT_ALIGNMENT);
+        total += sizes[i];
+    }
+
+    // Both cached and uncached allocations should show up.
+    expect_should_be(total, get_memory_usage_for_tag(MEMORY_TAG_JOB));
+    expect_should_be(base_count + 5, get_memory_alloc_count());
+
+    for (u32 i = 0; i < 5; ++i) {
+        lfree(blocks[i], sizes[i], MEMORY_TAG_JOB);
+    }
+    expect_should_be(0, get_memory_usage_for_tag(MEMORY_TAG_JOB));
+
+    // Freed small blocks should be handed straight back out by the cache.
+    void* reused = lallocate(sizes[3], MEMORY_TAG_JOB);
+    expect_should_be(blocks[3], reused);
+    lfree(reused, sizes[3], MEMORY_TAG_JOB);
+
+    // Releasing the cache keeps the stats around.
+    memory_system_release_thread_cache();
+    expect_should_be(base_count + 6, get_memory_alloc_count());
+
+    memory_system_shutdown();
+    return true;
+}
+
+typedef struct exit_hook_params {
+    lthread_exit_hook* hook;
+    u32 exit_count;
+} exit_hook_params;
+
+static void count_thread_exit(void* value) {
+    ((exit_hook_params*)value)->exit_count++;
+}
+
+static u32 exit_hook_worker(void* params) {
+    exit_hook_params* typed_params = params;
+    lthread_exit_hook_set(typed_params->hook, typed_params);
+    return 0;
+}
+
+// The memory system relies on this to release the cache of any thread, however it was started.
+u8 lthread_exit_hook_should_run_on_thread_exit() {
+    lthread_exit_hook hook = {0};
+    expect_to_be_true(lthread_exit_hook_create(count_thread_exit, &hook));
+
+    exit_hook_params params = {&hook, 0};
+    lthread thread;
+    expect_to_be_true(lthread_create(exit_hook_worker, &params, false, &thread));
+    expect_to_be_true(lthread_wait(&thread));
+    lthread_destroy(&thread);
+    expect_should_be(1, params.exit_count);
+
+    lthread_exit_hook_destroy(&hook);
+    expect_should_be(1, params.exit_count);
+    return true;
+}
+
+u8 memory_system_should_allocate_from_multiple_threads() {
+    expect_to_be_true(memory_system_initialize(test_memory_config()));
+    u64 base_count = get_memory_alloc_count();
+
+    alloc_worker_params params[WORKER_THREAD_COUNT];
+    lthread threads[WORKER_THREAD_COUNT];
+    for (u32 i = 0; i < WORKER_THREAD_COUNT; ++i) {
+        params[i].seed = 0x9E3779B9u * (i + 1);
+        params[i].iterations = 20000;
+        params[i].allocation_count = 0;
+        params[i].corrupted = false;
+        expect_to_be_true(lthread_create(alloc_worker, &params[i], false, &threads[i]));
+    }
+
+    u64 allocation_count = 0;
+    for (u32 i = 0; i < WORKER_THREAD_COUNT; ++i) {
+        expect_to_be_true(lthread_wait(&threads[i]));
+        lthread_destroy(&threads[i]);
+        expect_to_be_false(params[i].corrupted);
+        allocation_count += params[i].allocation_count;
+    }
+
+    // Each thread's caches are released on exit, with stats merged into the totals.
+    expect_should_be(0, get_memory_usage_for_tag(MEMORY_TAG_JOB));
+    expect_should_be(base_count + allocation_count, get_memory_alloc_count());
+
+    memory_system_shutdown();
+    return true;
+}
+
+u8 memory_system_uninit_allocations_should_track_identically() {
+    expect_to_be_true(memory_system_initialize(test_memory_config()));
+
+    u64 base_count = get_memory_alloc_count();
+    u64 sizes[2] = {100, 64 * 1024};
+    void* blocks[2];
+    for (u32 i = 0; i < 2; ++i) {
+        blocks[i] = lallocate_uninit(sizes[i], MEMORY_TAG_JOB);
+        expect_should_not_be(0, blocks[i]);
+        expect_should_be(0, ((u64)blocks[i]) % LMEMORY_DEFAULT_ALIGNMENT);
+    }
+    expect_should_be(sizes[0] + sizes[1], get_memory_usage_for_tag(MEMORY_TAG_JOB));
+    expect_should_be(base_count + 2, get_memory_alloc_count());
+
+    // Dirty a block, then free it and take it back. lallocate must still hand it out zeroed.
+    lset_memory(blocks[0], 0xAB, sizes[0]);
+    lfree(blocks[0], sizes[0], MEMORY_TAG_JOB);
+    u8* zeroed = lallocate(sizes[0], MEMORY_TAG_JOB);
+    expect_should_be(blocks[0], zeroed);
+    for (u64 i = 0; i < sizes[0]; ++i) {
+        expect_should_be(0, zeroed[i]);
+    }
+
+    lfree(zeroed, sizes[0], MEMORY_TAG_JOB);
+    lfree(blocks[1], sizes[1], MEMORY_TAG_JOB);
+    expect_should_be(0, get_memory_usage_for_tag(MEMORY_TAG_JOB));
+
+    memory_system_shutdown();
+    return true;
+}
+
+u8 memory_system_reallocate_should_grow_in_place() {
+    expect_to_be_true(memory_system_initialize(test_memory_config()));
+
+    // Large enough to bypass the thread caches. Nothing follows it yet, so it can grow in place.
+    u64 size = 64 * 1024;
+    u8* block = lallocate(size, MEMORY_TAG_JOB);
+    lset_memory(block, 0x5A, size);
+    u64 base_count = get_memory_alloc_count();
+
+    u8* grown = lreallocate(block, size, size * 4, MEMORY_TAG_JOB);
+    expect_should_be(block, grown);
+    expect_should_be(size * 4, get_memory_usage_for_tag(MEMORY_TAG_JOB));
+    expect_should_be(base_count, get_memory_alloc_count());
+
+    // Something in the way means it has to move, keeping the contents.
+    void* blocker = lallocate(size, MEMORY_TAG_JOB);
+    u8* moved = lreallocate(grown, size * 4, size * 16, MEMORY_TAG_JOB);
+    expect_should_not_be(grown, moved);
+    expect_should_be(0x5A, moved[0]);
+    expect_should_be(0x5A, moved[size - 1]);
+    expect_should_be(size * 17, get_memory_usage_for_tag(MEMORY_TAG_JOB));
+
+    // Shrinking stays put.
+    u8* shrunk = lreallocate(moved, size * 16, size * 2, MEMORY_TAG_JOB);
+    expect_should_be(moved, shrunk);
+    expect_should_be(size * 3, get_memory_usage_for_tag(MEMORY_TAG_JOB));
+
+    // Small blocks stay put within their cache size class, and move between classes.
+    u8* small = lallocate(40, MEMORY_TAG_JOB);
+    small[0] = 7;
+    expect_should_be(small, lreallocate(small, 40, 60, MEMORY_TAG_JOB));
+    u8* small_moved = lreallocate(small, 60, 200, MEMORY_TAG_JOB);
+    expect_should_be(7, small_moved[0]);
+
+    lfree(small_moved, 200, MEMORY_TAG_JOB);
+    lfree(shrunk, size * 2, MEMORY_TAG_JOB);
+    lfree(blocker, size, MEMORY_TAG_JOB);
+    expect_should_be(0, get_memory_usage_for_tag(MEMORY_TAG_JOB));
+
+    memory_system_shutdown();
+    return true;
+}
+
+u8 memory_system_tag_heap_should_release_all_at_once() {
+    expect_to_be_true(memory_system_initialize(test_memory_config()));
+
+    // Nothing to release without a heap.
+    LDEBUG("Note: The following errors are intentionally caused by this test.");
+    expect_to_be_false(lfree_all_for_tag(MEMORY_TAG_SCENE));
+    void* early = lallocate(64, MEMORY_TAG_ENTITY);
+    expect_to_be_false(memory_system_create_tag_heap(MEMORY_TAG_ENTITY, KIBIBYTES(64)));
+    lfree(early, 64, MEMORY_TAG_ENTITY);
+
+    expect_to_be_true(memory_system_create_tag_heap(MEMORY_TAG_SCENE, MEBIBYTES(1)));
+    expect_to_be_false(memory_system_create_tag_heap(MEMORY_TAG_SCENE, MEBIBYTES(1)));
+
+    // Lots of allocations, small and large. Small ones skip the thread caches.
+    void* first = 0;
+    u64 total = 0;
+    for (u32 i = 0; i < 1000; ++i) {
+        u64 size = (i % 10 == 0) ? 4096 : 24;
+        void* block = lallocate(size, MEMORY_TAG_SCENE);
+        expect_should_not_be(0, block);
+        if (!first) {
+            first = block;
+        }
+        total += size;
+    }
+    expect_should_be(total, get_memory_usage_for_tag(MEMORY_TAG_SCENE));
+
+    // Individual frees still work.
+    void* single = lallocate(100, MEMORY_TAG_SCENE);
+    lfree(single, 100, MEMORY_TAG_SCENE);
+    expect_should_be(total, get_memory_usage_for_tag(MEMORY_TAG_SCENE));
+
+    // Release everything at once. The heap starts over from the beginning.
+    expect_to_be_true(lfree_all_for_tag(MEMORY_TAG_SCENE));
+    expect_should_be(0, get_memory_usage_for_tag(MEMORY_TAG_SCENE));
+    void* again = lallocate(24, MEMORY_TAG_SCENE);
+    expect_should_be(first, again);
+
+    // Allocations fail once the heap is full, rather than spilling into the shared allocator.
+    LDEBUG("Note: The following errors are intentionally caused by this test.");
+    u64 alloc_count = get_memory_alloc_count();
+    expect_should_be(0, lallocate(MEBIBYTES(2), MEMORY_TAG_SCENE));
+    // A failed allocation is not counted.
+    expect_should_be(24, get_memory_usage_for_tag(MEMORY_TAG_SCENE));
+    expect_should_be(alloc_count, get_memory_alloc_count());
+
+    // Once destroyed, the tag is served by the shared allocator again.
+    memory_system_destroy_tag_heap(MEMORY_TAG_SCENE);
+    expect_should_be(0, get_memory_usage_for_tag(MEMORY_TAG_SCENE));
+    void* shared = lallocate(24, MEMORY_TAG_SCENE);
+    expect_should_not_be(0, shared);
+    lfree(shared, 24, MEMORY_TAG_SCENE);
+    expect_should_be(0, get_memory_usage_for_tag(MEMORY_TAG_SCENE));
+
+    memory_system_shutdown();
+    return true;
+}
+
+u8 memory_system_should_free_by_owner_when_tag_is_wrong() {
+    expect_to_be_true(memory_system_initialize(test_memory_config()));
+    expect_to_be_true(memory_system_create_tag_heap(MEMORY_TAG_SCENE, KIBIBYTES(64)));
+
+    LDEBUG("Note: The following warnings are intentionally caused by this test.");
+
+    // From the heap, freed with a tag that has none. Goes back to the heap, and the heap's tag is credited.
+    void* from_heap = lallocate(4096, MEMORY_TAG_SCENE);
+    expect_should_not_be(0, from_heap);
+    lfree(from_heap, 4096, MEMORY_TAG_ENTITY);
+    expect_should_be(0, get_memory_usage_for_tag(MEMORY_TAG_SCENE));
+    void* reused = lallocate(4096, MEMORY_TAG_SCENE);
+    expect_should_be(from_heap, reused);
+
+    // Resizing agrees with freeing: the heap's block grows in place, and the heap's tag is charged.
+    void* grown = lreallocate(reused, 4096, 8192, MEMORY_TAG_ENTITY);
+    expect_should_be(reused, grown);
+    expect_should_be(8192, get_memory_usage_for_tag(MEMORY_TAG_SCENE));
+    lfree(grown, 8192, MEMORY_TAG_SCENE);
+    expect_should_be(0, get_memory_usage_for_tag(MEMORY_TAG_SCENE));
+
+    // From the shared allocator (small and cached, and large), freed with the heap's tag.
+    void* small = lallocate(24, MEMORY_TAG_ARRAY);
+    void* large = lallocate(8192, MEMORY_TAG_ARRAY);
+    expect_should_not_be(0, small);
+    expect_should_not_be(0, large);
+    lfree(small, 24, MEMORY_TAG_SCENE);
+    lfree(large, 8192, MEMORY_TAG_SCENE);
+    expect_should_be(small, lallocate(24, MEMORY_TAG_ARRAY));
+    expect_should_be(large, lallocate(8192, MEMORY_TAG_ARRAY));
+    lfree(small, 24, MEMORY_TAG_ARRAY);
+    lfree(large, 8192, MEMORY_TAG_ARRAY);
+
+    memory_system_destroy_tag_heap(MEMORY_TAG_SCENE);
+    memory_system_shutdown();
+    return true;
+}
+
+// Dependent random reads over a buffer far larger than the TLB reach of regular pages. Returns the elapsed time.
+static f64 random_read_time(b8 use_huge_pages, u64* out_sum) {
+    memory_system_configuration config = test_memory_config();
+    config.total_alloc_size = MEBIBYTES(160);
+    config.use_huge_pages = use_huge_pages;
+    if (!memory_system_initialize(config)) {
+        return -1.0;
+    }
+
+    const u64 size = MEBIBYTES(128);
+    const u64 count = size / sizeof(u64);
+    u64* data = lallocate_uninit(size, MEMORY_TAG_APPLICATION);
+    // Touch every page first, so page faults are not part of the timing.
+    for (u64 i = 0; i < count; ++i) {
+        data[i] = i;
+    }
+
+    u32 random = 0x2545F491;
+    u64 sum = 0;
+    clock timer;
+    clock_start(&timer);
+    u64 index = 0;
+    for (u32 i = 0; i < 2 * 1024 * 1024; ++i) {
+        // Each read depends on the last, so the misses cannot overlap.
+        index = (data[index] ^ next_random(&random)) % count;
+        sum += index;
+    }
+    clock_update(&timer);
+
+    lfree(data, size, MEMORY_TAG_APPLICATION);
+    memory_system_shutdown();
+    *out_sum = sum;
+    return timer.elapsed;
+}
+
+// Benchmark. Random access is dominated by TLB misses on regular pages, so the
+// difference in time is (mostly) the TLB-miss cost huge pages save. Only the
+// results are checked, as huge pages may be unavailable.
+u8 memory_system_huge_pages_benchmark() {
+    u64 regular_sum = 0;
+    u64 huge_sum = 0;
+    f64 regular = random_read_time(false, &regular_sum);
+    f64 huge = random_read_time(true, &huge_sum);
+    expect_to_be_true((regular >= 0.0));
+    expect_to_be_true((huge >= 0.0));
+    // The same reads were made, so the memory should have held the same data.
+    expect_should_be(regular_sum, huge_sum);
+
+    LINFO("2M dependent random reads over 128MiB: regular pages %.2fms, huge pages %.2fms (%.2fx)",
+          regular * 1000.0, huge * 1000.0, huge > 0.0 ? regular / huge : 0.0);
+    return true;
+}
+
+u8 memory_profiler_should_attribute_allocations_to_call_sites() {
+    memory_system_configuration config = test_memory_config();
+    config.enable_profiling = true;
+    expect_to_be_true(memory_system_initialize(config));
+    expect_to_be_true(memory_profiler_is_enabled());
+
+    // Several allocations from one site, one cacheable and one not from another.
+    void* small[3];
+    u32 small_line = __LINE__ + 2;
+    for (u32 i = 0; i < 3; ++i) {
+        small[i] = lallocate(100, MEMORY_TAG_JOB);
+    }
+    u32 large_line = __LINE__ + 1;
+    void* large = lallocate_uninit(64 * 1024, MEMORY_TAG_JOB);
+
+    memory_profile_site site;
+    expect_to_be_true(memory_profiler_get_site(__FILE__, small_line, &site));
+    expect_should_be(MEMORY_TAG_JOB, site.tag);
+    expect_should_be(3, site.stats.live_count);
+    expect_should_be(300, site.stats.live_bytes);
+    // 100 bytes lands in the [64, 128) bucket.
+    expect_should_be(3, site.stats.histogram[2]);
+
+    expect_to_be_true(memory_profiler_get_site(__FILE__, large_line, &site));
+    expect_should_be(64 * 1024, site.stats.live_bytes);
+    // 64KiB is 16 << 12.
+    expect_should_be(1, site.stats.histogram[12]);
+
+    // Freeing keeps the peak and totals, but not the live counts.
+    lfree(large, 64 * 1024, MEMORY_TAG_JOB);
+    for (u32 i = 0; i < 2; ++i) {
+        lfree(small[i], 100, MEMORY_TAG_JOB);
+    }
+
+    memory_profile_stats tag_stats;
+    expect_to_be_true(memory_profiler_get_tag_stats(MEMORY_TAG_JOB, &tag_stats));
+    expect_should_be(100, tag_stats.live_bytes);
+    expect_should_be(300 + 64 * 1024, tag_stats.peak_bytes);
+    expect_should_be(4, tag_stats.total_count);
+    expect_should_be(1, tag_stats.live_count);
+
+    // The one left over is reported as a leak.
+    LDEBUG("Note: The following leak warnings are intentionally caused by this test.");
+    expect_should_be(1, memory_profiler_report_leaks());
+
+    expect_to_be_true(memory_profiler_dump("memory_profile_test.txt"));
+
+    lfree(small[2], 100, MEMORY_TAG_JOB);
+    expect_should_be(0, memory_profiler_report_leaks());
+
+    // Releasing a tag heap in one go is seen as freeing each allocation.
+    expect_to_be_true(memory_system_create_tag_heap(MEMORY_TAG_SCENE, KIBIBYTES(64)));
+    for (u32 i = 0; i < 3; ++i) {
+        lallocate(32, MEMORY_TAG_SCENE);
+    }
+    lfree_all_for_tag(MEMORY_TAG_SCENE);
+    expect_to_be_true(memory_profiler_get_tag_stats(MEMORY_TAG_SCENE, &tag_stats));
+    expect_should_be(0, tag_stats.live_count);
+    expect_should_be(3, tag_stats.total_count);
+    expect_should_be(0, memory_profiler_report_leaks());
+
+    memory_system_shutdown();
+    expect_to_be_false(memory_profiler_is_enabled());
+    return true;
+}
+
+void lmemory_register_tests() {
+    test_manager_register_test(memory_system_should_track_cached_allocations, "Memory system tracks cached and uncached allocations");
+    test_manager_register_test(lthread_exit_hook_should_run_on_thread_exit, "Thread exit hooks run when a thread exits");
+    test_manager_register_test(memory_system_should_allocate_from_multiple_threads, "Memory system allocates and frees from multiple threads");
+    test_manager_register_test(memory_system_uninit_allocations_should_track_identically, "Memory system tracks uninitialized allocations identically");
+    test_manager_register_test(memory_system_reallocate_should_grow_in_place, "Memory system reallocates in place where possible");
+    test_manager_register_test(memory_system_tag_heap_should_release_all_at_once, "Memory system tag heaps release all allocations at once");
+    test_manager_register_test(memory_system_should_free_by_owner_when_tag_is_wrong, "Memory system frees by the owning allocator when the tag is wrong");
+    test_manager_register_test(memory_system_huge_pages_benchmark, "Memory system random access with and without huge pages (benchmark)");
+    test_manager_register_test(memory_profiler_should_attribute_allocations_to_call_sites, "Memory profiler attributes allocations to call sites");
+}
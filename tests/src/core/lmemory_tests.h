@@ -0,0 +1,3 @@
+#pragma once
+
+void lmemory_register_tests();
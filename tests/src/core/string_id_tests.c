@@ -0,0 +1,97 @@
+#include "string_id_tests.h"
+#include "../test_manager.h"
+#include "../expect.h"
+
+#include <defines.h>
+#include <core/lhash.h>
+#include <core/lmemory.h>
+#include <core/lstring.h>
+#include <core/string_id.h>
+
+u8 string_id_should_intern_and_find()
+{
+    string_id_system_config config;
+    config.max_string_count = 16;
+    config.arena_block_size = 64;
+    u64 memory_requirement = 0;
+    expect_to_be_true(string_id_system_initialize(&memory_requirement, 0, config));
+    void* state = lallocate(memory_requirement, MEMORY_TAG_APPLICATION);
+    expect_to_be_true(string_id_system_initialize(&memory_requirement, state, config));
+
+    // Nothing has been interned yet.
+    expect_should_be(INVALID_STRING_ID, string_id_find("cobblestone"));
+
+    string_id a = string_id_intern("cobblestone");
+    string_id b = string_id_intern("paving");
+    expect_should_not_be(INVALID_STRING_ID, a);
+    expect_should_not_be(INVALID_STRING_ID, b);
+    expect_should_not_be(a, b);
+
+    // The same string, from a different buffer, gets the same id.
+    char copy[32];
+    string_ncopy(copy, "cobblestone", 32);
+    expect_should_be(a, string_id_intern(copy));
+    expect_should_be(a, string_id_find(copy));
+
+    // Interning is case sensitive.
+    expect_should_be(INVALID_STRING_ID, string_id_find("Cobblestone"));
+
+    // The interned copy is its own string, and keeps the hash it was interned with.
+    expect_to_be_true(strings_equal(string_id_str(a), "cobblestone"));
+    expect_to_be_true((string_id_str(a) != (const char*)copy));
+    expect_should_be(hash_string("cobblestone"), string_id_hash(a));
+    expect_should_be(hash_string("paving"), string_id_hash(b));
+
+    // The invalid id is an empty string.
+    expect_to_be_true(strings_equal(string_id_str(INVALID_STRING_ID), ""));
+    expect_should_be(0, string_id_hash(INVALID_STRING_ID));
+    expect_should_be(INVALID_STRING_ID, string_id_intern(0));
+
+    string_id_system_shutdown(state);
+    lfree(state, memory_requirement, MEMORY_TAG_APPLICATION);
+    return true;
+}
+
+u8 string_id_should_keep_strings_stable_until_full()
+{
+    string_id_system_config config;
+    config.max_string_count = 256;
+    // Small blocks, so the arena has to chain several.
+    config.arena_block_size = 128;
+    u64 memory_requirement = 0;
+    string_id_system_initialize(&memory_requirement, 0, config);
+    void* state = lallocate(memory_requirement, MEMORY_TAG_APPLICATION);
+    expect_to_be_true(string_id_system_initialize(&memory_requirement, state, config));
+
+    string_id ids[256];
+    const char* strs[256];
+    char name[64];
+    for (u32 i = 0; i < 256; ++i) {
+        string_format(name, "textures/crate_%03u_diff", i);
+        ids[i] = string_id_intern(name);
+        expect_should_not_be(INVALID_STRING_ID, ids[i]);
+        strs[i] = string_id_str(ids[i]);
+    }
+
+    // Every string is still where it was interned, and still found.
+    for (u32 i = 0; i < 256; ++i) {
+        string_format(name, "textures/crate_%03u_diff", i);
+        expect_should_be(ids[i], string_id_find(name));
+        expect_to_be_true((string_id_str(ids[i]) == strs[i]));
+        expect_to_be_true(strings_equal(strs[i], name));
+    }
+
+    // The system is full; new strings fail, but existing ones are still handed out.
+    expect_should_be(INVALID_STRING_ID, string_id_intern("textures/one_too_many"));
+    expect_should_be(ids[7], string_id_intern("textures/crate_007_diff"));
+
+    string_id_system_shutdown(state);
+    lfree(state, memory_requirement, MEMORY_TAG_APPLICATION);
+    return true;
+}
+
+void string_id_register_tests()
+{
+    test_manager_register_test(string_id_should_intern_and_find, "String ids are stable, case sensitive and carry their hash");
+    test_manager_register_test(string_id_should_keep_strings_stable_until_full, "Interned strings stay put until the system is full");
+}
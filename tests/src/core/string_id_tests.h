@@ -0,0 +1,3 @@
+#pragma once
+
+void string_id_register_tests();
@@ -38,8 +38,18 @@
 
 #include "memory/linear_allocator_tests.h"
 #include "containers/hashtable_tests.h"
+#include "containers/darray_tests.h"
+#include "containers/typed_containers_tests.h"
+#include "containers/ring_queue_tests.h"
 #include "containers/freelist_tests.h"
+#include "containers/buddy_allocator_tests.h"
 #include "memory/dynamic_allocator_tests.h"
+#include "memory/frame_arena_tests.h"
+#include "memory/pool_allocator_tests.h"
+#include "memory/allocator_tests.h"
+#include "core/lmemory_tests.h"
+#include "core/lhash_tests.h"
+#include "core/string_id_tests.h"
 
 #include <core/logger.h>
 
@@ -51,8 +61,18 @@ int main()
     // TODO: Add test registration here
     linear_allocator_register_tests();
     hashtable_register_tests();
+    darray_register_tests();
+    typed_containers_register_tests();
+    ring_queue_register_tests();
     freelist_register_tests();
+    buddy_allocator_register_tests();
     dynamic_allocator_register_tests();
+    frame_arena_register_tests();
+    pool_allocator_register_tests();
+    allocator_register_tests();
+    lmemory_register_tests();
+    lhash_register_tests();
+    string_id_register_tests();
 
     LDEBUG("Starting tests...");
     // Execute tests
@@ -0,0 +1,173 @@
+#include "allocator_tests.h"
+#include "../test_manager.h"
+#include "../expect.h"
+
+#include <defines.h>
+#include <core/lmemory.h>
+#include <memory/allocator.h>
+#include <memory/linear_allocator.h>
+#include <memory/frame_arena.h>
+#include <memory/pool_allocator.h>
+#include <containers/darray.h>
+#include <containers/hashtable.h>
+
+u8 allocator_darray_should_grow_in_linear_allocator() 
+{
+    memory_system_configuration config = {0};
+    config.total_alloc_size = MEBIBYTES(8);
+    config.allocator_type = DYNAMIC_ALLOCATOR_TYPE_TLSF;
+    expect_to_be_true(memory_system_initialize(config));
+
+    linear_allocator linear;
+    linear_allocator_create(4096, 0, &linear);
+    allocator_interface scratch = allocator_interface_from_linear(&linear);
+    u64 base_count = get_memory_alloc_count();
+
+    u32* array = darray_create_with_allocator(u32, &scratch);
+    expect_should_not_be(0, array);
+    u32* first = array;
+    for (u32 i = 0; i < 100; ++i) {
+        darray_push(array, i);
+    }
+    expect_should_be(100, darray_length(array));
+    expect_to_be_true((darray_capacity(array) >= 100));
+
+    // As the most recent allocation, the array grows in place, and never touches the memory system.
+    expect_should_be(first, array);
+    expect_should_be(base_count, get_memory_alloc_count());
+    for (u32 i = 0; i < 100; ++i) {
+        expect_should_be(i, array[i]);
+    }
+
+    // Once something else is allocated after it, growing moves the array, keeping its contents.
+    expect_should_not_be(0, linear_allocator_allocate(&linear, 8));
+    u64 capacity = darray_capacity(array);
+    while (darray_length(array) <= capacity) {
+        darray_push(array, (u32)darray_length(array));
+    }
+    expect_should_not_be(first, array);
+    for (u32 i = 0; i < darray_length(array); ++i) {
+        expect_should_be(i, array[i]);
+    }
+    expect_should_be(base_count, get_memory_alloc_count());
+
+    // Running the arena out fails the push rather than writing past the end.
+    u64 length = 0;
+    do {
+        length = darray_length(array);
+        darray_push(array, 0u);
+    } while (darray_length(array) > length);
+    expect_should_be(length, darray_capacity(array));
+    expect_to_be_true((length * sizeof(u32) < linear.total_size));
+
+    // Destroying is a no-op for the arena; everything goes with free_all.
+    darray_destroy(array);
+    linear_allocator_free_all(&linear);
+    expect_should_be(0, linear.allocated);
+
+    linear_allocator_destroy(&linear);
+    memory_system_shutdown();
+    return true;
+}
+
+u8 allocator_hashtable_should_live_in_frame_arena() 
+{
+    frame_arena arena;
+    frame_arena_create(1024, &arena);
+    frame_arena_begin_frame(&arena);
+    allocator_interface frame = allocator_interface_from_frame_arena(&arena);
+
+    hashtable table;
+    expect_to_be_true(hashtable_create_with_allocator(sizeof(u64), 16, false, &frame, &table));
+    expect_should_be(&frame, table.allocator);
+    u64 memory_requirement = 0;
+    hashtable_create(sizeof(u64), 16, false, &memory_requirement, 0, 0);
+    expect_should_be(memory_requirement, arena.allocators[arena.current].allocated);
+
+    u64 value = 42;
+    expect_to_be_true(hashtable_set(&table, "answer", &value));
+    u64 out_value = 0;
+    expect_to_be_true(hashtable_get(&table, "answer", &out_value));
+    expect_should_be(42, out_value);
+
+    hashtable_destroy(&table);
+    expect_should_be(0, table.memory);
+    expect_should_be(0, table.allocator);
+
+    // Too large for the frame's buffer.
+    expect_to_be_false(hashtable_create_with_allocator(sizeof(u64), 1024, false, &frame, &table));
+
+    frame_arena_destroy(&arena);
+    return true;
+}
+
+u8 allocator_pool_interface_should_hand_out_slots() 
+{
+    pool_allocator pool;
+    u64 memory_requirement = 0;
+    pool_allocator_create(64, 4, &memory_requirement, 0, &pool);
+    void* memory = lallocate(memory_requirement, MEMORY_TAG_ARRAY);
+    expect_to_be_true(pool_allocator_create(64, 4, &memory_requirement, memory, &pool));
+    allocator_interface slots = allocator_interface_from_pool(&pool);
+
+    void* a = allocator_allocate(&slots, 48, 8);
+    expect_should_not_be(0, a);
+    expect_should_be(3, pool.free_count);
+
+    // Fits in the slot, so stays put. Anything larger cannot be served.
+    expect_should_be(a, allocator_reallocate(&slots, a, 48, 64, 8));
+    expect_should_be(0, allocator_reallocate(&slots, a, 64, 65, 8));
+    expect_should_be(0, allocator_allocate(&slots, 65, 8));
+
+    allocator_free(&slots, a, 64, 8);
+    expect_should_be(4, pool.free_count);
+
+    pool_allocator_destroy(&pool);
+    lfree(memory, memory_requirement, MEMORY_TAG_ARRAY);
+    return true;
+}
+
+u8 allocator_default_interface_should_use_memory_system() 
+{
+    memory_system_configuration config = {0};
+    config.total_alloc_size = MEBIBYTES(8);
+    config.allocator_type = DYNAMIC_ALLOCATOR_TYPE_TLSF;
+    expect_to_be_true(memory_system_initialize(config));
+
+    allocator_interface heap = allocator_interface_default(MEMORY_TAG_DARRAY);
+    u64 base = get_memory_usage_for_tag(MEMORY_TAG_DARRAY);
+
+    u64* array = darray_reserve_with_allocator(u64, 8, &heap);
+    expect_should_not_be(0, array);
+    expect_should_be(base + (DARRAY_FIELD_LENGTH + 8) * sizeof(u64), get_memory_usage_for_tag(MEMORY_TAG_DARRAY));
+    for (u64 i = 0; i < 20; ++i) {
+        darray_push(array, i);
+    }
+    for (u64 i = 0; i < 20; ++i) {
+        expect_should_be(i, array[i]);
+    }
+    darray_destroy(array);
+    expect_should_be(base, get_memory_usage_for_tag(MEMORY_TAG_DARRAY));
+
+    // Over-aligned blocks take the copying path when resized.
+    u8* block = allocator_allocate(&heap, 100, 256);
+    expect_should_be(0, ((u64)block) % 256);
+    lset_memory(block, 0x5A, 100);
+    block = allocator_reallocate(&heap, block, 100, 1000, 256);
+    expect_should_be(0, ((u64)block) % 256);
+    for (u32 i = 0; i < 100; ++i) {
+        expect_should_be(0x5A, block[i]);
+    }
+    allocator_free(&heap, block, 1000, 256);
+    expect_should_be(base, get_memory_usage_for_tag(MEMORY_TAG_DARRAY));
+
+    memory_system_shutdown();
+    return true;
+}
+
+void allocator_register_tests() {
+    test_manager_register_test(allocator_darray_should_grow_in_linear_allocator, "Darray grows in place within a linear allocator");
+    test_manager_register_test(allocator_hashtable_should_live_in_frame_arena, "Hashtable can be created in a frame arena");
+    test_manager_register_test(allocator_pool_interface_should_hand_out_slots, "Pool allocator interface hands out and resizes slots");
+    test_manager_register_test(allocator_default_interface_should_use_memory_system, "Default allocator interface goes through the memory system");
+}
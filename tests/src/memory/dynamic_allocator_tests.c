@@ -6,6 +6,7 @@
 
 #include <core/lmemory.h>
 #include <memory/dynamic_allocator.h>
+#include <platform/platform.h>
 
 u8 dynamic_allocator_should_create_and_destroy() {
     dynamic_allocator alloc;
@@ -133,6 +134,310 @@ u8 dynamic_allocator_multi_allocation_all_space() {
     return true;
 }
 
+u8 dynamic_allocator_tlsf_single_allocation_all_space() {
+    dynamic_allocator alloc;
+    u64 memory_requirement = 0;
+    // Get the memory requirement
+    b8 result = dynamic_allocator_create_typed(DYNAMIC_ALLOCATOR_TYPE_TLSF, 1024, &memory_requirement, 0, 0);
+    expect_to_be_true(result);
+
+    // Actually create the allocator.
+    void* memory = lallocate(memory_requirement, MEMORY_TAG_APPLICATION);
+    result = dynamic_allocator_create_typed(DYNAMIC_ALLOCATOR_TYPE_TLSF, 1024, &memory_requirement, memory, &alloc);
+    expect_to_be_true(result);
+    expect_should_not_be(0, alloc.memory);
+    u64 free_space = dynamic_allocator_free_space(&alloc);
+    expect_should_be(1024, free_space);
+
+    // Allocate the whole thing.
+    void* block = dynamic_allocator_allocate(&alloc, 1024);
+    expect_should_not_be(0, block);
+
+    // Verify free space
+    free_space = dynamic_allocator_free_space(&alloc);
+    expect_should_be(0, free_space);
+
+    // Free the allocation
+    result = dynamic_allocator_free(&alloc, block, 1024);
+    expect_to_be_true(result);
+
+    // Verify free space.
+    free_space = dynamic_allocator_free_space(&alloc);
+    expect_should_be(1024, free_space);
+
+    // Destroy the allocator.
+    dynamic_allocator_destroy(&alloc);
+    expect_should_be(0, alloc.memory);
+    lfree(memory, memory_requirement, MEMORY_TAG_APPLICATION);
+    return true;
+}
+
+u8 dynamic_allocator_tlsf_multi_allocation_out_of_order_free() {
+    dynamic_allocator alloc;
+    u64 memory_requirement = 0;
+    dynamic_allocator_create_typed(DYNAMIC_ALLOCATOR_TYPE_TLSF, 1024, &memory_requirement, 0, 0);
+    void* memory = lallocate(memory_requirement, MEMORY_TAG_APPLICATION);
+    b8 result = dynamic_allocator_create_typed(DYNAMIC_ALLOCATOR_TYPE_TLSF, 1024, &memory_requirement, memory, &alloc);
+    expect_to_be_true(result);
+
+    // Allocate a few blocks of varying sizes.
+    void* block = dynamic_allocator_allocate(&alloc, 256);
+    expect_should_not_be(0, block);
+    void* block2 = dynamic_allocator_allocate(&alloc, 100);
+    expect_should_not_be(0, block2);
+    void* block3 = dynamic_allocator_allocate(&alloc, 256);
+    expect_should_not_be(0, block3);
+
+    // Blocks should be handed out aligned.
+    expect_should_be(0, ((u64)block2) % 16);
+
+    // Some space is used by block headers, so it should be strictly less than what was asked for.
+    u64 free_space = dynamic_allocator_free_space(&alloc);
+    b8 headers_accounted = free_space < 1024 - (256 + 100 + 256);
+    expect_to_be_true(headers_accounted);
+
+    // Free the allocations, out of order. Neighbours should be merged back together.
+    result = dynamic_allocator_free(&alloc, block2, 100);
+    expect_to_be_true(result);
+    result = dynamic_allocator_free(&alloc, block3, 256);
+    expect_to_be_true(result);
+    result = dynamic_allocator_free(&alloc, block, 256);
+    expect_to_be_true(result);
+
+    // Once merged, the entire space is available as a single block again.
+    free_space = dynamic_allocator_free_space(&alloc);
+    expect_should_be(1024, free_space);
+    block = dynamic_allocator_allocate(&alloc, 1024);
+    expect_should_not_be(0, block);
+    dynamic_allocator_free(&alloc, block, 1024);
+
+    // Double frees should be caught.
+    LDEBUG("The following warning and error messages are intentional.");
+    result = dynamic_allocator_free(&alloc, block, 1024);
+    expect_to_be_false(result);
+
+    dynamic_allocator_destroy(&alloc);
+    expect_should_be(0, alloc.memory);
+    lfree(memory, memory_requirement, MEMORY_TAG_APPLICATION);
+    return true;
+}
+
+u8 dynamic_allocator_tlsf_fragmented_allocations() {
+    const u64 total_size = 64 * 1024;
+    const u32 block_count = 256;
+    dynamic_allocator alloc;
+    u64 memory_requirement = 0;
+    dynamic_allocator_create_typed(DYNAMIC_ALLOCATOR_TYPE_TLSF, total_size, &memory_requirement, 0, 0);
+    void* memory = lallocate(memory_requirement, MEMORY_TAG_APPLICATION);
+    b8 result = dynamic_allocator_create_typed(DYNAMIC_ALLOCATOR_TYPE_TLSF, total_size, &memory_requirement, memory, &alloc);
+    expect_to_be_true(result);
+
+    // Fill a good portion of the space with small blocks of varying size.
+    void* blocks[256];
+    for (u32 i = 0; i < block_count; ++i) {
+        blocks[i] = dynamic_allocator_allocate(&alloc, 16 + (i % 7) * 24);
+        expect_should_not_be(0, blocks[i]);
+    }
+
+    // Free every other block, which fragments the pool.
+    for (u32 i = 0; i < block_count; i += 2) {
+        result = dynamic_allocator_free(&alloc, blocks[i], 16 + (i % 7) * 24);
+        expect_to_be_true(result);
+    }
+
+    // Each freed block is a separate hole, plus the untouched tail of the pool.
+    dynamic_allocator_stats stats;
+    result = dynamic_allocator_get_stats(&alloc, &stats);
+    expect_to_be_true(result);
+    expect_should_be(block_count / 2 + 1, stats.free_range_count);
+    expect_should_be(dynamic_allocator_free_space(&alloc), stats.total_free);
+    b8 fragmented = stats.fragmentation > 0.0f && stats.largest_free_block < stats.total_free;
+    expect_to_be_true(fragmented);
+
+    // Small allocations should be able to reuse the holes.
+    for (u32 i = 0; i < block_count; i += 2) {
+        blocks[i] = dynamic_allocator_allocate(&alloc, 16);
+        expect_should_not_be(0, blocks[i]);
+    }
+
+    // Free everything.
+    for (u32 i = 0; i < block_count; ++i) {
+        u64 size = (i % 2) ? 16 + (i % 7) * 24 : 16;
+        result = dynamic_allocator_free(&alloc, blocks[i], size);
+        expect_to_be_true(result);
+    }
+
+    // Everything should have been merged back into one block.
+    u64 free_space = dynamic_allocator_free_space(&alloc);
+    expect_should_be(total_size, free_space);
+    dynamic_allocator_get_stats(&alloc, &stats);
+    expect_should_be(1, stats.free_range_count);
+    expect_should_be(total_size, stats.largest_free_block);
+    expect_float_to_be(0.0f, stats.fragmentation);
+    void* block = dynamic_allocator_allocate(&alloc, total_size);
+    expect_should_not_be(0, block);
+    dynamic_allocator_free(&alloc, block, total_size);
+
+    dynamic_allocator_destroy(&alloc);
+    lfree(memory, memory_requirement, MEMORY_TAG_APPLICATION);
+    return true;
+}
+
+static u8 aligned_allocations_for_type(dynamic_allocator_type type) {
+    const u64 total_size = 64 * 1024;
+    dynamic_allocator alloc;
+    u64 memory_requirement = 0;
+    dynamic_allocator_create_typed(type, total_size, &memory_requirement, 0, 0);
+    void* memory = lallocate(memory_requirement, MEMORY_TAG_APPLICATION);
+    b8 result = dynamic_allocator_create_typed(type, total_size, &memory_requirement, memory, &alloc);
+    expect_to_be_true(result);
+
+    // Throw off the alignment of whatever comes next.
+    void* odd = dynamic_allocator_allocate(&alloc, 3);
+    expect_should_not_be(0, odd);
+
+    u16 alignments[4] = {16, 64, 256, 4096};
+    u64 sizes[4] = {48, 100, 1000, 512};
+    void* blocks[4];
+    for (u32 i = 0; i < 4; ++i) {
+        blocks[i] = dynamic_allocator_allocate_aligned(&alloc, sizes[i], alignments[i]);
+        expect_should_not_be(0, blocks[i]);
+        expect_should_be(0, ((u64)blocks[i]) % alignments[i]);
+        // The whole block should be usable.
+        lset_memory(blocks[i], 0xFF, sizes[i]);
+    }
+
+    // Non power of two alignments should be rejected.
+    LDEBUG("The following error message is intentional.");
+    void* bad = dynamic_allocator_allocate_aligned(&alloc, 64, 24);
+    expect_should_be(0, bad);
+
+    // Free everything. The alignment padding should have stayed free, so it all merges back together.
+    for (u32 i = 0; i < 4; ++i) {
+        result = dynamic_allocator_free(&alloc, blocks[i], sizes[i]);
+        expect_to_be_true(result);
+    }
+    result = dynamic_allocator_free(&alloc, odd, 3);
+    expect_to_be_true(result);
+
+    dynamic_allocator_stats stats;
+    dynamic_allocator_get_stats(&alloc, &stats);
+    expect_should_be(total_size, stats.total_free);
+    expect_should_be(1, stats.free_range_count);
+
+    dynamic_allocator_destroy(&alloc);
+    lfree(memory, memory_requirement, MEMORY_TAG_APPLICATION);
+    return true;
+}
+
+u8 dynamic_allocator_aligned_allocations() {
+    return aligned_allocations_for_type(DYNAMIC_ALLOCATOR_TYPE_FREELIST);
+}
+
+u8 dynamic_allocator_tlsf_aligned_allocations() {
+    return aligned_allocations_for_type(DYNAMIC_ALLOCATOR_TYPE_TLSF);
+}
+
+static u8 reserved_allocations_for_type(dynamic_allocator_type type) {
+    const u64 total_size = 4 * 1024 * 1024;
+    const u64 block_size = 256 * 1024;
+    dynamic_allocator alloc;
+    u64 memory_requirement = 0;
+    dynamic_allocator_create_reserved(type, total_size, &memory_requirement, 0, 0);
+    void* memory = platform_reserve_memory(memory_requirement);
+    expect_should_not_be(0, memory);
+    b8 result = dynamic_allocator_create_reserved(type, total_size, &memory_requirement, memory, &alloc);
+    expect_to_be_true(result);
+    expect_should_be(total_size, dynamic_allocator_free_space(&alloc));
+
+    // Allocate well past the initial commit. Every byte handed out should be accessible, and read as zero.
+    void* blocks[8];
+    for (u32 i = 0; i < 8; ++i) {
+        blocks[i] = dynamic_allocator_allocate_aligned(&alloc, block_size, 16);
+        expect_should_not_be(0, blocks[i]);
+        u8* bytes = blocks[i];
+        expect_should_be(0, bytes[block_size - 1]);
+        lset_memory(blocks[i], 0xFF, block_size);
+    }
+
+    for (u32 i = 0; i < 8; ++i) {
+        result = dynamic_allocator_free(&alloc, blocks[i], block_size);
+        expect_to_be_true(result);
+    }
+
+    // Committed or not, everything should be free again, and in one piece.
+    dynamic_allocator_stats stats;
+    dynamic_allocator_get_stats(&alloc, &stats);
+    expect_should_be(total_size, stats.total_free);
+    expect_should_be(total_size, stats.largest_free_block);
+
+    dynamic_allocator_destroy(&alloc);
+    platform_release_memory(memory, memory_requirement);
+    return true;
+}
+
+u8 dynamic_allocator_reserved_allocations() {
+    return reserved_allocations_for_type(DYNAMIC_ALLOCATOR_TYPE_FREELIST);
+}
+
+u8 dynamic_allocator_tlsf_reserved_allocations() {
+    return reserved_allocations_for_type(DYNAMIC_ALLOCATOR_TYPE_TLSF);
+}
+
+static u8 resize_in_place_for_type(dynamic_allocator_type type) {
+    const u64 total_size = 64 * 1024;
+    dynamic_allocator alloc;
+    u64 memory_requirement = 0;
+    dynamic_allocator_create_typed(type, total_size, &memory_requirement, 0, 0);
+    void* memory = lallocate(memory_requirement, MEMORY_TAG_APPLICATION);
+    b8 result = dynamic_allocator_create_typed(type, total_size, &memory_requirement, memory, &alloc);
+    expect_to_be_true(result);
+
+    void* a = dynamic_allocator_allocate(&alloc, 256);
+    void* b = dynamic_allocator_allocate(&alloc, 256);
+    void* c = dynamic_allocator_allocate(&alloc, 256);
+    expect_should_not_be(0, c);
+    lset_memory(a, 0xAB, 256);
+
+    // Nothing free after a, so it cannot grow.
+    expect_to_be_false(dynamic_allocator_resize(&alloc, a, 256, 512));
+
+    // Once b is freed, a can grow into its space, but not past c.
+    dynamic_allocator_free(&alloc, b, 256);
+    expect_to_be_true(dynamic_allocator_resize(&alloc, a, 256, 512));
+    expect_to_be_false(dynamic_allocator_resize(&alloc, a, 512, 1024));
+    u8* bytes = a;
+    expect_should_be(0xAB, bytes[255]);
+    lset_memory(a, 0xCD, 512);
+
+    // Shrinking always works, and the space given back can be used again.
+    expect_to_be_true(dynamic_allocator_resize(&alloc, a, 512, 128));
+    expect_should_be(0xCD, bytes[127]);
+    void* d = dynamic_allocator_allocate(&alloc, 256);
+    expect_to_be_true(((u8*)d > bytes && (u8*)d < (u8*)c));
+
+    dynamic_allocator_free(&alloc, d, 256);
+    dynamic_allocator_free(&alloc, c, 256);
+    dynamic_allocator_free(&alloc, a, 128);
+
+    dynamic_allocator_stats stats;
+    dynamic_allocator_get_stats(&alloc, &stats);
+    expect_should_be(total_size, stats.total_free);
+    expect_should_be(1, stats.free_range_count);
+
+    dynamic_allocator_destroy(&alloc);
+    lfree(memory, memory_requirement, MEMORY_TAG_APPLICATION);
+    return true;
+}
+
+u8 dynamic_allocator_resize_in_place() {
+    return resize_in_place_for_type(DYNAMIC_ALLOCATOR_TYPE_FREELIST);
+}
+
+u8 dynamic_allocator_tlsf_resize_in_place() {
+    return resize_in_place_for_type(DYNAMIC_ALLOCATOR_TYPE_TLSF);
+}
+
 /*
 u8 dynamic_allocator_multi_allocation_over_allocate() {
     u64 max_allocs = 3;
@@ -178,6 +483,15 @@ void dynamic_allocator_register_tests() {
     test_manager_register_test(dynamic_allocator_should_create_and_destroy, "Dynamic allocator should create and destroy");
     test_manager_register_test(dynamic_allocator_single_allocation_all_space, "Dynamic allocator single alloc for all space");
     test_manager_register_test(dynamic_allocator_multi_allocation_all_space, "Dynamic allocator multi alloc for all space");
+    test_manager_register_test(dynamic_allocator_tlsf_single_allocation_all_space, "Dynamic allocator (TLSF) single alloc for all space");
+    test_manager_register_test(dynamic_allocator_tlsf_multi_allocation_out_of_order_free, "Dynamic allocator (TLSF) multi alloc, free out of order and merge");
+    test_manager_register_test(dynamic_allocator_tlsf_fragmented_allocations, "Dynamic allocator (TLSF) reuse fragmented space and merge");
+    test_manager_register_test(dynamic_allocator_aligned_allocations, "Dynamic allocator aligned allocations");
+    test_manager_register_test(dynamic_allocator_tlsf_aligned_allocations, "Dynamic allocator (TLSF) aligned allocations");
+    test_manager_register_test(dynamic_allocator_reserved_allocations, "Dynamic allocator commits reserved memory on demand");
+    test_manager_register_test(dynamic_allocator_tlsf_reserved_allocations, "Dynamic allocator (TLSF) commits reserved memory on demand");
+    test_manager_register_test(dynamic_allocator_resize_in_place, "Dynamic allocator resizes blocks in place");
+    test_manager_register_test(dynamic_allocator_tlsf_resize_in_place, "Dynamic allocator (TLSF) resizes blocks in place");
     //test_manager_register_test(dynamic_allocator_multi_allocation_over_allocate, "Dynamic allocator try over allocate");
     //test_manager_register_test(dynamic_allocator_multi_allocation_all_space_then_free, "Dynamic allocator allocated should be 0 after free_all");
 }
\ No newline at end of file
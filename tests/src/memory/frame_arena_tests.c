@@ -0,0 +1,91 @@
+#include "frame_arena_tests.h"
+#include "../test_manager.h"
+#include "../expect.h"
+
+#include <defines.h>
+#include <core/lmemory.h>
+#include <memory/frame_arena.h>
+
+u8 frame_arena_should_create_and_destroy() 
+{
+    frame_arena arena;
+    frame_arena_create(1024, &arena);
+
+    for (u32 i = 0; i < FRAME_ARENA_BUFFER_COUNT; ++i) {
+        expect_should_not_be(0, arena.allocators[i].memory);
+        expect_should_be(1024, arena.allocators[i].total_size);
+        expect_should_be(0, arena.allocators[i].allocated);
+    }
+
+    frame_arena_destroy(&arena);
+    for (u32 i = 0; i < FRAME_ARENA_BUFFER_COUNT; ++i) {
+        expect_should_be(0, arena.allocators[i].memory);
+    }
+
+    return true;
+}
+
+u8 frame_arena_should_keep_previous_frame_alive() 
+{
+    frame_arena arena;
+    frame_arena_create(1024, &arena);
+
+    // Frame 0.
+    frame_arena_begin_frame(&arena);
+    u8* first = frame_arena_allocate(&arena, 24);
+    expect_should_not_be(0, first);
+    expect_should_be(0, ((u64)first) % LMEMORY_DEFAULT_ALIGNMENT);
+    lset_memory(first, 0xAB, 24);
+
+    // Blocks within a frame are aligned, even after odd sizes.
+    u8* second = frame_arena_allocate(&arena, 40);
+    expect_should_be(0, ((u64)second) % LMEMORY_DEFAULT_ALIGNMENT);
+
+    // Frame 1. The previous frame's data must be untouched.
+    frame_arena_begin_frame(&arena);
+    u8* other = frame_arena_allocate(&arena, 24);
+    expect_should_not_be(first, other);
+    expect_should_be(0xAB, first[0]);
+    expect_should_be(0xAB, first[23]);
+
+    // Frame 2 reuses frame 0's buffer, which comes back zeroed.
+    frame_arena_begin_frame(&arena);
+    u8* reused = frame_arena_allocate(&arena, 24);
+    expect_should_be(first, reused);
+    expect_should_be(0, reused[0]);
+    expect_should_be(0, reused[23]);
+
+    // The largest frame so far used both of frame 0's blocks.
+    expect_should_be(72, arena.peak_allocated);
+
+    frame_arena_destroy(&arena);
+    return true;
+}
+
+u8 frame_arena_should_fail_when_exhausted() 
+{
+    frame_arena arena;
+    frame_arena_create(64, &arena);
+    frame_arena_begin_frame(&arena);
+
+    void* block = frame_arena_allocate(&arena, 64);
+    expect_should_not_be(0, block);
+
+    LDEBUG("Note: The following errors are intentionally caused by this test.");
+    block = frame_arena_allocate(&arena, 1);
+    expect_should_be(0, block);
+
+    // The next frame has its own buffer.
+    frame_arena_begin_frame(&arena);
+    block = frame_arena_allocate(&arena, 64);
+    expect_should_not_be(0, block);
+
+    frame_arena_destroy(&arena);
+    return true;
+}
+
+void frame_arena_register_tests() {
+    test_manager_register_test(frame_arena_should_create_and_destroy, "Frame arena should create and destroy");
+    test_manager_register_test(frame_arena_should_keep_previous_frame_alive, "Frame arena keeps the previous frame alive and resets older ones");
+    test_manager_register_test(frame_arena_should_fail_when_exhausted, "Frame arena fails to allocate past its per-frame size");
+}
@@ -5,6 +5,8 @@
 #include <defines.h>
 
 #include <memory/linear_allocator.h>
+#include <core/lmemory.h>
+#include <core/logger.h>
 
 u8 linear_allocator_should_create_and_destroy() 
 {
@@ -113,6 +115,119 @@ u8 linear_allocator_multi_allocation_all_space_then_free()
     return true;
 }
 
+u8 linear_allocator_rewind_to_marker() 
+{
+    linear_allocator alloc;
+    linear_allocator_create(sizeof(u64) * 8, 0, &alloc);
+
+    void* first = linear_allocator_allocate(&alloc, sizeof(u64));
+    expect_should_not_be(0, first);
+
+    linear_allocator_marker marker = linear_allocator_get_marker(&alloc);
+    expect_should_be(sizeof(u64), marker.allocated);
+
+    u64* second = linear_allocator_allocate(&alloc, sizeof(u64) * 4);
+    expect_should_not_be(0, second);
+    second[0] = 42;
+    expect_should_be(sizeof(u64) * 5, alloc.allocated);
+
+    // Rewinding should release only what came after the marker, and zero it.
+    expect_to_be_true(linear_allocator_rewind(&alloc, marker));
+    expect_should_be(sizeof(u64), alloc.allocated);
+    expect_should_be(0, second[0]);
+
+    // The same memory should be handed out again.
+    void* third = linear_allocator_allocate(&alloc, sizeof(u64));
+    expect_should_be(second, third);
+
+    linear_allocator_destroy(&alloc);
+
+    return true;
+}
+
+u8 linear_allocator_nested_scopes() 
+{
+    linear_allocator alloc;
+    linear_allocator_create(sizeof(u64) * 8, 0, &alloc);
+
+    linear_allocator_scope outer = linear_allocator_scope_begin(&alloc);
+    linear_allocator_allocate(&alloc, sizeof(u64) * 2);
+
+    linear_allocator_scope inner = linear_allocator_scope_begin(&alloc);
+    linear_allocator_allocate(&alloc, sizeof(u64) * 3);
+    expect_should_be(sizeof(u64) * 5, alloc.allocated);
+    linear_allocator_scope_end(&inner);
+
+    expect_should_be(sizeof(u64) * 2, alloc.allocated);
+    linear_allocator_scope_end(&outer);
+    expect_should_be(0, alloc.allocated);
+
+    linear_allocator_destroy(&alloc);
+
+    return true;
+}
+
+u8 linear_allocator_chained_overflow() 
+{
+    u64 max_allocs = 3;
+    linear_allocator alloc;
+    linear_allocator_create_chained(sizeof(u64) * max_allocs, 0, &alloc);
+
+    for (u64 i = 0; i < max_allocs; ++i) {
+        expect_should_not_be(0, linear_allocator_allocate(&alloc, sizeof(u64)));
+    }
+    linear_allocator_marker marker = linear_allocator_get_marker(&alloc);
+
+    // Overflowing should chain a new block rather than fail, including for requests larger than the block size.
+    u64* block = linear_allocator_allocate(&alloc, sizeof(u64));
+    expect_should_not_be(0, block);
+    expect_should_not_be(0, alloc.overflow);
+    u64* large = linear_allocator_allocate(&alloc, sizeof(u64) * 16);
+    expect_should_not_be(0, large);
+    large[15] = 7;
+    expect_should_be(sizeof(u64) * max_allocs, alloc.allocated);
+
+    // Rewinding back to the full first block should release the chained blocks.
+    expect_to_be_true(linear_allocator_rewind(&alloc, marker));
+    expect_should_be(0, alloc.overflow);
+    expect_should_be(sizeof(u64) * max_allocs, alloc.allocated);
+
+    // Chain again, then make sure free_all releases the chain too.
+    expect_should_not_be(0, linear_allocator_allocate(&alloc, sizeof(u64)));
+    expect_should_not_be(0, alloc.overflow);
+    linear_allocator_free_all(&alloc);
+    expect_should_be(0, alloc.overflow);
+    expect_should_be(0, alloc.allocated);
+
+    linear_allocator_destroy(&alloc);
+
+    return true;
+}
+
+u8 linear_allocator_chained_out_of_memory() 
+{
+    memory_system_configuration config = {0};
+    config.total_alloc_size = MEBIBYTES(1);
+    config.allocator_type = DYNAMIC_ALLOCATOR_TYPE_TLSF;
+    expect_to_be_true(memory_system_initialize(config));
+
+    linear_allocator alloc;
+    linear_allocator_create_chained(sizeof(u64), 0, &alloc);
+    expect_should_not_be(0, linear_allocator_allocate(&alloc, sizeof(u64)));
+
+    // A block which cannot be chained fails the allocation, and leaves the chain as it was.
+    LDEBUG("Note: The following errors are intentionally caused by this test.");
+    expect_should_be(0, linear_allocator_allocate(&alloc, MEBIBYTES(2)));
+    expect_should_be(0, alloc.overflow);
+    expect_should_not_be(0, linear_allocator_allocate(&alloc, sizeof(u64)));
+    expect_should_not_be(0, alloc.overflow);
+
+    linear_allocator_destroy(&alloc);
+    memory_system_shutdown();
+
+    return true;
+}
+
 void linear_allocator_register_tests() {
     test_manager_register_test(
         linear_allocator_should_create_and_destroy, 
@@ -134,8 +249,28 @@ void linear_allocator_register_tests() {
         "Linear allocator try over allocate"
     );
     
-    // test_manager_register_test(
-    //     linear_allocator_multi_allocation_all_space_then_free, 
-    //     "Linear allocator allocated should be 0 after free_all"
-    // );
+    test_manager_register_test(
+        linear_allocator_multi_allocation_all_space_then_free, 
+        "Linear allocator allocated should be 0 after free_all"
+    );
+
+    test_manager_register_test(
+        linear_allocator_rewind_to_marker, 
+        "Linear allocator should rewind to a marker"
+    );
+
+    test_manager_register_test(
+        linear_allocator_nested_scopes, 
+        "Linear allocator nested scopes release in LIFO order"
+    );
+
+    test_manager_register_test(
+        linear_allocator_chained_overflow, 
+        "Linear allocator chained overflow and release"
+    );
+
+    test_manager_register_test(
+        linear_allocator_chained_out_of_memory, 
+        "Linear allocator chained overflow fails when out of memory"
+    );
 }
\ No newline at end of file
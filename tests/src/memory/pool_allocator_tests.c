@@ -0,0 +1,121 @@
+#include "pool_allocator_tests.h"
+#include "../test_manager.h"
+#include "../expect.h"
+
+#include <defines.h>
+#include <core/lmemory.h>
+#include <memory/pool_allocator.h>
+
+typedef struct pool_test_element {
+    u64 a;
+    u32 b;
+} pool_test_element;
+
+u8 pool_allocator_should_create_and_destroy()
+{
+    pool_allocator pool;
+    u64 memory_requirement = 0;
+    expect_to_be_true(pool_allocator_create(sizeof(pool_test_element), 16, &memory_requirement, 0, &pool));
+    expect_should_not_be(0, memory_requirement);
+
+    void* block = lallocate(memory_requirement, MEMORY_TAG_APPLICATION);
+    expect_to_be_true(pool_allocator_create(sizeof(pool_test_element), 16, &memory_requirement, block, &pool));
+    expect_should_be(block, pool.elements);
+    expect_should_be(16, pool.capacity);
+    expect_should_be(16, pool.free_count);
+
+    pool_allocator_destroy(&pool);
+    expect_should_be(0, pool.elements);
+    expect_should_be(0, pool.capacity);
+
+    lfree(block, memory_requirement, MEMORY_TAG_APPLICATION);
+
+    return true;
+}
+
+u8 pool_allocator_allocate_until_full_and_reuse()
+{
+    const u32 capacity = 8;
+    pool_allocator pool;
+    u64 memory_requirement = 0;
+    pool_allocator_create(sizeof(pool_test_element), capacity, &memory_requirement, 0, &pool);
+    void* block = lallocate(memory_requirement, MEMORY_TAG_APPLICATION);
+    pool_allocator_create(sizeof(pool_test_element), capacity, &memory_requirement, block, &pool);
+
+    // Slots should be handed out lowest index first, and line up with the element array.
+    pool_test_element* elements = pool.elements;
+    for (u32 i = 0; i < capacity; ++i) {
+        u32 index = INVALID_ID;
+        pool_test_element* e = pool_allocator_allocate(&pool, &index);
+        expect_should_be(i, index);
+        expect_should_be(&elements[i], e);
+        expect_should_be(e, pool_allocator_get(&pool, index));
+        expect_to_be_true(pool_allocator_is_allocated(&pool, index));
+        e->a = i;
+    }
+    expect_should_be(0, pool.free_count);
+
+    // The pool is full.
+    LDEBUG("Note: The following error is intentionally caused by this test.");
+    expect_should_be(0, pool_allocator_allocate(&pool, 0));
+
+    // The most recently released slot should be the next handed out.
+    expect_to_be_true(pool_allocator_free(&pool, 5));
+    expect_to_be_true(pool_allocator_free(&pool, 2));
+    expect_to_be_false(pool_allocator_is_allocated(&pool, 2));
+    expect_should_be(2, pool.free_count);
+
+    u32 index = INVALID_ID;
+    pool_allocator_allocate(&pool, &index);
+    expect_should_be(2, index);
+    pool_allocator_allocate(&pool, &index);
+    expect_should_be(5, index);
+
+    // Contents are left untouched.
+    expect_should_be(5, elements[5].a);
+
+    pool_allocator_destroy(&pool);
+    lfree(block, memory_requirement, MEMORY_TAG_APPLICATION);
+
+    return true;
+}
+
+u8 pool_allocator_rejects_double_and_invalid_free()
+{
+    pool_allocator pool;
+    u64 memory_requirement = 0;
+    pool_allocator_create(sizeof(u32), 4, &memory_requirement, 0, &pool);
+    void* block = lallocate(memory_requirement, MEMORY_TAG_APPLICATION);
+    pool_allocator_create(sizeof(u32), 4, &memory_requirement, block, &pool);
+
+    u32 index = INVALID_ID;
+    pool_allocator_allocate(&pool, &index);
+    expect_to_be_true(pool_allocator_free(&pool, index));
+
+    LDEBUG("Note: The following warning and error are intentionally caused by this test.");
+    expect_to_be_false(pool_allocator_free(&pool, index));
+    expect_to_be_false(pool_allocator_free(&pool, 4));
+    expect_should_be(4, pool.free_count);
+
+    pool_allocator_destroy(&pool);
+    lfree(block, memory_requirement, MEMORY_TAG_APPLICATION);
+
+    return true;
+}
+
+void pool_allocator_register_tests() {
+    test_manager_register_test(
+        pool_allocator_should_create_and_destroy,
+        "Pool allocator should create and destroy"
+    );
+
+    test_manager_register_test(
+        pool_allocator_allocate_until_full_and_reuse,
+        "Pool allocator allocate until full, then reuse freed slots"
+    );
+
+    test_manager_register_test(
+        pool_allocator_rejects_double_and_invalid_free,
+        "Pool allocator rejects double and out of range frees"
+    );
+}